@@ -41,6 +41,7 @@
 WEAKFUNC(SQLAllocConnect)
 WEAKFUNC(SQLAllocEnv)
 WEAKFUNC(SQLAllocStmt)
+WEAKFUNC(SQLBindCol)
 WEAKFUNC(SQLBindParameter)
 WEAKFUNC(SQLCancel)
 WEAKFUNC(SQLDescribeParam)
@@ -57,8 +58,11 @@ WEAKFUNC(SQLGetStmtOption)
 WEAKFUNC(SQLMoreResults)
 WEAKFUNC(SQLNumParams)
 WEAKFUNC(SQLNumResultCols)
+WEAKFUNC(SQLParamData)
+WEAKFUNC(SQLPutData)
 WEAKFUNC(SQLRowCount)
 WEAKFUNC(SQLSetEnvAttr)
+WEAKFUNC(SQLSetPos)
 WEAKFUNC(SQLSetStmtOption)
 WEAKFUNC(SQLTransact)
 WEAKFUNC(SQLEndTran)
@@ -87,6 +91,8 @@ WEAKFUNC(SQLGetCursorName)
 WEAKFUNC(SQLGetCursorNameW)
 WEAKFUNC(SQLGetInfo)
 WEAKFUNC(SQLGetInfoW)
+WEAKFUNC(SQLGetStmtAttr)
+WEAKFUNC(SQLGetStmtAttrW)
 WEAKFUNC(SQLGetTypeInfo)
 WEAKFUNC(SQLGetTypeInfoW)
 WEAKFUNC(SQLPrepare)
@@ -99,8 +105,12 @@ WEAKFUNC(SQLProcedures)
 WEAKFUNC(SQLProceduresW)
 WEAKFUNC(SQLSetConnectOption)
 WEAKFUNC(SQLSetConnectOptionW)
+WEAKFUNC(SQLSetDescField)
+WEAKFUNC(SQLSetDescFieldW)
 WEAKFUNC(SQLSetCursorName)
 WEAKFUNC(SQLSetCursorNameW)
+WEAKFUNC(SQLSetStmtAttr)
+WEAKFUNC(SQLSetStmtAttrW)
 WEAKFUNC(SQLSpecialColumns)
 WEAKFUNC(SQLSpecialColumnsW)
 WEAKFUNC(SQLStatistics)
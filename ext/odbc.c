@@ -18,10 +18,32 @@
 #endif
 #include <stdarg.h>
 #include <ctype.h>
+#include <time.h>
+#include <math.h>
+#include <errno.h>
+#if !defined(_WIN32) || defined(__CYGWIN32__)
+#include <unistd.h>
+#endif
 #include "ruby.h"
 #ifdef HAVE_VERSION_H
 #include "version.h"
 #endif
+#ifdef HAVE_MMAP
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#endif
+#ifdef HAVE_RUBY_THREAD_H
+#include "ruby/thread.h"
+#endif
+#ifdef HAVE_RUBY_FIBER_SCHEDULER_H
+#include "ruby/fiber/scheduler.h"
+#endif
+#ifdef HAVE_RUBY_ST_H
+#include "ruby/st.h"
+#else
+#include "st.h"
+#endif
 #ifdef HAVE_SQL_H
 #include <sql.h>
 #else
@@ -38,6 +60,16 @@
 
 #ifdef UNICODE
 #include <sqlucode.h>
+#if defined(HAVE_EMMINTRIN_H) && defined(__SSE2__)
+#include <emmintrin.h>
+#define USE_SSE2 1
+#endif
+#if defined(HAVE_IMMINTRIN_H) && defined(__GNUC__) && \
+    ((__GNUC__ >= 5) || defined(__clang__)) && \
+    (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define USE_AVX2 1
+#endif
 #endif
 
 static const char *VERSION = "0.99994";
@@ -117,17 +149,20 @@ static VALUE rb_encv = Qnil;
     rb_undef_method(CLASS_OF(cls), "new")
 #endif
 
-#ifdef RB_CVAR_SET_4ARGS
-#define CVAR_SET(x, y, z) rb_cvar_set(x, y, z, 0)
-#else
-#define CVAR_SET(x, y, z) rb_cvar_set(x, y, z)
-#endif
-
 #ifndef STR2CSTR
 #define STR2CSTR(x) StringValueCStr(x)
 #define NO_RB_STR2CSTR 1
 #endif
 
+#ifndef RSTRING_PTR
+#define RSTRING_PTR(x) (RSTRING(x)->ptr)
+#define RSTRING_LEN(x) (RSTRING(x)->len)
+#endif
+
+#ifndef RARRAY_LEN
+#define RARRAY_LEN(x) (RARRAY(x)->len)
+#endif
+
 #ifdef TRACING
 static int tracing = 0;
 #define tracemsg(t, x) {if (tracing & t) { x }}
@@ -147,6 +182,59 @@ static SQLRETURN tracesql(SQLHENV henv, SQLHDBC hdbc, SQLHSTMT hstmt,
 #define SQL_NO_DATA SQL_NO_DATA_FOUND
 #endif
 
+#if defined(HAVE_RB_THREAD_CALL_WITHOUT_GVL2) || \
+    defined(HAVE_RB_THREAD_CALL_WITHOUT_GVL)
+#define USE_NOGVL 1
+#endif
+
+#if defined(HAVE_RB_FIBER_SCHEDULER_CURRENT) && (ODBCVER >= 0x0300)
+#define USE_FIBER_ASYNC 1
+#endif
+
+#ifdef HAVE_RB_DATA_TYPE_T_FUNCTION
+#define USE_TYPEDDATA 1
+#endif
+
+/*
+ * Wrapping of ENV, DBC, STMT, and POOL structs, typed data
+ * objects provide memory sizes to the garbage collector.
+ */
+
+#ifdef USE_TYPEDDATA
+#define ODBC_Make_Struct(klass, type, dtype, mark, free, ptr) \
+    TypedData_Make_Struct(klass, type, &dtype, ptr)
+#define ODBC_Get_Struct(obj, type, dtype, ptr) \
+    TypedData_Get_Struct(obj, type, &dtype, ptr)
+/*
+ * Environments, connections and statements are released through the
+ * driver (SQLDisconnect() may take a network round trip), which must
+ * not stall the GC sweep, thus only pools are freed immediately.
+ */
+#define ODBC_TYPED_FLAGS 0, 0
+#ifdef RUBY_TYPED_FREE_IMMEDIATELY
+#define ODBC_TYPED_FLAGS_IMM 0, 0, RUBY_TYPED_FREE_IMMEDIATELY
+#else
+#define ODBC_TYPED_FLAGS_IMM 0, 0
+#endif
+#else
+#define ODBC_Make_Struct(klass, type, dtype, mark, free, ptr) \
+    Data_Make_Struct(klass, type, mark, free, ptr)
+#define ODBC_Get_Struct(obj, type, dtype, ptr) \
+    Data_Get_Struct(obj, type, ptr)
+#endif
+
+/*
+ * Number of fetches after which a full GC is forced, 0 disables it.
+ * Kept as fallback for Rubies lacking typed data objects, which
+ * cannot account for memory held by the extension otherwise.
+ */
+
+#ifdef USE_TYPEDDATA
+static int gcinterval = 0;
+#else
+static int gcinterval = 500;
+#endif
+
 typedef struct link {
     struct link *succ;
     struct link *pred;
@@ -160,6 +248,20 @@ typedef struct env {
     SQLHENV henv;
 } ENV;
 
+/* Performance counters, see stats_call(). */
+
+typedef struct {
+    unsigned long executes;
+    unsigned long prepares;
+    unsigned long fetches;
+    unsigned long rows;
+    unsigned long getdata;
+    unsigned long lobbytes;
+    unsigned long withinfo;
+    double drvtime;
+    double convtime;
+} STATS;
+
 typedef struct dbc {
     LINK link;
     VALUE self;
@@ -170,6 +272,24 @@ typedef struct dbc {
     VALUE rbtime;
     VALUE gmtime;
     int upc;
+    int bigdec;
+    int rssize;
+    LINK scache;
+    int sccap;
+    int sccount;
+    long schits;
+    long scmisses;
+    long scevicts;
+    VALUE pool;
+    double pooltime;
+    int tzvalid;
+    time_t tzhour;
+    time_t tzoff;
+    VALUE error;
+    VALUE info;
+    int warnings;
+    STATS stats;
+    int busy;
 } DBC;
 
 typedef struct {
@@ -183,19 +303,30 @@ typedef struct {
     int override;
 #ifdef UNICODE
     SQLWCHAR *tofree;
+    SQLWCHAR *ucbuf;
+    int ucsize;
 #endif
     char buffer[sizeof (double) * 4 + sizeof (TIMESTAMP_STRUCT)];
     SQLSMALLINT ctype;
     SQLSMALLINT outtype;
     int outsize;
     char *outbuf;
+    VALUE stream;
+    VALUE strval;
 } PARAMINFO;
 
 typedef struct {
     int type;
     int size;
+    int sqltype;
+    int conv;
 } COLTYPE;
 
+/* Conversions of SQL_C_CHAR column values */
+#define COLCONV_NONE   0
+#define COLCONV_INT    1
+#define COLCONV_BIGDEC 2
+
 typedef struct stmt {
     LINK link;
     VALUE self;
@@ -206,19 +337,82 @@ typedef struct stmt {
     PARAMINFO *paraminfo;
     int ncols;
     COLTYPE *coltypes;
+    int bigdec;
+    int ndesc;
+    COLTYPE *desc;
     char **colnames;
     VALUE *colvals;
+    VALUE *colsyms;
+    VALUE *rowkv;
     char **dbufs;
+    size_t bufsize;
     int fetchc;
     int upc;
     int usef;
+    int rssize;
+    int rsmode;
+    int rsgd;
+    int rsmax;
+    SQLULEN rsrows;
+    SQLULEN rspos;
+    char **rsbufs;
+    SQLLEN *rslens;
+    SQLUSMALLINT *rsstat;
+    size_t rsbufsize;
+    VALUE sckey;
+    VALUE scopts;
+    unsigned long schash;
+    LINK sclink;
+    VALUE error;
+    VALUE info;
+    SQLHSTMT diagh;
+    STATS stats;
+    int busy;
+    int lazyinfo;
+    int async;
 } STMT;
 
+typedef struct pool {
+    VALUE self;
+    VALUE env;
+    VALUE dsn;
+    VALUE user;
+    VALUE passwd;
+    VALUE idle;
+    VALUE waiters;
+    int min;
+    int max;
+    int count;
+    int busy;
+    int validate;
+    int closed;
+    double timeout;
+    double idletime;
+    long waits;
+    double waittime;
+    long creations;
+    long timeouts;
+    long discards;
+    long reaped;
+} POOL;
+
+#ifdef USE_TYPEDDATA
+static const rb_data_type_t env_type;
+static const rb_data_type_t dbc_type;
+static const rb_data_type_t stmt_type;
+static const rb_data_type_t pool_type;
+#endif
+
+/* Performance counters of all connections and statements. */
+
+static STATS stats_total;
+
 static VALUE Modbc;
 static VALUE Cobj;
 static VALUE Cenv;
 static VALUE Cdbc;
 static VALUE Cstmt;
+static VALUE Cpool;
 static VALUE Ccolumn;
 static VALUE Cparam;
 static VALUE Cerror;
@@ -231,8 +425,8 @@ static VALUE Cproc;
 static VALUE rb_cDate;
 
 static ID IDstart;
-static ID IDatatinfo;
-static ID IDataterror;
+static ID IDodbcinfo;
+static ID IDodbcerror;
 static ID IDkeys;
 static ID IDatattrs;
 static ID IDday;
@@ -243,6 +437,10 @@ static ID IDnsec;
 static ID IDusec;
 static ID IDsec;
 static ID IDmin;
+static ID IDmax;
+static ID IDtimeout;
+static ID IDidle_timeout;
+static ID IDvalidate;
 static ID IDhour;
 static ID IDusec;
 static ID IDkeyp;
@@ -252,6 +450,7 @@ static ID IDString;
 static ID IDFixnum;
 static ID IDtable_names;
 static ID IDnew;
+static ID IDjd;
 static ID IDnow;
 static ID IDname;
 static ID IDtable;
@@ -274,10 +473,26 @@ static ID IDdefault;
 #ifdef USE_RB_ENC
 static ID IDencode;
 #endif
-static ID IDparse;
 static ID IDutc;
 static ID IDlocal;
 static ID IDto_s;
+static ID IDwrite;
+static ID IDread;
+static ID IDBigDecimal;
+static ID IDbatch_rows;
+static ID IDsep;
+static ID IDquote;
+static ID IDnull;
+static ID IDheader;
+static ID IDbinmodep;
+static ID IDfileno;
+static ID IDcolumns;
+static ID IDbatch;
+static ID IDbinread;
+static ID IDparallelism;
+static ID IDjoin;
+static ID IDstatuses;
+static ID IDinserted;
 
 /*
  * Modes for dbc_info
@@ -302,8 +517,10 @@ static ID IDto_s;
 #define MAKERES_NOCLOSE 2
 #define MAKERES_PREPARE 4
 #define MAKERES_EXECD   8
-#define EXEC_PARMXNULL(x) (16 | ((x) << 5))
-#define EXEC_PARMXOUT(x)  (((x) & 16) ? ((x) >> 5) : -1)
+#define MAKERES_REEXEC  16
+#define MAKERES_NOCACHE 32
+#define EXEC_PARMXNULL(x) (64 | ((x) << 7))
+#define EXEC_PARMXOUT(x)  (((x) & 64) ? ((x) >> 7) : -1)
 
 /*
  * Modes for do_fetch
@@ -336,6 +553,14 @@ static VALUE stmt_each(VALUE self);
 static VALUE stmt_each_hash(int argc, VALUE *argv, VALUE self);
 static VALUE stmt_close(VALUE self);
 static VALUE stmt_drop(VALUE self);
+static VALUE stmt_prep_int(int argc, VALUE *argv, VALUE self, int mode);
+static void rowset_free(STMT *q);
+static VALUE wrap_stmt(VALUE dbc, DBC *p, SQLHSTMT hstmt, STMT **qp);
+static VALUE diag_read(SQLHENV henv, SQLHDBC hdbc, SQLHSTMT hstmt,
+		       int isinfo, VALUE *v0p);
+#ifdef USE_FIBER_ASYNC
+static void async_done(SQLHSTMT hstmt);
+#endif
 
 /*
  * Column name buffers on statement.
@@ -411,8 +636,8 @@ mkutf(char *dest, SQLWCHAR *src, int len)
 		(c >= 0xd800) && (c <= 0xdbff) && ((i + 1) < len)) {
 		unsigned long c2 = src[i + 1] & 0xffff;
 
-		if ((c2 >= 0xdc00) && (c <= 0xdfff)) {
-		    c = ((c & 0x3ff) | ((c2 & 0x3ff) << 10)) + 0x10000;
+		if ((c2 >= 0xdc00) && (c2 <= 0xdfff)) {
+		    c = (((c & 0x3ff) << 10) | (c2 & 0x3ff)) + 0x10000;
 		    *cp++ = 0xf0 | ((c >> 18) & 0x07);
 		    *cp++ = 0x80 | ((c >> 12) & 0x3f);
 		    *cp++ = 0x80 | ((c >> 6) & 0x3f);
@@ -448,23 +673,141 @@ mkutf(char *dest, SQLWCHAR *src, int len)
     return cp - dest;
 }
 
+/*
+ * UTF-16/UCS-4 to UTF-8 straight into the buffer of a Ruby string.
+ * Leading runs of ASCII are narrowed by the fastest variant the CPU
+ * supports, the remainder is sized exactly and converted by mkutf().
+ */
+
+static long
+uc_ascii_scalar(const SQLWCHAR *src, long len, char *dest)
+{
+    long i;
+
+    for (i = 0; i < len; i++) {
+	unsigned long c = src[i];
+
+	if (c >= 0x80) {
+	    break;
+	}
+	dest[i] = (char) c;
+    }
+    return i;
+}
+
+#ifdef USE_SSE2
+static long
+uc_ascii_sse2(const SQLWCHAR *src, long len, char *dest)
+{
+    const __m128i hibits = _mm_set1_epi16((short) 0xff80);
+    const __m128i zero = _mm_setzero_si128();
+    long i = 0;
+
+    for (; i + 16 <= len; i += 16) {
+	__m128i a = _mm_loadu_si128((const __m128i *) (src + i));
+	__m128i b = _mm_loadu_si128((const __m128i *) (src + i + 8));
+	__m128i t = _mm_and_si128(_mm_or_si128(a, b), hibits);
+
+	if (_mm_movemask_epi8(_mm_cmpeq_epi16(t, zero)) != 0xffff) {
+	    break;
+	}
+	_mm_storeu_si128((__m128i *) (dest + i), _mm_packus_epi16(a, b));
+    }
+    return i + uc_ascii_scalar(src + i, len - i, dest + i);
+}
+#endif
+
+#ifdef USE_AVX2
+__attribute__((target("avx2")))
+static long
+uc_ascii_avx2(const SQLWCHAR *src, long len, char *dest)
+{
+    const __m256i hibits = _mm256_set1_epi16((short) 0xff80);
+    long i = 0;
+
+    for (; i + 32 <= len; i += 32) {
+	__m256i a = _mm256_loadu_si256((const __m256i *) (src + i));
+	__m256i b = _mm256_loadu_si256((const __m256i *) (src + i + 16));
+	__m256i t = _mm256_and_si256(_mm256_or_si256(a, b), hibits);
+
+	if (!_mm256_testz_si256(t, t)) {
+	    break;
+	}
+	/* packus works per 128 bit lane, restore order of quadwords */
+	t = _mm256_permute4x64_epi64(_mm256_packus_epi16(a, b), 0xd8);
+	_mm256_storeu_si256((__m256i *) (dest + i), t);
+    }
+    return i + uc_ascii_scalar(src + i, len - i, dest + i);
+}
+#endif
+
+static long (*uc_ascii)(const SQLWCHAR *src, long len, char *dest) =
+    uc_ascii_scalar;
+
+static long
+utf8len(SQLWCHAR *src, long len)
+{
+    long i, ulen = 0;
+
+    for (i = 0; i < len; i++) {
+	unsigned long c = src[i];
+
+	if (sizeof (SQLWCHAR) == (2 * sizeof (char))) {
+	    c &= 0xffff;
+	}
+	if (c < 0x80) {
+	    ulen += 1;
+	} else if (c < 0x800) {
+	    ulen += 2;
+	} else if (c < 0x10000) {
+	    if ((sizeof (SQLWCHAR) == (2 * sizeof (char))) &&
+		(c >= 0xd800) && (c <= 0xdbff) && ((i + 1) < len)) {
+		unsigned long c2 = src[i + 1] & 0xffff;
+
+		if ((c2 >= 0xdc00) && (c2 <= 0xdfff)) {
+		    ulen += 4;
+		    ++i;
+		    continue;
+		}
+	    }
+	    ulen += 3;
+	} else if (c < 0x200000) {
+	    ulen += 4;
+	} else if (c < 0x4000000) {
+	    ulen += 5;
+	} else if (c < 0x80000000) {
+	    ulen += 6;
+	}
+    }
+    return ulen;
+}
+
 static VALUE
-uc_tainted_str_new(SQLWCHAR *str, int len)
+uc_fill_str(VALUE v, SQLWCHAR *str, int len)
 {
-    VALUE v;
-    char *cp = xmalloc(len * 6 + 1);
-    int ulen = 0;
+    long n;
 
-    if ((cp != NULL) && (str != NULL)) {
-	ulen = mkutf(cp, str, len);
+    if ((str == NULL) || (len <= 0)) {
+	rb_str_resize(v, 0);
+	return v;
     }
-    v = rb_tainted_str_new((cp != NULL) ? cp : "", ulen);
+    n = uc_ascii(str, len, RSTRING_PTR(v));
+    if (n < len) {
+	rb_str_resize(v, n + utf8len(str + n, len - n));
+	mkutf(RSTRING_PTR(v) + n, str + n, len - n);
+    }
+    return v;
+}
+
+static VALUE
+uc_tainted_str_new(SQLWCHAR *str, int len)
+{
+    VALUE v = uc_fill_str(rb_tainted_str_new(NULL, (len > 0) ? len : 0),
+			  str, len);
+
 #ifdef USE_RB_ENC
     rb_enc_associate(v, rb_enc);
 #endif
-    if (cp != NULL) {
-	xfree(cp);
-    }
     return v;
 }
 
@@ -477,21 +820,11 @@ uc_tainted_str_new2(SQLWCHAR *str)
 static VALUE
 uc_str_new(SQLWCHAR *str, int len)
 {
-    VALUE v;
-    char *cp = xmalloc(len * 6 + 1);
-    int ulen = 0;
+    VALUE v = uc_fill_str(rb_str_new(NULL, (len > 0) ? len : 0), str, len);
 
-    if ((cp != NULL) && (str != NULL)) {
-	ulen = mkutf(cp, str, len);
-    }
 #ifdef USE_RB_ENC
-    v = rb_enc_str_new((cp != NULL) ? cp : "", ulen, rb_enc);
-#else
-    v = rb_str_new((cp != NULL) ? cp : "", ulen);
+    rb_enc_associate(v, rb_enc);
 #endif
-    if (cp != NULL) {
-	xfree(cp);
-    }
     return v;
 }
 
@@ -518,104 +851,187 @@ uc_str_cat(VALUE v, SQLWCHAR *str, int len)
     return vv;
 }
 
+/*
+ * UTF-8 to UTF-16/UCS-4, runs of ASCII are validated and widened
+ * in blocks of 16 or 32 bytes when SQLWCHAR is 16 bits wide.
+ */
+
+static long
+uc_widen_scalar(const unsigned char *str, long len, SQLWCHAR *dest)
+{
+    long i;
+
+    for (i = 0; (i < len) && (str[i] < 0x80); i++) {
+	dest[i] = str[i];
+    }
+    return i;
+}
+
+#ifdef USE_SSE2
+static long
+uc_widen_sse2(const unsigned char *str, long len, SQLWCHAR *dest)
+{
+    const __m128i zero = _mm_setzero_si128();
+    long i = 0;
+
+    for (; i + 16 <= len; i += 16) {
+	__m128i v = _mm_loadu_si128((const __m128i *) (str + i));
+
+	if (_mm_movemask_epi8(v) != 0) {
+	    break;
+	}
+	_mm_storeu_si128((__m128i *) (dest + i), _mm_unpacklo_epi8(v, zero));
+	_mm_storeu_si128((__m128i *) (dest + i + 8),
+			 _mm_unpackhi_epi8(v, zero));
+    }
+    return i + uc_widen_scalar(str + i, len - i, dest + i);
+}
+#endif
+
+#ifdef USE_AVX2
+__attribute__((target("avx2")))
+static long
+uc_widen_avx2(const unsigned char *str, long len, SQLWCHAR *dest)
+{
+    long i = 0;
+
+    for (; i + 32 <= len; i += 32) {
+	__m256i v = _mm256_loadu_si256((const __m256i *) (str + i));
+
+	if (_mm256_movemask_epi8(v) != 0) {
+	    break;
+	}
+	_mm256_storeu_si256((__m256i *) (dest + i),
+			    _mm256_cvtepu8_epi16(_mm256_castsi256_si128(v)));
+	_mm256_storeu_si256((__m256i *) (dest + i + 16),
+			    _mm256_cvtepu8_epi16(_mm256_extracti128_si256(v,
+									  1)));
+    }
+    return i + uc_widen_scalar(str + i, len - i, dest + i);
+}
+#endif
+
+static long (*uc_widen_ascii)(const unsigned char *str, long len,
+			      SQLWCHAR *dest) = uc_widen_scalar;
+
+static void
+uc_init_simd(void)
+{
+    if (sizeof (SQLWCHAR) != (2 * sizeof (char))) {
+	return;
+    }
+#ifdef USE_SSE2
+    uc_ascii = uc_ascii_sse2;
+    uc_widen_ascii = uc_widen_sse2;
+#endif
+#ifdef USE_AVX2
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+	uc_ascii = uc_ascii_avx2;
+	uc_widen_ascii = uc_widen_avx2;
+    }
+#endif
+}
+
+static long
+uc_widen(unsigned char *str, long len, SQLWCHAR *uc)
+{
+    unsigned char *strend = str + len;
+    long i = 0;
+
+    while (str < strend) {
+	unsigned char c = str[0];
+	long rest = strend - str;
+
+	if (c < 0x80) {
+	    long n = uc_widen_ascii(str, rest, uc + i);
+
+	    i += n;
+	    str += n;
+	} else if ((c <= 0xc1) || (c >= 0xf5)) {
+	    /* illegal, ignored */
+	    ++str;
+	} else if (c < 0xe0) {
+	    if ((rest > 1) && ((str[1] & 0xc0) == 0x80)) {
+		uc[i++] = ((c & 0x1f) << 6) | (str[1] & 0x3f);
+		str += 2;
+	    } else {
+		uc[i++] = c;
+		++str;
+	    }
+	} else if (c < 0xf0) {
+	    if ((rest > 2) && ((str[1] & 0xc0) == 0x80) &&
+		((str[2] & 0xc0) == 0x80)) {
+		uc[i++] = ((c & 0x0f) << 12) |
+		    ((str[1] & 0x3f) << 6) | (str[2] & 0x3f);
+		str += 3;
+	    } else {
+		uc[i++] = c;
+		++str;
+	    }
+	} else {
+	    if ((rest > 3) && ((str[1] & 0xc0) == 0x80) &&
+		((str[2] & 0xc0) == 0x80) && ((str[3] & 0xc0) == 0x80)) {
+		unsigned long t = ((c & 0x07) << 18) |
+		    ((str[1] & 0x3f) << 12) | ((str[2] & 0x3f) << 6) |
+		    (str[3] & 0x3f);
+
+		if ((sizeof (SQLWCHAR) == (2 * sizeof (char))) &&
+		    (t >= 0x10000)) {
+		    t -= 0x10000;
+		    uc[i++] = 0xd800 | ((t >> 10) & 0x3ff);
+		    t = 0xdc00 | (t & 0x3ff);
+		}
+		uc[i++] = t;
+		str += 4;
+	    } else {
+		uc[i++] = c;
+		++str;
+	    }
+	}
+    }
+    uc[i] = 0;
+    return i;
+}
+
 static SQLWCHAR *
 uc_from_utf(unsigned char *str, int len)
 {
     SQLWCHAR *uc = NULL;
 
     if (str != NULL) {
-	int i = 0;
-	unsigned char *strend;
-
 	if (len < 0) {
 	    len = strlen((char *) str);
 	}
-	strend = str + len;
 	uc = ALLOC_N(SQLWCHAR, len + 1);
 	if (uc != NULL) {
-	    while (str < strend) {
-		unsigned char c = str[0];
-
-		if (c < 0x80) {
-		    uc[i++] = c;
-		    ++str;
-		} else if ((c <= 0xc1) || (c >= 0xf5)) {
-		    /* illegal, ignored */
-		    ++str;
-		} else if (c < 0xe0) {
-		    if ((str[1] & 0xc0) == 0x80) {
-			unsigned long t = ((c & 0x1f) << 6) | (str[1] & 0x3f);
-
-			uc[i++] = t;
-			str += 2;
-		    } else {
-			uc[i++] = c;
-			++str;
-		    }
-		} else if (c < 0xf0) {
-		    if (((str[1] & 0xc0) == 0x80) &&
-			((str[2] & 0xc0) == 0x80)) {
-			unsigned long t = ((c & 0x0f) << 12) |
-			    ((str[1] & 0x3f) << 6) | (str[2] & 0x3f);
-
-			uc[i++] = t;
-			str += 3;
-		    } else {
-			uc[i++] = c;
-			++str;
-		    }
-		} else if (c < 0xf8) {
-		    if (((str[1] & 0xc0) == 0x80) &&
-			((str[2] & 0xc0) == 0x80) &&
-			((str[3] & 0xc0) == 0x80)) {
-			unsigned long t = ((c & 0x03) << 18) |
-			    ((str[1] & 0x3f) << 12) | ((str[2] & 0x3f) << 6) |
-			    (str[4] & 0x3f);
-
-			if ((sizeof (SQLWCHAR) == (2 * sizeof (char))) &&
-			    (t >= 0x10000)) {
-			    t -= 0x10000;
-			    uc[i++] = 0xd800 | (t & 0x3ff);
-			    t = 0xdc00 | ((t >> 10) & 0x3ff);
-			}
-			uc[i++] = t;
-			str += 4;
-		    } else {
-			uc[i++] = c;
-			++str;
-		    }
-		} else if (c < 0xfc) {
-		    if (((str[1] & 0xc0) == 0x80) &&
-			((str[2] & 0xc0) == 0x80) &&
-			((str[3] & 0xc0) == 0x80) &&
-			((str[4] & 0xc0) == 0x80)) {
-			unsigned long t = ((c & 0x01) << 24) |
-			    ((str[1] & 0x3f) << 18) | ((str[2] & 0x3f) << 12) |
-			    ((str[4] & 0x3f) << 6) | (str[5] & 0x3f);
-
-			if ((sizeof (SQLWCHAR) == (2 * sizeof (char))) &&
-			    (t >= 0x10000)) {
-			    t -= 0x10000;
-			    uc[i++] = 0xd800 | (t & 0x3ff);
-			    t = 0xdc00 | ((t >> 10) & 0x3ff);
-			}
-			uc[i++] = t;
-			str += 5;
-		    } else {
-			uc[i++] = c;
-			++str;
-		    }
-		} else {
-		    /* ignore */
-		    ++str;
-		}
-	    }
-	    uc[i] = 0;
+	    uc_widen(str, len, uc);
 	}
     }
     return uc;
 }
 
+/*
+ * Same using caller supplied buffer of bufsize elements when large
+ * enough, result must be released with uc_free_buf().
+ */
+
+static SQLWCHAR *
+uc_from_utf_buf(unsigned char *str, int len, SQLWCHAR *buf, int bufsize)
+{
+    if (str == NULL) {
+	return NULL;
+    }
+    if (len < 0) {
+	len = strlen((char *) str);
+    }
+    if (len >= bufsize) {
+	return uc_from_utf(str, len);
+    }
+    uc_widen(str, len, buf);
+    return buf;
+}
+
 static void
 uc_free(SQLWCHAR *str)
 {
@@ -624,6 +1040,42 @@ uc_free(SQLWCHAR *str)
     }
 }
 
+static void
+uc_free_buf(SQLWCHAR *str, SQLWCHAR *buf)
+{
+    if (str != buf) {
+	uc_free(str);
+    }
+}
+
+/*
+ * Scratch buffer of a parameter, kept with the statement and grown
+ * to the largest value seen up to UC_SCRATCH_MAX elements. Larger
+ * values get their own buffer which must be released by the caller.
+ */
+
+#define UC_SCRATCH_MAX (1024 * 1024)
+
+static SQLWCHAR *
+uc_from_utf_scratch(SQLWCHAR **bufp, int *sizep, unsigned char *str, int len)
+{
+    if (len + 1 > UC_SCRATCH_MAX) {
+	return uc_from_utf(str, len);
+    }
+    if (*sizep < len + 1) {
+	uc_free(*bufp);
+	*bufp = NULL;
+	*sizep = 0;
+	*bufp = ALLOC_N(SQLWCHAR, len + 1);
+	if (*bufp == NULL) {
+	    return NULL;
+	}
+	*sizep = len + 1;
+    }
+    uc_widen(str, len, *bufp);
+    return *bufp;
+}
+
 #endif
 
 
@@ -749,38 +1201,245 @@ list_empty(LINK *head)
     return head->succ == NULL;
 }
 
+/*
+ *----------------------------------------------------------------------
+ *
+ *      Diagnostics are kept per thread and per handle.
+ *
+ *      The last error and warning of the current thread (fiber)
+ *      are thread local values, and the ones of a connection or
+ *      statement are stored in its DBC or STMT, which are found by
+ *      their ODBC handle while attached to it. Warnings/errors of a
+ *      statement are recorded on its connection, too.
+ *
+ *      Warnings of fetches are read lazily: instead of the messages,
+ *      the statement whose handle holds the diagnostic records is
+ *      stored, and the records are retrieved when asked for or before
+ *      the next call on that handle would discard them, see
+ *      diag_drain(). All other warnings are read immediately.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static st_table *diag_dbcs = NULL;
+static st_table *diag_stmts = NULL;
+
 static void
-free_env(ENV *e)
+diag_own_dbc(DBC *p)
 {
-    e->self = Qnil;
-    if (!list_empty(&e->dbcs)) {
-	return;
-    }
-    tracemsg(2, fprintf(stderr, "ObjFree: ENV %p\n", e););
-    if (e->henv != SQL_NULL_HENV) {
-	callsql(SQL_NULL_HENV, e->henv, SQL_NULL_HSTMT,
-		SQLFreeEnv(e->henv), "SQLFreeEnv");
-	e->henv = SQL_NULL_HENV;
+    if (p->hdbc != SQL_NULL_HDBC) {
+	st_insert(diag_dbcs, (st_data_t) p->hdbc, (st_data_t) p);
     }
-    xfree(e);
 }
 
 static void
-link_dbc(DBC *p, ENV *e)
+diag_disown_dbc(DBC *p)
 {
-    p->envp = e;
-    list_add(&p->link, &e->dbcs);
+    st_data_t key = (st_data_t) p->hdbc, val;
+
+    if ((p->hdbc != SQL_NULL_HDBC) && st_lookup(diag_dbcs, key, &val) &&
+	((DBC *) val == p)) {
+	st_delete(diag_dbcs, &key, NULL);
+    }
 }
 
 static void
-unlink_dbc(DBC *p)
+diag_disown_stmt(STMT *q)
 {
-    if (p == NULL) {
+    st_data_t key = (st_data_t) q->diagh, val;
+
+    if (q->diagh == SQL_NULL_HSTMT) {
 	return;
     }
-    p->env = Qnil;
-    if (p->envp != NULL) {
-	ENV *e = p->envp;
+    if (st_lookup(diag_stmts, key, &val) && ((STMT *) val == q)) {
+	st_delete(diag_stmts, &key, NULL);
+    }
+    q->diagh = SQL_NULL_HSTMT;
+}
+
+static void
+diag_own_stmt(STMT *q)
+{
+    if (q->diagh != q->hstmt) {
+	diag_disown_stmt(q);
+    }
+    if (q->hstmt != SQL_NULL_HSTMT) {
+	st_insert(diag_stmts, (st_data_t) q->hstmt, (st_data_t) q);
+	q->diagh = q->hstmt;
+    }
+}
+
+static void
+diag_find(SQLHDBC hdbc, SQLHSTMT hstmt, DBC **pp, STMT **qp)
+{
+    st_data_t val;
+
+    *pp = NULL;
+    *qp = NULL;
+    if ((hstmt != SQL_NULL_HSTMT) &&
+	st_lookup(diag_stmts, (st_data_t) hstmt, &val)) {
+	*qp = (STMT *) val;
+	*pp = (*qp)->dbcp;
+    } else if ((hdbc != SQL_NULL_HDBC) &&
+	       st_lookup(diag_dbcs, (st_data_t) hdbc, &val)) {
+	*pp = (DBC *) val;
+    }
+}
+
+static void
+diag_store(DBC *p, STMT *q, int isinfo, VALUE a)
+{
+    rb_thread_local_aset(rb_thread_current(),
+			 isinfo ? IDodbcinfo : IDodbcerror, a);
+    if (q != NULL) {
+	q->lazyinfo = 0;
+	if (isinfo) {
+	    q->info = a;
+	} else {
+	    q->error = a;
+	}
+    }
+    if (p != NULL) {
+	if (isinfo) {
+	    p->info = a;
+	} else {
+	    p->error = a;
+	}
+    }
+}
+
+static void
+diag_set(SQLHDBC hdbc, SQLHSTMT hstmt, int isinfo, VALUE a)
+{
+    DBC *p;
+    STMT *q;
+
+    diag_find(hdbc, hstmt, &p, &q);
+    diag_store(p, q, isinfo, a);
+}
+
+/* Retrieve pending warnings, see diag_pending(). */
+
+static VALUE
+diag_fetch(VALUE v)
+{
+    VALUE a = Qnil;
+
+    if ((v == Qnil) || (TYPE(v) == T_ARRAY)) {
+	return v;
+    }
+    if (rb_obj_is_kind_of(v, Cstmt) == Qtrue) {
+	STMT *q;
+
+	ODBC_Get_Struct(v, STMT, stmt_type, q);
+	if (q->info != v) {
+	    return Qnil;
+	}
+	if (q->hstmt != SQL_NULL_HSTMT) {
+	    a = diag_read(SQL_NULL_HENV, SQL_NULL_HDBC, q->hstmt, 1, NULL);
+	}
+	q->info = a;
+	if ((q->dbcp != NULL) && (q->dbcp->info == v)) {
+	    q->dbcp->info = a;
+	}
+    } else if (rb_obj_is_kind_of(v, Cdbc) == Qtrue) {
+	DBC *p;
+
+	ODBC_Get_Struct(v, DBC, dbc_type, p);
+	if (p->info != v) {
+	    return Qnil;
+	}
+	if (p->hdbc != SQL_NULL_HDBC) {
+	    a = diag_read(SQL_NULL_HENV, p->hdbc, SQL_NULL_HSTMT, 1, NULL);
+	}
+	p->info = a;
+    }
+    return a;
+}
+
+/* Read pending warnings of statement before its handle is used again. */
+
+static void
+diag_drain(STMT *q)
+{
+    VALUE a;
+
+    if ((q->info == Qnil) || (q->info != q->self)) {
+	return;
+    }
+    a = diag_fetch(q->self);
+    if (rb_thread_local_aref(rb_thread_current(), IDodbcinfo) == q->self) {
+	rb_thread_local_aset(rb_thread_current(), IDodbcinfo, a);
+    }
+}
+
+static VALUE
+diag_get(VALUE self, int isinfo)
+{
+    VALUE v = Qnil;
+    int handle = 1;
+
+    if (rb_obj_is_kind_of(self, Cstmt) == Qtrue) {
+	STMT *q;
+
+	ODBC_Get_Struct(self, STMT, stmt_type, q);
+	v = isinfo ? q->info : q->error;
+    } else if (rb_obj_is_kind_of(self, Cdbc) == Qtrue) {
+	DBC *p;
+
+	ODBC_Get_Struct(self, DBC, dbc_type, p);
+	v = isinfo ? p->info : p->error;
+    } else {
+	handle = 0;
+    }
+    /* internal errors are only known to the thread */
+    if ((v == Qnil) && (!handle || !isinfo)) {
+	v = rb_thread_local_aref(rb_thread_current(),
+				 isinfo ? IDodbcinfo : IDodbcerror);
+	handle = 0;
+    }
+    if (isinfo && (v != Qnil) && (TYPE(v) != T_ARRAY)) {
+	/* handles are updated by diag_fetch() */
+	v = diag_fetch(v);
+	if (!handle) {
+	    rb_thread_local_aset(rb_thread_current(), IDodbcinfo, v);
+	}
+    }
+    return v;
+}
+
+static void
+free_env(ENV *e)
+{
+    e->self = Qnil;
+    if (!list_empty(&e->dbcs)) {
+	return;
+    }
+    tracemsg(2, fprintf(stderr, "ObjFree: ENV %p\n", e););
+    if (e->henv != SQL_NULL_HENV) {
+	callsql(SQL_NULL_HENV, e->henv, SQL_NULL_HSTMT,
+		SQLFreeEnv(e->henv), "SQLFreeEnv");
+	e->henv = SQL_NULL_HENV;
+    }
+    xfree(e);
+}
+
+static void
+link_dbc(DBC *p, ENV *e)
+{
+    p->envp = e;
+    list_add(&p->link, &e->dbcs);
+}
+
+static void
+unlink_dbc(DBC *p)
+{
+    if (p == NULL) {
+	return;
+    }
+    p->env = Qnil;
+    if (p->envp != NULL) {
+	ENV *e = p->envp;
 
 	list_del(&p->link);
 	if (e->self == Qnil) {
@@ -803,6 +1462,7 @@ free_dbc(DBC *p)
 		SQLDisconnect(p->hdbc), "SQLDisconnect");
 	callsql(SQL_NULL_HENV, p->hdbc, SQL_NULL_HSTMT,
 		SQLFreeConnect(p->hdbc), "SQLFreeConnect");
+	diag_disown_dbc(p);
 	p->hdbc = SQL_NULL_HDBC;
     }
     unlink_dbc(p);
@@ -820,12 +1480,16 @@ free_stmt_sub(STMT *q, int withp)
 		if (q->paraminfo[i].outbuf != NULL) {
 		    xfree(q->paraminfo[i].outbuf);
 		}
+#ifdef UNICODE
+		uc_free(q->paraminfo[i].ucbuf);
+#endif
 	    }
 	    xfree(q->paraminfo);
 	    q->paraminfo = NULL;
 	}
 	q->nump = 0;
     }
+    rowset_free(q);
     q->ncols = 0;
     if (q->coltypes != NULL) {
 	xfree(q->coltypes);
@@ -839,10 +1503,19 @@ free_stmt_sub(STMT *q, int withp)
 	xfree(q->colvals);
 	q->colvals = NULL;
     }
+    if (q->colsyms != NULL) {
+	xfree(q->colsyms);
+	q->colsyms = NULL;
+    }
+    if (q->rowkv != NULL) {
+	xfree(q->rowkv);
+	q->rowkv = NULL;
+    }
     if (q->dbufs != NULL) {
 	xfree(q->dbufs);
 	q->dbufs = NULL;
     }
+    q->bufsize = 0;
     if (q->self != Qnil) {
 	VALUE v;
 
@@ -863,6 +1536,21 @@ free_stmt_sub(STMT *q, int withp)
     }
 }
 
+/*
+ * Forget result set description kept for re-execution,
+ * the next execute describes the columns again.
+ */
+
+static void
+desc_clear(STMT *q)
+{
+    if (q->desc != NULL) {
+	xfree(q->desc);
+	q->desc = NULL;
+    }
+    q->ndesc = -1;
+}
+
 static void
 link_stmt(STMT *q, DBC *p)
 {
@@ -877,6 +1565,7 @@ unlink_stmt(STMT *q)
 	return;
     }
     q->dbc = Qnil;
+    diag_disown_stmt(q);
     if (q->dbcp != NULL) {
 	DBC *p = q->dbcp;
 
@@ -894,12 +1583,22 @@ free_stmt(STMT *q)
     VALUE qself = q->self;
 
     q->self = q->dbc = Qnil;
+    q->sckey = Qnil;
     free_stmt_sub(q, 1);
+    desc_clear(q);
     tracemsg(2, fprintf(stderr, "ObjFree: STMT %p\n", q););
-    if (q->hstmt != SQL_NULL_HSTMT) {
+    if (q->sclink.head != NULL) {
+	/* cached statement, silently dropped */
+	list_del(&q->sclink);
+	if (q->dbcp != NULL) {
+	    q->dbcp->sccount--;
+	}
+    } else if (q->hstmt != SQL_NULL_HSTMT) {
 	/* Issue warning message. */
 	fprintf(stderr,	"WARNING: #<ODBC::Statement:0x%lx> was not dropped"
 		" before garbage collection.\n", (long) qself);
+    }
+    if (q->hstmt != SQL_NULL_HSTMT) {
 	callsql(SQL_NULL_HENV, SQL_NULL_HDBC, q->hstmt,
 		SQLFreeStmt(q->hstmt, SQL_DROP), "SQLFreeStmt(SQL_DROP)");
 	q->hstmt = SQL_NULL_HSTMT;
@@ -917,9 +1616,24 @@ start_gc()
 static void
 mark_dbc(DBC *p)
 {
+    LINK *l;
+
     if (p->env != Qnil) {
 	rb_gc_mark(p->env);
     }
+    if (p->pool != Qnil) {
+	rb_gc_mark(p->pool);
+    }
+    rb_gc_mark(p->error);
+    rb_gc_mark(p->info);
+    /* statements in prepared statement cache */
+    for (l = p->scache.succ; l != NULL; l = l->succ) {
+	STMT *q = (STMT *) ((char *) l - p->scache.offs);
+
+	if (q->self != Qnil) {
+	    rb_gc_mark(q->self);
+	}
+    }
 }
 
 static void
@@ -928,8 +1642,96 @@ mark_stmt(STMT *q)
     if (q->dbc != Qnil) {
 	rb_gc_mark(q->dbc);
     }
+    if (q->sckey != Qnil) {
+	rb_gc_mark(q->sckey);
+    }
+    rb_gc_mark(q->scopts);
+    rb_gc_mark(q->error);
+    rb_gc_mark(q->info);
+    if (q->rowkv != NULL) {
+	int i;
+
+	for (i = 0; i < 2 * q->ncols; i++) {
+	    rb_gc_mark(q->rowkv[i]);
+	}
+    }
+    if (q->paraminfo != NULL) {
+	int i;
+
+	for (i = 0; i < q->nump; i++) {
+	    rb_gc_mark(q->paraminfo[i].stream);
+	    rb_gc_mark(q->paraminfo[i].strval);
+	}
+    }
+}
+
+#ifdef USE_TYPEDDATA
+static size_t
+memsize_env(const void *ptr)
+{
+    return sizeof (ENV);
+}
+
+static size_t
+memsize_dbc(const void *ptr)
+{
+    return sizeof (DBC);
+}
+
+static size_t
+memsize_stmt(const void *ptr)
+{
+    const STMT *q = (const STMT *) ptr;
+    size_t size = sizeof (STMT) + q->bufsize + q->rsbufsize;
+    int i;
+
+    if (q->paraminfo != NULL) {
+	size += q->nump * sizeof (PARAMINFO);
+	for (i = 0; i < q->nump; i++) {
+	    if (q->paraminfo[i].outbuf != NULL) {
+		size += q->paraminfo[i].outsize;
+	    }
+#ifdef UNICODE
+	    size += q->paraminfo[i].ucsize * sizeof (SQLWCHAR);
+#endif
+	}
+    }
+    if (q->coltypes != NULL) {
+	size += q->ncols * sizeof (COLTYPE);
+    }
+    if (q->colvals != NULL) {
+	size += 4 * q->ncols * sizeof (VALUE);
+    }
+    if (q->colsyms != NULL) {
+	size += 4 * q->ncols * sizeof (VALUE);
+    }
+    if (q->rowkv != NULL) {
+	size += 2 * q->ncols * sizeof (VALUE);
+    }
+    return size;
 }
 
+static const rb_data_type_t env_type = {
+    "ODBC::Environment",
+    { NULL, (void (*)(void *)) free_env, memsize_env, },
+    ODBC_TYPED_FLAGS
+};
+
+static const rb_data_type_t dbc_type = {
+    "ODBC::Database",
+    { (void (*)(void *)) mark_dbc, (void (*)(void *)) free_dbc,
+      memsize_dbc, },
+    ODBC_TYPED_FLAGS
+};
+
+static const rb_data_type_t stmt_type = {
+    "ODBC::Statement",
+    { (void (*)(void *)) mark_stmt, (void (*)(void *)) free_stmt,
+      memsize_stmt, },
+    ODBC_TYPED_FLAGS
+};
+#endif
+
 /*
  *----------------------------------------------------------------------
  *
@@ -949,7 +1751,7 @@ set_err(const char *msg, int warn)
 #endif
     a = rb_ary_new2(1);
     rb_ary_push(a, rb_obj_taint(v));
-    CVAR_SET(Cobj, warn ? IDatatinfo : IDataterror, a);
+    diag_set(SQL_NULL_HDBC, SQL_NULL_HSTMT, warn, a);
     return STR2CSTR(v);
 }
 
@@ -961,8 +1763,9 @@ set_err(const char *msg, int warn)
  *----------------------------------------------------------------------
  */
 
-static char *
-get_err_or_info(SQLHENV henv, SQLHDBC hdbc, SQLHSTMT hstmt, int isinfo)
+static VALUE
+diag_read(SQLHENV henv, SQLHDBC hdbc, SQLHSTMT hstmt, int isinfo,
+	  VALUE *v0p)
 {
 #ifdef UNICODE
     SQLWCHAR msg[SQL_MAX_MESSAGE_LENGTH], state[6 + 1];
@@ -1030,13 +1833,64 @@ get_err_or_info(SQLHENV henv, SQLHDBC hdbc, SQLHSTMT hstmt, int isinfo)
 	    tracemsg(1, fprintf(stderr, "  | %s\n", STR2CSTR(v)););
 	}
     }
-    CVAR_SET(Cobj, isinfo ? IDatatinfo : IDataterror, a);
+    if (v0p != NULL) {
+	*v0p = v0;
+    }
+    return a;
+}
+
+static char *
+get_err_or_info(SQLHENV henv, SQLHDBC hdbc, SQLHSTMT hstmt, int isinfo)
+{
+    VALUE v0, a;
+
+    a = diag_read(henv, hdbc, hstmt, isinfo, &v0);
+    diag_set(hdbc, hstmt, isinfo, a);
     if (isinfo) {
 	return NULL;
     }
     return (v0 == Qnil) ? NULL : STR2CSTR(v0);
 }
 
+/*
+ * SQL_SUCCESS_WITH_INFO: after a fetch remember the statement whose
+ * handle has the warnings, otherwise (or when the handle is not known)
+ * read them now, since the calls following e.g. an execute would
+ * discard them before the caller gets a chance to ask for them.
+ */
+
+static void
+diag_pending(SQLHENV henv, SQLHDBC hdbc, SQLHSTMT hstmt)
+{
+    DBC *p;
+    STMT *q;
+    VALUE obj;
+
+    diag_find(hdbc, hstmt, &p, &q);
+    stats_total.withinfo++;
+    if (q != NULL) {
+	q->stats.withinfo++;
+    }
+    if (p != NULL) {
+	p->stats.withinfo++;
+    }
+    if ((p != NULL) && !p->warnings) {
+	diag_store(p, q, 1, Qnil);
+	return;
+    }
+    obj = ((q != NULL) && q->lazyinfo) ? q->self : Qnil;
+#ifdef USE_FIBER_ASYNC
+    if ((q != NULL) && q->async) {
+	obj = Qnil;
+    }
+#endif
+    if (obj == Qnil) {
+	diag_store(p, q, 1, diag_read(henv, hdbc, hstmt, 1, NULL));
+	return;
+    }
+    diag_store(p, q, 1, obj);
+}
+
 #if defined(HAVE_SQLINSTALLERERROR) || (defined(UNICODE) && defined(HAVE_SQLINSTALLERERRORW))
 static char *
 get_installer_err()
@@ -1126,7 +1980,7 @@ get_installer_err()
 	    tracemsg(1, fprintf(stderr, "  | %s\n", STR2CSTR(v)););
 	}
     }
-    CVAR_SET(Cobj, IDataterror, a);
+    diag_set(SQL_NULL_HDBC, SQL_NULL_HSTMT, 0, a);
     return (v0 == Qnil) ? NULL : STR2CSTR(v0);
 }
 #endif
@@ -1186,37 +2040,11 @@ static SQLRETURN
 callsql(SQLHENV henv, SQLHDBC hdbc, SQLHSTMT hstmt, SQLRETURN ret,
 	const char *m)
 {
-    SQLRETURN err;
-
-    err = tracesql(henv, hdbc, hstmt, ret, m);
-    if (err != SQL_SUCCESS) {
-#ifdef UNICODE
-	SQLWCHAR msg[SQL_MAX_MESSAGE_LENGTH], state[6 + 1];
-#else
-	SQLCHAR msg[SQL_MAX_MESSAGE_LENGTH], state[6 + 1];
-#endif
-	SQLINTEGER nativeerr;
-	SQLSMALLINT len;
-	int done = 0;
-
-	while (!done) {
-	    err = tracesql(henv, hdbc, hstmt,
-			   SQLError(henv, hdbc, hstmt, state, &nativeerr, msg,
-				    SQL_MAX_MESSAGE_LENGTH - 1, &len),
-			   "SQLError");
-	    switch (err) {
-	    case SQL_SUCCESS:
-		break;
-	    case SQL_NO_DATA:
-	    case SQL_INVALID_HANDLE:
-	    case SQL_ERROR:
-	    default:
-		done = 1;
-		break;
-	    }
-	}
-    }
-    return ret;
+    /*
+     * Diagnostics are not drained, the driver manager discards
+     * them on the next call on the handle anyway.
+     */
+    return tracesql(henv, hdbc, hstmt, ret, m);
 }
 
 static int
@@ -1230,12 +2058,18 @@ succeeded_common(SQLHENV henv, SQLHDBC hdbc, SQLHSTMT hstmt, SQLRETURN ret,
 	    msgp = &dummy;
 	}
 	*msgp = get_err_or_info(henv, hdbc, hstmt, 0);
+#ifdef USE_FIBER_ASYNC
+	async_done(hstmt);
+#endif
 	return 0;
     }
     if (ret == SQL_SUCCESS_WITH_INFO) {
-	get_err_or_info(henv, hdbc, hstmt, 1);
+	diag_pending(henv, hdbc, hstmt);
+#ifdef USE_FIBER_ASYNC
+	async_done(hstmt);
+#endif
     } else {
-	CVAR_SET(Cobj, IDatatinfo, Qnil);
+	diag_set(hdbc, hstmt, 1, Qnil);
     }
     return 1;
 }
@@ -1278,7 +2112,7 @@ succeeded_nodata(SQLHENV henv, SQLHDBC hdbc, SQLHSTMT hstmt, SQLRETURN ret,
     }
 #endif
     if (ret == SQL_NO_DATA) {
-	CVAR_SET(Cobj, IDatatinfo, Qnil);
+	diag_set(hdbc, hstmt, 1, Qnil);
 	return 1;
     }
     return succeeded_common(henv, hdbc, hstmt, ret, msgp);
@@ -1287,1615 +2121,3640 @@ succeeded_nodata(SQLHENV henv, SQLHDBC hdbc, SQLHSTMT hstmt, SQLRETURN ret,
 /*
  *----------------------------------------------------------------------
  *
- *      Return ENV from VALUE.
+ *      Blocking statement calls made without holding the GVL.
+ *
+ *      The unblocking function issues SQLCancel() on the statement,
+ *      which makes the pending call return SQL_ERROR (SQLSTATE HY008)
+ *      so that the normal error path is taken afterwards.
  *
  *----------------------------------------------------------------------
  */
 
-static VALUE
-env_of(VALUE self)
-{
-    if (rb_obj_is_kind_of(self, Cstmt) == Qtrue) {
-	STMT *q;
-
-	Data_Get_Struct(self, STMT, q);
-	self = q->dbc;
-	if (self == Qnil) {
-	    rb_raise(Cerror, "%s", set_err("Stale ODBC::Statement", 0));
-	}
-    }
-    if (rb_obj_is_kind_of(self, Cdbc) == Qtrue) {
-	DBC *p;
+#define NOGVL_EXECUTE    0
+#define NOGVL_EXECDIRECT 1
+#define NOGVL_PREPARE    2
+#define NOGVL_FETCH      3
+#define NOGVL_FETCHSCRL  4
+#define NOGVL_GETDATA    5
+#define NOGVL_CONNECT    6
+#define NOGVL_DRVCONNECT 7
+#define NOGVL_GETCONNOPT 8
+#define NOGVL_PARAMDATA  9
+#define NOGVL_PUTDATA    10
+#define NOGVL_WRITE      11
+#define NOGVL_MORERES    12
 
-	Data_Get_Struct(self, DBC, p);
-	self = p->env;
-	if (self == Qnil) {
-	    rb_raise(Cerror, "%s", set_err("Stale ODBC::Database", 0));
-	}
-    }
-    return self;
-}
+typedef struct {
+    int func;
+    int called;
+    SQLHDBC hdbc;
+    SQLHSTMT hstmt;
+    SQLTCHAR *sql;
+    SQLTCHAR *user;
+    SQLTCHAR *passwd;
+    SQLINTEGER attr;
+    SQLSMALLINT dir;
+    SQLLEN offs;
+    SQLUSMALLINT col;
+    SQLSMALLINT type;
+    SQLPOINTER val;
+    SQLLEN len;
+    SQLLEN *lenp;
+    SQLRETURN ret;
+    int fd;
+    int err;
+} NOGVLARGS;
 
-static ENV *
-get_env(VALUE self)
+static void *
+nogvl_func(void *arg)
 {
-    ENV *e;
-
-    Data_Get_Struct(env_of(self), ENV, e);
-    return e;
-}
+    NOGVLARGS *a = (NOGVLARGS *) arg;
 
-/*
- *----------------------------------------------------------------------
- *
- *      Return DBC from VALUE.
- *
- *----------------------------------------------------------------------
- */
-
-static DBC *
-get_dbc(VALUE self)
-{
-    DBC *p;
-
-    if (rb_obj_is_kind_of(self, Cstmt) == Qtrue) {
-	STMT *q;
+    a->called = 1;
+    switch (a->func) {
+    case NOGVL_EXECUTE:
+	a->ret = SQLExecute(a->hstmt);
+	break;
+    case NOGVL_EXECDIRECT:
+	a->ret = SQLExecDirect(a->hstmt, a->sql, SQL_NTS);
+	break;
+    case NOGVL_PREPARE:
+	a->ret = SQLPrepare(a->hstmt, a->sql, SQL_NTS);
+	break;
+    case NOGVL_FETCH:
+	a->ret = SQLFetch(a->hstmt);
+	break;
+    case NOGVL_FETCHSCRL:
+#if (ODBCVER < 0x0300)
+	{
+	    SQLUINTEGER nRows;
+	    SQLUSMALLINT rowStat[1];
 
-	Data_Get_Struct(self, STMT, q);
-	self = q->dbc;
-	if (self == Qnil) {
-	    rb_raise(Cerror, "%s", set_err("Stale ODBC::Statement", 0));
+	    a->ret = SQLExtendedFetch(a->hstmt, a->dir, (SQLINTEGER) a->offs,
+				      &nRows, rowStat);
 	}
+#else
+	a->ret = SQLFetchScroll(a->hstmt, a->dir, a->offs);
+#endif
+	break;
+    case NOGVL_GETDATA:
+	a->ret = SQLGetData(a->hstmt, a->col, a->type, a->val, a->len,
+			    a->lenp);
+	break;
+    case NOGVL_CONNECT:
+	a->ret = SQLConnect(a->hdbc, a->sql, SQL_NTS,
+			    a->user, (SQLSMALLINT) (a->user ? SQL_NTS : 0),
+			    a->passwd,
+			    (SQLSMALLINT) (a->passwd ? SQL_NTS : 0));
+	break;
+    case NOGVL_DRVCONNECT:
+	a->ret = SQLDriverConnect(a->hdbc, NULL, a->sql, SQL_NTS,
+				  NULL, 0, NULL, SQL_DRIVER_NOPROMPT);
+	break;
+    case NOGVL_GETCONNOPT:
+#if (ODBCVER >= 0x0300)
+	a->ret = SQLGetConnectAttr(a->hdbc, (SQLINTEGER) a->attr, a->val,
+				   0, NULL);
+#else
+	a->ret = SQLGetConnectOption(a->hdbc, (SQLUSMALLINT) a->attr, a->val);
+#endif
+	break;
+    case NOGVL_PARAMDATA:
+	a->ret = SQLParamData(a->hstmt, (SQLPOINTER *) a->val);
+	break;
+    case NOGVL_PUTDATA:
+	a->ret = SQLPutData(a->hstmt, a->val, a->len);
+	break;
+    case NOGVL_MORERES:
+	a->ret = SQLMoreResults(a->hstmt);
+	break;
+    case NOGVL_WRITE:
+	a->len = (SQLLEN) write(a->fd, a->val, (size_t) a->len);
+	a->err = (a->len < 0) ? errno : 0;
+	break;
+    default:
+	a->ret = SQL_ERROR;
+	break;
     }
-    Data_Get_Struct(self, DBC, p);
-    return p;
+    return NULL;
 }
 
-/*
- *----------------------------------------------------------------------
- *
- *      Raise ODBC error from Ruby.
- *
- *----------------------------------------------------------------------
- */
-
-static VALUE
-dbc_raise(VALUE self, VALUE msg)
+#ifdef USE_NOGVL
+static void
+nogvl_ubf(void *arg)
 {
-    VALUE a, v;
-    char buf[SQL_MAX_MESSAGE_LENGTH + 1], *p;
+    NOGVLARGS *a = (NOGVLARGS *) arg;
 
-    if (TYPE(msg) == T_STRING) {
-	v = msg;
-    } else {
-	v = rb_any_to_s(msg);
+    if (a->hstmt != SQL_NULL_HSTMT) {
+	SQLCancel(a->hstmt);
     }
-    strcpy(buf, "INTERN (1) [RubyODBC]");
-    p = STR2CSTR(v);
-    strncat(buf, p, SQL_MAX_MESSAGE_LENGTH - strlen(buf));
-    buf[SQL_MAX_MESSAGE_LENGTH] = '\0';
-    v = rb_str_new2(buf);
-    a = rb_ary_new2(1);
-    rb_ary_push(a, rb_obj_taint(v));
-    CVAR_SET(Cobj, IDataterror, a);
-    rb_raise(Cerror, "%s", buf);
-    return Qnil;
 }
+#endif
+
+#ifdef USE_FIBER_ASYNC
 
 /*
- *----------------------------------------------------------------------
- *
- *      Obtain an ENV.
- *
- *----------------------------------------------------------------------
+ * Asynchronous execution for fibers with a scheduler: the statement
+ * is switched to SQL_ATTR_ASYNC_ENABLE for the call, which is
+ * repeated on SQL_STILL_EXECUTING while the scheduler runs other
+ * fibers between polls. The statement is switched back right away
+ * on success, otherwise after succeeded() has read the diagnostics
+ * (STMT.async flags statements left in asynchronous mode).
  */
 
+#define ASYNC_DELAY_MIN 0.0001
+#define ASYNC_DELAY_MAX 0.05
+
+typedef struct {
+    VALUE scheduler;
+    double delay;
+} ASYNCWAIT;
+
 static VALUE
-env_new(VALUE self)
+async_wait(VALUE arg)
 {
-    ENV *e;
-    SQLHENV henv = SQL_NULL_HENV;
-    VALUE obj;
+    ASYNCWAIT *w = (ASYNCWAIT *) arg;
 
-    if (TYPE(self) == T_MODULE) {
-	self = Cobj;
-    }
-    if (self == Cobj) {
-	self = Cenv;
-    }
-    if ((!SQL_SUCCEEDED(SQLAllocEnv(&henv))) || (henv == SQL_NULL_HENV)) {
-	rb_raise(Cerror, "%s", set_err("Cannot allocate SQLHENV", 0));
-    }
-    obj = Data_Make_Struct(self, ENV, NULL, free_env, e);
-    tracemsg(2, fprintf(stderr, "ObjAlloc: ENV %p\n", e););
-    e->self = obj;
-    e->henv = henv;
-    list_init(&e->dbcs, offsetof(DBC, link));
-#if defined(UNICODE) && defined(SQL_OV_ODBC3)
-    callsql(henv, SQL_NULL_HDBC, SQL_NULL_HSTMT,
-	    SQLSetEnvAttr(henv, SQL_ATTR_ODBC_VERSION,
-			  (SQLPOINTER) SQL_OV_ODBC3, 0),
-	    "SQLSetEnvAttr(SQL_OV_ODBC3)");
-#endif
-    return obj;
+    return rb_fiber_scheduler_kernel_sleep(w->scheduler,
+					   rb_float_new(w->delay));
 }
 
-/*
- *----------------------------------------------------------------------
- *
- *      Obtain array of known DSNs.
- *
- *----------------------------------------------------------------------
- */
+/* Wait for a cancelled call to finish, without the scheduler. */
 
 static VALUE
-dbc_dsns(VALUE self)
+async_sleep(VALUE arg)
 {
-#ifdef UNICODE
-    SQLWCHAR dsn[SQL_MAX_DSN_LENGTH], descr[SQL_MAX_MESSAGE_LENGTH * 2];
-#else
-    char dsn[SQL_MAX_DSN_LENGTH], descr[SQL_MAX_MESSAGE_LENGTH * 2];
-#endif
-    SQLSMALLINT dsnLen = 0, descrLen = 0;
-    int first = 1;
-    VALUE env, aret;
-    ENV *e;
+    ASYNCWAIT *w = (ASYNCWAIT *) arg;
+    struct timeval tv;
 
-    env = env_new(Cenv);
-    Data_Get_Struct(env, ENV, e);
-    aret = rb_ary_new();
-    while (succeeded(e->henv, SQL_NULL_HDBC, SQL_NULL_HSTMT,
-		     SQLDataSources(e->henv, (SQLUSMALLINT) (first ?
-				    SQL_FETCH_FIRST : SQL_FETCH_NEXT),
-				    (SQLTCHAR *) dsn,
-				    (SQLSMALLINT) sizeof (dsn), &dsnLen,
-				    (SQLTCHAR *) descr,
-				    (SQLSMALLINT) sizeof (descr),
-				    &descrLen),
-		     NULL, "SQLDataSources")) {
-	VALUE odsn = rb_obj_alloc(Cdsn);
+    tv.tv_sec = 0;
+    tv.tv_usec = (long) (w->delay * 1000000.0);
+    rb_thread_wait_for(tv);
+    return Qnil;
+}
 
-#ifdef UNICODE
-	dsnLen = (dsnLen == 0) ? (SQLSMALLINT) uc_strlen(dsn) :
-	    (SQLSMALLINT) (dsnLen / sizeof (SQLWCHAR));
-	descrLen = (descrLen == 0) ?
-	    (SQLSMALLINT) uc_strlen(descr) :
-	    (SQLSMALLINT) (descrLen / sizeof (SQLWCHAR));
-	rb_iv_set(odsn, "@name", uc_tainted_str_new(dsn, dsnLen));
-	rb_iv_set(odsn, "@descr", uc_tainted_str_new(descr, descrLen));
-#else
-	dsnLen = (dsnLen == 0) ? (SQLSMALLINT) strlen(dsn) : dsnLen;
-	descrLen = (descrLen == 0) ? (SQLSMALLINT) strlen(descr) : descrLen;
-	rb_iv_set(odsn, "@name", rb_tainted_str_new(dsn, dsnLen));
-	rb_iv_set(odsn, "@descr", rb_tainted_str_new(descr, descrLen));
-#endif
-	rb_ary_push(aret, odsn);
-	first = dsnLen = descrLen = 0;
-    }
-    return aret;
+static int
+async_off(SQLHSTMT hstmt)
+{
+    return SQL_SUCCEEDED(SQLSetStmtAttr(hstmt, SQL_ATTR_ASYNC_ENABLE,
+					(SQLPOINTER) SQL_ASYNC_ENABLE_OFF,
+					0));
 }
 
-/*
- *----------------------------------------------------------------------
- *
- *      Obtain array of known drivers.
- *
- *----------------------------------------------------------------------
- */
+/* Called by succeeded_common() after diagnostics have been read. */
 
-static VALUE
-dbc_drivers(VALUE self)
+static void
+async_done(SQLHSTMT hstmt)
 {
-#ifdef UNICODE
-    SQLWCHAR driver[SQL_MAX_MESSAGE_LENGTH], attrs[SQL_MAX_MESSAGE_LENGTH * 2];
-    SQLWCHAR *attr;
-#else
-    char driver[SQL_MAX_MESSAGE_LENGTH], attrs[SQL_MAX_MESSAGE_LENGTH * 2];
-    char *attr;
-#endif
-    SQLSMALLINT driverLen = 0, attrsLen = 0;
-    int first = 1;
-    VALUE env, aret;
-    ENV *e;
+    DBC *p;
+    STMT *q;
 
-    env = env_new(Cenv);
-    Data_Get_Struct(env, ENV, e);
-    aret = rb_ary_new();
-    while (succeeded(e->henv, SQL_NULL_HDBC, SQL_NULL_HSTMT,
-		     SQLDrivers(e->henv, (SQLUSMALLINT) (first ?
-				SQL_FETCH_FIRST : SQL_FETCH_NEXT),
-				(SQLTCHAR *) driver,
-				(SQLSMALLINT) sizeof (driver), &driverLen,
-				(SQLTCHAR *) attrs,
-				(SQLSMALLINT) sizeof (attrs), &attrsLen),
-		     NULL, "SQLDrivers")) {
-	VALUE odrv = rb_obj_alloc(Cdrv);
-	VALUE h = rb_hash_new();
-	int count = 0;
+    diag_find(SQL_NULL_HDBC, hstmt, &p, &q);
+    if ((q != NULL) && q->async && async_off(hstmt)) {
+	q->async = 0;
+    }
+}
 
-#ifdef UNICODE
-	driverLen = (driverLen == 0) ?
-	    (SQLSMALLINT) uc_strlen(driver) :
-	    (SQLSMALLINT) (driverLen / sizeof (SQLWCHAR));
-	rb_iv_set(odrv, "@name", uc_tainted_str_new(driver, driverLen));
-	for (attr = attrs; *attr; attr += uc_strlen(attr) + 1) {
-	    SQLWCHAR *p = uc_strchr(attr, (SQLWCHAR) '=');
+static int
+nogvl_async(NOGVLARGS *a, STMT *q, int *statep)
+{
+    ASYNCWAIT w;
+    int state = 0;
 
-	    if ((p != NULL) && (p != attr)) {
-		rb_hash_aset(h,
-			     uc_tainted_str_new(attr, (p - attr) /
-						 sizeof (SQLWCHAR)),
-			     uc_tainted_str_new2(p + 1));
-		count++;
-	    }
+    if ((a->hstmt == SQL_NULL_HSTMT) || (q == NULL)) {
+	return 0;
+    }
+    w.scheduler = rb_fiber_scheduler_current();
+    if (w.scheduler == Qnil) {
+	return 0;
+    }
+    switch (a->func) {
+    case NOGVL_EXECUTE:
+    case NOGVL_EXECDIRECT:
+    case NOGVL_FETCH:
+    case NOGVL_FETCHSCRL:
+    case NOGVL_MORERES:
+	if (SQLSetStmtAttr(a->hstmt, SQL_ATTR_ASYNC_ENABLE,
+			   (SQLPOINTER) SQL_ASYNC_ENABLE_ON, 0)
+	    != SQL_SUCCESS) {
+	    /* not supported by driver */
+	    return 0;
 	}
-#else
-	driverLen = (driverLen == 0) ? (SQLSMALLINT) strlen(driver) : driverLen;
-	rb_iv_set(odrv, "@name", rb_tainted_str_new(driver, driverLen));
-	for (attr = attrs; *attr; attr += strlen(attr) + 1) {
-	    char *p = strchr(attr, '=');
-
-	    if ((p != NULL) && (p != attr)) {
-		rb_hash_aset(h, rb_tainted_str_new(attr, p - attr),
-			     rb_tainted_str_new2(p + 1));
-		count++;
+	break;
+    case NOGVL_PARAMDATA:
+    case NOGVL_PUTDATA:
+	/* still asynchronous from SQLExecute() returning SQL_NEED_DATA */
+	break;
+    default:
+	return 0;
+    }
+    w.delay = ASYNC_DELAY_MIN;
+    nogvl_func(a);
+    while (a->ret == SQL_STILL_EXECUTING) {
+	rb_protect(async_wait, (VALUE) &w, &state);
+	if (state) {
+	    SQLCancel(a->hstmt);
+	    nogvl_func(a);
+	    w.delay = ASYNC_DELAY_MIN;
+	    while (a->ret == SQL_STILL_EXECUTING) {
+		int state2 = 0;
+
+		/* only the first interrupt is kept */
+		rb_protect(async_sleep, (VALUE) &w, &state2);
+		nogvl_func(a);
+		w.delay *= 2;
+		if (w.delay > ASYNC_DELAY_MAX) {
+		    w.delay = ASYNC_DELAY_MAX;
+		}
 	    }
+	    break;
 	}
-#endif
-	if (count > 0) {
-	    rb_iv_set(odrv, "@attrs", h);
+	nogvl_func(a);
+	w.delay *= 2;
+	if (w.delay > ASYNC_DELAY_MAX) {
+	    w.delay = ASYNC_DELAY_MAX;
 	}
-	rb_ary_push(aret, odrv);
-	first = driverLen = attrsLen = 0;
     }
-    return aret;
+    if (state || (a->ret == SQL_SUCCESS) || (a->ret == SQL_NO_DATA)) {
+	/* fails while data at execution is pending, retried later */
+	q->async = !async_off(a->hstmt);
+    } else if ((a->ret == SQL_ERROR) || (a->ret == SQL_SUCCESS_WITH_INFO) ||
+	       (a->ret == SQL_NEED_DATA)) {
+	q->async = 1;
+    }
+    *statep = state;
+    return 1;
 }
 
+#endif
+
 /*
  *----------------------------------------------------------------------
  *
- *      Management methods.
+ *      Performance counters.
+ *
+ *      Driver calls made through nogvl_call() are counted and timed
+ *      on their statement, its connection and in stats_total, as
+ *      is the time do_fetch() spends converting column values.
  *
  *----------------------------------------------------------------------
  */
 
-#ifdef HAVE_ODBCINST_H
-static VALUE
-conf_dsn(int argc, VALUE *argv, VALUE self, int op)
+static double
+stats_now(void)
 {
-    VALUE drv, attr, issys, astr;
-#ifdef UNICODE
-#ifdef HAVE_SQLCONFIGDATASOURCEW
-    int have_w = 1;
+#ifdef _WIN32
+    LARGE_INTEGER freq, count;
+
+    QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&count);
+    return (double) count.QuadPart / (double) freq.QuadPart;
 #else
-    int have_w = 0;
+#if defined(HAVE_CLOCK_GETTIME) && defined(CLOCK_MONOTONIC)
+    struct timespec ts;
+
+    if (clock_gettime(CLOCK_MONOTONIC, &ts) == 0) {
+	return (double) ts.tv_sec + (double) ts.tv_nsec / 1000000000.0;
+    }
 #endif
-    SQLWCHAR *sdrv, *sastr;
-#else
-    char *sdrv, *sastr;
+    {
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+	return (double) tv.tv_sec + (double) tv.tv_usec / 1000000.0;
+    }
 #endif
+}
 
-    rb_scan_args(argc, argv, "12", &drv, &attr, &issys);
-    if (rb_obj_is_kind_of(drv, Cdrv) == Qtrue) {
-	VALUE a, x;
+static void
+stats_add(STATS *s, int func, double dt, unsigned long rows,
+	  unsigned long bytes)
+{
+    switch (func) {
+    case NOGVL_EXECUTE:
+    case NOGVL_EXECDIRECT:
+	s->executes++;
+	break;
+    case NOGVL_PREPARE:
+	s->prepares++;
+	break;
+    case NOGVL_FETCH:
+    case NOGVL_FETCHSCRL:
+	s->fetches++;
+	s->rows += rows;
+	break;
+    case NOGVL_GETDATA:
+	s->getdata++;
+	/* fall through */
+    case NOGVL_PUTDATA:
+	s->lobbytes += bytes;
+	break;
+    }
+    s->drvtime += dt;
+}
 
-	if (argc > 2) {
-	    rb_raise(rb_eArgError, "wrong # of arguments");
-	}
-	x = rb_iv_get(drv, "@name");
-	a = rb_iv_get(drv, "@attrs");
-	issys = attr;
-	drv = x;
-	attr = a;
+static void
+stats_rec(DBC *p, STMT *q, int func, double dt, unsigned long rows,
+	  unsigned long bytes)
+{
+    if (q != NULL) {
+	stats_add(&q->stats, func, dt, rows, bytes);
     }
-    Check_Type(drv, T_STRING);
-    if (RTEST(issys)) {
-	switch (op) {
-	case ODBC_ADD_DSN:	op = ODBC_ADD_SYS_DSN; break;
-	case ODBC_CONFIG_DSN:	op = ODBC_CONFIG_SYS_DSN; break;
-	case ODBC_REMOVE_DSN:	op = ODBC_REMOVE_SYS_DSN; break;
-	}
+    if (p != NULL) {
+	stats_add(&p->stats, func, dt, rows, bytes);
     }
-    astr = rb_str_new2("");
-    if (rb_obj_is_kind_of(attr, rb_cHash) == Qtrue) {
-	VALUE a, x;
+    stats_add(&stats_total, func, dt, rows, bytes);
+}
 
-	a = rb_funcall(attr, IDkeys, 0, NULL);
-	while ((x = rb_ary_shift(a)) != Qnil) {
-	    VALUE v = rb_hash_aref(attr, x);
+/* Bytes transferred by SQLGetData() into a buffer of size len. */
 
-	    astr = rb_str_concat(astr, x);
-	    astr = rb_str_cat2(astr, "=");
-	    astr = rb_str_concat(astr, v);
-	    astr = rb_str_cat(astr, "", 1);
-	}
+static unsigned long
+stats_getlen(SQLRETURN ret, SQLLEN len, SQLLEN *lenp)
+{
+    SQLLEN n;
+
+    if (!SQL_SUCCEEDED(ret) || (lenp == NULL)) {
+	return 0;
     }
-    astr = rb_str_cat(astr, "", 1);
-#ifdef UNICODE
-#ifdef USE_DLOPEN_FOR_ODBC_LIBS
-    have_w = ruby_odbc_have_func("SQLConfigDataSourceW", SQLConfigDataSourceW);
-#endif
-    if (have_w) {
-#ifdef USE_RB_ENC
-	drv = rb_funcall(drv, IDencode, 1, rb_encv);
-	astr = rb_funcall(astr, IDencode, 1, rb_encv);
-#endif
-	sdrv = uc_from_utf((unsigned char *) STR2CSTR(drv), -1);
-	sastr = uc_from_utf((unsigned char *) STR2CSTR(astr), -1);
-	if ((sdrv == NULL) || (sastr == NULL)) {
-	    uc_free(sdrv);
-	    uc_free(sastr);
-	    rb_raise(Cerror, "%s", set_err("Out of memory", 0));
-	}
-	if (SQLConfigDataSourceW(NULL, (WORD) op,
-				 (LPWSTR) sdrv, (LPWSTR) sastr)) {
-	    uc_free(sdrv);
-	    uc_free(sastr);
-	    return Qnil;
-	}
-	uc_free(sdrv);
-	uc_free(sastr);
-    } else {
-	sdrv = (SQLWCHAR *) STR2CSTR(drv);
-	sastr = (SQLWCHAR *) STR2CSTR(astr);
-	if (SQLConfigDataSource(NULL, (WORD) op,
-				(LPCSTR) sdrv, (LPCSTR) sastr)) {
-	    return Qnil;
-	}
+    n = *lenp;
+    if (n == SQL_NULL_DATA) {
+	return 0;
     }
-#else
-    sdrv = STR2CSTR(drv);
-    sastr = STR2CSTR(astr);
-    if (SQLConfigDataSource(NULL, (WORD) op, sdrv, sastr)) {
-	return Qnil;
+    if ((n == SQL_NO_TOTAL) || (n > len)) {
+	n = len;
     }
-#endif
-#if defined(HAVE_SQLINSTALLERERROR) || (defined(UNICODE) && defined(HAVE_SQLINSTALLERERRORW))
-    rb_raise(Cerror, "%s", set_err(get_installer_err(), 0));
-#else
-    rb_raise(Cerror, "%s", set_err("DSN configuration error", 0));
-#endif
-    return Qnil;
+    return (n < 0) ? 0 : (unsigned long) n;
 }
-#endif
 
-static VALUE
-dbc_adddsn(int argc, VALUE *argv, VALUE self)
+static void
+stats_conv(STMT *q, double dt)
 {
-#ifdef HAVE_ODBCINST_H
-    return conf_dsn(argc, argv, self, ODBC_ADD_DSN);
-#else
-    rb_raise(Cerror, "%s", set_err("ODBC::add_dsn not supported", 0));
-    return Qnil;
-#endif
+    q->stats.convtime += dt;
+    if (q->dbcp != NULL) {
+	q->dbcp->stats.convtime += dt;
+    }
+    stats_total.convtime += dt;
 }
 
-static VALUE
-dbc_confdsn(int argc, VALUE *argv, VALUE self)
+static void
+stats_call(NOGVLARGS *a, double t0, DBC *p, STMT *q)
 {
-#ifdef HAVE_ODBCINST_H
-    return conf_dsn(argc, argv, self, ODBC_CONFIG_DSN);
-#else
-    rb_raise(Cerror, "%s", set_err("ODBC::config_dsn not supported", 0));
-    return Qnil;
-#endif
+    double dt;
+    unsigned long rows = 0, bytes = 0;
+
+    if (a->func == NOGVL_WRITE) {
+	return;
+    }
+    dt = stats_now() - t0;
+    switch (a->func) {
+    case NOGVL_FETCH:
+    case NOGVL_FETCHSCRL:
+	if (SQL_SUCCEEDED(a->ret)) {
+	    rows = ((q != NULL) && (q->rsmode > 0)) ? q->rsrows : 1;
+	}
+	break;
+    case NOGVL_GETDATA:
+	bytes = stats_getlen(a->ret, a->len, a->lenp);
+	break;
+    case NOGVL_PUTDATA:
+	if (SQL_SUCCEEDED(a->ret) && (a->len > 0)) {
+	    bytes = (unsigned long) a->len;
+	}
+	break;
+    }
+    stats_rec(p, q, a->func, dt, rows, bytes);
 }
 
-static VALUE
-dbc_deldsn(int argc, VALUE *argv, VALUE self)
+/*
+ * While a driver call is made without the GVL (or a fiber waits for
+ * an asynchronous one), its statement and connection are marked busy
+ * so that other threads/fibers cannot close, drop or disconnect them,
+ * see stmt_check_busy() and dbc_check_busy().
+ */
+
+static void
+nogvl_owner(NOGVLARGS *a, DBC **pp, STMT **qp)
 {
-#ifdef HAVE_ODBCINST_H
-    return conf_dsn(argc, argv, self, ODBC_REMOVE_DSN);
-#else
-    rb_raise(Cerror, "%s", set_err("ODBC::del_dsn not supported", 0));
-    return Qnil;
-#endif
+    if (a->func == NOGVL_WRITE) {
+	*pp = NULL;
+	*qp = NULL;
+    } else {
+	/* a statement handle not (yet) owned falls back to the connection */
+	diag_find(a->hdbc, a->hstmt, pp, qp);
+    }
+    if (*qp != NULL) {
+	(*qp)->busy++;
+    }
+    if (*pp != NULL) {
+	(*pp)->busy++;
+    }
 }
 
-static VALUE
-dbc_wfdsn(int argc, VALUE *argv, VALUE self)
+static void
+nogvl_done(DBC *p, STMT *q)
 {
-#ifdef HAVE_ODBCINST_H
-    VALUE fname, aname, kname, val;
-#ifdef UNICODE
-#ifdef HAVE_SQLWRITEFILEDSNW
-    int have_w = 1;
-#else
-    int have_w = 0;
-#endif
-    SQLWCHAR *sfname, *saname, *skname, *sval = NULL;
-#else
-    char *sfname, *saname, *skname, *sval = NULL;
-#endif
-
-    rb_scan_args(argc, argv, "31", &fname, &aname, &kname, &val);
-    Check_Type(fname, T_STRING);
-    Check_Type(aname, T_STRING);
-    Check_Type(kname, T_STRING);
-    if (val != Qnil) {
-	Check_Type(val, T_STRING);
+    if (q != NULL) {
+	q->busy--;
     }
-#ifdef UNICODE
-#ifdef USE_DLOPEN_FOR_ODBC_LIBS
-    have_w = ruby_odbc_have_func("SQLWriteFileDSNW", SQLWriteFileDSNW);
-#endif
-    if (have_w) {
-	BOOL rc;
+    if (p != NULL) {
+	p->busy--;
+    }
+}
 
-#ifdef USE_RB_ENC
-	fname = rb_funcall(fname, IDencode, 1, rb_encv);
-	aname = rb_funcall(aname, IDencode, 1, rb_encv);
-	kname = rb_funcall(kname, IDencode, 1, rb_encv);
-	if (val != Qnil) {
-	    val = rb_funcall(val, IDencode, 1, rb_encv);
-	}
+static SQLRETURN
+nogvl_call(NOGVLARGS *a)
+{
+    double t0 = stats_now();
+    DBC *p;
+    STMT *q;
+#ifdef USE_NOGVL
+    rb_unblock_function_t *ubf = nogvl_ubf;
 #endif
-	sfname = uc_from_utf((unsigned char *) STR2CSTR(fname), -1);
-	saname = uc_from_utf((unsigned char *) STR2CSTR(aname), -1);
-	skname = uc_from_utf((unsigned char *) STR2CSTR(kname), -1);
-	if ((sfname == NULL) || (saname == NULL) || (skname == NULL)) {
-nomem:
-	    uc_free(sfname);
-	    uc_free(saname);
-	    uc_free(skname);
-	    rb_raise(Cerror, "%s", set_err("Out of memory", 0));
-	}
-	if (val != Qnil) {
-	    sval = uc_from_utf((unsigned char *) STR2CSTR(val), -1);
-	    if (sval == NULL) {
-		goto nomem;
-	    }
-	}
-	rc = SQLWriteFileDSNW(sfname, saname, skname, sval);
-	uc_free(sfname);
-	uc_free(saname);
-	uc_free(skname);
-	uc_free(sval);
-	if (rc) {
-	    return Qnil;
-	}
-    } else {
-	sfname = (SQLWCHAR *) STR2CSTR(fname);
-	saname = (SQLWCHAR *) STR2CSTR(aname);
-	skname = (SQLWCHAR *) STR2CSTR(kname);
-	if (val != Qnil) {
-	    sval = (SQLWCHAR *) STR2CSTR(val);
+#ifdef USE_FIBER_ASYNC
+    int state = 0;
+#endif
+
+    nogvl_owner(a, &p, &q);
+    if (q != NULL) {
+	if ((a->func == NOGVL_FETCH) || (a->func == NOGVL_FETCHSCRL)) {
+	    /* new warnings supersede pending ones */
+	    q->lazyinfo = 1;
+	} else {
+	    diag_drain(q);
+	    q->lazyinfo = 0;
 	}
-	if (SQLWriteFileDSN((LPCSTR) sfname, (LPCSTR) saname,
-			    (LPCSTR) skname, (LPCSTR) sval)) {
-	    return Qnil;
+    }
+#ifdef USE_FIBER_ASYNC
+    if (nogvl_async(a, q, &state)) {
+	nogvl_done(p, q);
+	if (state) {
+	    rb_jump_tag(state);
 	}
+	stats_call(a, t0, p, q);
+	return a->ret;
     }
-#else
-    sfname = STR2CSTR(fname);
-    saname = STR2CSTR(aname);
-    skname = STR2CSTR(kname);
-    if (val != Qnil) {
-	sval = STR2CSTR(val);
+    if ((q != NULL) && q->async && async_off(a->hstmt)) {
+	/* left over by an asynchronous call, now outside a scheduler */
+	q->async = 0;
     }
-    if (SQLWriteFileDSN(sfname, saname, skname, sval)) {
-	return Qnil;
+#endif
+    a->called = 0;
+#ifdef USE_NOGVL
+#ifdef RUBY_UBF_IO
+    if (a->func == NOGVL_WRITE) {
+	/* no statement to cancel, write(2) is interrupted by a signal */
+	ubf = RUBY_UBF_IO;
     }
 #endif
-#if defined(HAVE_SQLINSTALLERERROR) || (defined(UNICODE) && defined(HAVE_SQLINSTALLERERRORW))
-    rb_raise(Cerror, "%s", set_err(get_installer_err(), 0));
+#ifdef HAVE_RB_THREAD_CALL_WITHOUT_GVL2
+    /*
+     * Pending interrupts are not checked on return, thus
+     * no exception is thrown past our cleanup code. When
+     * interrupted before the call was made, make it with
+     * the GVL held; the interrupt is handled later on.
+     */
+    rb_thread_call_without_gvl2(nogvl_func, a, ubf, a);
 #else
-    rb_raise(Cerror, "%s", set_err("File DSN configuration error", 0));
+    rb_thread_call_without_gvl(nogvl_func, a, ubf, a);
 #endif
-#else
-    rb_raise(Cerror, "%s", set_err("ODBC::write_file_dsn not supported", 0));
 #endif
-    return Qnil;
+    if (!a->called) {
+	nogvl_func(a);
+    }
+    nogvl_done(p, q);
+    stats_call(a, t0, p, q);
+    return a->ret;
 }
 
-static VALUE
-dbc_rfdsn(int argc, VALUE *argv, VALUE self)
+static SQLRETURN
+nogvl_execute(SQLHSTMT hstmt)
 {
-#ifdef HAVE_ODBCINST_H
-    VALUE fname, aname, kname;
-#ifdef UNICODE
-#ifdef HAVE_SQLREADFILEDSNW
-    int have_w = 1;
-#else
-    int have_w = 0;
-#endif
-    SQLWCHAR *sfname, *saname, *skname, valbuf[SQL_MAX_MESSAGE_LENGTH];
-#else
-    char *sfname, *saname, *skname, valbuf[SQL_MAX_MESSAGE_LENGTH];
-#endif
+    NOGVLARGS a;
 
-    rb_scan_args(argc, argv, "30", &fname, &aname, &kname);
-    Check_Type(fname, T_STRING);
-    Check_Type(aname, T_STRING);
-    Check_Type(kname, T_STRING);
-#ifdef UNICODE
-#ifdef USE_DLOPEN_FOR_ODBC_LIBS
-    have_w = ruby_odbc_have_func("SQLReadFileDSNW", SQLReadFileDSNW);
-#endif
-    if (have_w) {
-	BOOL rc;
+    a.func = NOGVL_EXECUTE;
+    a.hdbc = SQL_NULL_HDBC;
+    a.hstmt = hstmt;
+    return nogvl_call(&a);
+}
 
-#ifdef USE_RB_ENC
-	fname = rb_funcall(fname, IDencode, 1, rb_encv);
-	aname = rb_funcall(aname, IDencode, 1, rb_encv);
-	kname = rb_funcall(kname, IDencode, 1, rb_encv);
-#endif
-	sfname = uc_from_utf((unsigned char *) STR2CSTR(fname), -1);
-	saname = uc_from_utf((unsigned char *) STR2CSTR(aname), -1);
-	skname = uc_from_utf((unsigned char *) STR2CSTR(kname), -1);
-	valbuf[0] = 0;
-	if ((sfname == NULL) || (saname == NULL) || (skname == NULL)) {
-	    uc_free(sfname);
-	    uc_free(saname);
-	    uc_free(skname);
-	    rb_raise(Cerror, "%s", set_err("Out of memory", 0));
-	}
-	rc = SQLReadFileDSNW(sfname, saname, skname, valbuf,
-			     sizeof (valbuf), NULL);
-	uc_free(sfname);
-	uc_free(saname);
-	uc_free(skname);
-	if (rc) {
-	    return uc_tainted_str_new2(valbuf);
-	}
-    } else {
-	sfname = (SQLWCHAR *) STR2CSTR(fname);
-	saname = (SQLWCHAR *) STR2CSTR(aname);
-	skname = (SQLWCHAR *) STR2CSTR(kname);
-	valbuf[0] = '\0';
-	if (SQLReadFileDSN((LPCSTR) sfname, (LPCSTR) saname,
-			   (LPCSTR) skname, (LPSTR) valbuf,
-			   sizeof (valbuf), NULL)) {
-	    return rb_tainted_str_new2((char *) valbuf);
-	}
-    }
-#else
-    sfname = STR2CSTR(fname);
-    saname = STR2CSTR(aname);
-    skname = STR2CSTR(kname);
-    valbuf[0] = '\0';
-    if (SQLReadFileDSN(sfname, saname, skname, valbuf,
-		       sizeof (valbuf), NULL)) {
-	return rb_tainted_str_new2(valbuf);
-    }
-#endif
-#if defined(HAVE_SQLINSTALLERERROR) || (defined(UNICODE) && defined(HAVE_SQLINSTALLERERRORW))
-    rb_raise(Cerror, "%s", set_err(get_installer_err(), 0));
-#else
-    rb_raise(Cerror, "%s", set_err("File DSN configuration error", 0));
-#endif
-#else
-    rb_raise(Cerror, "%s", set_err("ODBC::read_file_dsn not supported", 0));
-    return Qnil;
-#endif
+static SQLRETURN
+nogvl_execdirect(SQLHDBC hdbc, SQLHSTMT hstmt, SQLTCHAR *sql)
+{
+    NOGVLARGS a;
+
+    a.func = NOGVL_EXECDIRECT;
+    a.hdbc = hdbc;
+    a.hstmt = hstmt;
+    a.sql = sql;
+    return nogvl_call(&a);
 }
 
-/*
- *----------------------------------------------------------------------
- *
- *      Return last ODBC error or warning.
- *
- *----------------------------------------------------------------------
- */
+static SQLRETURN
+nogvl_prepare(SQLHDBC hdbc, SQLHSTMT hstmt, SQLTCHAR *sql)
+{
+    NOGVLARGS a;
 
-static VALUE
-dbc_error(VALUE self)
+    a.func = NOGVL_PREPARE;
+    a.hdbc = hdbc;
+    a.hstmt = hstmt;
+    a.sql = sql;
+    return nogvl_call(&a);
+}
+
+static SQLRETURN
+nogvl_fetch(SQLHSTMT hstmt)
 {
-    return rb_cvar_get(Cobj, IDataterror);
+    NOGVLARGS a;
+
+    a.func = NOGVL_FETCH;
+    a.hdbc = SQL_NULL_HDBC;
+    a.hstmt = hstmt;
+    return nogvl_call(&a);
 }
 
-static VALUE
-dbc_warn(VALUE self)
+static SQLRETURN
+nogvl_moreresults(SQLHSTMT hstmt)
 {
-    return rb_cvar_get(Cobj, IDatatinfo);
+    NOGVLARGS a;
+
+    a.func = NOGVL_MORERES;
+    a.hdbc = SQL_NULL_HDBC;
+    a.hstmt = hstmt;
+    return nogvl_call(&a);
 }
 
-static VALUE
-dbc_clrerror(VALUE self)
+static SQLRETURN
+nogvl_fetchscroll(SQLHSTMT hstmt, SQLSMALLINT dir, SQLLEN offs)
 {
-    CVAR_SET(Cobj, IDataterror, Qnil);
-    CVAR_SET(Cobj, IDatatinfo, Qnil);
-    return Qnil;
+    NOGVLARGS a;
+
+    a.func = NOGVL_FETCHSCRL;
+    a.hdbc = SQL_NULL_HDBC;
+    a.hstmt = hstmt;
+    a.dir = dir;
+    a.offs = offs;
+    return nogvl_call(&a);
+}
+
+static SQLRETURN
+nogvl_getdata(SQLHSTMT hstmt, SQLUSMALLINT col, SQLSMALLINT type,
+	      SQLPOINTER val, SQLLEN len, SQLLEN *lenp)
+{
+    NOGVLARGS a;
+
+    a.func = NOGVL_GETDATA;
+    a.hdbc = SQL_NULL_HDBC;
+    a.hstmt = hstmt;
+    a.col = col;
+    a.type = type;
+    a.val = val;
+    a.len = len;
+    a.lenp = lenp;
+    return nogvl_call(&a);
+}
+
+static SQLRETURN
+nogvl_connect(SQLHDBC hdbc, SQLTCHAR *dsn, SQLTCHAR *user, SQLTCHAR *passwd)
+{
+    NOGVLARGS a;
+
+    a.func = NOGVL_CONNECT;
+    a.hdbc = hdbc;
+    a.hstmt = SQL_NULL_HSTMT;
+    a.sql = dsn;
+    a.user = user;
+    a.passwd = passwd;
+    return nogvl_call(&a);
+}
+
+static SQLRETURN
+nogvl_drvconnect(SQLHDBC hdbc, SQLTCHAR *drv)
+{
+    NOGVLARGS a;
+
+    a.func = NOGVL_DRVCONNECT;
+    a.hdbc = hdbc;
+    a.hstmt = SQL_NULL_HSTMT;
+    a.sql = drv;
+    return nogvl_call(&a);
+}
+
+static SQLRETURN
+nogvl_getconnopt(SQLHDBC hdbc, SQLUSMALLINT opt, SQLPOINTER val)
+{
+    NOGVLARGS a;
+
+    a.func = NOGVL_GETCONNOPT;
+    a.hdbc = hdbc;
+    a.hstmt = SQL_NULL_HSTMT;
+    a.attr = opt;
+    a.val = val;
+    return nogvl_call(&a);
+}
+
+static SQLRETURN
+nogvl_paramdata(SQLHSTMT hstmt, SQLPOINTER *tokenp)
+{
+    NOGVLARGS a;
+
+    a.func = NOGVL_PARAMDATA;
+    a.hdbc = SQL_NULL_HDBC;
+    a.hstmt = hstmt;
+    a.val = (SQLPOINTER) tokenp;
+    return nogvl_call(&a);
+}
+
+static SQLRETURN
+nogvl_putdata(SQLHSTMT hstmt, SQLPOINTER data, SQLLEN len)
+{
+    NOGVLARGS a;
+
+    a.func = NOGVL_PUTDATA;
+    a.hdbc = SQL_NULL_HDBC;
+    a.hstmt = hstmt;
+    a.val = data;
+    a.len = len;
+    return nogvl_call(&a);
+}
+
+static long
+nogvl_write(int fd, char *buf, size_t len, int *errp)
+{
+    NOGVLARGS a;
+
+    a.func = NOGVL_WRITE;
+    a.hdbc = SQL_NULL_HDBC;
+    a.hstmt = SQL_NULL_HSTMT;
+    a.fd = fd;
+    a.val = (SQLPOINTER) buf;
+    a.len = (SQLLEN) len;
+    nogvl_call(&a);
+    *errp = a.err;
+    return (long) a.len;
 }
 
 /*
  *----------------------------------------------------------------------
  *
- *      Connection instance initializer.
+ *      Block cursor support.
+ *
+ *      When the row set size of a statement is greater than one,
+ *      result columns are bound column-wise using SQLBindCol() and
+ *      that many rows are retrieved per SQLFetchScroll(). The fetch
+ *      methods then deliver rows out of the bound arrays. Long
+ *      (SQL_NO_TOTAL) columns are read using SQLSetPos() and
+ *      SQLGetData() which requires SQL_GD_BLOCK support of the
+ *      driver, otherwise single row fetches are used.
  *
  *----------------------------------------------------------------------
  */
 
-#ifdef HAVE_RB_DEFINE_ALLOC_FUNC
-static VALUE
-dbc_alloc(VALUE self)
+static void
+rowset_free(STMT *q)
 {
-    DBC *p;
-    VALUE obj = Data_Make_Struct(self, DBC, mark_dbc, free_dbc, p);
-
-    tracemsg(2, fprintf(stderr, "ObjAlloc: DBC %p\n", p););
-    list_init(&p->link, offsetof(DBC, link));
-    p->self = obj;
-    p->env = Qnil;
-    p->envp = NULL;
-    list_init(&p->stmts, offsetof(STMT, link));
-    p->hdbc = SQL_NULL_HDBC;
-    p->rbtime = Qfalse;
-    p->gmtime = Qfalse;
-    return obj;
-}
+#if (ODBCVER >= 0x0300)
+    if ((q->rsmode > 0) && (q->hstmt != SQL_NULL_HSTMT)) {
+	callsql(SQL_NULL_HENV, SQL_NULL_HDBC, q->hstmt,
+		SQLFreeStmt(q->hstmt, SQL_UNBIND), "SQLFreeStmt(SQL_UNBIND)");
+	callsql(SQL_NULL_HENV, SQL_NULL_HDBC, q->hstmt,
+		SQLSetStmtAttr(q->hstmt, SQL_ATTR_ROW_ARRAY_SIZE,
+			       (SQLPOINTER) 1, 0),
+		"SQLSetStmtAttr(SQL_ATTR_ROW_ARRAY_SIZE)");
+	callsql(SQL_NULL_HENV, SQL_NULL_HDBC, q->hstmt,
+		SQLSetStmtAttr(q->hstmt, SQL_ATTR_ROWS_FETCHED_PTR, NULL, 0),
+		"SQLSetStmtAttr(SQL_ATTR_ROWS_FETCHED_PTR)");
+	callsql(SQL_NULL_HENV, SQL_NULL_HDBC, q->hstmt,
+		SQLSetStmtAttr(q->hstmt, SQL_ATTR_ROW_STATUS_PTR, NULL, 0),
+		"SQLSetStmtAttr(SQL_ATTR_ROW_STATUS_PTR)");
+    }
 #endif
+    if (q->rsbufs != NULL) {
+	xfree(q->rsbufs);
+	q->rsbufs = NULL;
+    }
+    q->rsbufsize = 0;
+    q->rsmode = 0;
+    q->rsrows = q->rspos = 0;
+}
 
-static VALUE
-dbc_new(int argc, VALUE *argv, VALUE self)
+static void
+rowset_setup(STMT *q)
 {
-    DBC *p;
-    VALUE obj, env = Qnil;
+#if (ODBCVER >= 0x0300)
+    int i, nlong = 0, firstlong = -1, lastbound = -1;
+    size_t need;
+    SQLULEN nrows;
+    SQLRETURN ret;
+    char *p;
 
-    if (TYPE(self) == T_MODULE) {
-	self = Cobj;
+    q->rsmode = -1;
+    if ((q->rssize <= 1) || (q->ncols <= 0) || (q->coltypes == NULL) ||
+	(q->dbcp == NULL) || (q->hstmt == SQL_NULL_HSTMT)) {
+	return;
     }
-    if (self == Cobj) {
-	self = Cdbc;
+    for (i = 0; i < q->ncols; i++) {
+	if (q->coltypes[i].size == SQL_NO_TOTAL) {
+	    if (firstlong < 0) {
+		firstlong = i;
+	    }
+	    nlong++;
+	} else {
+	    lastbound = i;
+	}
     }
-    if (rb_obj_is_kind_of(self, Cenv) == Qtrue) {
-	env = env_of(self);
-	self = Cdbc;
+    if (nlong >= q->ncols) {
+	return;
     }
-#ifdef HAVE_RB_DEFINE_ALLOC_FUNC
-    obj = rb_obj_alloc(Cdbc);
-    Data_Get_Struct(obj, DBC, p);
-    p->env = env;
+    if (nlong > 0) {
+	SQLUINTEGER gdext = 0;
+
+	if (!SQL_SUCCEEDED(SQLGetInfo(q->dbcp->hdbc, SQL_GETDATA_EXTENSIONS,
+				      (SQLPOINTER) &gdext, sizeof (gdext),
+				      NULL))) {
+	    gdext = 0;
+	}
+	if (!(gdext & SQL_GD_BLOCK)) {
+	    return;
+	}
+	if ((firstlong < lastbound) && !(gdext & SQL_GD_ANY_COLUMN)) {
+	    return;
+	}
+    }
+    need = LEN_ALIGN(sizeof (char *) * q->ncols);
+    need += LEN_ALIGN(sizeof (SQLLEN) * q->ncols * q->rssize);
+    need += LEN_ALIGN(sizeof (SQLUSMALLINT) * q->rssize);
+    for (i = 0; i < q->ncols; i++) {
+	if (q->coltypes[i].size != SQL_NO_TOTAL) {
+	    need += LEN_ALIGN((size_t) q->coltypes[i].size * q->rssize);
+	}
+    }
+    p = ALLOC_N(char, need);
+    if (p == NULL) {
+	return;
+    }
+    q->rsbufs = (char **) p;
+    q->rsbufsize = need;
+    p += LEN_ALIGN(sizeof (char *) * q->ncols);
+    q->rslens = (SQLLEN *) p;
+    p += LEN_ALIGN(sizeof (SQLLEN) * q->ncols * q->rssize);
+    q->rsstat = (SQLUSMALLINT *) p;
+    p += LEN_ALIGN(sizeof (SQLUSMALLINT) * q->rssize);
+    for (i = 0; i < q->ncols; i++) {
+	if (q->coltypes[i].size == SQL_NO_TOTAL) {
+	    q->rsbufs[i] = NULL;
+	} else {
+	    q->rsbufs[i] = p;
+	    p += LEN_ALIGN((size_t) q->coltypes[i].size * q->rssize);
+	}
+    }
+    q->rsmax = q->rssize;
+    q->rsgd = nlong > 0;
+    q->rsrows = q->rspos = 0;
+    /* from now on rowset_free() must reset the statement */
+    q->rsmode = 1;
+    if (!SQL_SUCCEEDED(callsql(SQL_NULL_HENV, SQL_NULL_HDBC, q->hstmt,
+			       SQLSetStmtAttr(q->hstmt,
+					      SQL_ATTR_ROW_BIND_TYPE,
+					      (SQLPOINTER) SQL_BIND_BY_COLUMN,
+					      0),
+			       "SQLSetStmtAttr(SQL_ATTR_ROW_BIND_TYPE)"))) {
+	goto error;
+    }
+    ret = callsql(SQL_NULL_HENV, SQL_NULL_HDBC, q->hstmt,
+		  SQLSetStmtAttr(q->hstmt, SQL_ATTR_ROW_ARRAY_SIZE,
+				 (SQLPOINTER) (SQLULEN) q->rsmax, 0),
+		  "SQLSetStmtAttr(SQL_ATTR_ROW_ARRAY_SIZE)");
+    if (!SQL_SUCCEEDED(ret)) {
+	goto error;
+    }
+    if (ret == SQL_SUCCESS_WITH_INFO) {
+	/* driver substituted a smaller row set size */
+	nrows = 0;
+	callsql(SQL_NULL_HENV, SQL_NULL_HDBC, q->hstmt,
+		SQLGetStmtAttr(q->hstmt, SQL_ATTR_ROW_ARRAY_SIZE,
+			       (SQLPOINTER) &nrows, sizeof (nrows), NULL),
+		"SQLGetStmtAttr(SQL_ATTR_ROW_ARRAY_SIZE)");
+	if ((nrows <= 1) || (nrows > (SQLULEN) q->rsmax)) {
+	    goto error;
+	}
+    }
+    if (!SQL_SUCCEEDED(callsql(SQL_NULL_HENV, SQL_NULL_HDBC, q->hstmt,
+			       SQLSetStmtAttr(q->hstmt,
+					      SQL_ATTR_ROWS_FETCHED_PTR,
+					      (SQLPOINTER) &q->rsrows, 0),
+			       "SQLSetStmtAttr(SQL_ATTR_ROWS_FETCHED_PTR)")) ||
+	!SQL_SUCCEEDED(callsql(SQL_NULL_HENV, SQL_NULL_HDBC, q->hstmt,
+			       SQLSetStmtAttr(q->hstmt,
+					      SQL_ATTR_ROW_STATUS_PTR,
+					      (SQLPOINTER) q->rsstat, 0),
+			       "SQLSetStmtAttr(SQL_ATTR_ROW_STATUS_PTR)"))) {
+	goto error;
+    }
+    for (i = 0; i < q->ncols; i++) {
+	if (q->rsbufs[i] == NULL) {
+	    continue;
+	}
+	if (!SQL_SUCCEEDED(callsql(SQL_NULL_HENV, SQL_NULL_HDBC, q->hstmt,
+				   SQLBindCol(q->hstmt, (SQLUSMALLINT) (i + 1),
+					      (SQLSMALLINT) q->coltypes[i].type,
+					      (SQLPOINTER) q->rsbufs[i],
+					      q->coltypes[i].size,
+					      q->rslens + i * q->rsmax),
+				   "SQLBindCol"))) {
+	    goto error;
+	}
+    }
+    return;
+error:
+    rowset_free(q);
+    q->rsmode = -1;
 #else
-    obj = Data_Make_Struct(self, DBC, mark_dbc, free_dbc, p);
-    tracemsg(2, fprintf(stderr, "ObjAlloc: DBC %p\n", p););
-    list_init(&p->link, offsetof(DBC, link));
-    p->self = obj;
-    p->env = env;
-    p->envp = NULL;
-    list_init(&p->stmts, offsetof(STMT, link));
-    p->hdbc = SQL_NULL_HDBC;
-    p->upc = 0;
+    q->rsmode = -1;
 #endif
-    if (env != Qnil) {
-	ENV *e;
+}
 
-	Data_Get_Struct(env, ENV, e);
-	link_dbc(p, e);
+static SQLRETURN
+fetch_rowset(STMT *q, int dir, SQLLEN offs, int usef)
+{
+    SQLRETURN ret;
+
+    if (q->rsmode == 0) {
+	rowset_setup(q);
     }
-    if (argc > 0) {
-	rb_obj_call_init(obj, argc, argv);
+    if (q->rsmode <= 0) {
+	return usef ? nogvl_fetch(q->hstmt)
+		    : nogvl_fetchscroll(q->hstmt, (SQLSMALLINT) dir, offs);
     }
-    return obj;
+    ret = SQL_SUCCESS;
+    if (dir == SQL_FETCH_NEXT) {
+	while (++q->rspos < q->rsrows) {
+	    if (q->rsstat[q->rspos] != SQL_ROW_NOROW) {
+		goto gotrow;
+	    }
+	}
+    } else if (dir == SQL_FETCH_LAST) {
+	/* row set starting at the last row */
+	dir = SQL_FETCH_ABSOLUTE;
+	offs = -1;
+    } else if ((dir == SQL_FETCH_PRIOR) || (dir == SQL_FETCH_RELATIVE)) {
+	SQLLEN pos = (SQLLEN) q->rspos;
+
+	/*
+	 * The driver moves these by whole row sets, continue with
+	 * single row fetches relative to the current row instead.
+	 */
+	rowset_free(q);
+	q->rsmode = -1;
+	if (dir == SQL_FETCH_PRIOR) {
+	    if (pos == 0) {
+		return nogvl_fetchscroll(q->hstmt, SQL_FETCH_PRIOR, 0);
+	    }
+	    offs = -1;
+	}
+	return nogvl_fetchscroll(q->hstmt, SQL_FETCH_RELATIVE, pos + offs);
+    }
+    q->rsrows = q->rspos = 0;
+    ret = usef ? nogvl_fetch(q->hstmt)
+	       : nogvl_fetchscroll(q->hstmt, (SQLSMALLINT) dir, offs);
+    if (!SQL_SUCCEEDED(ret)) {
+	q->rsrows = 0;
+	return ret;
+    }
+gotrow:
+    if (q->rsstat[q->rspos] == SQL_ROW_ERROR) {
+	rb_raise(Cerror, "%s", set_err("Error in row of row set", 0));
+    }
+    return ret;
 }
 
 /*
  *----------------------------------------------------------------------
  *
- *      Connect to data source.
+ *      Return ENV from VALUE.
  *
  *----------------------------------------------------------------------
  */
 
 static VALUE
-dbc_connect(int argc, VALUE *argv, VALUE self)
+env_of(VALUE self)
 {
-    ENV *e;
-    DBC *p;
-    VALUE dsn, user, passwd;
-#ifdef UNICODE
-    SQLWCHAR *sdsn = NULL, *suser = NULL, *spasswd = NULL;
-#else
-    char *sdsn, *suser = NULL, *spasswd = NULL;
-#endif
-    char *msg;
-    SQLHDBC dbc;
+    if (rb_obj_is_kind_of(self, Cstmt) == Qtrue) {
+	STMT *q;
 
-    rb_scan_args(argc, argv, "03", &dsn, &user, &passwd);
-    if (dsn != Qnil) {
-	if (rb_obj_is_kind_of(dsn, Cdsn) == Qtrue) {
-	    dsn = rb_iv_get(dsn, "@name");
+	ODBC_Get_Struct(self, STMT, stmt_type, q);
+	self = q->dbc;
+	if (self == Qnil) {
+	    rb_raise(Cerror, "%s", set_err("Stale ODBC::Statement", 0));
 	}
-	Check_Type(dsn, T_STRING);
     }
-    if (user != Qnil) {
-	Check_Type(user, T_STRING);
-    }
-    if (passwd != Qnil) {
-	Check_Type(passwd, T_STRING);
-    }
-    p = get_dbc(self);
-    if (p->hdbc != SQL_NULL_HDBC) {
-	rb_raise(Cerror, "%s", set_err("Already connected", 0));
-    }
-    if (p->env == Qnil) {
-	p->env = env_new(Cenv);
-	e = get_env(p->env);
-	link_dbc(p, e);
-    } else {
-	e = get_env(p->env);
-    }
-    if (dsn == Qnil) {
-	return self;
-    }
-#ifdef UNICODE
-    if (user != Qnil) {
-#ifdef USE_RB_ENC
-	user = rb_funcall(user, IDencode, 1, rb_encv);
-#endif
-	suser = uc_from_utf((unsigned char *) STR2CSTR(user), -1);
-    }
-    if (passwd != Qnil) {
-#ifdef USE_RB_ENC
-	passwd = rb_funcall(passwd, IDencode, 1, rb_encv);
-#endif
-	spasswd = uc_from_utf((unsigned char *) STR2CSTR(passwd), -1);
-    }
-#ifdef USE_RB_ENC
-    dsn = rb_funcall(dsn, IDencode, 1, rb_encv);
-#endif
-    sdsn = uc_from_utf((unsigned char *) STR2CSTR(dsn), -1);
-    if (((suser == NULL) && (user != Qnil)) ||
-	((spasswd == NULL) && (passwd != Qnil)) ||
-	(sdsn == NULL)) {
-	uc_free(sdsn);
-	uc_free(suser);
-	uc_free(spasswd);
-	rb_raise(Cerror, "%s", set_err("Out of memory", 0));
-    }
-#else
-    if (user != Qnil) {
-	suser = STR2CSTR(user);
-    }
-    if (passwd != Qnil) {
-	spasswd = STR2CSTR(passwd);
-    }
-    sdsn = STR2CSTR(dsn);
-#endif
-    if (!succeeded(e->henv, SQL_NULL_HDBC, SQL_NULL_HSTMT,
-		   SQLAllocConnect(e->henv, &dbc), &msg, "SQLAllocConnect")) {
-#ifdef UNICODE
-	uc_free(sdsn);
-	uc_free(suser);
-	uc_free(spasswd);
-#endif
-	rb_raise(Cerror, "%s", msg);
-    }
-    if (!succeeded(SQL_NULL_HENV, dbc, SQL_NULL_HSTMT,
-		   SQLConnect(dbc, (SQLTCHAR *) sdsn, SQL_NTS,
-			      (SQLTCHAR *) suser,
-			      (SQLSMALLINT) (suser ? SQL_NTS : 0),
-			      (SQLTCHAR *) spasswd,
-			      (SQLSMALLINT) (spasswd ? SQL_NTS : 0)),
-		   &msg,
-		   "SQLConnect('%s')", sdsn)) {
-#ifdef UNICODE
-	uc_free(sdsn);
-	uc_free(suser);
-	uc_free(spasswd);
-#endif
-	callsql(SQL_NULL_HENV, dbc, SQL_NULL_HSTMT,
-		SQLFreeConnect(dbc), "SQLFreeConnect");
-	rb_raise(Cerror, "%s", msg);
+    if (rb_obj_is_kind_of(self, Cdbc) == Qtrue) {
+	DBC *p;
+
+	ODBC_Get_Struct(self, DBC, dbc_type, p);
+	self = p->env;
+	if (self == Qnil) {
+	    rb_raise(Cerror, "%s", set_err("Stale ODBC::Database", 0));
+	}
     }
-#ifdef UNICODE
-    uc_free(sdsn);
-    uc_free(suser);
-    uc_free(spasswd);
-#endif
-    p->hdbc = dbc;
     return self;
 }
 
-static VALUE
-dbc_drvconnect(VALUE self, VALUE drv)
+static ENV *
+get_env(VALUE self)
 {
     ENV *e;
-    DBC *p;
-#ifdef UNICODE
-    SQLWCHAR *sdrv;
-#else
-    char *sdrv;
-#endif
-    char *msg;
-    SQLHDBC dbc;
 
-    if (rb_obj_is_kind_of(drv, Cdrv) == Qtrue) {
-	VALUE d, a, x;
+    ODBC_Get_Struct(env_of(self), ENV, env_type, e);
+    return e;
+}
 
-	d = rb_str_new2("");
-	a = rb_funcall(rb_iv_get(drv, "@attrs"), IDkeys, 0, NULL);
-	while ((x = rb_ary_shift(a)) != Qnil) {
-	    VALUE v = rb_hash_aref(rb_iv_get(drv, "@attrs"), x);
+/*
+ *----------------------------------------------------------------------
+ *
+ *      Return DBC from VALUE.
+ *
+ *----------------------------------------------------------------------
+ */
 
-	    d = rb_str_concat(d, x);
-	    d = rb_str_cat2(d, "=");
-	    d = rb_str_concat(d, v);
-	    d = rb_str_cat2(d, ";");
+static DBC *
+get_dbc(VALUE self)
+{
+    DBC *p;
+
+    if (rb_obj_is_kind_of(self, Cstmt) == Qtrue) {
+	STMT *q;
+
+	ODBC_Get_Struct(self, STMT, stmt_type, q);
+	self = q->dbc;
+	if (self == Qnil) {
+	    rb_raise(Cerror, "%s", set_err("Stale ODBC::Statement", 0));
 	}
-	drv = d;
-    }
-    Check_Type(drv, T_STRING);
-    p = get_dbc(self);
-    if (p->hdbc != SQL_NULL_HDBC) {
-	rb_raise(Cerror, "%s", set_err("Already connected", 0));
-    }
-    if (p->env == Qnil) {
-	p->env = env_new(Cenv);
-	e = get_env(p->env);
-	link_dbc(p, e);
-    } else {
-	e = get_env(p->env);
-    }
-#ifdef UNICODE
-#ifdef USE_RB_ENC
-    drv = rb_funcall(drv, IDencode, 1, rb_encv);
-#endif
-    sdrv = uc_from_utf((unsigned char *) STR2CSTR(drv), -1);
-    if (sdrv == NULL) {
-	rb_raise(Cerror, "%s", set_err("Out of memory", 0));
-    }
-#else
-    sdrv = STR2CSTR(drv);
-#endif
-    if (!succeeded(e->henv, SQL_NULL_HDBC, SQL_NULL_HSTMT,
-		   SQLAllocConnect(e->henv, &dbc), &msg, "SQLAllocConnect")) {
-#ifdef UNICODE
-	uc_free(sdrv);
-#endif
-	rb_raise(Cerror, "%s", msg);
-    }
-    if (!succeeded(e->henv, dbc, SQL_NULL_HSTMT,
-		   SQLDriverConnect(dbc, NULL, (SQLTCHAR *) sdrv, SQL_NTS,
-				    NULL, 0, NULL, SQL_DRIVER_NOPROMPT),
-		   &msg, "SQLDriverConnect")) {
-#ifdef UNICODE
-	uc_free(sdrv);
-#endif
-	callsql(SQL_NULL_HENV, dbc, SQL_NULL_HSTMT,
-		SQLFreeConnect(dbc), "SQLFreeConnect");
-	rb_raise(Cerror, "%s", msg);
     }
-#ifdef UNICODE
-    uc_free(sdrv);
-#endif
-    p->hdbc = dbc;
-    return self;
+    ODBC_Get_Struct(self, DBC, dbc_type, p);
+    return p;
 }
 
-static VALUE
-dbc_connected(VALUE self)
-{
-    DBC *p = get_dbc(self);
-
-    return (p->hdbc == SQL_NULL_HDBC) ? Qfalse : Qtrue;
-}
+/* Refuse to free what a driver call in progress is using. */
 
-static VALUE
-dbc_timefmt(int argc, VALUE *argv, VALUE self)
+static void
+dbc_check_busy(DBC *p)
 {
-    DBC *p = get_dbc(self);
-    VALUE val;
-
-    if (argc > 0) {
-	rb_scan_args(argc, argv, "1", &val);
-	p->rbtime = (val != Qnil && val != Qfalse) ? Qtrue : Qfalse;
+    if (p->busy > 0) {
+	rb_raise(Cerror, "%s", set_err("Connection in use", 0));
     }
-    return p->rbtime;
 }
 
-static VALUE
-dbc_timeutc(int argc, VALUE *argv, VALUE self)
+static void
+stmt_check_busy(STMT *q)
 {
-    DBC *p = get_dbc(self);
-    VALUE val;
-
-    if (argc > 0) {
-	rb_scan_args(argc, argv, "1", &val);
-	p->gmtime = (val != Qnil && val != Qfalse) ? Qtrue : Qfalse;
+    if (q->busy > 0) {
+	rb_raise(Cerror, "%s", set_err("Statement in use", 0));
     }
-    return p->gmtime;
 }
 
 /*
  *----------------------------------------------------------------------
  *
- *      Drop all active statements from data source.
+ *      Raise ODBC error from Ruby.
  *
  *----------------------------------------------------------------------
  */
 
 static VALUE
-dbc_dropall(VALUE self)
+dbc_raise(VALUE self, VALUE msg)
 {
-    DBC *p = get_dbc(self);
-
-    while (!list_empty(&p->stmts)) {
-	STMT *q = list_first(&p->stmts);
+    VALUE a, v;
+    char buf[SQL_MAX_MESSAGE_LENGTH + 1], *p;
 
-	if (q->self == Qnil) {
-	    rb_fatal("RubyODBC: invalid stmt in dropall");
-	}
-	stmt_drop(q->self);
+    if (TYPE(msg) == T_STRING) {
+	v = msg;
+    } else {
+	v = rb_any_to_s(msg);
     }
-    return self;
+    strcpy(buf, "INTERN (1) [RubyODBC]");
+    p = STR2CSTR(v);
+    strncat(buf, p, SQL_MAX_MESSAGE_LENGTH - strlen(buf));
+    buf[SQL_MAX_MESSAGE_LENGTH] = '\0';
+    v = rb_str_new2(buf);
+    a = rb_ary_new2(1);
+    rb_ary_push(a, rb_obj_taint(v));
+    diag_set(SQL_NULL_HDBC, SQL_NULL_HSTMT, 0, a);
+    rb_raise(Cerror, "%s", buf);
+    return Qnil;
 }
 
 /*
  *----------------------------------------------------------------------
  *
- *      Disconnect from data source.
+ *      Obtain an ENV.
  *
  *----------------------------------------------------------------------
  */
 
 static VALUE
-dbc_disconnect(int argc, VALUE *argv, VALUE self)
+env_new(VALUE self)
 {
-    DBC *p = get_dbc(self);
-    VALUE nodrop = Qfalse;
-    char *msg;
+    ENV *e;
+    SQLHENV henv = SQL_NULL_HENV;
+    VALUE obj;
 
-    rb_scan_args(argc, argv, "01", &nodrop);
-    if (!RTEST(nodrop)) {
-	dbc_dropall(self);
+    if (TYPE(self) == T_MODULE) {
+	self = Cobj;
     }
-    if (p->hdbc == SQL_NULL_HDBC) {
-	return Qtrue;
+    if (self == Cobj) {
+	self = Cenv;
     }
-    if (list_empty(&p->stmts)) {
-	callsql(SQL_NULL_HENV, p->hdbc, SQL_NULL_HSTMT,
-		SQLDisconnect(p->hdbc), "SQLDisconnect");
-	if (!succeeded(SQL_NULL_HENV, p->hdbc, SQL_NULL_HSTMT,
-		       SQLFreeConnect(p->hdbc), &msg, "SQLFreeConnect")) {
-	    rb_raise(Cerror, "%s", msg);
-	}
-	p->hdbc = SQL_NULL_HDBC;
-	unlink_dbc(p);
-	start_gc();
-	return Qtrue;
+    if ((!SQL_SUCCEEDED(SQLAllocEnv(&henv))) || (henv == SQL_NULL_HENV)) {
+	rb_raise(Cerror, "%s", set_err("Cannot allocate SQLHENV", 0));
     }
-    return Qfalse;
-}
+    obj = ODBC_Make_Struct(self, ENV, env_type, NULL, free_env, e);
+    tracemsg(2, fprintf(stderr, "ObjAlloc: ENV %p\n", e););
+    e->self = obj;
+    e->henv = henv;
+    list_init(&e->dbcs, offsetof(DBC, link));
+#if defined(UNICODE) && defined(SQL_OV_ODBC3)
+    callsql(henv, SQL_NULL_HDBC, SQL_NULL_HSTMT,
+	    SQLSetEnvAttr(henv, SQL_ATTR_ODBC_VERSION,
+			  (SQLPOINTER) SQL_OV_ODBC3, 0),
+	    "SQLSetEnvAttr(SQL_OV_ODBC3)");
+#endif
+    return obj;
+}
 
 /*
  *----------------------------------------------------------------------
  *
- *      Database meta data via SQLGetInfo()
+ *      Obtain array of known DSNs.
  *
  *----------------------------------------------------------------------
  */
 
-#define GI_CONST_SINT(x) { #x, x, SQL_C_SHORT }
-#define GI_CONST_INT(x)  { #x, x, SQL_C_LONG }
-#define GI_CONST_BITS(x) { #x, x, SQL_C_LONG }
-#define GI_CONST_STR(x)  { #x, x, SQL_C_CHAR }
-#define GI_CONST_END     { NULL, -1, -1 }
-static struct {
-    const char *name;
-    int info;
-    int maptype;
-} get_info_map[] = {
+static VALUE
+dbc_dsns(VALUE self)
+{
+#ifdef UNICODE
+    SQLWCHAR dsn[SQL_MAX_DSN_LENGTH], descr[SQL_MAX_MESSAGE_LENGTH * 2];
+#else
+    char dsn[SQL_MAX_DSN_LENGTH], descr[SQL_MAX_MESSAGE_LENGTH * 2];
+#endif
+    SQLSMALLINT dsnLen = 0, descrLen = 0;
+    int first = 1;
+    VALUE env, aret;
+    ENV *e;
 
-    /* yielding ints */
-    GI_CONST_SINT(SQL_ACTIVE_ENVIRONMENTS),
-    GI_CONST_SINT(SQL_ACTIVE_CONNECTIONS),
-    GI_CONST_SINT(SQL_ACTIVE_STATEMENTS),
-    GI_CONST_INT(SQL_ASYNC_MODE),
-    GI_CONST_SINT(SQL_CATALOG_LOCATION),
-    GI_CONST_SINT(SQL_CONCAT_NULL_BEHAVIOR),
-    GI_CONST_SINT(SQL_CORRELATION_NAME),
-    GI_CONST_SINT(SQL_CURSOR_COMMIT_BEHAVIOR),
-    GI_CONST_SINT(SQL_CURSOR_ROLLBACK_BEHAVIOR),
-    GI_CONST_INT(SQL_CURSOR_SENSITIVITY),
-    GI_CONST_INT(SQL_DDL_INDEX),
-    GI_CONST_INT(SQL_DEFAULT_TXN_ISOLATION),
-    GI_CONST_INT(SQL_DRIVER_HDBC),
-    GI_CONST_INT(SQL_DRIVER_HENV),
-    GI_CONST_INT(SQL_DRIVER_HDESC),
-    GI_CONST_INT(SQL_DRIVER_HLIB),
-    GI_CONST_INT(SQL_DRIVER_HSTMT),
-    GI_CONST_SINT(SQL_FILE_USAGE),
-    GI_CONST_SINT(SQL_GROUP_BY),
-    GI_CONST_SINT(SQL_IDENTIFIER_CASE),
-    GI_CONST_INT(SQL_MAX_ASYNC_CONCURRENT_STATEMENTS),
-    GI_CONST_INT(SQL_MAX_BINARY_LITERAL_LEN),
-    GI_CONST_SINT(SQL_MAX_CATALOG_NAME_LEN),
-    GI_CONST_INT(SQL_MAX_CHAR_LITERAL_LEN),
-    GI_CONST_SINT(SQL_MAX_COLUMN_NAME_LEN),
-    GI_CONST_SINT(SQL_MAX_COLUMNS_IN_GROUP_BY),
-    GI_CONST_SINT(SQL_MAX_COLUMNS_IN_INDEX),
-    GI_CONST_SINT(SQL_MAX_COLUMNS_IN_ORDER_BY),
-    GI_CONST_SINT(SQL_MAX_COLUMNS_IN_SELECT),
-    GI_CONST_SINT(SQL_MAX_COLUMNS_IN_TABLE),
-    GI_CONST_SINT(SQL_MAX_CONCURRENT_ACTIVITIES),
-    GI_CONST_SINT(SQL_MAX_CURSOR_NAME_LEN),
-    GI_CONST_SINT(SQL_MAX_DRIVER_CONNECTIONS),
-    GI_CONST_SINT(SQL_MAX_IDENTIFIER_LEN),
-    GI_CONST_INT(SQL_MAX_INDEX_SIZE),
-    GI_CONST_SINT(SQL_MAX_OWNER_NAME_LEN),
-    GI_CONST_SINT(SQL_MAX_PROCEDURE_NAME_LEN),
-    GI_CONST_SINT(SQL_MAX_QUALIFIER_NAME_LEN),
-    GI_CONST_INT(SQL_MAX_ROW_SIZE),
-    GI_CONST_SINT(SQL_MAX_SCHEMA_NAME_LEN),
-    GI_CONST_INT(SQL_MAX_STATEMENT_LEN),
-    GI_CONST_SINT(SQL_MAX_TABLE_NAME_LEN),
-    GI_CONST_SINT(SQL_MAX_TABLES_IN_SELECT),
-    GI_CONST_SINT(SQL_MAX_USER_NAME_LEN),
-    GI_CONST_SINT(SQL_NON_NULLABLE_COLUMNS),
-    GI_CONST_SINT(SQL_NULL_COLLATION),
-    GI_CONST_SINT(SQL_ODBC_API_CONFORMANCE),
-    GI_CONST_INT(SQL_ODBC_INTERFACE_CONFORMANCE),
-    GI_CONST_SINT(SQL_ODBC_SAG_CLI_CONFORMANCE),
-    GI_CONST_SINT(SQL_ODBC_SQL_CONFORMANCE),
-    GI_CONST_INT(SQL_PARAM_ARRAY_ROW_COUNTS),
-    GI_CONST_INT(SQL_PARAM_ARRAY_SELECTS),
-    GI_CONST_SINT(SQL_QUALIFIER_LOCATION),
-    GI_CONST_SINT(SQL_QUOTED_IDENTIFIER_CASE),
-    GI_CONST_INT(SQL_SQL_CONFORMANCE),
-    GI_CONST_SINT(SQL_TXN_CAPABLE),
+    env = env_new(Cenv);
+    ODBC_Get_Struct(env, ENV, env_type, e);
+    aret = rb_ary_new();
+    while (succeeded(e->henv, SQL_NULL_HDBC, SQL_NULL_HSTMT,
+		     SQLDataSources(e->henv, (SQLUSMALLINT) (first ?
+				    SQL_FETCH_FIRST : SQL_FETCH_NEXT),
+				    (SQLTCHAR *) dsn,
+				    (SQLSMALLINT) sizeof (dsn), &dsnLen,
+				    (SQLTCHAR *) descr,
+				    (SQLSMALLINT) sizeof (descr),
+				    &descrLen),
+		     NULL, "SQLDataSources")) {
+	VALUE odsn = rb_obj_alloc(Cdsn);
 
-    /* yielding ints (but bitmasks) */
-    GI_CONST_BITS(SQL_AGGREGATE_FUNCTIONS),
-    GI_CONST_BITS(SQL_ALTER_DOMAIN),
-    GI_CONST_BITS(SQL_ALTER_TABLE),
-    GI_CONST_BITS(SQL_BATCH_ROW_COUNT),
-    GI_CONST_BITS(SQL_BATCH_SUPPORT),
-    GI_CONST_BITS(SQL_BOOKMARK_PERSISTENCE),
-    GI_CONST_BITS(SQL_CATALOG_USAGE),
-    GI_CONST_BITS(SQL_CONVERT_BINARY),
-    GI_CONST_BITS(SQL_CONVERT_BIT),
-    GI_CONST_BITS(SQL_CONVERT_CHAR),
-#ifdef SQL_CONVERT_GUID
-    GI_CONST_BITS(SQL_CONVERT_GUID),
+#ifdef UNICODE
+	dsnLen = (dsnLen == 0) ? (SQLSMALLINT) uc_strlen(dsn) :
+	    (SQLSMALLINT) (dsnLen / sizeof (SQLWCHAR));
+	descrLen = (descrLen == 0) ?
+	    (SQLSMALLINT) uc_strlen(descr) :
+	    (SQLSMALLINT) (descrLen / sizeof (SQLWCHAR));
+	rb_iv_set(odsn, "@name", uc_tainted_str_new(dsn, dsnLen));
+	rb_iv_set(odsn, "@descr", uc_tainted_str_new(descr, descrLen));
+#else
+	dsnLen = (dsnLen == 0) ? (SQLSMALLINT) strlen(dsn) : dsnLen;
+	descrLen = (descrLen == 0) ? (SQLSMALLINT) strlen(descr) : descrLen;
+	rb_iv_set(odsn, "@name", rb_tainted_str_new(dsn, dsnLen));
+	rb_iv_set(odsn, "@descr", rb_tainted_str_new(descr, descrLen));
 #endif
-    GI_CONST_BITS(SQL_CONVERT_DATE),
-    GI_CONST_BITS(SQL_CONVERT_DECIMAL),
-    GI_CONST_BITS(SQL_CONVERT_DOUBLE),
-    GI_CONST_BITS(SQL_CONVERT_FLOAT),
-    GI_CONST_BITS(SQL_CONVERT_FUNCTIONS),
-    GI_CONST_BITS(SQL_CONVERT_INTEGER),
-    GI_CONST_BITS(SQL_CONVERT_INTERVAL_YEAR_MONTH),
-    GI_CONST_BITS(SQL_CONVERT_INTERVAL_DAY_TIME),
-    GI_CONST_BITS(SQL_CONVERT_LONGVARBINARY),
-    GI_CONST_BITS(SQL_CONVERT_LONGVARCHAR),
-    GI_CONST_BITS(SQL_CONVERT_NUMERIC),
-    GI_CONST_BITS(SQL_CONVERT_REAL),
-    GI_CONST_BITS(SQL_CONVERT_SMALLINT),
-    GI_CONST_BITS(SQL_CONVERT_TIME),
-    GI_CONST_BITS(SQL_CONVERT_TIMESTAMP),
-    GI_CONST_BITS(SQL_CONVERT_TINYINT),
-    GI_CONST_BITS(SQL_CONVERT_VARBINARY),
-    GI_CONST_BITS(SQL_CONVERT_VARCHAR),
-    GI_CONST_BITS(SQL_CONVERT_WCHAR),
-    GI_CONST_BITS(SQL_CONVERT_WLONGVARCHAR),
-    GI_CONST_BITS(SQL_CONVERT_WVARCHAR),
-    GI_CONST_BITS(SQL_CREATE_ASSERTION),
-    GI_CONST_BITS(SQL_CREATE_CHARACTER_SET),
-    GI_CONST_BITS(SQL_CREATE_COLLATION),
-    GI_CONST_BITS(SQL_CREATE_DOMAIN),
-    GI_CONST_BITS(SQL_CREATE_SCHEMA),
-    GI_CONST_BITS(SQL_CREATE_TABLE),
-    GI_CONST_BITS(SQL_CREATE_TRANSLATION),
-    GI_CONST_BITS(SQL_CREATE_VIEW),
-    GI_CONST_BITS(SQL_DATETIME_LITERALS),
-    GI_CONST_BITS(SQL_DROP_ASSERTION),
-    GI_CONST_BITS(SQL_DROP_CHARACTER_SET),
-    GI_CONST_BITS(SQL_DROP_COLLATION),
-    GI_CONST_BITS(SQL_DROP_DOMAIN),
-    GI_CONST_BITS(SQL_DROP_SCHEMA),
-    GI_CONST_BITS(SQL_DROP_TABLE),
-    GI_CONST_BITS(SQL_DROP_TRANSLATION),
-    GI_CONST_BITS(SQL_DROP_VIEW),
-    GI_CONST_BITS(SQL_DTC_TRANSITION_COST),
-    GI_CONST_BITS(SQL_DYNAMIC_CURSOR_ATTRIBUTES1),
-    GI_CONST_BITS(SQL_DYNAMIC_CURSOR_ATTRIBUTES2),
-    GI_CONST_BITS(SQL_FETCH_DIRECTION),
-    GI_CONST_BITS(SQL_FORWARD_ONLY_CURSOR_ATTRIBUTES1),
-    GI_CONST_BITS(SQL_FORWARD_ONLY_CURSOR_ATTRIBUTES2),
-    GI_CONST_BITS(SQL_GETDATA_EXTENSIONS),
-    GI_CONST_BITS(SQL_KEYSET_CURSOR_ATTRIBUTES1),
-    GI_CONST_BITS(SQL_KEYSET_CURSOR_ATTRIBUTES2),
-    GI_CONST_BITS(SQL_INDEX_KEYWORDS),
-    GI_CONST_BITS(SQL_INFO_SCHEMA_VIEWS),
-    GI_CONST_BITS(SQL_INSERT_STATEMENT),
-    GI_CONST_BITS(SQL_LOCK_TYPES),
-    GI_CONST_BITS(SQL_NUMERIC_FUNCTIONS),
-    GI_CONST_BITS(SQL_OJ_CAPABILITIES),
-    GI_CONST_BITS(SQL_OWNER_USAGE),
-    GI_CONST_BITS(SQL_POS_OPERATIONS),
-    GI_CONST_BITS(SQL_POSITIONED_STATEMENTS),
-    GI_CONST_BITS(SQL_QUALIFIER_USAGE),
-    GI_CONST_BITS(SQL_SCHEMA_USAGE),
-    GI_CONST_BITS(SQL_SCROLL_CONCURRENCY),
-    GI_CONST_BITS(SQL_SCROLL_OPTIONS),
-    GI_CONST_BITS(SQL_SQL92_DATETIME_FUNCTIONS),
-    GI_CONST_BITS(SQL_SQL92_FOREIGN_KEY_DELETE_RULE),
-    GI_CONST_BITS(SQL_SQL92_FOREIGN_KEY_UPDATE_RULE),
-    GI_CONST_BITS(SQL_SQL92_GRANT),
-    GI_CONST_BITS(SQL_SQL92_NUMERIC_VALUE_FUNCTIONS),
-    GI_CONST_BITS(SQL_SQL92_PREDICATES),
-    GI_CONST_BITS(SQL_SQL92_RELATIONAL_JOIN_OPERATORS),
-    GI_CONST_BITS(SQL_SQL92_REVOKE),
-    GI_CONST_BITS(SQL_SQL92_ROW_VALUE_CONSTRUCTOR),
-    GI_CONST_BITS(SQL_SQL92_STRING_FUNCTIONS),
-    GI_CONST_BITS(SQL_SQL92_VALUE_EXPRESSIONS),
-    GI_CONST_BITS(SQL_STANDARD_CLI_CONFORMANCE),
-    GI_CONST_BITS(SQL_STATIC_CURSOR_ATTRIBUTES1),
-    GI_CONST_BITS(SQL_STATIC_CURSOR_ATTRIBUTES2),
-    GI_CONST_BITS(SQL_STATIC_SENSITIVITY),
-    GI_CONST_BITS(SQL_STRING_FUNCTIONS),
-    GI_CONST_BITS(SQL_SUBQUERIES),
-    GI_CONST_BITS(SQL_SYSTEM_FUNCTIONS),
-    GI_CONST_BITS(SQL_TIMEDATE_ADD_INTERVALS),
-    GI_CONST_BITS(SQL_TIMEDATE_DIFF_INTERVALS),
-    GI_CONST_BITS(SQL_TIMEDATE_FUNCTIONS),
-    GI_CONST_BITS(SQL_TXN_ISOLATION_OPTION),
-    GI_CONST_BITS(SQL_UNION),
+	rb_ary_push(aret, odsn);
+	first = dsnLen = descrLen = 0;
+    }
+    return aret;
+}
 
-    /* yielding strings */
-    GI_CONST_STR(SQL_ACCESSIBLE_PROCEDURES),
-    GI_CONST_STR(SQL_ACCESSIBLE_TABLES),
-    GI_CONST_STR(SQL_CATALOG_NAME),
-    GI_CONST_STR(SQL_CATALOG_NAME_SEPARATOR),
-    GI_CONST_STR(SQL_CATALOG_TERM),
-    GI_CONST_STR(SQL_COLLATION_SEQ),
-    GI_CONST_STR(SQL_COLUMN_ALIAS),
-    GI_CONST_STR(SQL_DATA_SOURCE_NAME),
-    GI_CONST_STR(SQL_DATA_SOURCE_READ_ONLY),
-    GI_CONST_STR(SQL_DATABASE_NAME),
-    GI_CONST_STR(SQL_DBMS_NAME),
-    GI_CONST_STR(SQL_DBMS_VER),
-    GI_CONST_STR(SQL_DESCRIBE_PARAMETER),
-    GI_CONST_STR(SQL_DM_VER),
-    GI_CONST_STR(SQL_DRIVER_NAME),
-    GI_CONST_STR(SQL_DRIVER_ODBC_VER),
-    GI_CONST_STR(SQL_DRIVER_VER),
-    GI_CONST_STR(SQL_EXPRESSIONS_IN_ORDERBY),
-    GI_CONST_STR(SQL_IDENTIFIER_QUOTE_CHAR),
-    GI_CONST_STR(SQL_INTEGRITY),
-    GI_CONST_STR(SQL_KEYWORDS),
-    GI_CONST_STR(SQL_LIKE_ESCAPE_CLAUSE),
-    GI_CONST_STR(SQL_MAX_ROW_SIZE_INCLUDES_LONG),
-    GI_CONST_STR(SQL_MULT_RESULT_SETS),
-    GI_CONST_STR(SQL_MULTIPLE_ACTIVE_TXN),
-    GI_CONST_STR(SQL_NEED_LONG_DATA_LEN),
-    GI_CONST_STR(SQL_ODBC_SQL_OPT_IEF),
-    GI_CONST_STR(SQL_ODBC_VER),
-    GI_CONST_STR(SQL_ORDER_BY_COLUMNS_IN_SELECT),
-    GI_CONST_STR(SQL_OUTER_JOINS),
-    GI_CONST_STR(SQL_OWNER_TERM),
-    GI_CONST_STR(SQL_PROCEDURE_TERM),
-    GI_CONST_STR(SQL_PROCEDURES),
-    GI_CONST_STR(SQL_QUALIFIER_NAME_SEPARATOR),
-    GI_CONST_STR(SQL_QUALIFIER_TERM),
-    GI_CONST_STR(SQL_ROW_UPDATES),
-    GI_CONST_STR(SQL_SCHEMA_TERM),
-    GI_CONST_STR(SQL_SEARCH_PATTERN_ESCAPE),
-    GI_CONST_STR(SQL_SERVER_NAME),
-    GI_CONST_STR(SQL_SPECIAL_CHARACTERS),
-    GI_CONST_STR(SQL_TABLE_TERM),
-    GI_CONST_STR(SQL_USER_NAME),
-    GI_CONST_STR(SQL_XOPEN_CLI_YEAR),
+/*
+ *----------------------------------------------------------------------
+ *
+ *      Obtain array of known drivers.
+ *
+ *----------------------------------------------------------------------
+ */
 
-    /* end of table */
-    GI_CONST_END
-};
+static VALUE
+dbc_drivers(VALUE self)
+{
+#ifdef UNICODE
+    SQLWCHAR driver[SQL_MAX_MESSAGE_LENGTH], attrs[SQL_MAX_MESSAGE_LENGTH * 2];
+    SQLWCHAR *attr;
+#else
+    char driver[SQL_MAX_MESSAGE_LENGTH], attrs[SQL_MAX_MESSAGE_LENGTH * 2];
+    char *attr;
+#endif
+    SQLSMALLINT driverLen = 0, attrsLen = 0;
+    int first = 1;
+    VALUE env, aret;
+    ENV *e;
 
-#define GI_CONST_BITMAP(x)  { #x, x }
-#define GI_CONST_BITMAP_END { NULL, 0 }
-static struct {
-    const char *name;
-    int bits;
-} get_info_bitmap[] = {
-    GI_CONST_BITMAP(SQL_AD_ADD_CONSTRAINT_DEFERRABLE),
-    GI_CONST_BITMAP(SQL_AD_ADD_CONSTRAINT_INITIALLY_DEFERRED),
-    GI_CONST_BITMAP(SQL_AD_ADD_CONSTRAINT_INITIALLY_IMMEDIATE),
-    GI_CONST_BITMAP(SQL_AD_ADD_CONSTRAINT_NON_DEFERRABLE),
-    GI_CONST_BITMAP(SQL_AD_ADD_DOMAIN_CONSTRAINT),
-    GI_CONST_BITMAP(SQL_AD_ADD_DOMAIN_DEFAULT),
-    GI_CONST_BITMAP(SQL_AD_CONSTRAINT_NAME_DEFINITION),
-    GI_CONST_BITMAP(SQL_AD_DROP_DOMAIN_CONSTRAINT),
-    GI_CONST_BITMAP(SQL_AD_DROP_DOMAIN_DEFAULT),
-    GI_CONST_BITMAP(SQL_AF_ALL),
-    GI_CONST_BITMAP(SQL_AF_AVG),
-    GI_CONST_BITMAP(SQL_AF_COUNT),
-    GI_CONST_BITMAP(SQL_AF_DISTINCT),
-    GI_CONST_BITMAP(SQL_AF_MAX),
-    GI_CONST_BITMAP(SQL_AF_MIN),
-    GI_CONST_BITMAP(SQL_AF_SUM),
-    GI_CONST_BITMAP(SQL_AM_CONNECTION),
-    GI_CONST_BITMAP(SQL_AM_NONE),
-    GI_CONST_BITMAP(SQL_AM_STATEMENT),
-    GI_CONST_BITMAP(SQL_AT_ADD_COLUMN),
-    GI_CONST_BITMAP(SQL_AT_ADD_COLUMN_COLLATION),
-    GI_CONST_BITMAP(SQL_AT_ADD_COLUMN_DEFAULT),
-    GI_CONST_BITMAP(SQL_AT_ADD_COLUMN_SINGLE),
-    GI_CONST_BITMAP(SQL_AT_ADD_CONSTRAINT),
-    GI_CONST_BITMAP(SQL_AT_ADD_TABLE_CONSTRAINT),
-#ifdef SQL_AT_COLUMN_SINGLE
-    GI_CONST_BITMAP(SQL_AT_COLUMN_SINGLE),
+    env = env_new(Cenv);
+    ODBC_Get_Struct(env, ENV, env_type, e);
+    aret = rb_ary_new();
+    while (succeeded(e->henv, SQL_NULL_HDBC, SQL_NULL_HSTMT,
+		     SQLDrivers(e->henv, (SQLUSMALLINT) (first ?
+				SQL_FETCH_FIRST : SQL_FETCH_NEXT),
+				(SQLTCHAR *) driver,
+				(SQLSMALLINT) sizeof (driver), &driverLen,
+				(SQLTCHAR *) attrs,
+				(SQLSMALLINT) sizeof (attrs), &attrsLen),
+		     NULL, "SQLDrivers")) {
+	VALUE odrv = rb_obj_alloc(Cdrv);
+	VALUE h = rb_hash_new();
+	int count = 0;
+
+#ifdef UNICODE
+	driverLen = (driverLen == 0) ?
+	    (SQLSMALLINT) uc_strlen(driver) :
+	    (SQLSMALLINT) (driverLen / sizeof (SQLWCHAR));
+	rb_iv_set(odrv, "@name", uc_tainted_str_new(driver, driverLen));
+	for (attr = attrs; *attr; attr += uc_strlen(attr) + 1) {
+	    SQLWCHAR *p = uc_strchr(attr, (SQLWCHAR) '=');
+
+	    if ((p != NULL) && (p != attr)) {
+		rb_hash_aset(h,
+			     uc_tainted_str_new(attr, (p - attr) /
+						 sizeof (SQLWCHAR)),
+			     uc_tainted_str_new2(p + 1));
+		count++;
+	    }
+	}
+#else
+	driverLen = (driverLen == 0) ? (SQLSMALLINT) strlen(driver) : driverLen;
+	rb_iv_set(odrv, "@name", rb_tainted_str_new(driver, driverLen));
+	for (attr = attrs; *attr; attr += strlen(attr) + 1) {
+	    char *p = strchr(attr, '=');
+
+	    if ((p != NULL) && (p != attr)) {
+		rb_hash_aset(h, rb_tainted_str_new(attr, p - attr),
+			     rb_tainted_str_new2(p + 1));
+		count++;
+	    }
+	}
 #endif
-    GI_CONST_BITMAP(SQL_AT_CONSTRAINT_DEFERRABLE),
-    GI_CONST_BITMAP(SQL_AT_CONSTRAINT_INITIALLY_DEFERRED),
-    GI_CONST_BITMAP(SQL_AT_CONSTRAINT_INITIALLY_IMMEDIATE),
-    GI_CONST_BITMAP(SQL_AT_CONSTRAINT_NAME_DEFINITION),
-    GI_CONST_BITMAP(SQL_AT_CONSTRAINT_NON_DEFERRABLE),
-    GI_CONST_BITMAP(SQL_AT_DROP_COLUMN),
-    GI_CONST_BITMAP(SQL_AT_DROP_COLUMN_CASCADE),
-    GI_CONST_BITMAP(SQL_AT_DROP_COLUMN_DEFAULT),
-    GI_CONST_BITMAP(SQL_AT_DROP_COLUMN_RESTRICT),
-    GI_CONST_BITMAP(SQL_AT_DROP_TABLE_CONSTRAINT_CASCADE),
-    GI_CONST_BITMAP(SQL_AT_DROP_TABLE_CONSTRAINT_RESTRICT),
-    GI_CONST_BITMAP(SQL_AT_SET_COLUMN_DEFAULT),
-    GI_CONST_BITMAP(SQL_BP_CLOSE),
-    GI_CONST_BITMAP(SQL_BP_DELETE),
-    GI_CONST_BITMAP(SQL_BP_DROP),
-    GI_CONST_BITMAP(SQL_BP_OTHER_HSTMT),
-    GI_CONST_BITMAP(SQL_BP_SCROLL),
-    GI_CONST_BITMAP(SQL_BP_TRANSACTION),
-    GI_CONST_BITMAP(SQL_BP_UPDATE),
-    GI_CONST_BITMAP(SQL_BRC_EXPLICIT),
-    GI_CONST_BITMAP(SQL_BRC_PROCEDURES),
-    GI_CONST_BITMAP(SQL_BRC_ROLLED_UP),
-    GI_CONST_BITMAP(SQL_BS_ROW_COUNT_EXPLICIT),
-    GI_CONST_BITMAP(SQL_BS_ROW_COUNT_PROC),
-    GI_CONST_BITMAP(SQL_BS_SELECT_EXPLICIT),
-    GI_CONST_BITMAP(SQL_BS_SELECT_PROC),
-    GI_CONST_BITMAP(SQL_CA1_ABSOLUTE),
-    GI_CONST_BITMAP(SQL_CA1_BOOKMARK),
-    GI_CONST_BITMAP(SQL_CA1_BULK_ADD),
-    GI_CONST_BITMAP(SQL_CA1_BULK_DELETE_BY_BOOKMARK),
-    GI_CONST_BITMAP(SQL_CA1_BULK_FETCH_BY_BOOKMARK),
-    GI_CONST_BITMAP(SQL_CA1_BULK_UPDATE_BY_BOOKMARK),
-    GI_CONST_BITMAP(SQL_CA1_LOCK_EXCLUSIVE),
-    GI_CONST_BITMAP(SQL_CA1_LOCK_NO_CHANGE),
-    GI_CONST_BITMAP(SQL_CA1_LOCK_UNLOCK),
-    GI_CONST_BITMAP(SQL_CA1_NEXT),
-    GI_CONST_BITMAP(SQL_CA1_POS_DELETE),
-    GI_CONST_BITMAP(SQL_CA1_POSITIONED_DELETE),
-    GI_CONST_BITMAP(SQL_CA1_POSITIONED_UPDATE),
-    GI_CONST_BITMAP(SQL_CA1_POS_POSITION),
-    GI_CONST_BITMAP(SQL_CA1_POS_REFRESH),
-    GI_CONST_BITMAP(SQL_CA1_POS_UPDATE),
-    GI_CONST_BITMAP(SQL_CA1_RELATIVE),
-    GI_CONST_BITMAP(SQL_CA1_SELECT_FOR_UPDATE),
-    GI_CONST_BITMAP(SQL_CA2_CRC_APPROXIMATE),
-    GI_CONST_BITMAP(SQL_CA2_CRC_EXACT),
-    GI_CONST_BITMAP(SQL_CA2_LOCK_CONCURRENCY),
-    GI_CONST_BITMAP(SQL_CA2_MAX_ROWS_AFFECTS_ALL),
-    GI_CONST_BITMAP(SQL_CA2_MAX_ROWS_CATALOG),
-    GI_CONST_BITMAP(SQL_CA2_MAX_ROWS_DELETE),
-    GI_CONST_BITMAP(SQL_CA2_MAX_ROWS_INSERT),
-    GI_CONST_BITMAP(SQL_CA2_MAX_ROWS_SELECT),
-    GI_CONST_BITMAP(SQL_CA2_MAX_ROWS_UPDATE),
-    GI_CONST_BITMAP(SQL_CA2_OPT_ROWVER_CONCURRENCY),
-    GI_CONST_BITMAP(SQL_CA2_OPT_VALUES_CONCURRENCY),
-    GI_CONST_BITMAP(SQL_CA2_READ_ONLY_CONCURRENCY),
-    GI_CONST_BITMAP(SQL_CA2_SENSITIVITY_ADDITIONS),
-    GI_CONST_BITMAP(SQL_CA2_SENSITIVITY_DELETIONS),
-    GI_CONST_BITMAP(SQL_CA2_SENSITIVITY_UPDATES),
-    GI_CONST_BITMAP(SQL_CA2_SIMULATE_NON_UNIQUE),
-    GI_CONST_BITMAP(SQL_CA2_SIMULATE_TRY_UNIQUE),
-    GI_CONST_BITMAP(SQL_CA2_SIMULATE_UNIQUE),
-    GI_CONST_BITMAP(SQL_CA_CONSTRAINT_DEFERRABLE),
-    GI_CONST_BITMAP(SQL_CA_CONSTRAINT_INITIALLY_DEFERRED),
-    GI_CONST_BITMAP(SQL_CA_CONSTRAINT_INITIALLY_IMMEDIATE),
-    GI_CONST_BITMAP(SQL_CA_CONSTRAINT_NON_DEFERRABLE),
-    GI_CONST_BITMAP(SQL_CA_CREATE_ASSERTION),
-    GI_CONST_BITMAP(SQL_CB_CLOSE),
-    GI_CONST_BITMAP(SQL_CB_DELETE),
-    GI_CONST_BITMAP(SQL_CB_NON_NULL),
-    GI_CONST_BITMAP(SQL_CB_NULL),
-    GI_CONST_BITMAP(SQL_CB_PRESERVE),
-    GI_CONST_BITMAP(SQL_CC_CLOSE),
-    GI_CONST_BITMAP(SQL_CC_DELETE),
-    GI_CONST_BITMAP(SQL_CCOL_CREATE_COLLATION),
-    GI_CONST_BITMAP(SQL_CC_PRESERVE),
-    GI_CONST_BITMAP(SQL_CCS_COLLATE_CLAUSE),
-    GI_CONST_BITMAP(SQL_CCS_CREATE_CHARACTER_SET),
-    GI_CONST_BITMAP(SQL_CCS_LIMITED_COLLATION),
-    GI_CONST_BITMAP(SQL_CDO_COLLATION),
-    GI_CONST_BITMAP(SQL_CDO_CONSTRAINT),
-    GI_CONST_BITMAP(SQL_CDO_CONSTRAINT_DEFERRABLE),
-    GI_CONST_BITMAP(SQL_CDO_CONSTRAINT_INITIALLY_DEFERRED),
-    GI_CONST_BITMAP(SQL_CDO_CONSTRAINT_INITIALLY_IMMEDIATE),
-    GI_CONST_BITMAP(SQL_CDO_CONSTRAINT_NAME_DEFINITION),
-    GI_CONST_BITMAP(SQL_CDO_CONSTRAINT_NON_DEFERRABLE),
-    GI_CONST_BITMAP(SQL_CDO_CREATE_DOMAIN),
-    GI_CONST_BITMAP(SQL_CDO_DEFAULT),
-    GI_CONST_BITMAP(SQL_CL_END),
-    GI_CONST_BITMAP(SQL_CL_START),
-    GI_CONST_BITMAP(SQL_CN_ANY),
-    GI_CONST_BITMAP(SQL_CN_DIFFERENT),
-    GI_CONST_BITMAP(SQL_CN_NONE),
-    GI_CONST_BITMAP(SQL_CONCUR_TIMESTAMP),
-    GI_CONST_BITMAP(SQL_CR_CLOSE),
-    GI_CONST_BITMAP(SQL_CR_DELETE),
-    GI_CONST_BITMAP(SQL_CR_PRESERVE),
-    GI_CONST_BITMAP(SQL_CS_AUTHORIZATION),
-    GI_CONST_BITMAP(SQL_CS_CREATE_SCHEMA),
-    GI_CONST_BITMAP(SQL_CS_DEFAULT_CHARACTER_SET),
-    GI_CONST_BITMAP(SQL_CT_COLUMN_COLLATION),
-    GI_CONST_BITMAP(SQL_CT_COLUMN_CONSTRAINT),
-    GI_CONST_BITMAP(SQL_CT_COLUMN_DEFAULT),
-    GI_CONST_BITMAP(SQL_CT_COMMIT_DELETE),
-    GI_CONST_BITMAP(SQL_CT_COMMIT_PRESERVE),
-    GI_CONST_BITMAP(SQL_CT_CONSTRAINT_DEFERRABLE),
-    GI_CONST_BITMAP(SQL_CT_CONSTRAINT_INITIALLY_DEFERRED),
-    GI_CONST_BITMAP(SQL_CT_CONSTRAINT_INITIALLY_IMMEDIATE),
-    GI_CONST_BITMAP(SQL_CT_CONSTRAINT_NAME_DEFINITION),
-    GI_CONST_BITMAP(SQL_CT_CONSTRAINT_NON_DEFERRABLE),
-    GI_CONST_BITMAP(SQL_CT_CREATE_TABLE),
-    GI_CONST_BITMAP(SQL_CT_GLOBAL_TEMPORARY),
-    GI_CONST_BITMAP(SQL_CT_LOCAL_TEMPORARY),
-    GI_CONST_BITMAP(SQL_CTR_CREATE_TRANSLATION),
-    GI_CONST_BITMAP(SQL_CT_TABLE_CONSTRAINT),
-    GI_CONST_BITMAP(SQL_CU_DML_STATEMENTS),
-    GI_CONST_BITMAP(SQL_CU_INDEX_DEFINITION),
-    GI_CONST_BITMAP(SQL_CU_PRIVILEGE_DEFINITION),
-    GI_CONST_BITMAP(SQL_CU_PROCEDURE_INVOCATION),
-    GI_CONST_BITMAP(SQL_CU_TABLE_DEFINITION),
-    GI_CONST_BITMAP(SQL_CV_CASCADED),
-    GI_CONST_BITMAP(SQL_CV_CHECK_OPTION),
-    GI_CONST_BITMAP(SQL_CV_CREATE_VIEW),
-    GI_CONST_BITMAP(SQL_CV_LOCAL),
-    GI_CONST_BITMAP(SQL_CVT_BIGINT),
-    GI_CONST_BITMAP(SQL_CVT_BINARY),
-    GI_CONST_BITMAP(SQL_CVT_BIT),
-    GI_CONST_BITMAP(SQL_CVT_CHAR),
-    GI_CONST_BITMAP(SQL_CVT_DATE),
-    GI_CONST_BITMAP(SQL_CVT_DECIMAL),
-    GI_CONST_BITMAP(SQL_CVT_DOUBLE),
-    GI_CONST_BITMAP(SQL_CVT_FLOAT),
-    GI_CONST_BITMAP(SQL_CVT_INTEGER),
-    GI_CONST_BITMAP(SQL_CVT_INTERVAL_DAY_TIME),
-    GI_CONST_BITMAP(SQL_CVT_INTERVAL_YEAR_MONTH),
-    GI_CONST_BITMAP(SQL_CVT_LONGVARBINARY),
-    GI_CONST_BITMAP(SQL_CVT_LONGVARCHAR),
-    GI_CONST_BITMAP(SQL_CVT_NUMERIC),
-    GI_CONST_BITMAP(SQL_CVT_REAL),
-    GI_CONST_BITMAP(SQL_CVT_SMALLINT),
-    GI_CONST_BITMAP(SQL_CVT_TIME),
-    GI_CONST_BITMAP(SQL_CVT_TIMESTAMP),
-    GI_CONST_BITMAP(SQL_CVT_TINYINT),
-    GI_CONST_BITMAP(SQL_CVT_VARBINARY),
-    GI_CONST_BITMAP(SQL_CVT_VARCHAR),
-    GI_CONST_BITMAP(SQL_CVT_WCHAR),
-    GI_CONST_BITMAP(SQL_CVT_WLONGVARCHAR),
-    GI_CONST_BITMAP(SQL_CVT_WVARCHAR),
-    GI_CONST_BITMAP(SQL_DA_DROP_ASSERTION),
-    GI_CONST_BITMAP(SQL_DC_DROP_COLLATION),
-    GI_CONST_BITMAP(SQL_DCS_DROP_CHARACTER_SET),
-    GI_CONST_BITMAP(SQL_DD_CASCADE),
-    GI_CONST_BITMAP(SQL_DD_DROP_DOMAIN),
-    GI_CONST_BITMAP(SQL_DD_RESTRICT),
-    GI_CONST_BITMAP(SQL_DI_CREATE_INDEX),
-    GI_CONST_BITMAP(SQL_DI_DROP_INDEX),
-    GI_CONST_BITMAP(SQL_DL_SQL92_DATE),
-    GI_CONST_BITMAP(SQL_DL_SQL92_INTERVAL_DAY),
-    GI_CONST_BITMAP(SQL_DL_SQL92_INTERVAL_DAY_TO_HOUR),
-    GI_CONST_BITMAP(SQL_DL_SQL92_INTERVAL_DAY_TO_MINUTE),
-    GI_CONST_BITMAP(SQL_DL_SQL92_INTERVAL_DAY_TO_SECOND),
-    GI_CONST_BITMAP(SQL_DL_SQL92_INTERVAL_HOUR),
-    GI_CONST_BITMAP(SQL_DL_SQL92_INTERVAL_HOUR_TO_MINUTE),
-    GI_CONST_BITMAP(SQL_DL_SQL92_INTERVAL_HOUR_TO_SECOND),
-    GI_CONST_BITMAP(SQL_DL_SQL92_INTERVAL_MINUTE),
-    GI_CONST_BITMAP(SQL_DL_SQL92_INTERVAL_MINUTE_TO_SECOND),
-    GI_CONST_BITMAP(SQL_DL_SQL92_INTERVAL_MONTH),
-    GI_CONST_BITMAP(SQL_DL_SQL92_INTERVAL_SECOND),
-    GI_CONST_BITMAP(SQL_DL_SQL92_INTERVAL_YEAR),
-    GI_CONST_BITMAP(SQL_DL_SQL92_INTERVAL_YEAR_TO_MONTH),
-    GI_CONST_BITMAP(SQL_DL_SQL92_TIME),
-    GI_CONST_BITMAP(SQL_DL_SQL92_TIMESTAMP),
-    GI_CONST_BITMAP(SQL_DS_CASCADE),
-    GI_CONST_BITMAP(SQL_DS_DROP_SCHEMA),
-    GI_CONST_BITMAP(SQL_DS_RESTRICT),
-    GI_CONST_BITMAP(SQL_DT_CASCADE),
-    GI_CONST_BITMAP(SQL_DTC_ENLIST_EXPENSIVE),
-    GI_CONST_BITMAP(SQL_DTC_UNENLIST_EXPENSIVE),
-    GI_CONST_BITMAP(SQL_DT_DROP_TABLE),
-    GI_CONST_BITMAP(SQL_DTR_DROP_TRANSLATION),
-    GI_CONST_BITMAP(SQL_DT_RESTRICT),
-    GI_CONST_BITMAP(SQL_DV_CASCADE),
-    GI_CONST_BITMAP(SQL_DV_DROP_VIEW),
-    GI_CONST_BITMAP(SQL_DV_RESTRICT),
-    GI_CONST_BITMAP(SQL_FD_FETCH_ABSOLUTE),
-    GI_CONST_BITMAP(SQL_FD_FETCH_BOOKMARK),
-    GI_CONST_BITMAP(SQL_FD_FETCH_FIRST),
-    GI_CONST_BITMAP(SQL_FD_FETCH_LAST),
-    GI_CONST_BITMAP(SQL_FD_FETCH_NEXT),
-    GI_CONST_BITMAP(SQL_FD_FETCH_PRIOR),
-    GI_CONST_BITMAP(SQL_FD_FETCH_RELATIVE),
-#ifdef SQL_FD_FETCH_RESUME
-    GI_CONST_BITMAP(SQL_FD_FETCH_RESUME),
+	if (count > 0) {
+	    rb_iv_set(odrv, "@attrs", h);
+	}
+	rb_ary_push(aret, odrv);
+	first = driverLen = attrsLen = 0;
+    }
+    return aret;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ *      Management methods.
+ *
+ *----------------------------------------------------------------------
+ */
+
+#ifdef HAVE_ODBCINST_H
+static VALUE
+conf_dsn(int argc, VALUE *argv, VALUE self, int op)
+{
+    VALUE drv, attr, issys, astr;
+#ifdef UNICODE
+#ifdef HAVE_SQLCONFIGDATASOURCEW
+    int have_w = 1;
+#else
+    int have_w = 0;
 #endif
-    GI_CONST_BITMAP(SQL_FILE_CATALOG),
-    GI_CONST_BITMAP(SQL_FILE_NOT_SUPPORTED),
-    GI_CONST_BITMAP(SQL_FILE_QUALIFIER),
-    GI_CONST_BITMAP(SQL_FILE_TABLE),
-    GI_CONST_BITMAP(SQL_FN_CVT_CAST),
-    GI_CONST_BITMAP(SQL_FN_CVT_CONVERT),
-    GI_CONST_BITMAP(SQL_FN_NUM_ABS),
-    GI_CONST_BITMAP(SQL_FN_NUM_ACOS),
-    GI_CONST_BITMAP(SQL_FN_NUM_ASIN),
-    GI_CONST_BITMAP(SQL_FN_NUM_ATAN),
-    GI_CONST_BITMAP(SQL_FN_NUM_ATAN2),
-    GI_CONST_BITMAP(SQL_FN_NUM_CEILING),
-    GI_CONST_BITMAP(SQL_FN_NUM_COS),
-    GI_CONST_BITMAP(SQL_FN_NUM_COT),
-    GI_CONST_BITMAP(SQL_FN_NUM_DEGREES),
-    GI_CONST_BITMAP(SQL_FN_NUM_EXP),
-    GI_CONST_BITMAP(SQL_FN_NUM_FLOOR),
-    GI_CONST_BITMAP(SQL_FN_NUM_LOG),
-    GI_CONST_BITMAP(SQL_FN_NUM_LOG10),
-    GI_CONST_BITMAP(SQL_FN_NUM_MOD),
-    GI_CONST_BITMAP(SQL_FN_NUM_PI),
-    GI_CONST_BITMAP(SQL_FN_NUM_POWER),
-    GI_CONST_BITMAP(SQL_FN_NUM_RADIANS),
-    GI_CONST_BITMAP(SQL_FN_NUM_RAND),
-    GI_CONST_BITMAP(SQL_FN_NUM_ROUND),
-    GI_CONST_BITMAP(SQL_FN_NUM_SIGN),
-    GI_CONST_BITMAP(SQL_FN_NUM_SIN),
-    GI_CONST_BITMAP(SQL_FN_NUM_SQRT),
-    GI_CONST_BITMAP(SQL_FN_NUM_TAN),
-    GI_CONST_BITMAP(SQL_FN_NUM_TRUNCATE),
-    GI_CONST_BITMAP(SQL_FN_STR_ASCII),
-    GI_CONST_BITMAP(SQL_FN_STR_BIT_LENGTH),
-    GI_CONST_BITMAP(SQL_FN_STR_CHAR),
-    GI_CONST_BITMAP(SQL_FN_STR_CHARACTER_LENGTH),
-    GI_CONST_BITMAP(SQL_FN_STR_CHAR_LENGTH),
-    GI_CONST_BITMAP(SQL_FN_STR_CONCAT),
-    GI_CONST_BITMAP(SQL_FN_STR_DIFFERENCE),
-    GI_CONST_BITMAP(SQL_FN_STR_INSERT),
-    GI_CONST_BITMAP(SQL_FN_STR_LCASE),
-    GI_CONST_BITMAP(SQL_FN_STR_LEFT),
-    GI_CONST_BITMAP(SQL_FN_STR_LENGTH),
-    GI_CONST_BITMAP(SQL_FN_STR_LOCATE),
-    GI_CONST_BITMAP(SQL_FN_STR_LOCATE_2),
-    GI_CONST_BITMAP(SQL_FN_STR_LTRIM),
-    GI_CONST_BITMAP(SQL_FN_STR_OCTET_LENGTH),
-    GI_CONST_BITMAP(SQL_FN_STR_POSITION),
-    GI_CONST_BITMAP(SQL_FN_STR_REPEAT),
-    GI_CONST_BITMAP(SQL_FN_STR_REPLACE),
-    GI_CONST_BITMAP(SQL_FN_STR_RIGHT),
-    GI_CONST_BITMAP(SQL_FN_STR_RTRIM),
-    GI_CONST_BITMAP(SQL_FN_STR_SOUNDEX),
-    GI_CONST_BITMAP(SQL_FN_STR_SPACE),
-    GI_CONST_BITMAP(SQL_FN_STR_SUBSTRING),
-    GI_CONST_BITMAP(SQL_FN_STR_UCASE),
-    GI_CONST_BITMAP(SQL_FN_SYS_DBNAME),
-    GI_CONST_BITMAP(SQL_FN_SYS_IFNULL),
-    GI_CONST_BITMAP(SQL_FN_SYS_USERNAME),
-    GI_CONST_BITMAP(SQL_FN_TD_CURDATE),
-    GI_CONST_BITMAP(SQL_FN_TD_CURRENT_DATE),
-    GI_CONST_BITMAP(SQL_FN_TD_CURRENT_TIME),
-    GI_CONST_BITMAP(SQL_FN_TD_CURRENT_TIMESTAMP),
-    GI_CONST_BITMAP(SQL_FN_TD_CURTIME),
-    GI_CONST_BITMAP(SQL_FN_TD_DAYNAME),
-    GI_CONST_BITMAP(SQL_FN_TD_DAYOFMONTH),
-    GI_CONST_BITMAP(SQL_FN_TD_DAYOFWEEK),
-    GI_CONST_BITMAP(SQL_FN_TD_DAYOFYEAR),
-    GI_CONST_BITMAP(SQL_FN_TD_EXTRACT),
-    GI_CONST_BITMAP(SQL_FN_TD_HOUR),
-    GI_CONST_BITMAP(SQL_FN_TD_MINUTE),
-    GI_CONST_BITMAP(SQL_FN_TD_MONTH),
-    GI_CONST_BITMAP(SQL_FN_TD_MONTHNAME),
-    GI_CONST_BITMAP(SQL_FN_TD_NOW),
-    GI_CONST_BITMAP(SQL_FN_TD_QUARTER),
-    GI_CONST_BITMAP(SQL_FN_TD_SECOND),
-    GI_CONST_BITMAP(SQL_FN_TD_TIMESTAMPADD),
-    GI_CONST_BITMAP(SQL_FN_TD_TIMESTAMPDIFF),
-    GI_CONST_BITMAP(SQL_FN_TD_WEEK),
-    GI_CONST_BITMAP(SQL_FN_TD_YEAR),
-    GI_CONST_BITMAP(SQL_FN_TSI_DAY),
-    GI_CONST_BITMAP(SQL_FN_TSI_FRAC_SECOND),
-    GI_CONST_BITMAP(SQL_FN_TSI_HOUR),
-    GI_CONST_BITMAP(SQL_FN_TSI_MINUTE),
-    GI_CONST_BITMAP(SQL_FN_TSI_MONTH),
-    GI_CONST_BITMAP(SQL_FN_TSI_QUARTER),
-    GI_CONST_BITMAP(SQL_FN_TSI_SECOND),
-    GI_CONST_BITMAP(SQL_FN_TSI_WEEK),
-    GI_CONST_BITMAP(SQL_FN_TSI_YEAR),
-    GI_CONST_BITMAP(SQL_GB_COLLATE),
-    GI_CONST_BITMAP(SQL_GB_GROUP_BY_CONTAINS_SELECT),
-    GI_CONST_BITMAP(SQL_GB_GROUP_BY_EQUALS_SELECT),
-    GI_CONST_BITMAP(SQL_GB_NO_RELATION),
-    GI_CONST_BITMAP(SQL_GB_NOT_SUPPORTED),
-    GI_CONST_BITMAP(SQL_GD_ANY_COLUMN),
-    GI_CONST_BITMAP(SQL_GD_ANY_ORDER),
-    GI_CONST_BITMAP(SQL_GD_BLOCK),
-    GI_CONST_BITMAP(SQL_GD_BOUND),
-    GI_CONST_BITMAP(SQL_IC_LOWER),
-    GI_CONST_BITMAP(SQL_IC_MIXED),
-    GI_CONST_BITMAP(SQL_IC_SENSITIVE),
-    GI_CONST_BITMAP(SQL_IC_UPPER),
-    GI_CONST_BITMAP(SQL_IK_ALL),
-    GI_CONST_BITMAP(SQL_IK_ASC),
-    GI_CONST_BITMAP(SQL_IK_DESC),
-    GI_CONST_BITMAP(SQL_IK_NONE),
-    GI_CONST_BITMAP(SQL_IS_INSERT_LITERALS),
-    GI_CONST_BITMAP(SQL_IS_INSERT_SEARCHED),
-    GI_CONST_BITMAP(SQL_IS_SELECT_INTO),
-    GI_CONST_BITMAP(SQL_ISV_ASSERTIONS),
-    GI_CONST_BITMAP(SQL_ISV_CHARACTER_SETS),
-    GI_CONST_BITMAP(SQL_ISV_CHECK_CONSTRAINTS),
-    GI_CONST_BITMAP(SQL_ISV_COLLATIONS),
-    GI_CONST_BITMAP(SQL_ISV_COLUMN_DOMAIN_USAGE),
-    GI_CONST_BITMAP(SQL_ISV_COLUMN_PRIVILEGES),
-    GI_CONST_BITMAP(SQL_ISV_COLUMNS),
-    GI_CONST_BITMAP(SQL_ISV_CONSTRAINT_COLUMN_USAGE),
-    GI_CONST_BITMAP(SQL_ISV_CONSTRAINT_TABLE_USAGE),
-    GI_CONST_BITMAP(SQL_ISV_DOMAIN_CONSTRAINTS),
-    GI_CONST_BITMAP(SQL_ISV_DOMAINS),
-    GI_CONST_BITMAP(SQL_ISV_KEY_COLUMN_USAGE),
-    GI_CONST_BITMAP(SQL_ISV_REFERENTIAL_CONSTRAINTS),
-    GI_CONST_BITMAP(SQL_ISV_SCHEMATA),
-    GI_CONST_BITMAP(SQL_ISV_SQL_LANGUAGES),
-    GI_CONST_BITMAP(SQL_ISV_TABLE_CONSTRAINTS),
-    GI_CONST_BITMAP(SQL_ISV_TABLE_PRIVILEGES),
-    GI_CONST_BITMAP(SQL_ISV_TABLES),
-    GI_CONST_BITMAP(SQL_ISV_TRANSLATIONS),
-    GI_CONST_BITMAP(SQL_ISV_USAGE_PRIVILEGES),
-    GI_CONST_BITMAP(SQL_ISV_VIEW_COLUMN_USAGE),
-    GI_CONST_BITMAP(SQL_ISV_VIEWS),
-    GI_CONST_BITMAP(SQL_ISV_VIEW_TABLE_USAGE),
-    GI_CONST_BITMAP(SQL_LCK_EXCLUSIVE),
-    GI_CONST_BITMAP(SQL_LCK_NO_CHANGE),
-    GI_CONST_BITMAP(SQL_LCK_UNLOCK),
-    GI_CONST_BITMAP(SQL_NC_END),
-    GI_CONST_BITMAP(SQL_NC_HIGH),
-    GI_CONST_BITMAP(SQL_NC_LOW),
-    GI_CONST_BITMAP(SQL_NC_START),
-    GI_CONST_BITMAP(SQL_NNC_NON_NULL),
-    GI_CONST_BITMAP(SQL_NNC_NULL),
-    GI_CONST_BITMAP(SQL_OAC_LEVEL1),
-    GI_CONST_BITMAP(SQL_OAC_LEVEL2),
-    GI_CONST_BITMAP(SQL_OAC_NONE),
-    GI_CONST_BITMAP(SQL_OIC_CORE),
-    GI_CONST_BITMAP(SQL_OIC_LEVEL1),
-    GI_CONST_BITMAP(SQL_OIC_LEVEL2),
-    GI_CONST_BITMAP(SQL_OJ_ALL_COMPARISON_OPS),
-    GI_CONST_BITMAP(SQL_OJ_FULL),
-    GI_CONST_BITMAP(SQL_OJ_INNER),
-    GI_CONST_BITMAP(SQL_OJ_LEFT),
-    GI_CONST_BITMAP(SQL_OJ_NESTED),
-    GI_CONST_BITMAP(SQL_OJ_NOT_ORDERED),
-    GI_CONST_BITMAP(SQL_OJ_RIGHT),
-    GI_CONST_BITMAP(SQL_OSCC_COMPLIANT),
-    GI_CONST_BITMAP(SQL_OSCC_NOT_COMPLIANT),
-    GI_CONST_BITMAP(SQL_OSC_CORE),
-    GI_CONST_BITMAP(SQL_OSC_EXTENDED),
-    GI_CONST_BITMAP(SQL_OSC_MINIMUM),
-    GI_CONST_BITMAP(SQL_OU_DML_STATEMENTS),
-    GI_CONST_BITMAP(SQL_OU_INDEX_DEFINITION),
-    GI_CONST_BITMAP(SQL_OU_PRIVILEGE_DEFINITION),
-    GI_CONST_BITMAP(SQL_OU_PROCEDURE_INVOCATION),
-    GI_CONST_BITMAP(SQL_OU_TABLE_DEFINITION),
-    GI_CONST_BITMAP(SQL_PARC_BATCH),
-    GI_CONST_BITMAP(SQL_PARC_NO_BATCH),
-    GI_CONST_BITMAP(SQL_PAS_BATCH),
-    GI_CONST_BITMAP(SQL_PAS_NO_BATCH),
-    GI_CONST_BITMAP(SQL_PAS_NO_SELECT),
-    GI_CONST_BITMAP(SQL_POS_ADD),
-    GI_CONST_BITMAP(SQL_POS_DELETE),
-    GI_CONST_BITMAP(SQL_POS_POSITION),
-    GI_CONST_BITMAP(SQL_POS_REFRESH),
-    GI_CONST_BITMAP(SQL_POS_UPDATE),
-    GI_CONST_BITMAP(SQL_PS_POSITIONED_DELETE),
-    GI_CONST_BITMAP(SQL_PS_POSITIONED_UPDATE),
-    GI_CONST_BITMAP(SQL_PS_SELECT_FOR_UPDATE),
-    GI_CONST_BITMAP(SQL_QL_END),
-    GI_CONST_BITMAP(SQL_QL_START),
-    GI_CONST_BITMAP(SQL_QU_DML_STATEMENTS),
-    GI_CONST_BITMAP(SQL_QU_INDEX_DEFINITION),
-    GI_CONST_BITMAP(SQL_QU_PRIVILEGE_DEFINITION),
-    GI_CONST_BITMAP(SQL_QU_PROCEDURE_INVOCATION),
-    GI_CONST_BITMAP(SQL_QU_TABLE_DEFINITION),
-    GI_CONST_BITMAP(SQL_SCC_ISO92_CLI),
-    GI_CONST_BITMAP(SQL_SCCO_LOCK),
-    GI_CONST_BITMAP(SQL_SCCO_OPT_ROWVER),
-    GI_CONST_BITMAP(SQL_SCCO_OPT_TIMESTAMP),
+    SQLWCHAR *sdrv, *sastr;
+#else
+    char *sdrv, *sastr;
+#endif
+
+    rb_scan_args(argc, argv, "12", &drv, &attr, &issys);
+    if (rb_obj_is_kind_of(drv, Cdrv) == Qtrue) {
+	VALUE a, x;
+
+	if (argc > 2) {
+	    rb_raise(rb_eArgError, "wrong # of arguments");
+	}
+	x = rb_iv_get(drv, "@name");
+	a = rb_iv_get(drv, "@attrs");
+	issys = attr;
+	drv = x;
+	attr = a;
+    }
+    Check_Type(drv, T_STRING);
+    if (RTEST(issys)) {
+	switch (op) {
+	case ODBC_ADD_DSN:	op = ODBC_ADD_SYS_DSN; break;
+	case ODBC_CONFIG_DSN:	op = ODBC_CONFIG_SYS_DSN; break;
+	case ODBC_REMOVE_DSN:	op = ODBC_REMOVE_SYS_DSN; break;
+	}
+    }
+    astr = rb_str_new2("");
+    if (rb_obj_is_kind_of(attr, rb_cHash) == Qtrue) {
+	VALUE a, x;
+
+	a = rb_funcall(attr, IDkeys, 0, NULL);
+	while ((x = rb_ary_shift(a)) != Qnil) {
+	    VALUE v = rb_hash_aref(attr, x);
+
+	    astr = rb_str_concat(astr, x);
+	    astr = rb_str_cat2(astr, "=");
+	    astr = rb_str_concat(astr, v);
+	    astr = rb_str_cat(astr, "", 1);
+	}
+    }
+    astr = rb_str_cat(astr, "", 1);
+#ifdef UNICODE
+#ifdef USE_DLOPEN_FOR_ODBC_LIBS
+    have_w = ruby_odbc_have_func("SQLConfigDataSourceW", SQLConfigDataSourceW);
+#endif
+    if (have_w) {
+#ifdef USE_RB_ENC
+	drv = rb_funcall(drv, IDencode, 1, rb_encv);
+	astr = rb_funcall(astr, IDencode, 1, rb_encv);
+#endif
+	sdrv = uc_from_utf((unsigned char *) STR2CSTR(drv), -1);
+	sastr = uc_from_utf((unsigned char *) STR2CSTR(astr), -1);
+	if ((sdrv == NULL) || (sastr == NULL)) {
+	    uc_free(sdrv);
+	    uc_free(sastr);
+	    rb_raise(Cerror, "%s", set_err("Out of memory", 0));
+	}
+	if (SQLConfigDataSourceW(NULL, (WORD) op,
+				 (LPWSTR) sdrv, (LPWSTR) sastr)) {
+	    uc_free(sdrv);
+	    uc_free(sastr);
+	    return Qnil;
+	}
+	uc_free(sdrv);
+	uc_free(sastr);
+    } else {
+	sdrv = (SQLWCHAR *) STR2CSTR(drv);
+	sastr = (SQLWCHAR *) STR2CSTR(astr);
+	if (SQLConfigDataSource(NULL, (WORD) op,
+				(LPCSTR) sdrv, (LPCSTR) sastr)) {
+	    return Qnil;
+	}
+    }
+#else
+    sdrv = STR2CSTR(drv);
+    sastr = STR2CSTR(astr);
+    if (SQLConfigDataSource(NULL, (WORD) op, sdrv, sastr)) {
+	return Qnil;
+    }
+#endif
+#if defined(HAVE_SQLINSTALLERERROR) || (defined(UNICODE) && defined(HAVE_SQLINSTALLERERRORW))
+    rb_raise(Cerror, "%s", set_err(get_installer_err(), 0));
+#else
+    rb_raise(Cerror, "%s", set_err("DSN configuration error", 0));
+#endif
+    return Qnil;
+}
+#endif
+
+static VALUE
+dbc_adddsn(int argc, VALUE *argv, VALUE self)
+{
+#ifdef HAVE_ODBCINST_H
+    return conf_dsn(argc, argv, self, ODBC_ADD_DSN);
+#else
+    rb_raise(Cerror, "%s", set_err("ODBC::add_dsn not supported", 0));
+    return Qnil;
+#endif
+}
+
+static VALUE
+dbc_confdsn(int argc, VALUE *argv, VALUE self)
+{
+#ifdef HAVE_ODBCINST_H
+    return conf_dsn(argc, argv, self, ODBC_CONFIG_DSN);
+#else
+    rb_raise(Cerror, "%s", set_err("ODBC::config_dsn not supported", 0));
+    return Qnil;
+#endif
+}
+
+static VALUE
+dbc_deldsn(int argc, VALUE *argv, VALUE self)
+{
+#ifdef HAVE_ODBCINST_H
+    return conf_dsn(argc, argv, self, ODBC_REMOVE_DSN);
+#else
+    rb_raise(Cerror, "%s", set_err("ODBC::del_dsn not supported", 0));
+    return Qnil;
+#endif
+}
+
+static VALUE
+dbc_wfdsn(int argc, VALUE *argv, VALUE self)
+{
+#ifdef HAVE_ODBCINST_H
+    VALUE fname, aname, kname, val;
+#ifdef UNICODE
+#ifdef HAVE_SQLWRITEFILEDSNW
+    int have_w = 1;
+#else
+    int have_w = 0;
+#endif
+    SQLWCHAR *sfname, *saname, *skname, *sval = NULL;
+#else
+    char *sfname, *saname, *skname, *sval = NULL;
+#endif
+
+    rb_scan_args(argc, argv, "31", &fname, &aname, &kname, &val);
+    Check_Type(fname, T_STRING);
+    Check_Type(aname, T_STRING);
+    Check_Type(kname, T_STRING);
+    if (val != Qnil) {
+	Check_Type(val, T_STRING);
+    }
+#ifdef UNICODE
+#ifdef USE_DLOPEN_FOR_ODBC_LIBS
+    have_w = ruby_odbc_have_func("SQLWriteFileDSNW", SQLWriteFileDSNW);
+#endif
+    if (have_w) {
+	BOOL rc;
+
+#ifdef USE_RB_ENC
+	fname = rb_funcall(fname, IDencode, 1, rb_encv);
+	aname = rb_funcall(aname, IDencode, 1, rb_encv);
+	kname = rb_funcall(kname, IDencode, 1, rb_encv);
+	if (val != Qnil) {
+	    val = rb_funcall(val, IDencode, 1, rb_encv);
+	}
+#endif
+	sfname = uc_from_utf((unsigned char *) STR2CSTR(fname), -1);
+	saname = uc_from_utf((unsigned char *) STR2CSTR(aname), -1);
+	skname = uc_from_utf((unsigned char *) STR2CSTR(kname), -1);
+	if ((sfname == NULL) || (saname == NULL) || (skname == NULL)) {
+nomem:
+	    uc_free(sfname);
+	    uc_free(saname);
+	    uc_free(skname);
+	    rb_raise(Cerror, "%s", set_err("Out of memory", 0));
+	}
+	if (val != Qnil) {
+	    sval = uc_from_utf((unsigned char *) STR2CSTR(val), -1);
+	    if (sval == NULL) {
+		goto nomem;
+	    }
+	}
+	rc = SQLWriteFileDSNW(sfname, saname, skname, sval);
+	uc_free(sfname);
+	uc_free(saname);
+	uc_free(skname);
+	uc_free(sval);
+	if (rc) {
+	    return Qnil;
+	}
+    } else {
+	sfname = (SQLWCHAR *) STR2CSTR(fname);
+	saname = (SQLWCHAR *) STR2CSTR(aname);
+	skname = (SQLWCHAR *) STR2CSTR(kname);
+	if (val != Qnil) {
+	    sval = (SQLWCHAR *) STR2CSTR(val);
+	}
+	if (SQLWriteFileDSN((LPCSTR) sfname, (LPCSTR) saname,
+			    (LPCSTR) skname, (LPCSTR) sval)) {
+	    return Qnil;
+	}
+    }
+#else
+    sfname = STR2CSTR(fname);
+    saname = STR2CSTR(aname);
+    skname = STR2CSTR(kname);
+    if (val != Qnil) {
+	sval = STR2CSTR(val);
+    }
+    if (SQLWriteFileDSN(sfname, saname, skname, sval)) {
+	return Qnil;
+    }
+#endif
+#if defined(HAVE_SQLINSTALLERERROR) || (defined(UNICODE) && defined(HAVE_SQLINSTALLERERRORW))
+    rb_raise(Cerror, "%s", set_err(get_installer_err(), 0));
+#else
+    rb_raise(Cerror, "%s", set_err("File DSN configuration error", 0));
+#endif
+#else
+    rb_raise(Cerror, "%s", set_err("ODBC::write_file_dsn not supported", 0));
+#endif
+    return Qnil;
+}
+
+static VALUE
+dbc_rfdsn(int argc, VALUE *argv, VALUE self)
+{
+#ifdef HAVE_ODBCINST_H
+    VALUE fname, aname, kname;
+#ifdef UNICODE
+#ifdef HAVE_SQLREADFILEDSNW
+    int have_w = 1;
+#else
+    int have_w = 0;
+#endif
+    SQLWCHAR *sfname, *saname, *skname, valbuf[SQL_MAX_MESSAGE_LENGTH];
+#else
+    char *sfname, *saname, *skname, valbuf[SQL_MAX_MESSAGE_LENGTH];
+#endif
+
+    rb_scan_args(argc, argv, "30", &fname, &aname, &kname);
+    Check_Type(fname, T_STRING);
+    Check_Type(aname, T_STRING);
+    Check_Type(kname, T_STRING);
+#ifdef UNICODE
+#ifdef USE_DLOPEN_FOR_ODBC_LIBS
+    have_w = ruby_odbc_have_func("SQLReadFileDSNW", SQLReadFileDSNW);
+#endif
+    if (have_w) {
+	BOOL rc;
+
+#ifdef USE_RB_ENC
+	fname = rb_funcall(fname, IDencode, 1, rb_encv);
+	aname = rb_funcall(aname, IDencode, 1, rb_encv);
+	kname = rb_funcall(kname, IDencode, 1, rb_encv);
+#endif
+	sfname = uc_from_utf((unsigned char *) STR2CSTR(fname), -1);
+	saname = uc_from_utf((unsigned char *) STR2CSTR(aname), -1);
+	skname = uc_from_utf((unsigned char *) STR2CSTR(kname), -1);
+	valbuf[0] = 0;
+	if ((sfname == NULL) || (saname == NULL) || (skname == NULL)) {
+	    uc_free(sfname);
+	    uc_free(saname);
+	    uc_free(skname);
+	    rb_raise(Cerror, "%s", set_err("Out of memory", 0));
+	}
+	rc = SQLReadFileDSNW(sfname, saname, skname, valbuf,
+			     sizeof (valbuf), NULL);
+	uc_free(sfname);
+	uc_free(saname);
+	uc_free(skname);
+	if (rc) {
+	    return uc_tainted_str_new2(valbuf);
+	}
+    } else {
+	sfname = (SQLWCHAR *) STR2CSTR(fname);
+	saname = (SQLWCHAR *) STR2CSTR(aname);
+	skname = (SQLWCHAR *) STR2CSTR(kname);
+	valbuf[0] = '\0';
+	if (SQLReadFileDSN((LPCSTR) sfname, (LPCSTR) saname,
+			   (LPCSTR) skname, (LPSTR) valbuf,
+			   sizeof (valbuf), NULL)) {
+	    return rb_tainted_str_new2((char *) valbuf);
+	}
+    }
+#else
+    sfname = STR2CSTR(fname);
+    saname = STR2CSTR(aname);
+    skname = STR2CSTR(kname);
+    valbuf[0] = '\0';
+    if (SQLReadFileDSN(sfname, saname, skname, valbuf,
+		       sizeof (valbuf), NULL)) {
+	return rb_tainted_str_new2(valbuf);
+    }
+#endif
+#if defined(HAVE_SQLINSTALLERERROR) || (defined(UNICODE) && defined(HAVE_SQLINSTALLERERRORW))
+    rb_raise(Cerror, "%s", set_err(get_installer_err(), 0));
+#else
+    rb_raise(Cerror, "%s", set_err("File DSN configuration error", 0));
+#endif
+#else
+    rb_raise(Cerror, "%s", set_err("ODBC::read_file_dsn not supported", 0));
+    return Qnil;
+#endif
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ *      Return last ODBC error or warning.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static VALUE
+dbc_error(VALUE self)
+{
+    return diag_get(self, 0);
+}
+
+static VALUE
+dbc_warn(VALUE self)
+{
+    return diag_get(self, 1);
+}
+
+static VALUE
+dbc_clrerror(VALUE self)
+{
+    VALUE thr = rb_thread_current();
+
+    if (rb_obj_is_kind_of(self, Cstmt) == Qtrue) {
+	STMT *q;
+
+	ODBC_Get_Struct(self, STMT, stmt_type, q);
+	q->error = q->info = Qnil;
+    } else if (rb_obj_is_kind_of(self, Cdbc) == Qtrue) {
+	DBC *p;
+
+	ODBC_Get_Struct(self, DBC, dbc_type, p);
+	p->error = p->info = Qnil;
+    }
+    rb_thread_local_aset(thr, IDodbcerror, Qnil);
+    rb_thread_local_aset(thr, IDodbcinfo, Qnil);
+    return Qnil;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ *      Connection instance initializer.
+ *
+ *----------------------------------------------------------------------
+ */
+
+#ifdef HAVE_RB_DEFINE_ALLOC_FUNC
+static VALUE
+dbc_alloc(VALUE self)
+{
+    DBC *p;
+    VALUE obj = ODBC_Make_Struct(self, DBC, dbc_type, mark_dbc, free_dbc,
+				 p);
+
+    tracemsg(2, fprintf(stderr, "ObjAlloc: DBC %p\n", p););
+    list_init(&p->link, offsetof(DBC, link));
+    p->self = obj;
+    p->env = Qnil;
+    p->envp = NULL;
+    list_init(&p->stmts, offsetof(STMT, link));
+    p->hdbc = SQL_NULL_HDBC;
+    p->rbtime = Qfalse;
+    p->gmtime = Qfalse;
+    p->bigdec = 0;
+    p->tzvalid = 0;
+    p->rssize = 1;
+    list_init(&p->scache, offsetof(STMT, sclink));
+    p->sccap = p->sccount = 0;
+    p->schits = p->scmisses = p->scevicts = 0;
+    p->pool = Qnil;
+    p->pooltime = 0;
+    p->error = p->info = Qnil;
+    p->warnings = 1;
+    memset(&p->stats, 0, sizeof (STATS));
+    p->busy = 0;
+    return obj;
+}
+#endif
+
+static VALUE
+dbc_new(int argc, VALUE *argv, VALUE self)
+{
+    DBC *p;
+    VALUE obj, env = Qnil;
+
+    if (TYPE(self) == T_MODULE) {
+	self = Cobj;
+    }
+    if (self == Cobj) {
+	self = Cdbc;
+    }
+    if (rb_obj_is_kind_of(self, Cenv) == Qtrue) {
+	env = env_of(self);
+	self = Cdbc;
+    }
+#ifdef HAVE_RB_DEFINE_ALLOC_FUNC
+    obj = rb_obj_alloc(Cdbc);
+    ODBC_Get_Struct(obj, DBC, dbc_type, p);
+    p->env = env;
+#else
+    obj = ODBC_Make_Struct(self, DBC, dbc_type, mark_dbc, free_dbc, p);
+    tracemsg(2, fprintf(stderr, "ObjAlloc: DBC %p\n", p););
+    list_init(&p->link, offsetof(DBC, link));
+    p->self = obj;
+    p->env = env;
+    p->envp = NULL;
+    list_init(&p->stmts, offsetof(STMT, link));
+    p->hdbc = SQL_NULL_HDBC;
+    p->upc = 0;
+    p->bigdec = 0;
+    p->tzvalid = 0;
+    p->rssize = 1;
+    list_init(&p->scache, offsetof(STMT, sclink));
+    p->sccap = p->sccount = 0;
+    p->schits = p->scmisses = p->scevicts = 0;
+    p->pool = Qnil;
+    p->pooltime = 0;
+    p->error = p->info = Qnil;
+    p->warnings = 1;
+    memset(&p->stats, 0, sizeof (STATS));
+    p->busy = 0;
+#endif
+    if (env != Qnil) {
+	ENV *e;
+
+	ODBC_Get_Struct(env, ENV, env_type, e);
+	link_dbc(p, e);
+    }
+    if (argc > 0) {
+	rb_obj_call_init(obj, argc, argv);
+    }
+    return obj;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ *      Connect to data source.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static VALUE
+dbc_connect(int argc, VALUE *argv, VALUE self)
+{
+    ENV *e;
+    DBC *p;
+    VALUE dsn, user, passwd;
+#ifdef UNICODE
+    SQLWCHAR *sdsn = NULL, *suser = NULL, *spasswd = NULL;
+#else
+    char *sdsn, *suser = NULL, *spasswd = NULL;
+#endif
+    char *msg;
+    SQLHDBC dbc;
+
+    rb_scan_args(argc, argv, "03", &dsn, &user, &passwd);
+    if (dsn != Qnil) {
+	if (rb_obj_is_kind_of(dsn, Cdsn) == Qtrue) {
+	    dsn = rb_iv_get(dsn, "@name");
+	}
+	Check_Type(dsn, T_STRING);
+    }
+    if (user != Qnil) {
+	Check_Type(user, T_STRING);
+    }
+    if (passwd != Qnil) {
+	Check_Type(passwd, T_STRING);
+    }
+    p = get_dbc(self);
+    if (p->hdbc != SQL_NULL_HDBC) {
+	rb_raise(Cerror, "%s", set_err("Already connected", 0));
+    }
+    if (p->env == Qnil) {
+	p->env = env_new(Cenv);
+	e = get_env(p->env);
+	link_dbc(p, e);
+    } else {
+	e = get_env(p->env);
+    }
+    if (dsn == Qnil) {
+	return self;
+    }
+#ifdef UNICODE
+    if (user != Qnil) {
+#ifdef USE_RB_ENC
+	user = rb_funcall(user, IDencode, 1, rb_encv);
+#endif
+	suser = uc_from_utf((unsigned char *) STR2CSTR(user), -1);
+    }
+    if (passwd != Qnil) {
+#ifdef USE_RB_ENC
+	passwd = rb_funcall(passwd, IDencode, 1, rb_encv);
+#endif
+	spasswd = uc_from_utf((unsigned char *) STR2CSTR(passwd), -1);
+    }
+#ifdef USE_RB_ENC
+    dsn = rb_funcall(dsn, IDencode, 1, rb_encv);
+#endif
+    sdsn = uc_from_utf((unsigned char *) STR2CSTR(dsn), -1);
+    if (((suser == NULL) && (user != Qnil)) ||
+	((spasswd == NULL) && (passwd != Qnil)) ||
+	(sdsn == NULL)) {
+	uc_free(sdsn);
+	uc_free(suser);
+	uc_free(spasswd);
+	rb_raise(Cerror, "%s", set_err("Out of memory", 0));
+    }
+#else
+    if (user != Qnil) {
+	suser = STR2CSTR(user);
+    }
+    if (passwd != Qnil) {
+	spasswd = STR2CSTR(passwd);
+    }
+    sdsn = STR2CSTR(dsn);
+#endif
+    if (!succeeded(e->henv, SQL_NULL_HDBC, SQL_NULL_HSTMT,
+		   SQLAllocConnect(e->henv, &dbc), &msg, "SQLAllocConnect")) {
+#ifdef UNICODE
+	uc_free(sdsn);
+	uc_free(suser);
+	uc_free(spasswd);
+#endif
+	rb_raise(Cerror, "%s", msg);
+    }
+    if (!succeeded(SQL_NULL_HENV, dbc, SQL_NULL_HSTMT,
+		   nogvl_connect(dbc, (SQLTCHAR *) sdsn,
+				 (SQLTCHAR *) suser, (SQLTCHAR *) spasswd),
+		   &msg,
+		   "SQLConnect('%s')", sdsn)) {
+#ifdef UNICODE
+	uc_free(sdsn);
+	uc_free(suser);
+	uc_free(spasswd);
+#endif
+	callsql(SQL_NULL_HENV, dbc, SQL_NULL_HSTMT,
+		SQLFreeConnect(dbc), "SQLFreeConnect");
+	rb_raise(Cerror, "%s", msg);
+    }
+#ifdef UNICODE
+    uc_free(sdsn);
+    uc_free(suser);
+    uc_free(spasswd);
+#endif
+    p->hdbc = dbc;
+    diag_own_dbc(p);
+    return self;
+}
+
+/* Connection string from ODBC::Driver attributes. */
+
+static VALUE
+drv_conn_str(VALUE drv)
+{
+    if (rb_obj_is_kind_of(drv, Cdrv) == Qtrue) {
+	VALUE d, a, x;
+
+	d = rb_str_new2("");
+	a = rb_funcall(rb_iv_get(drv, "@attrs"), IDkeys, 0, NULL);
+	while ((x = rb_ary_shift(a)) != Qnil) {
+	    VALUE v = rb_hash_aref(rb_iv_get(drv, "@attrs"), x);
+
+	    d = rb_str_concat(d, x);
+	    d = rb_str_cat2(d, "=");
+	    d = rb_str_concat(d, v);
+	    d = rb_str_cat2(d, ";");
+	}
+	drv = d;
+    }
+    Check_Type(drv, T_STRING);
+    return drv;
+}
+
+static VALUE
+dbc_drvconnect(VALUE self, VALUE drv)
+{
+    ENV *e;
+    DBC *p;
+#ifdef UNICODE
+    SQLWCHAR *sdrv;
+#else
+    char *sdrv;
+#endif
+    char *msg;
+    SQLHDBC dbc;
+
+    drv = drv_conn_str(drv);
+    p = get_dbc(self);
+    if (p->hdbc != SQL_NULL_HDBC) {
+	rb_raise(Cerror, "%s", set_err("Already connected", 0));
+    }
+    if (p->env == Qnil) {
+	p->env = env_new(Cenv);
+	e = get_env(p->env);
+	link_dbc(p, e);
+    } else {
+	e = get_env(p->env);
+    }
+#ifdef UNICODE
+#ifdef USE_RB_ENC
+    drv = rb_funcall(drv, IDencode, 1, rb_encv);
+#endif
+    sdrv = uc_from_utf((unsigned char *) STR2CSTR(drv), -1);
+    if (sdrv == NULL) {
+	rb_raise(Cerror, "%s", set_err("Out of memory", 0));
+    }
+#else
+    sdrv = STR2CSTR(drv);
+#endif
+    if (!succeeded(e->henv, SQL_NULL_HDBC, SQL_NULL_HSTMT,
+		   SQLAllocConnect(e->henv, &dbc), &msg, "SQLAllocConnect")) {
+#ifdef UNICODE
+	uc_free(sdrv);
+#endif
+	rb_raise(Cerror, "%s", msg);
+    }
+    if (!succeeded(e->henv, dbc, SQL_NULL_HSTMT,
+		   nogvl_drvconnect(dbc, (SQLTCHAR *) sdrv),
+		   &msg, "SQLDriverConnect")) {
+#ifdef UNICODE
+	uc_free(sdrv);
+#endif
+	callsql(SQL_NULL_HENV, dbc, SQL_NULL_HSTMT,
+		SQLFreeConnect(dbc), "SQLFreeConnect");
+	rb_raise(Cerror, "%s", msg);
+    }
+#ifdef UNICODE
+    uc_free(sdrv);
+#endif
+    p->hdbc = dbc;
+    diag_own_dbc(p);
+    return self;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ *      Connect many data sources in parallel.
+ *
+ *      Environment.connect_many runs the SQLAllocConnect() and
+ *      SQLConnect()/SQLDriverConnect() sequences in up to parallelism
+ *      Ruby threads. The connects are made without the GVL, thus the
+ *      logins proceed concurrently.
+ *
+ *----------------------------------------------------------------------
+ */
+
+typedef struct {
+    int drv;
+    SQLTCHAR *dsn;
+    SQLTCHAR *user;
+    SQLTCHAR *passwd;
+    SQLHDBC hdbc;
+} CONNJOB;
+
+typedef struct {
+    ENV *e;
+    VALUE specs;
+    CONNJOB *jobs;
+    long njobs;
+    long next;
+    long nthreads;
+    VALUE errs;
+    VALUE threads;
+} CONNMANY;
+
+static SQLTCHAR *
+connect_str(VALUE str)
+{
+    SQLTCHAR *s;
+
+    if (str == Qnil) {
+	return NULL;
+    }
+    Check_Type(str, T_STRING);
+#ifdef UNICODE
+#ifdef USE_RB_ENC
+    str = rb_funcall(str, IDencode, 1, rb_encv);
+#endif
+    s = (SQLTCHAR *) uc_from_utf((unsigned char *) RSTRING_PTR(str),
+				 (int) RSTRING_LEN(str));
+    if (s == NULL) {
+	rb_raise(Cerror, "%s", set_err("Out of memory", 0));
+    }
+#else
+    s = (SQLTCHAR *) ALLOC_N(char, RSTRING_LEN(str) + 1);
+    memcpy(s, RSTRING_PTR(str), RSTRING_LEN(str));
+    ((char *) s)[RSTRING_LEN(str)] = '\0';
+#endif
+    return s;
+}
+
+/* Keep message and diagnostics, which are local to the worker thread. */
+
+static void
+connect_many_err(CONNMANY *m, long k, char *msg)
+{
+    VALUE diag = rb_thread_local_aref(rb_thread_current(), IDodbcerror);
+
+    rb_ary_store(m->errs, k, rb_ary_new3(2, rb_str_new2(msg), diag));
+}
+
+static VALUE
+connect_many_thread(void *arg)
+{
+    CONNMANY *m = (CONNMANY *) arg;
+
+    /* jobs are taken with the GVL held */
+    while (m->next < m->njobs) {
+	long k = m->next++;
+	CONNJOB *j = &m->jobs[k];
+	SQLHDBC dbc = SQL_NULL_HDBC;
+	SQLRETURN ret;
+	char *msg;
+
+	if (!succeeded(m->e->henv, SQL_NULL_HDBC, SQL_NULL_HSTMT,
+		       SQLAllocConnect(m->e->henv, &dbc),
+		       &msg, "SQLAllocConnect")) {
+	    connect_many_err(m, k, msg);
+	    continue;
+	}
+	if (j->drv) {
+	    ret = nogvl_drvconnect(dbc, j->dsn);
+	} else {
+	    ret = nogvl_connect(dbc, j->dsn, j->user, j->passwd);
+	}
+	if (!succeeded(SQL_NULL_HENV, dbc, SQL_NULL_HSTMT, ret, &msg,
+		       j->drv ? "SQLDriverConnect" : "SQLConnect")) {
+	    connect_many_err(m, k, msg);
+	    callsql(SQL_NULL_HENV, dbc, SQL_NULL_HSTMT,
+		    SQLFreeConnect(dbc), "SQLFreeConnect");
+	    continue;
+	}
+	j->hdbc = dbc;
+    }
+    return Qnil;
+}
+
+static VALUE
+connect_many_join(VALUE thread)
+{
+    return rb_funcall(thread, IDjoin, 0);
+}
+
+static VALUE
+connect_many_ensure(VALUE arg)
+{
+    CONNMANY *m = (CONNMANY *) arg;
+    long k;
+    int state;
+
+    /* threads use the job strings until they are done */
+    for (k = 0; k < RARRAY_LEN(m->threads); k++) {
+	rb_protect(connect_many_join, rb_ary_entry(m->threads, k), &state);
+    }
+    for (k = 0; k < m->njobs; k++) {
+	CONNJOB *j = &m->jobs[k];
+
+	if (j->dsn != NULL) {
+	    xfree(j->dsn);
+	}
+	if (j->user != NULL) {
+	    xfree(j->user);
+	}
+	if (j->passwd != NULL) {
+	    xfree(j->passwd);
+	}
+	if (j->hdbc != SQL_NULL_HDBC) {
+	    /* not handed over to ODBC::Database */
+	    callsql(SQL_NULL_HENV, j->hdbc, SQL_NULL_HSTMT,
+		    SQLDisconnect(j->hdbc), "SQLDisconnect");
+	    callsql(SQL_NULL_HENV, j->hdbc, SQL_NULL_HSTMT,
+		    SQLFreeConnect(j->hdbc), "SQLFreeConnect");
+	}
+    }
+    xfree(m->jobs);
+    return Qnil;
+}
+
+static VALUE
+connect_many_run(VALUE arg)
+{
+    CONNMANY *m = (CONNMANY *) arg;
+    long k;
+    VALUE res;
+
+    for (k = 0; k < m->nthreads; k++) {
+	rb_ary_push(m->threads,
+		    rb_thread_create(connect_many_thread, (void *) m));
+    }
+    for (k = 0; k < m->nthreads; k++) {
+	connect_many_join(rb_ary_entry(m->threads, k));
+    }
+    for (k = 0; k < m->njobs; k++) {
+	VALUE err = rb_ary_entry(m->errs, k);
+
+	if (err != Qnil) {
+	    VALUE msg = rb_ary_entry(err, 0);
+
+	    /* make ODBC.error of the caller tell about it */
+	    rb_thread_local_aset(rb_thread_current(), IDodbcerror,
+				 rb_ary_entry(err, 1));
+	    rb_raise(Cerror, "%s", STR2CSTR(msg));
+	}
+    }
+    res = rb_ary_new2(m->njobs);
+    for (k = 0; k < m->njobs; k++) {
+	VALUE obj = dbc_new(0, NULL, m->e->self);
+	DBC *p;
+
+	ODBC_Get_Struct(obj, DBC, dbc_type, p);
+	p->hdbc = m->jobs[k].hdbc;
+	m->jobs[k].hdbc = SQL_NULL_HDBC;
+	diag_own_dbc(p);
+	rb_ary_push(res, obj);
+    }
+    return res;
+}
+
+static VALUE
+connect_many_prep(VALUE arg)
+{
+    CONNMANY *m = (CONNMANY *) arg;
+    long k;
+
+    for (k = 0; k < m->njobs; k++) {
+	CONNJOB *j = &m->jobs[k];
+	VALUE spec = rb_ary_entry(m->specs, k);
+
+	if (rb_obj_is_kind_of(spec, Cdrv) == Qtrue) {
+	    j->drv = 1;
+	    j->dsn = connect_str(drv_conn_str(spec));
+	    continue;
+	}
+	if (TYPE(spec) == T_ARRAY) {
+	    j->user = connect_str(rb_ary_entry(spec, 1));
+	    j->passwd = connect_str(rb_ary_entry(spec, 2));
+	    spec = rb_ary_entry(spec, 0);
+	}
+	if (rb_obj_is_kind_of(spec, Cdsn) == Qtrue) {
+	    spec = rb_iv_get(spec, "@name");
+	}
+	if (spec == Qnil) {
+	    rb_raise(rb_eArgError, "missing data source name");
+	}
+	j->dsn = connect_str(spec);
+    }
+    return connect_many_run(arg);
+}
+
+static VALUE
+env_connect_many(int argc, VALUE *argv, VALUE self)
+{
+    CONNMANY m;
+    VALUE specs, opts;
+    long par = 8;
+
+    rb_scan_args(argc, argv, "11", &specs, &opts);
+    Check_Type(specs, T_ARRAY);
+    if (opts != Qnil) {
+	if (FIXNUM_P(opts)) {
+	    par = FIX2LONG(opts);
+	} else {
+	    VALUE v;
+
+	    Check_Type(opts, T_HASH);
+	    if ((v = rb_hash_aref(opts, ID2SYM(IDparallelism))) != Qnil) {
+		par = NUM2LONG(v);
+	    }
+	}
+    }
+    if (par <= 0) {
+	rb_raise(rb_eArgError, "parallelism must be positive");
+    }
+    m.e = get_env(self);
+    m.specs = specs;
+    m.njobs = RARRAY_LEN(specs);
+    m.next = 0;
+    if (m.njobs == 0) {
+	return rb_ary_new();
+    }
+    m.nthreads = (par < m.njobs) ? par : m.njobs;
+    m.errs = rb_ary_new2(m.njobs);
+    m.threads = rb_ary_new2(m.nthreads);
+    m.jobs = ALLOC_N(CONNJOB, m.njobs);
+    memset(m.jobs, 0, m.njobs * sizeof (CONNJOB));
+    return rb_ensure(connect_many_prep, (VALUE) &m, connect_many_ensure,
+		     (VALUE) &m);
+}
+
+static VALUE
+dbc_connected(VALUE self)
+{
+    DBC *p = get_dbc(self);
+
+    return (p->hdbc == SQL_NULL_HDBC) ? Qfalse : Qtrue;
+}
+
+static VALUE
+dbc_timefmt(int argc, VALUE *argv, VALUE self)
+{
+    DBC *p = get_dbc(self);
+    VALUE val;
+
+    if (argc > 0) {
+	rb_scan_args(argc, argv, "1", &val);
+	p->rbtime = (val != Qnil && val != Qfalse) ? Qtrue : Qfalse;
+	p->tzvalid = 0;
+    }
+    return p->rbtime;
+}
+
+static VALUE
+dbc_timeutc(int argc, VALUE *argv, VALUE self)
+{
+    DBC *p = get_dbc(self);
+    VALUE val;
+
+    if (argc > 0) {
+	rb_scan_args(argc, argv, "1", &val);
+	p->gmtime = (val != Qnil && val != Qfalse) ? Qtrue : Qfalse;
+	p->tzvalid = 0;
+    }
+    return p->gmtime;
+}
+
+static VALUE
+dbc_bigdec(int argc, VALUE *argv, VALUE self)
+{
+    DBC *p = get_dbc(self);
+    VALUE val;
+
+    if (argc > 0) {
+	rb_scan_args(argc, argv, "1", &val);
+	p->bigdec = RTEST(val);
+	if (p->bigdec) {
+	    rb_require("bigdecimal");
+	}
+    }
+    return p->bigdec ? Qtrue : Qfalse;
+}
+
+static VALUE
+dbc_warnings(int argc, VALUE *argv, VALUE self)
+{
+    DBC *p = get_dbc(self);
+    VALUE val;
+
+    if (argc > 0) {
+	rb_scan_args(argc, argv, "1", &val);
+	p->warnings = RTEST(val);
+	if (!p->warnings) {
+	    p->info = Qnil;
+	}
+    }
+    return p->warnings ? Qtrue : Qfalse;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ *      Prepared statement cache of connection.
+ *
+ *      Statements prepared by ODBC::Database.prepare/run/do are
+ *      tagged with their SQL text. When dropped (or at the end of
+ *      the block given to prepare) they are closed and kept in a
+ *      per connection LRU list instead, ready for the next prepare
+ *      of the same SQL text. Cached statements are owned by the
+ *      cache and marked through their connection. The handle moves
+ *      to a new ODBC::Statement object when cached, the dropped one
+ *      is stale from then on. Statement options changed by the
+ *      application are restored before caching.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static unsigned long
+scache_hash(VALUE sql)
+{
+    unsigned char *s = (unsigned char *) RSTRING_PTR(sql);
+    long len = RSTRING_LEN(sql);
+    unsigned long h = 2166136261UL;
+
+    while (len-- > 0) {
+	h = (h ^ *s++) * 16777619UL;
+    }
+    return h;
+}
+
+static STMT *
+scache_find(DBC *p, VALUE sql, unsigned long hash)
+{
+    LINK *l;
+
+    for (l = p->scache.succ; l != NULL; l = l->succ) {
+	STMT *q = (STMT *) ((char *) l - p->scache.offs);
+
+	if ((q->schash == hash) &&
+	    (RSTRING_LEN(q->sckey) == RSTRING_LEN(sql)) &&
+	    (memcmp(RSTRING_PTR(q->sckey), RSTRING_PTR(sql),
+		    RSTRING_LEN(sql)) == 0)) {
+	    return q;
+	}
+    }
+    return NULL;
+}
+
+static void
+scache_evict(DBC *p, STMT *q)
+{
+    list_del(&q->sclink);
+    p->sccount--;
+    q->sckey = Qnil;
+    stmt_drop(q->self);
+}
+
+static void
+scache_trim(DBC *p)
+{
+    while (p->sccount > p->sccap) {
+	LINK *l = p->scache.succ;
+
+	/* least recently used is at tail of list */
+	while (l->succ != NULL) {
+	    l = l->succ;
+	}
+	scache_evict(p, (STMT *) ((char *) l - p->scache.offs));
+	p->scevicts++;
+    }
+}
+
+static void
+scache_flush(DBC *p)
+{
+    while (!list_empty(&p->scache)) {
+	scache_evict(p, list_first(&p->scache));
+    }
+}
+
+static void
+scache_saveopt(STMT *q, int op)
+{
+    SQLINTEGER v = 0;
+    long i;
+
+    if (q->sckey == Qnil) {
+	return;
+    }
+    if (q->scopts == Qnil) {
+	q->scopts = rb_ary_new();
+    }
+    /* pairs of option and value before first change */
+    for (i = 0; i < RARRAY_LEN(q->scopts); i += 2) {
+	if (NUM2INT(rb_ary_entry(q->scopts, i)) == op) {
+	    return;
+	}
+    }
+    if (!succeeded(SQL_NULL_HENV, SQL_NULL_HDBC, q->hstmt,
+		   SQLGetStmtOption(q->hstmt, (SQLUSMALLINT) op,
+				    (SQLPOINTER) &v),
+		   NULL, "SQLGetStmtOption(%d)", op)) {
+	/* can't be restored, don't cache */
+	q->sckey = Qnil;
+	return;
+    }
+    rb_ary_push(q->scopts, INT2NUM(op));
+    rb_ary_push(q->scopts, INT2NUM(v));
+}
+
+static int
+scache_resetopts(STMT *q)
+{
+    long i;
+    int ret = 1;
+
+    for (i = 0; (q->scopts != Qnil) && (i < RARRAY_LEN(q->scopts)); i += 2) {
+	int op = NUM2INT(rb_ary_entry(q->scopts, i));
+	SQLINTEGER v = NUM2INT(rb_ary_entry(q->scopts, i + 1));
+
+	if (!succeeded(SQL_NULL_HENV, SQL_NULL_HDBC, q->hstmt,
+		       SQLSetStmtOption(q->hstmt, (SQLUSMALLINT) op,
+					(SQLUINTEGER) v),
+		       NULL, "SQLSetStmtOption(%d)", op)) {
+	    ret = 0;
+	}
+    }
+    q->scopts = Qnil;
+    return ret;
+}
+
+static int
+scache_put(STMT *q)
+{
+    DBC *p = q->dbcp;
+    STMT *nq;
+
+    if ((q->sckey == Qnil) || (p == NULL) || (p->sccap <= 0) ||
+	(q->hstmt == SQL_NULL_HSTMT) || (q->sclink.head != NULL) ||
+	(scache_find(p, q->sckey, q->schash) != NULL)) {
+	return 0;
+    }
+    if (!succeeded(SQL_NULL_HENV, SQL_NULL_HDBC, q->hstmt,
+		   SQLFreeStmt(q->hstmt, SQL_CLOSE),
+		   NULL, "SQLFreeStmt(SQL_CLOSE)") ||
+	!scache_resetopts(q)) {
+	return 0;
+    }
+    /* hand over handle, parameters and result set description */
+    wrap_stmt(q->dbc, p, q->hstmt, &nq);
+    nq->sckey = q->sckey;
+    nq->schash = q->schash;
+    nq->nump = q->nump;
+    nq->paraminfo = q->paraminfo;
+    nq->bigdec = q->bigdec;
+    nq->ndesc = q->ndesc;
+    nq->desc = q->desc;
+    nq->async = q->async;
+    q->async = 0;
+    q->paraminfo = NULL;
+    q->nump = 0;
+    q->desc = NULL;
+    q->ndesc = -1;
+    q->sckey = Qnil;
+    free_stmt_sub(q, 1);
+    unlink_stmt(q);
+    q->hstmt = SQL_NULL_HSTMT;
+    list_add(&nq->sclink, &p->scache);
+    p->sccount++;
+    scache_trim(p);
+    return 1;
+}
+
+static VALUE
+scache_release(VALUE self)
+{
+    STMT *q;
+
+    ODBC_Get_Struct(self, STMT, stmt_type, q);
+    if (!scache_put(q)) {
+	stmt_close(self);
+    }
+    return self;
+}
+
+static VALUE
+scache_prep(int argc, VALUE *argv, VALUE self, int mode)
+{
+    DBC *p = get_dbc(self);
+    STMT *q;
+    VALUE sql, stmt;
+    unsigned long hash;
+
+    rb_scan_args(argc, argv, "1", &sql);
+    Check_Type(sql, T_STRING);
+    hash = scache_hash(sql);
+    q = scache_find(p, sql, hash);
+    if (q != NULL) {
+	list_del(&q->sclink);
+	p->sccount--;
+	p->schits++;
+	stmt = q->self;
+    } else {
+	p->scmisses++;
+	stmt = stmt_prep_int(argc, argv, self,
+			     (mode & ~MAKERES_BLOCK) | MAKERES_NOCACHE);
+	ODBC_Get_Struct(stmt, STMT, stmt_type, q);
+	q->sckey = rb_str_new(RSTRING_PTR(sql), RSTRING_LEN(sql));
+	rb_obj_freeze(q->sckey);
+	q->schash = hash;
+    }
+    if ((mode & MAKERES_BLOCK) && rb_block_given_p()) {
+	return rb_ensure(rb_yield, stmt, scache_release, stmt);
+    }
+    return stmt;
+}
+
+static VALUE
+dbc_stmtcache(int argc, VALUE *argv, VALUE self)
+{
+    DBC *p = get_dbc(self);
+    VALUE val;
+
+    if (argc > 0) {
+	int n;
+
+	rb_scan_args(argc, argv, "1", &val);
+	n = NUM2INT(val);
+	if (n < 0) {
+	    rb_raise(Cerror, "%s", set_err("Invalid statement cache size", 0));
+	}
+	p->sccap = n;
+	scache_trim(p);
+    }
+    return INT2NUM(p->sccap);
+}
+
+static VALUE
+dbc_stmtcachestats(VALUE self)
+{
+    DBC *p = get_dbc(self);
+    VALUE h = rb_hash_new();
+
+    rb_hash_aset(h, ID2SYM(rb_intern("size")), INT2NUM(p->sccount));
+    rb_hash_aset(h, ID2SYM(rb_intern("capacity")), INT2NUM(p->sccap));
+    rb_hash_aset(h, ID2SYM(rb_intern("hits")), LONG2NUM(p->schits));
+    rb_hash_aset(h, ID2SYM(rb_intern("misses")), LONG2NUM(p->scmisses));
+    rb_hash_aset(h, ID2SYM(rb_intern("evictions")), LONG2NUM(p->scevicts));
+    return h;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ *      Performance counters as Hash.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static VALUE
+stats_hash(STATS *s)
+{
+    VALUE h = rb_hash_new();
+
+    rb_hash_aset(h, ID2SYM(rb_intern("executes")), ULONG2NUM(s->executes));
+    rb_hash_aset(h, ID2SYM(rb_intern("prepares")), ULONG2NUM(s->prepares));
+    rb_hash_aset(h, ID2SYM(rb_intern("fetches")), ULONG2NUM(s->fetches));
+    rb_hash_aset(h, ID2SYM(rb_intern("rows")), ULONG2NUM(s->rows));
+    rb_hash_aset(h, ID2SYM(rb_intern("get_data")), ULONG2NUM(s->getdata));
+    rb_hash_aset(h, ID2SYM(rb_intern("lob_bytes")), ULONG2NUM(s->lobbytes));
+    rb_hash_aset(h, ID2SYM(rb_intern("with_info")), ULONG2NUM(s->withinfo));
+    rb_hash_aset(h, ID2SYM(rb_intern("driver_time")),
+		 rb_float_new(s->drvtime));
+    rb_hash_aset(h, ID2SYM(rb_intern("convert_time")),
+		 rb_float_new(s->convtime));
+    return h;
+}
+
+static VALUE
+mod_stats(int argc, VALUE *argv, VALUE self)
+{
+    VALUE h, reset = Qfalse;
+
+    rb_scan_args(argc, argv, "01", &reset);
+    h = stats_hash(&stats_total);
+    if (RTEST(reset)) {
+	memset(&stats_total, 0, sizeof (STATS));
+    }
+    return h;
+}
+
+static VALUE
+dbc_stats(int argc, VALUE *argv, VALUE self)
+{
+    DBC *p = get_dbc(self);
+    VALUE h, reset = Qfalse;
+
+    rb_scan_args(argc, argv, "01", &reset);
+    h = stats_hash(&p->stats);
+    if (RTEST(reset)) {
+	memset(&p->stats, 0, sizeof (STATS));
+    }
+    return h;
+}
+
+static VALUE
+stmt_stats(int argc, VALUE *argv, VALUE self)
+{
+    STMT *q;
+    VALUE h, reset = Qfalse;
+
+    ODBC_Get_Struct(self, STMT, stmt_type, q);
+    rb_scan_args(argc, argv, "01", &reset);
+    h = stats_hash(&q->stats);
+    if (RTEST(reset)) {
+	memset(&q->stats, 0, sizeof (STATS));
+    }
+    return h;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ *      Drop all active statements from data source.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static VALUE
+dbc_dropall(VALUE self)
+{
+    DBC *p = get_dbc(self);
+
+    dbc_check_busy(p);
+    scache_flush(p);
+    while (!list_empty(&p->stmts)) {
+	STMT *q = list_first(&p->stmts);
+
+	if (q->self == Qnil) {
+	    rb_fatal("RubyODBC: invalid stmt in dropall");
+	}
+	q->sckey = Qnil;
+	stmt_drop(q->self);
+    }
+    return self;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ *      Disconnect from data source.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static VALUE
+dbc_disconnect(int argc, VALUE *argv, VALUE self)
+{
+    DBC *p = get_dbc(self);
+    VALUE nodrop = Qfalse;
+    char *msg;
+
+    rb_scan_args(argc, argv, "01", &nodrop);
+    dbc_check_busy(p);
+    if (!RTEST(nodrop)) {
+	dbc_dropall(self);
+    }
+    if (p->hdbc == SQL_NULL_HDBC) {
+	return Qtrue;
+    }
+    if (list_empty(&p->stmts)) {
+	callsql(SQL_NULL_HENV, p->hdbc, SQL_NULL_HSTMT,
+		SQLDisconnect(p->hdbc), "SQLDisconnect");
+	if (!succeeded(SQL_NULL_HENV, p->hdbc, SQL_NULL_HSTMT,
+		       SQLFreeConnect(p->hdbc), &msg, "SQLFreeConnect")) {
+	    rb_raise(Cerror, "%s", msg);
+	}
+	diag_disown_dbc(p);
+	p->hdbc = SQL_NULL_HDBC;
+	unlink_dbc(p);
+	if (gcinterval > 0) {
+	    start_gc();
+	}
+	return Qtrue;
+    }
+    return Qfalse;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ *      Connection pool.
+ *
+ *      An ODBC::Pool keeps up to max connections to one data source.
+ *      Idle connections are kept in an array, most recently used
+ *      last, and are validated using SQL_ATTR_CONNECTION_DEAD on
+ *      checkout. Threads waiting for a connection sleep and are
+ *      woken up on checkin. All pool state is only changed while
+ *      holding the GVL; connects and validations release it.
+ *
+ *----------------------------------------------------------------------
+ */
+
+#define POOL_WAIT_SLICE 0.1
+
+static void
+mark_pool(POOL *pl)
+{
+    rb_gc_mark(pl->env);
+    rb_gc_mark(pl->dsn);
+    rb_gc_mark(pl->user);
+    rb_gc_mark(pl->passwd);
+    rb_gc_mark(pl->idle);
+    rb_gc_mark(pl->waiters);
+}
+
+static void
+free_pool(POOL *pl)
+{
+    tracemsg(2, fprintf(stderr, "ObjFree: POOL %p\n", pl););
+    xfree(pl);
+}
+
+#ifdef USE_TYPEDDATA
+static size_t
+memsize_pool(const void *ptr)
+{
+    return sizeof (POOL);
+}
+
+static const rb_data_type_t pool_type = {
+    "ODBC::Pool",
+    { (void (*)(void *)) mark_pool, (void (*)(void *)) free_pool,
+      memsize_pool, },
+    ODBC_TYPED_FLAGS_IMM
+};
+#endif
+
+static POOL *
+get_pool(VALUE self)
+{
+    POOL *pl;
+
+    ODBC_Get_Struct(self, POOL, pool_type, pl);
+    return pl;
+}
+
+static double
+pool_now(void)
+{
+    /* monotonic, wall clock jumps must not expire connections */
+    return stats_now();
+}
+
+static VALUE
+pool_connect_body(VALUE arg)
+{
+    POOL *pl = (POOL *) arg;
+    VALUE dbc, args[3];
+
+    dbc = dbc_new(0, NULL, pl->env);
+    if (rb_obj_is_kind_of(pl->dsn, Cdrv) == Qtrue) {
+	dbc_drvconnect(dbc, pl->dsn);
+    } else {
+	args[0] = pl->dsn;
+	args[1] = pl->user;
+	args[2] = pl->passwd;
+	dbc_connect(3, args, dbc);
+    }
+    return dbc;
+}
+
+static void
+pool_wakeup(POOL *pl)
+{
+    VALUE th = rb_ary_shift(pl->waiters);
+
+    if (th != Qnil) {
+	rb_thread_wakeup(th);
+    }
+}
+
+static VALUE
+pool_connect(POOL *pl)
+{
+    VALUE dbc;
+    DBC *p;
+    int state = 0;
+
+    /* reserve the slot, other threads run while connecting */
+    pl->count++;
+    dbc = rb_protect(pool_connect_body, (VALUE) pl, &state);
+    if (state) {
+	pl->count--;
+	pool_wakeup(pl);
+	rb_jump_tag(state);
+    }
+    pl->creations++;
+    p = get_dbc(dbc);
+    p->pool = pl->self;
+    p->pooltime = pool_now();
+    return dbc;
+}
+
+static void
+pool_discard(POOL *pl, VALUE dbc)
+{
+    DBC *p = get_dbc(dbc);
+
+    p->pool = Qnil;
+    pl->count--;
+    pool_wakeup(pl);
+    dbc_disconnect(0, NULL, dbc);
+}
+
+static int
+pool_valid(POOL *pl, VALUE dbc)
+{
+    DBC *p = get_dbc(dbc);
+
+    if (p->hdbc == SQL_NULL_HDBC) {
+	return 0;
+    }
+#ifdef SQL_ATTR_CONNECTION_DEAD
+    if (pl->validate) {
+	SQLUINTEGER dead = SQL_CD_FALSE;
+
+	/* drivers not supporting the attribute fail, assume alive */
+	if (SQL_SUCCEEDED(nogvl_getconnopt(p->hdbc,
+					   SQL_ATTR_CONNECTION_DEAD,
+					   (SQLPOINTER) &dead)) &&
+	    (dead == SQL_CD_TRUE)) {
+	    return 0;
+	}
+    }
+#endif
+    return 1;
+}
+
+static int
+pool_reap_int(POOL *pl)
+{
+    int n = 0;
+    double now;
+
+    if (pl->idletime <= 0) {
+	return 0;
+    }
+    now = pool_now();
+    /* least recently used idle connections are at the front */
+    while ((RARRAY_LEN(pl->idle) > 0) && (pl->count > pl->min)) {
+	VALUE dbc = rb_ary_entry(pl->idle, 0);
+
+	if (now - get_dbc(dbc)->pooltime < pl->idletime) {
+	    break;
+	}
+	rb_ary_shift(pl->idle);
+	pl->reaped++;
+	n++;
+	pool_discard(pl, dbc);
+    }
+    return n;
+}
+
+static VALUE
+pool_sleep(VALUE arg)
+{
+    double *secs = (double *) arg;
+    struct timeval tv;
+
+    tv.tv_sec = (long) *secs;
+    tv.tv_usec = (long) ((*secs - (double) tv.tv_sec) * 1000000.0);
+    rb_thread_wait_for(tv);
+    return Qnil;
+}
+
+static VALUE
+pool_unwait(VALUE self)
+{
+    POOL *pl = get_pool(self);
+
+    rb_ary_delete(pl->waiters, rb_thread_current());
+    return Qnil;
+}
+
+static VALUE
+pool_checkout(VALUE self)
+{
+    POOL *pl = get_pool(self);
+    double start = 0, secs;
+    int waited = 0;
+    VALUE dbc;
+
+    for (;;) {
+	if (pl->closed) {
+	    rb_raise(Cerror, "%s", set_err("Pool is shut down", 0));
+	}
+	while (RARRAY_LEN(pl->idle) > 0) {
+	    dbc = rb_ary_pop(pl->idle);
+	    pl->busy++;
+	    if (pool_valid(pl, dbc)) {
+		goto done;
+	    }
+	    pl->busy--;
+	    pl->discards++;
+	    pool_discard(pl, dbc);
+	}
+	if (pl->count < pl->max) {
+	    dbc = pool_connect(pl);
+	    pl->busy++;
+	    goto done;
+	}
+	if (!waited) {
+	    waited = 1;
+	    start = pool_now();
+	    pl->waits++;
+	}
+	secs = POOL_WAIT_SLICE;
+	if (pl->timeout >= 0) {
+	    double left = pl->timeout - (pool_now() - start);
+
+	    if (left <= 0) {
+		pl->timeouts++;
+		pl->waittime += pool_now() - start;
+		rb_raise(Cerror, "%s",
+			 set_err("Timeout waiting for connection", 0));
+	    }
+	    if (left < secs) {
+		secs = left;
+	    }
+	}
+	rb_ary_push(pl->waiters, rb_thread_current());
+	rb_ensure(pool_sleep, (VALUE) &secs, pool_unwait, self);
+    }
+done:
+    if (waited) {
+	pl->waittime += pool_now() - start;
+    }
+    return dbc;
+}
+
+static VALUE
+pool_checkin(VALUE self, VALUE dbc)
+{
+    POOL *pl = get_pool(self);
+    DBC *p;
+
+    if (rb_obj_is_kind_of(dbc, Cdbc) != Qtrue) {
+	rb_raise(rb_eTypeError, "expecting ODBC::Database");
+    }
+    p = get_dbc(dbc);
+    if ((p->pool != self) || (rb_ary_includes(pl->idle, dbc) == Qtrue)) {
+	rb_raise(Cerror, "%s",
+		 set_err("Connection not checked out from this pool", 0));
+    }
+    pl->busy--;
+    if (pl->closed || (p->hdbc == SQL_NULL_HDBC)) {
+	pool_discard(pl, dbc);
+	return self;
+    }
+    p->pooltime = pool_now();
+    rb_ary_push(pl->idle, dbc);
+    pool_reap_int(pl);
+    pool_wakeup(pl);
+    return self;
+}
+
+static VALUE
+pool_checkin_ensure(VALUE arg)
+{
+    return pool_checkin(rb_ary_entry(arg, 0), rb_ary_entry(arg, 1));
+}
+
+static VALUE
+pool_with(VALUE self)
+{
+    VALUE dbc = pool_checkout(self);
+
+    return rb_ensure(rb_yield, dbc, pool_checkin_ensure,
+		     rb_ary_new3(2, self, dbc));
+}
+
+static VALUE
+pool_reap(VALUE self)
+{
+    return INT2NUM(pool_reap_int(get_pool(self)));
+}
+
+static VALUE
+pool_shutdown(VALUE self)
+{
+    POOL *pl = get_pool(self);
+    VALUE dbc;
+
+    pl->closed = 1;
+    while ((dbc = rb_ary_pop(pl->idle)) != Qnil) {
+	pool_discard(pl, dbc);
+    }
+    while (RARRAY_LEN(pl->waiters) > 0) {
+	pool_wakeup(pl);
+    }
+    return self;
+}
+
+static VALUE
+pool_stats(VALUE self)
+{
+    POOL *pl = get_pool(self);
+    VALUE h = rb_hash_new();
+
+    rb_hash_aset(h, ID2SYM(rb_intern("size")), INT2NUM(pl->count));
+    rb_hash_aset(h, ID2SYM(rb_intern("idle")),
+		 INT2NUM(RARRAY_LEN(pl->idle)));
+    rb_hash_aset(h, ID2SYM(rb_intern("busy")), INT2NUM(pl->busy));
+    rb_hash_aset(h, ID2SYM(IDmin), INT2NUM(pl->min));
+    rb_hash_aset(h, ID2SYM(IDmax), INT2NUM(pl->max));
+    rb_hash_aset(h, ID2SYM(rb_intern("waits")), LONG2NUM(pl->waits));
+    rb_hash_aset(h, ID2SYM(rb_intern("wait_time")),
+		 rb_float_new(pl->waittime));
+    rb_hash_aset(h, ID2SYM(rb_intern("creations")),
+		 LONG2NUM(pl->creations));
+    rb_hash_aset(h, ID2SYM(rb_intern("timeouts")), LONG2NUM(pl->timeouts));
+    rb_hash_aset(h, ID2SYM(rb_intern("discarded")),
+		 LONG2NUM(pl->discards));
+    rb_hash_aset(h, ID2SYM(rb_intern("reaped")), LONG2NUM(pl->reaped));
+    return h;
+}
+
+/* Make the :min connections in parallel, see env_connect_many(). */
+
+static void
+pool_warmup(POOL *pl)
+{
+    VALUE spec, specs, conns;
+    long k;
+
+    if (pl->min <= 0) {
+	return;
+    }
+    if (rb_obj_is_kind_of(pl->dsn, Cdrv) == Qtrue) {
+	spec = pl->dsn;
+    } else {
+	spec = rb_ary_new3(3, pl->dsn, pl->user, pl->passwd);
+    }
+    specs = rb_ary_new2(pl->min);
+    for (k = 0; k < pl->min; k++) {
+	rb_ary_push(specs, spec);
+    }
+    conns = env_connect_many(1, &specs, pl->env);
+    for (k = 0; k < RARRAY_LEN(conns); k++) {
+	VALUE dbc = rb_ary_entry(conns, k);
+	DBC *p = get_dbc(dbc);
+
+	p->pool = pl->self;
+	p->pooltime = pool_now();
+	pl->count++;
+	pl->creations++;
+	rb_ary_push(pl->idle, dbc);
+    }
+}
+
+static VALUE
+pool_new(int argc, VALUE *argv, VALUE self)
+{
+    POOL *pl;
+    VALUE obj, dsn, user, passwd, opts = Qnil, env, v;
+
+    if ((argc > 0) &&
+	(rb_obj_is_kind_of(argv[argc - 1], rb_cHash) == Qtrue)) {
+	opts = argv[--argc];
+    }
+    rb_scan_args(argc, argv, "12", &dsn, &user, &passwd);
+    if (rb_obj_is_kind_of(dsn, Cdsn) == Qtrue) {
+	dsn = rb_iv_get(dsn, "@name");
+    }
+    if (rb_obj_is_kind_of(dsn, Cdrv) != Qtrue) {
+	Check_Type(dsn, T_STRING);
+    }
+    if (user != Qnil) {
+	Check_Type(user, T_STRING);
+    }
+    if (passwd != Qnil) {
+	Check_Type(passwd, T_STRING);
+    }
+    env = (self == Cpool) ? env_new(Cenv) : env_of(self);
+    obj = ODBC_Make_Struct(Cpool, POOL, pool_type, mark_pool, free_pool, pl);
+    tracemsg(2, fprintf(stderr, "ObjAlloc: POOL %p\n", pl););
+    pl->self = obj;
+    pl->env = env;
+    pl->dsn = dsn;
+    pl->user = user;
+    pl->passwd = passwd;
+    pl->idle = rb_ary_new();
+    pl->waiters = rb_ary_new();
+    pl->min = 0;
+    pl->max = 5;
+    pl->timeout = 5.0;
+    pl->idletime = 300.0;
+    pl->validate = 1;
+    if (opts != Qnil) {
+	if ((v = rb_hash_aref(opts, ID2SYM(IDmin))) != Qnil) {
+	    pl->min = NUM2INT(v);
+	}
+	if ((v = rb_hash_aref(opts, ID2SYM(IDmax))) != Qnil) {
+	    pl->max = NUM2INT(v);
+	}
+	if ((v = rb_hash_aref(opts, ID2SYM(IDtimeout))) != Qnil) {
+	    pl->timeout = NUM2DBL(v);
+	}
+	if ((v = rb_hash_aref(opts, ID2SYM(IDidle_timeout))) != Qnil) {
+	    pl->idletime = NUM2DBL(v);
+	}
+	if ((v = rb_hash_aref(opts, ID2SYM(IDvalidate))) != Qnil) {
+	    pl->validate = RTEST(v);
+	}
+    }
+    if ((pl->max < 1) || (pl->min < 0) || (pl->min > pl->max)) {
+	rb_raise(Cerror, "%s", set_err("Invalid pool size", 0));
+    }
+    pool_warmup(pl);
+    return obj;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ *      Database meta data via SQLGetInfo()
+ *
+ *----------------------------------------------------------------------
+ */
+
+#define GI_CONST_SINT(x) { #x, x, SQL_C_SHORT }
+#define GI_CONST_INT(x)  { #x, x, SQL_C_LONG }
+#define GI_CONST_BITS(x) { #x, x, SQL_C_LONG }
+#define GI_CONST_STR(x)  { #x, x, SQL_C_CHAR }
+#define GI_CONST_END     { NULL, -1, -1 }
+static struct {
+    const char *name;
+    int info;
+    int maptype;
+} get_info_map[] = {
+
+    /* yielding ints */
+    GI_CONST_SINT(SQL_ACTIVE_ENVIRONMENTS),
+    GI_CONST_SINT(SQL_ACTIVE_CONNECTIONS),
+    GI_CONST_SINT(SQL_ACTIVE_STATEMENTS),
+    GI_CONST_INT(SQL_ASYNC_MODE),
+    GI_CONST_SINT(SQL_CATALOG_LOCATION),
+    GI_CONST_SINT(SQL_CONCAT_NULL_BEHAVIOR),
+    GI_CONST_SINT(SQL_CORRELATION_NAME),
+    GI_CONST_SINT(SQL_CURSOR_COMMIT_BEHAVIOR),
+    GI_CONST_SINT(SQL_CURSOR_ROLLBACK_BEHAVIOR),
+    GI_CONST_INT(SQL_CURSOR_SENSITIVITY),
+    GI_CONST_INT(SQL_DDL_INDEX),
+    GI_CONST_INT(SQL_DEFAULT_TXN_ISOLATION),
+    GI_CONST_INT(SQL_DRIVER_HDBC),
+    GI_CONST_INT(SQL_DRIVER_HENV),
+    GI_CONST_INT(SQL_DRIVER_HDESC),
+    GI_CONST_INT(SQL_DRIVER_HLIB),
+    GI_CONST_INT(SQL_DRIVER_HSTMT),
+    GI_CONST_SINT(SQL_FILE_USAGE),
+    GI_CONST_SINT(SQL_GROUP_BY),
+    GI_CONST_SINT(SQL_IDENTIFIER_CASE),
+    GI_CONST_INT(SQL_MAX_ASYNC_CONCURRENT_STATEMENTS),
+    GI_CONST_INT(SQL_MAX_BINARY_LITERAL_LEN),
+    GI_CONST_SINT(SQL_MAX_CATALOG_NAME_LEN),
+    GI_CONST_INT(SQL_MAX_CHAR_LITERAL_LEN),
+    GI_CONST_SINT(SQL_MAX_COLUMN_NAME_LEN),
+    GI_CONST_SINT(SQL_MAX_COLUMNS_IN_GROUP_BY),
+    GI_CONST_SINT(SQL_MAX_COLUMNS_IN_INDEX),
+    GI_CONST_SINT(SQL_MAX_COLUMNS_IN_ORDER_BY),
+    GI_CONST_SINT(SQL_MAX_COLUMNS_IN_SELECT),
+    GI_CONST_SINT(SQL_MAX_COLUMNS_IN_TABLE),
+    GI_CONST_SINT(SQL_MAX_CONCURRENT_ACTIVITIES),
+    GI_CONST_SINT(SQL_MAX_CURSOR_NAME_LEN),
+    GI_CONST_SINT(SQL_MAX_DRIVER_CONNECTIONS),
+    GI_CONST_SINT(SQL_MAX_IDENTIFIER_LEN),
+    GI_CONST_INT(SQL_MAX_INDEX_SIZE),
+    GI_CONST_SINT(SQL_MAX_OWNER_NAME_LEN),
+    GI_CONST_SINT(SQL_MAX_PROCEDURE_NAME_LEN),
+    GI_CONST_SINT(SQL_MAX_QUALIFIER_NAME_LEN),
+    GI_CONST_INT(SQL_MAX_ROW_SIZE),
+    GI_CONST_SINT(SQL_MAX_SCHEMA_NAME_LEN),
+    GI_CONST_INT(SQL_MAX_STATEMENT_LEN),
+    GI_CONST_SINT(SQL_MAX_TABLE_NAME_LEN),
+    GI_CONST_SINT(SQL_MAX_TABLES_IN_SELECT),
+    GI_CONST_SINT(SQL_MAX_USER_NAME_LEN),
+    GI_CONST_SINT(SQL_NON_NULLABLE_COLUMNS),
+    GI_CONST_SINT(SQL_NULL_COLLATION),
+    GI_CONST_SINT(SQL_ODBC_API_CONFORMANCE),
+    GI_CONST_INT(SQL_ODBC_INTERFACE_CONFORMANCE),
+    GI_CONST_SINT(SQL_ODBC_SAG_CLI_CONFORMANCE),
+    GI_CONST_SINT(SQL_ODBC_SQL_CONFORMANCE),
+    GI_CONST_INT(SQL_PARAM_ARRAY_ROW_COUNTS),
+    GI_CONST_INT(SQL_PARAM_ARRAY_SELECTS),
+    GI_CONST_SINT(SQL_QUALIFIER_LOCATION),
+    GI_CONST_SINT(SQL_QUOTED_IDENTIFIER_CASE),
+    GI_CONST_INT(SQL_SQL_CONFORMANCE),
+    GI_CONST_SINT(SQL_TXN_CAPABLE),
+
+    /* yielding ints (but bitmasks) */
+    GI_CONST_BITS(SQL_AGGREGATE_FUNCTIONS),
+    GI_CONST_BITS(SQL_ALTER_DOMAIN),
+    GI_CONST_BITS(SQL_ALTER_TABLE),
+    GI_CONST_BITS(SQL_BATCH_ROW_COUNT),
+    GI_CONST_BITS(SQL_BATCH_SUPPORT),
+    GI_CONST_BITS(SQL_BOOKMARK_PERSISTENCE),
+    GI_CONST_BITS(SQL_CATALOG_USAGE),
+    GI_CONST_BITS(SQL_CONVERT_BINARY),
+    GI_CONST_BITS(SQL_CONVERT_BIT),
+    GI_CONST_BITS(SQL_CONVERT_CHAR),
+#ifdef SQL_CONVERT_GUID
+    GI_CONST_BITS(SQL_CONVERT_GUID),
+#endif
+    GI_CONST_BITS(SQL_CONVERT_DATE),
+    GI_CONST_BITS(SQL_CONVERT_DECIMAL),
+    GI_CONST_BITS(SQL_CONVERT_DOUBLE),
+    GI_CONST_BITS(SQL_CONVERT_FLOAT),
+    GI_CONST_BITS(SQL_CONVERT_FUNCTIONS),
+    GI_CONST_BITS(SQL_CONVERT_INTEGER),
+    GI_CONST_BITS(SQL_CONVERT_INTERVAL_YEAR_MONTH),
+    GI_CONST_BITS(SQL_CONVERT_INTERVAL_DAY_TIME),
+    GI_CONST_BITS(SQL_CONVERT_LONGVARBINARY),
+    GI_CONST_BITS(SQL_CONVERT_LONGVARCHAR),
+    GI_CONST_BITS(SQL_CONVERT_NUMERIC),
+    GI_CONST_BITS(SQL_CONVERT_REAL),
+    GI_CONST_BITS(SQL_CONVERT_SMALLINT),
+    GI_CONST_BITS(SQL_CONVERT_TIME),
+    GI_CONST_BITS(SQL_CONVERT_TIMESTAMP),
+    GI_CONST_BITS(SQL_CONVERT_TINYINT),
+    GI_CONST_BITS(SQL_CONVERT_VARBINARY),
+    GI_CONST_BITS(SQL_CONVERT_VARCHAR),
+    GI_CONST_BITS(SQL_CONVERT_WCHAR),
+    GI_CONST_BITS(SQL_CONVERT_WLONGVARCHAR),
+    GI_CONST_BITS(SQL_CONVERT_WVARCHAR),
+    GI_CONST_BITS(SQL_CREATE_ASSERTION),
+    GI_CONST_BITS(SQL_CREATE_CHARACTER_SET),
+    GI_CONST_BITS(SQL_CREATE_COLLATION),
+    GI_CONST_BITS(SQL_CREATE_DOMAIN),
+    GI_CONST_BITS(SQL_CREATE_SCHEMA),
+    GI_CONST_BITS(SQL_CREATE_TABLE),
+    GI_CONST_BITS(SQL_CREATE_TRANSLATION),
+    GI_CONST_BITS(SQL_CREATE_VIEW),
+    GI_CONST_BITS(SQL_DATETIME_LITERALS),
+    GI_CONST_BITS(SQL_DROP_ASSERTION),
+    GI_CONST_BITS(SQL_DROP_CHARACTER_SET),
+    GI_CONST_BITS(SQL_DROP_COLLATION),
+    GI_CONST_BITS(SQL_DROP_DOMAIN),
+    GI_CONST_BITS(SQL_DROP_SCHEMA),
+    GI_CONST_BITS(SQL_DROP_TABLE),
+    GI_CONST_BITS(SQL_DROP_TRANSLATION),
+    GI_CONST_BITS(SQL_DROP_VIEW),
+    GI_CONST_BITS(SQL_DTC_TRANSITION_COST),
+    GI_CONST_BITS(SQL_DYNAMIC_CURSOR_ATTRIBUTES1),
+    GI_CONST_BITS(SQL_DYNAMIC_CURSOR_ATTRIBUTES2),
+    GI_CONST_BITS(SQL_FETCH_DIRECTION),
+    GI_CONST_BITS(SQL_FORWARD_ONLY_CURSOR_ATTRIBUTES1),
+    GI_CONST_BITS(SQL_FORWARD_ONLY_CURSOR_ATTRIBUTES2),
+    GI_CONST_BITS(SQL_GETDATA_EXTENSIONS),
+    GI_CONST_BITS(SQL_KEYSET_CURSOR_ATTRIBUTES1),
+    GI_CONST_BITS(SQL_KEYSET_CURSOR_ATTRIBUTES2),
+    GI_CONST_BITS(SQL_INDEX_KEYWORDS),
+    GI_CONST_BITS(SQL_INFO_SCHEMA_VIEWS),
+    GI_CONST_BITS(SQL_INSERT_STATEMENT),
+    GI_CONST_BITS(SQL_LOCK_TYPES),
+    GI_CONST_BITS(SQL_NUMERIC_FUNCTIONS),
+    GI_CONST_BITS(SQL_OJ_CAPABILITIES),
+    GI_CONST_BITS(SQL_OWNER_USAGE),
+    GI_CONST_BITS(SQL_POS_OPERATIONS),
+    GI_CONST_BITS(SQL_POSITIONED_STATEMENTS),
+    GI_CONST_BITS(SQL_QUALIFIER_USAGE),
+    GI_CONST_BITS(SQL_SCHEMA_USAGE),
+    GI_CONST_BITS(SQL_SCROLL_CONCURRENCY),
+    GI_CONST_BITS(SQL_SCROLL_OPTIONS),
+    GI_CONST_BITS(SQL_SQL92_DATETIME_FUNCTIONS),
+    GI_CONST_BITS(SQL_SQL92_FOREIGN_KEY_DELETE_RULE),
+    GI_CONST_BITS(SQL_SQL92_FOREIGN_KEY_UPDATE_RULE),
+    GI_CONST_BITS(SQL_SQL92_GRANT),
+    GI_CONST_BITS(SQL_SQL92_NUMERIC_VALUE_FUNCTIONS),
+    GI_CONST_BITS(SQL_SQL92_PREDICATES),
+    GI_CONST_BITS(SQL_SQL92_RELATIONAL_JOIN_OPERATORS),
+    GI_CONST_BITS(SQL_SQL92_REVOKE),
+    GI_CONST_BITS(SQL_SQL92_ROW_VALUE_CONSTRUCTOR),
+    GI_CONST_BITS(SQL_SQL92_STRING_FUNCTIONS),
+    GI_CONST_BITS(SQL_SQL92_VALUE_EXPRESSIONS),
+    GI_CONST_BITS(SQL_STANDARD_CLI_CONFORMANCE),
+    GI_CONST_BITS(SQL_STATIC_CURSOR_ATTRIBUTES1),
+    GI_CONST_BITS(SQL_STATIC_CURSOR_ATTRIBUTES2),
+    GI_CONST_BITS(SQL_STATIC_SENSITIVITY),
+    GI_CONST_BITS(SQL_STRING_FUNCTIONS),
+    GI_CONST_BITS(SQL_SUBQUERIES),
+    GI_CONST_BITS(SQL_SYSTEM_FUNCTIONS),
+    GI_CONST_BITS(SQL_TIMEDATE_ADD_INTERVALS),
+    GI_CONST_BITS(SQL_TIMEDATE_DIFF_INTERVALS),
+    GI_CONST_BITS(SQL_TIMEDATE_FUNCTIONS),
+    GI_CONST_BITS(SQL_TXN_ISOLATION_OPTION),
+    GI_CONST_BITS(SQL_UNION),
+
+    /* yielding strings */
+    GI_CONST_STR(SQL_ACCESSIBLE_PROCEDURES),
+    GI_CONST_STR(SQL_ACCESSIBLE_TABLES),
+    GI_CONST_STR(SQL_CATALOG_NAME),
+    GI_CONST_STR(SQL_CATALOG_NAME_SEPARATOR),
+    GI_CONST_STR(SQL_CATALOG_TERM),
+    GI_CONST_STR(SQL_COLLATION_SEQ),
+    GI_CONST_STR(SQL_COLUMN_ALIAS),
+    GI_CONST_STR(SQL_DATA_SOURCE_NAME),
+    GI_CONST_STR(SQL_DATA_SOURCE_READ_ONLY),
+    GI_CONST_STR(SQL_DATABASE_NAME),
+    GI_CONST_STR(SQL_DBMS_NAME),
+    GI_CONST_STR(SQL_DBMS_VER),
+    GI_CONST_STR(SQL_DESCRIBE_PARAMETER),
+    GI_CONST_STR(SQL_DM_VER),
+    GI_CONST_STR(SQL_DRIVER_NAME),
+    GI_CONST_STR(SQL_DRIVER_ODBC_VER),
+    GI_CONST_STR(SQL_DRIVER_VER),
+    GI_CONST_STR(SQL_EXPRESSIONS_IN_ORDERBY),
+    GI_CONST_STR(SQL_IDENTIFIER_QUOTE_CHAR),
+    GI_CONST_STR(SQL_INTEGRITY),
+    GI_CONST_STR(SQL_KEYWORDS),
+    GI_CONST_STR(SQL_LIKE_ESCAPE_CLAUSE),
+    GI_CONST_STR(SQL_MAX_ROW_SIZE_INCLUDES_LONG),
+    GI_CONST_STR(SQL_MULT_RESULT_SETS),
+    GI_CONST_STR(SQL_MULTIPLE_ACTIVE_TXN),
+    GI_CONST_STR(SQL_NEED_LONG_DATA_LEN),
+    GI_CONST_STR(SQL_ODBC_SQL_OPT_IEF),
+    GI_CONST_STR(SQL_ODBC_VER),
+    GI_CONST_STR(SQL_ORDER_BY_COLUMNS_IN_SELECT),
+    GI_CONST_STR(SQL_OUTER_JOINS),
+    GI_CONST_STR(SQL_OWNER_TERM),
+    GI_CONST_STR(SQL_PROCEDURE_TERM),
+    GI_CONST_STR(SQL_PROCEDURES),
+    GI_CONST_STR(SQL_QUALIFIER_NAME_SEPARATOR),
+    GI_CONST_STR(SQL_QUALIFIER_TERM),
+    GI_CONST_STR(SQL_ROW_UPDATES),
+    GI_CONST_STR(SQL_SCHEMA_TERM),
+    GI_CONST_STR(SQL_SEARCH_PATTERN_ESCAPE),
+    GI_CONST_STR(SQL_SERVER_NAME),
+    GI_CONST_STR(SQL_SPECIAL_CHARACTERS),
+    GI_CONST_STR(SQL_TABLE_TERM),
+    GI_CONST_STR(SQL_USER_NAME),
+    GI_CONST_STR(SQL_XOPEN_CLI_YEAR),
+
+    /* end of table */
+    GI_CONST_END
+};
+
+#define GI_CONST_BITMAP(x)  { #x, x }
+#define GI_CONST_BITMAP_END { NULL, 0 }
+static struct {
+    const char *name;
+    int bits;
+} get_info_bitmap[] = {
+    GI_CONST_BITMAP(SQL_AD_ADD_CONSTRAINT_DEFERRABLE),
+    GI_CONST_BITMAP(SQL_AD_ADD_CONSTRAINT_INITIALLY_DEFERRED),
+    GI_CONST_BITMAP(SQL_AD_ADD_CONSTRAINT_INITIALLY_IMMEDIATE),
+    GI_CONST_BITMAP(SQL_AD_ADD_CONSTRAINT_NON_DEFERRABLE),
+    GI_CONST_BITMAP(SQL_AD_ADD_DOMAIN_CONSTRAINT),
+    GI_CONST_BITMAP(SQL_AD_ADD_DOMAIN_DEFAULT),
+    GI_CONST_BITMAP(SQL_AD_CONSTRAINT_NAME_DEFINITION),
+    GI_CONST_BITMAP(SQL_AD_DROP_DOMAIN_CONSTRAINT),
+    GI_CONST_BITMAP(SQL_AD_DROP_DOMAIN_DEFAULT),
+    GI_CONST_BITMAP(SQL_AF_ALL),
+    GI_CONST_BITMAP(SQL_AF_AVG),
+    GI_CONST_BITMAP(SQL_AF_COUNT),
+    GI_CONST_BITMAP(SQL_AF_DISTINCT),
+    GI_CONST_BITMAP(SQL_AF_MAX),
+    GI_CONST_BITMAP(SQL_AF_MIN),
+    GI_CONST_BITMAP(SQL_AF_SUM),
+    GI_CONST_BITMAP(SQL_AM_CONNECTION),
+    GI_CONST_BITMAP(SQL_AM_NONE),
+    GI_CONST_BITMAP(SQL_AM_STATEMENT),
+    GI_CONST_BITMAP(SQL_AT_ADD_COLUMN),
+    GI_CONST_BITMAP(SQL_AT_ADD_COLUMN_COLLATION),
+    GI_CONST_BITMAP(SQL_AT_ADD_COLUMN_DEFAULT),
+    GI_CONST_BITMAP(SQL_AT_ADD_COLUMN_SINGLE),
+    GI_CONST_BITMAP(SQL_AT_ADD_CONSTRAINT),
+    GI_CONST_BITMAP(SQL_AT_ADD_TABLE_CONSTRAINT),
+#ifdef SQL_AT_COLUMN_SINGLE
+    GI_CONST_BITMAP(SQL_AT_COLUMN_SINGLE),
+#endif
+    GI_CONST_BITMAP(SQL_AT_CONSTRAINT_DEFERRABLE),
+    GI_CONST_BITMAP(SQL_AT_CONSTRAINT_INITIALLY_DEFERRED),
+    GI_CONST_BITMAP(SQL_AT_CONSTRAINT_INITIALLY_IMMEDIATE),
+    GI_CONST_BITMAP(SQL_AT_CONSTRAINT_NAME_DEFINITION),
+    GI_CONST_BITMAP(SQL_AT_CONSTRAINT_NON_DEFERRABLE),
+    GI_CONST_BITMAP(SQL_AT_DROP_COLUMN),
+    GI_CONST_BITMAP(SQL_AT_DROP_COLUMN_CASCADE),
+    GI_CONST_BITMAP(SQL_AT_DROP_COLUMN_DEFAULT),
+    GI_CONST_BITMAP(SQL_AT_DROP_COLUMN_RESTRICT),
+    GI_CONST_BITMAP(SQL_AT_DROP_TABLE_CONSTRAINT_CASCADE),
+    GI_CONST_BITMAP(SQL_AT_DROP_TABLE_CONSTRAINT_RESTRICT),
+    GI_CONST_BITMAP(SQL_AT_SET_COLUMN_DEFAULT),
+    GI_CONST_BITMAP(SQL_BP_CLOSE),
+    GI_CONST_BITMAP(SQL_BP_DELETE),
+    GI_CONST_BITMAP(SQL_BP_DROP),
+    GI_CONST_BITMAP(SQL_BP_OTHER_HSTMT),
+    GI_CONST_BITMAP(SQL_BP_SCROLL),
+    GI_CONST_BITMAP(SQL_BP_TRANSACTION),
+    GI_CONST_BITMAP(SQL_BP_UPDATE),
+    GI_CONST_BITMAP(SQL_BRC_EXPLICIT),
+    GI_CONST_BITMAP(SQL_BRC_PROCEDURES),
+    GI_CONST_BITMAP(SQL_BRC_ROLLED_UP),
+    GI_CONST_BITMAP(SQL_BS_ROW_COUNT_EXPLICIT),
+    GI_CONST_BITMAP(SQL_BS_ROW_COUNT_PROC),
+    GI_CONST_BITMAP(SQL_BS_SELECT_EXPLICIT),
+    GI_CONST_BITMAP(SQL_BS_SELECT_PROC),
+    GI_CONST_BITMAP(SQL_CA1_ABSOLUTE),
+    GI_CONST_BITMAP(SQL_CA1_BOOKMARK),
+    GI_CONST_BITMAP(SQL_CA1_BULK_ADD),
+    GI_CONST_BITMAP(SQL_CA1_BULK_DELETE_BY_BOOKMARK),
+    GI_CONST_BITMAP(SQL_CA1_BULK_FETCH_BY_BOOKMARK),
+    GI_CONST_BITMAP(SQL_CA1_BULK_UPDATE_BY_BOOKMARK),
+    GI_CONST_BITMAP(SQL_CA1_LOCK_EXCLUSIVE),
+    GI_CONST_BITMAP(SQL_CA1_LOCK_NO_CHANGE),
+    GI_CONST_BITMAP(SQL_CA1_LOCK_UNLOCK),
+    GI_CONST_BITMAP(SQL_CA1_NEXT),
+    GI_CONST_BITMAP(SQL_CA1_POS_DELETE),
+    GI_CONST_BITMAP(SQL_CA1_POSITIONED_DELETE),
+    GI_CONST_BITMAP(SQL_CA1_POSITIONED_UPDATE),
+    GI_CONST_BITMAP(SQL_CA1_POS_POSITION),
+    GI_CONST_BITMAP(SQL_CA1_POS_REFRESH),
+    GI_CONST_BITMAP(SQL_CA1_POS_UPDATE),
+    GI_CONST_BITMAP(SQL_CA1_RELATIVE),
+    GI_CONST_BITMAP(SQL_CA1_SELECT_FOR_UPDATE),
+    GI_CONST_BITMAP(SQL_CA2_CRC_APPROXIMATE),
+    GI_CONST_BITMAP(SQL_CA2_CRC_EXACT),
+    GI_CONST_BITMAP(SQL_CA2_LOCK_CONCURRENCY),
+    GI_CONST_BITMAP(SQL_CA2_MAX_ROWS_AFFECTS_ALL),
+    GI_CONST_BITMAP(SQL_CA2_MAX_ROWS_CATALOG),
+    GI_CONST_BITMAP(SQL_CA2_MAX_ROWS_DELETE),
+    GI_CONST_BITMAP(SQL_CA2_MAX_ROWS_INSERT),
+    GI_CONST_BITMAP(SQL_CA2_MAX_ROWS_SELECT),
+    GI_CONST_BITMAP(SQL_CA2_MAX_ROWS_UPDATE),
+    GI_CONST_BITMAP(SQL_CA2_OPT_ROWVER_CONCURRENCY),
+    GI_CONST_BITMAP(SQL_CA2_OPT_VALUES_CONCURRENCY),
+    GI_CONST_BITMAP(SQL_CA2_READ_ONLY_CONCURRENCY),
+    GI_CONST_BITMAP(SQL_CA2_SENSITIVITY_ADDITIONS),
+    GI_CONST_BITMAP(SQL_CA2_SENSITIVITY_DELETIONS),
+    GI_CONST_BITMAP(SQL_CA2_SENSITIVITY_UPDATES),
+    GI_CONST_BITMAP(SQL_CA2_SIMULATE_NON_UNIQUE),
+    GI_CONST_BITMAP(SQL_CA2_SIMULATE_TRY_UNIQUE),
+    GI_CONST_BITMAP(SQL_CA2_SIMULATE_UNIQUE),
+    GI_CONST_BITMAP(SQL_CA_CONSTRAINT_DEFERRABLE),
+    GI_CONST_BITMAP(SQL_CA_CONSTRAINT_INITIALLY_DEFERRED),
+    GI_CONST_BITMAP(SQL_CA_CONSTRAINT_INITIALLY_IMMEDIATE),
+    GI_CONST_BITMAP(SQL_CA_CONSTRAINT_NON_DEFERRABLE),
+    GI_CONST_BITMAP(SQL_CA_CREATE_ASSERTION),
+    GI_CONST_BITMAP(SQL_CB_CLOSE),
+    GI_CONST_BITMAP(SQL_CB_DELETE),
+    GI_CONST_BITMAP(SQL_CB_NON_NULL),
+    GI_CONST_BITMAP(SQL_CB_NULL),
+    GI_CONST_BITMAP(SQL_CB_PRESERVE),
+    GI_CONST_BITMAP(SQL_CC_CLOSE),
+    GI_CONST_BITMAP(SQL_CC_DELETE),
+    GI_CONST_BITMAP(SQL_CCOL_CREATE_COLLATION),
+    GI_CONST_BITMAP(SQL_CC_PRESERVE),
+    GI_CONST_BITMAP(SQL_CCS_COLLATE_CLAUSE),
+    GI_CONST_BITMAP(SQL_CCS_CREATE_CHARACTER_SET),
+    GI_CONST_BITMAP(SQL_CCS_LIMITED_COLLATION),
+    GI_CONST_BITMAP(SQL_CDO_COLLATION),
+    GI_CONST_BITMAP(SQL_CDO_CONSTRAINT),
+    GI_CONST_BITMAP(SQL_CDO_CONSTRAINT_DEFERRABLE),
+    GI_CONST_BITMAP(SQL_CDO_CONSTRAINT_INITIALLY_DEFERRED),
+    GI_CONST_BITMAP(SQL_CDO_CONSTRAINT_INITIALLY_IMMEDIATE),
+    GI_CONST_BITMAP(SQL_CDO_CONSTRAINT_NAME_DEFINITION),
+    GI_CONST_BITMAP(SQL_CDO_CONSTRAINT_NON_DEFERRABLE),
+    GI_CONST_BITMAP(SQL_CDO_CREATE_DOMAIN),
+    GI_CONST_BITMAP(SQL_CDO_DEFAULT),
+    GI_CONST_BITMAP(SQL_CL_END),
+    GI_CONST_BITMAP(SQL_CL_START),
+    GI_CONST_BITMAP(SQL_CN_ANY),
+    GI_CONST_BITMAP(SQL_CN_DIFFERENT),
+    GI_CONST_BITMAP(SQL_CN_NONE),
+    GI_CONST_BITMAP(SQL_CONCUR_TIMESTAMP),
+    GI_CONST_BITMAP(SQL_CR_CLOSE),
+    GI_CONST_BITMAP(SQL_CR_DELETE),
+    GI_CONST_BITMAP(SQL_CR_PRESERVE),
+    GI_CONST_BITMAP(SQL_CS_AUTHORIZATION),
+    GI_CONST_BITMAP(SQL_CS_CREATE_SCHEMA),
+    GI_CONST_BITMAP(SQL_CS_DEFAULT_CHARACTER_SET),
+    GI_CONST_BITMAP(SQL_CT_COLUMN_COLLATION),
+    GI_CONST_BITMAP(SQL_CT_COLUMN_CONSTRAINT),
+    GI_CONST_BITMAP(SQL_CT_COLUMN_DEFAULT),
+    GI_CONST_BITMAP(SQL_CT_COMMIT_DELETE),
+    GI_CONST_BITMAP(SQL_CT_COMMIT_PRESERVE),
+    GI_CONST_BITMAP(SQL_CT_CONSTRAINT_DEFERRABLE),
+    GI_CONST_BITMAP(SQL_CT_CONSTRAINT_INITIALLY_DEFERRED),
+    GI_CONST_BITMAP(SQL_CT_CONSTRAINT_INITIALLY_IMMEDIATE),
+    GI_CONST_BITMAP(SQL_CT_CONSTRAINT_NAME_DEFINITION),
+    GI_CONST_BITMAP(SQL_CT_CONSTRAINT_NON_DEFERRABLE),
+    GI_CONST_BITMAP(SQL_CT_CREATE_TABLE),
+    GI_CONST_BITMAP(SQL_CT_GLOBAL_TEMPORARY),
+    GI_CONST_BITMAP(SQL_CT_LOCAL_TEMPORARY),
+    GI_CONST_BITMAP(SQL_CTR_CREATE_TRANSLATION),
+    GI_CONST_BITMAP(SQL_CT_TABLE_CONSTRAINT),
+    GI_CONST_BITMAP(SQL_CU_DML_STATEMENTS),
+    GI_CONST_BITMAP(SQL_CU_INDEX_DEFINITION),
+    GI_CONST_BITMAP(SQL_CU_PRIVILEGE_DEFINITION),
+    GI_CONST_BITMAP(SQL_CU_PROCEDURE_INVOCATION),
+    GI_CONST_BITMAP(SQL_CU_TABLE_DEFINITION),
+    GI_CONST_BITMAP(SQL_CV_CASCADED),
+    GI_CONST_BITMAP(SQL_CV_CHECK_OPTION),
+    GI_CONST_BITMAP(SQL_CV_CREATE_VIEW),
+    GI_CONST_BITMAP(SQL_CV_LOCAL),
+    GI_CONST_BITMAP(SQL_CVT_BIGINT),
+    GI_CONST_BITMAP(SQL_CVT_BINARY),
+    GI_CONST_BITMAP(SQL_CVT_BIT),
+    GI_CONST_BITMAP(SQL_CVT_CHAR),
+    GI_CONST_BITMAP(SQL_CVT_DATE),
+    GI_CONST_BITMAP(SQL_CVT_DECIMAL),
+    GI_CONST_BITMAP(SQL_CVT_DOUBLE),
+    GI_CONST_BITMAP(SQL_CVT_FLOAT),
+    GI_CONST_BITMAP(SQL_CVT_INTEGER),
+    GI_CONST_BITMAP(SQL_CVT_INTERVAL_DAY_TIME),
+    GI_CONST_BITMAP(SQL_CVT_INTERVAL_YEAR_MONTH),
+    GI_CONST_BITMAP(SQL_CVT_LONGVARBINARY),
+    GI_CONST_BITMAP(SQL_CVT_LONGVARCHAR),
+    GI_CONST_BITMAP(SQL_CVT_NUMERIC),
+    GI_CONST_BITMAP(SQL_CVT_REAL),
+    GI_CONST_BITMAP(SQL_CVT_SMALLINT),
+    GI_CONST_BITMAP(SQL_CVT_TIME),
+    GI_CONST_BITMAP(SQL_CVT_TIMESTAMP),
+    GI_CONST_BITMAP(SQL_CVT_TINYINT),
+    GI_CONST_BITMAP(SQL_CVT_VARBINARY),
+    GI_CONST_BITMAP(SQL_CVT_VARCHAR),
+    GI_CONST_BITMAP(SQL_CVT_WCHAR),
+    GI_CONST_BITMAP(SQL_CVT_WLONGVARCHAR),
+    GI_CONST_BITMAP(SQL_CVT_WVARCHAR),
+    GI_CONST_BITMAP(SQL_DA_DROP_ASSERTION),
+    GI_CONST_BITMAP(SQL_DC_DROP_COLLATION),
+    GI_CONST_BITMAP(SQL_DCS_DROP_CHARACTER_SET),
+    GI_CONST_BITMAP(SQL_DD_CASCADE),
+    GI_CONST_BITMAP(SQL_DD_DROP_DOMAIN),
+    GI_CONST_BITMAP(SQL_DD_RESTRICT),
+    GI_CONST_BITMAP(SQL_DI_CREATE_INDEX),
+    GI_CONST_BITMAP(SQL_DI_DROP_INDEX),
+    GI_CONST_BITMAP(SQL_DL_SQL92_DATE),
+    GI_CONST_BITMAP(SQL_DL_SQL92_INTERVAL_DAY),
+    GI_CONST_BITMAP(SQL_DL_SQL92_INTERVAL_DAY_TO_HOUR),
+    GI_CONST_BITMAP(SQL_DL_SQL92_INTERVAL_DAY_TO_MINUTE),
+    GI_CONST_BITMAP(SQL_DL_SQL92_INTERVAL_DAY_TO_SECOND),
+    GI_CONST_BITMAP(SQL_DL_SQL92_INTERVAL_HOUR),
+    GI_CONST_BITMAP(SQL_DL_SQL92_INTERVAL_HOUR_TO_MINUTE),
+    GI_CONST_BITMAP(SQL_DL_SQL92_INTERVAL_HOUR_TO_SECOND),
+    GI_CONST_BITMAP(SQL_DL_SQL92_INTERVAL_MINUTE),
+    GI_CONST_BITMAP(SQL_DL_SQL92_INTERVAL_MINUTE_TO_SECOND),
+    GI_CONST_BITMAP(SQL_DL_SQL92_INTERVAL_MONTH),
+    GI_CONST_BITMAP(SQL_DL_SQL92_INTERVAL_SECOND),
+    GI_CONST_BITMAP(SQL_DL_SQL92_INTERVAL_YEAR),
+    GI_CONST_BITMAP(SQL_DL_SQL92_INTERVAL_YEAR_TO_MONTH),
+    GI_CONST_BITMAP(SQL_DL_SQL92_TIME),
+    GI_CONST_BITMAP(SQL_DL_SQL92_TIMESTAMP),
+    GI_CONST_BITMAP(SQL_DS_CASCADE),
+    GI_CONST_BITMAP(SQL_DS_DROP_SCHEMA),
+    GI_CONST_BITMAP(SQL_DS_RESTRICT),
+    GI_CONST_BITMAP(SQL_DT_CASCADE),
+    GI_CONST_BITMAP(SQL_DTC_ENLIST_EXPENSIVE),
+    GI_CONST_BITMAP(SQL_DTC_UNENLIST_EXPENSIVE),
+    GI_CONST_BITMAP(SQL_DT_DROP_TABLE),
+    GI_CONST_BITMAP(SQL_DTR_DROP_TRANSLATION),
+    GI_CONST_BITMAP(SQL_DT_RESTRICT),
+    GI_CONST_BITMAP(SQL_DV_CASCADE),
+    GI_CONST_BITMAP(SQL_DV_DROP_VIEW),
+    GI_CONST_BITMAP(SQL_DV_RESTRICT),
+    GI_CONST_BITMAP(SQL_FD_FETCH_ABSOLUTE),
+    GI_CONST_BITMAP(SQL_FD_FETCH_BOOKMARK),
+    GI_CONST_BITMAP(SQL_FD_FETCH_FIRST),
+    GI_CONST_BITMAP(SQL_FD_FETCH_LAST),
+    GI_CONST_BITMAP(SQL_FD_FETCH_NEXT),
+    GI_CONST_BITMAP(SQL_FD_FETCH_PRIOR),
+    GI_CONST_BITMAP(SQL_FD_FETCH_RELATIVE),
+#ifdef SQL_FD_FETCH_RESUME
+    GI_CONST_BITMAP(SQL_FD_FETCH_RESUME),
+#endif
+    GI_CONST_BITMAP(SQL_FILE_CATALOG),
+    GI_CONST_BITMAP(SQL_FILE_NOT_SUPPORTED),
+    GI_CONST_BITMAP(SQL_FILE_QUALIFIER),
+    GI_CONST_BITMAP(SQL_FILE_TABLE),
+    GI_CONST_BITMAP(SQL_FN_CVT_CAST),
+    GI_CONST_BITMAP(SQL_FN_CVT_CONVERT),
+    GI_CONST_BITMAP(SQL_FN_NUM_ABS),
+    GI_CONST_BITMAP(SQL_FN_NUM_ACOS),
+    GI_CONST_BITMAP(SQL_FN_NUM_ASIN),
+    GI_CONST_BITMAP(SQL_FN_NUM_ATAN),
+    GI_CONST_BITMAP(SQL_FN_NUM_ATAN2),
+    GI_CONST_BITMAP(SQL_FN_NUM_CEILING),
+    GI_CONST_BITMAP(SQL_FN_NUM_COS),
+    GI_CONST_BITMAP(SQL_FN_NUM_COT),
+    GI_CONST_BITMAP(SQL_FN_NUM_DEGREES),
+    GI_CONST_BITMAP(SQL_FN_NUM_EXP),
+    GI_CONST_BITMAP(SQL_FN_NUM_FLOOR),
+    GI_CONST_BITMAP(SQL_FN_NUM_LOG),
+    GI_CONST_BITMAP(SQL_FN_NUM_LOG10),
+    GI_CONST_BITMAP(SQL_FN_NUM_MOD),
+    GI_CONST_BITMAP(SQL_FN_NUM_PI),
+    GI_CONST_BITMAP(SQL_FN_NUM_POWER),
+    GI_CONST_BITMAP(SQL_FN_NUM_RADIANS),
+    GI_CONST_BITMAP(SQL_FN_NUM_RAND),
+    GI_CONST_BITMAP(SQL_FN_NUM_ROUND),
+    GI_CONST_BITMAP(SQL_FN_NUM_SIGN),
+    GI_CONST_BITMAP(SQL_FN_NUM_SIN),
+    GI_CONST_BITMAP(SQL_FN_NUM_SQRT),
+    GI_CONST_BITMAP(SQL_FN_NUM_TAN),
+    GI_CONST_BITMAP(SQL_FN_NUM_TRUNCATE),
+    GI_CONST_BITMAP(SQL_FN_STR_ASCII),
+    GI_CONST_BITMAP(SQL_FN_STR_BIT_LENGTH),
+    GI_CONST_BITMAP(SQL_FN_STR_CHAR),
+    GI_CONST_BITMAP(SQL_FN_STR_CHARACTER_LENGTH),
+    GI_CONST_BITMAP(SQL_FN_STR_CHAR_LENGTH),
+    GI_CONST_BITMAP(SQL_FN_STR_CONCAT),
+    GI_CONST_BITMAP(SQL_FN_STR_DIFFERENCE),
+    GI_CONST_BITMAP(SQL_FN_STR_INSERT),
+    GI_CONST_BITMAP(SQL_FN_STR_LCASE),
+    GI_CONST_BITMAP(SQL_FN_STR_LEFT),
+    GI_CONST_BITMAP(SQL_FN_STR_LENGTH),
+    GI_CONST_BITMAP(SQL_FN_STR_LOCATE),
+    GI_CONST_BITMAP(SQL_FN_STR_LOCATE_2),
+    GI_CONST_BITMAP(SQL_FN_STR_LTRIM),
+    GI_CONST_BITMAP(SQL_FN_STR_OCTET_LENGTH),
+    GI_CONST_BITMAP(SQL_FN_STR_POSITION),
+    GI_CONST_BITMAP(SQL_FN_STR_REPEAT),
+    GI_CONST_BITMAP(SQL_FN_STR_REPLACE),
+    GI_CONST_BITMAP(SQL_FN_STR_RIGHT),
+    GI_CONST_BITMAP(SQL_FN_STR_RTRIM),
+    GI_CONST_BITMAP(SQL_FN_STR_SOUNDEX),
+    GI_CONST_BITMAP(SQL_FN_STR_SPACE),
+    GI_CONST_BITMAP(SQL_FN_STR_SUBSTRING),
+    GI_CONST_BITMAP(SQL_FN_STR_UCASE),
+    GI_CONST_BITMAP(SQL_FN_SYS_DBNAME),
+    GI_CONST_BITMAP(SQL_FN_SYS_IFNULL),
+    GI_CONST_BITMAP(SQL_FN_SYS_USERNAME),
+    GI_CONST_BITMAP(SQL_FN_TD_CURDATE),
+    GI_CONST_BITMAP(SQL_FN_TD_CURRENT_DATE),
+    GI_CONST_BITMAP(SQL_FN_TD_CURRENT_TIME),
+    GI_CONST_BITMAP(SQL_FN_TD_CURRENT_TIMESTAMP),
+    GI_CONST_BITMAP(SQL_FN_TD_CURTIME),
+    GI_CONST_BITMAP(SQL_FN_TD_DAYNAME),
+    GI_CONST_BITMAP(SQL_FN_TD_DAYOFMONTH),
+    GI_CONST_BITMAP(SQL_FN_TD_DAYOFWEEK),
+    GI_CONST_BITMAP(SQL_FN_TD_DAYOFYEAR),
+    GI_CONST_BITMAP(SQL_FN_TD_EXTRACT),
+    GI_CONST_BITMAP(SQL_FN_TD_HOUR),
+    GI_CONST_BITMAP(SQL_FN_TD_MINUTE),
+    GI_CONST_BITMAP(SQL_FN_TD_MONTH),
+    GI_CONST_BITMAP(SQL_FN_TD_MONTHNAME),
+    GI_CONST_BITMAP(SQL_FN_TD_NOW),
+    GI_CONST_BITMAP(SQL_FN_TD_QUARTER),
+    GI_CONST_BITMAP(SQL_FN_TD_SECOND),
+    GI_CONST_BITMAP(SQL_FN_TD_TIMESTAMPADD),
+    GI_CONST_BITMAP(SQL_FN_TD_TIMESTAMPDIFF),
+    GI_CONST_BITMAP(SQL_FN_TD_WEEK),
+    GI_CONST_BITMAP(SQL_FN_TD_YEAR),
+    GI_CONST_BITMAP(SQL_FN_TSI_DAY),
+    GI_CONST_BITMAP(SQL_FN_TSI_FRAC_SECOND),
+    GI_CONST_BITMAP(SQL_FN_TSI_HOUR),
+    GI_CONST_BITMAP(SQL_FN_TSI_MINUTE),
+    GI_CONST_BITMAP(SQL_FN_TSI_MONTH),
+    GI_CONST_BITMAP(SQL_FN_TSI_QUARTER),
+    GI_CONST_BITMAP(SQL_FN_TSI_SECOND),
+    GI_CONST_BITMAP(SQL_FN_TSI_WEEK),
+    GI_CONST_BITMAP(SQL_FN_TSI_YEAR),
+    GI_CONST_BITMAP(SQL_GB_COLLATE),
+    GI_CONST_BITMAP(SQL_GB_GROUP_BY_CONTAINS_SELECT),
+    GI_CONST_BITMAP(SQL_GB_GROUP_BY_EQUALS_SELECT),
+    GI_CONST_BITMAP(SQL_GB_NO_RELATION),
+    GI_CONST_BITMAP(SQL_GB_NOT_SUPPORTED),
+    GI_CONST_BITMAP(SQL_GD_ANY_COLUMN),
+    GI_CONST_BITMAP(SQL_GD_ANY_ORDER),
+    GI_CONST_BITMAP(SQL_GD_BLOCK),
+    GI_CONST_BITMAP(SQL_GD_BOUND),
+    GI_CONST_BITMAP(SQL_IC_LOWER),
+    GI_CONST_BITMAP(SQL_IC_MIXED),
+    GI_CONST_BITMAP(SQL_IC_SENSITIVE),
+    GI_CONST_BITMAP(SQL_IC_UPPER),
+    GI_CONST_BITMAP(SQL_IK_ALL),
+    GI_CONST_BITMAP(SQL_IK_ASC),
+    GI_CONST_BITMAP(SQL_IK_DESC),
+    GI_CONST_BITMAP(SQL_IK_NONE),
+    GI_CONST_BITMAP(SQL_IS_INSERT_LITERALS),
+    GI_CONST_BITMAP(SQL_IS_INSERT_SEARCHED),
+    GI_CONST_BITMAP(SQL_IS_SELECT_INTO),
+    GI_CONST_BITMAP(SQL_ISV_ASSERTIONS),
+    GI_CONST_BITMAP(SQL_ISV_CHARACTER_SETS),
+    GI_CONST_BITMAP(SQL_ISV_CHECK_CONSTRAINTS),
+    GI_CONST_BITMAP(SQL_ISV_COLLATIONS),
+    GI_CONST_BITMAP(SQL_ISV_COLUMN_DOMAIN_USAGE),
+    GI_CONST_BITMAP(SQL_ISV_COLUMN_PRIVILEGES),
+    GI_CONST_BITMAP(SQL_ISV_COLUMNS),
+    GI_CONST_BITMAP(SQL_ISV_CONSTRAINT_COLUMN_USAGE),
+    GI_CONST_BITMAP(SQL_ISV_CONSTRAINT_TABLE_USAGE),
+    GI_CONST_BITMAP(SQL_ISV_DOMAIN_CONSTRAINTS),
+    GI_CONST_BITMAP(SQL_ISV_DOMAINS),
+    GI_CONST_BITMAP(SQL_ISV_KEY_COLUMN_USAGE),
+    GI_CONST_BITMAP(SQL_ISV_REFERENTIAL_CONSTRAINTS),
+    GI_CONST_BITMAP(SQL_ISV_SCHEMATA),
+    GI_CONST_BITMAP(SQL_ISV_SQL_LANGUAGES),
+    GI_CONST_BITMAP(SQL_ISV_TABLE_CONSTRAINTS),
+    GI_CONST_BITMAP(SQL_ISV_TABLE_PRIVILEGES),
+    GI_CONST_BITMAP(SQL_ISV_TABLES),
+    GI_CONST_BITMAP(SQL_ISV_TRANSLATIONS),
+    GI_CONST_BITMAP(SQL_ISV_USAGE_PRIVILEGES),
+    GI_CONST_BITMAP(SQL_ISV_VIEW_COLUMN_USAGE),
+    GI_CONST_BITMAP(SQL_ISV_VIEWS),
+    GI_CONST_BITMAP(SQL_ISV_VIEW_TABLE_USAGE),
+    GI_CONST_BITMAP(SQL_LCK_EXCLUSIVE),
+    GI_CONST_BITMAP(SQL_LCK_NO_CHANGE),
+    GI_CONST_BITMAP(SQL_LCK_UNLOCK),
+    GI_CONST_BITMAP(SQL_NC_END),
+    GI_CONST_BITMAP(SQL_NC_HIGH),
+    GI_CONST_BITMAP(SQL_NC_LOW),
+    GI_CONST_BITMAP(SQL_NC_START),
+    GI_CONST_BITMAP(SQL_NNC_NON_NULL),
+    GI_CONST_BITMAP(SQL_NNC_NULL),
+    GI_CONST_BITMAP(SQL_OAC_LEVEL1),
+    GI_CONST_BITMAP(SQL_OAC_LEVEL2),
+    GI_CONST_BITMAP(SQL_OAC_NONE),
+    GI_CONST_BITMAP(SQL_OIC_CORE),
+    GI_CONST_BITMAP(SQL_OIC_LEVEL1),
+    GI_CONST_BITMAP(SQL_OIC_LEVEL2),
+    GI_CONST_BITMAP(SQL_OJ_ALL_COMPARISON_OPS),
+    GI_CONST_BITMAP(SQL_OJ_FULL),
+    GI_CONST_BITMAP(SQL_OJ_INNER),
+    GI_CONST_BITMAP(SQL_OJ_LEFT),
+    GI_CONST_BITMAP(SQL_OJ_NESTED),
+    GI_CONST_BITMAP(SQL_OJ_NOT_ORDERED),
+    GI_CONST_BITMAP(SQL_OJ_RIGHT),
+    GI_CONST_BITMAP(SQL_OSCC_COMPLIANT),
+    GI_CONST_BITMAP(SQL_OSCC_NOT_COMPLIANT),
+    GI_CONST_BITMAP(SQL_OSC_CORE),
+    GI_CONST_BITMAP(SQL_OSC_EXTENDED),
+    GI_CONST_BITMAP(SQL_OSC_MINIMUM),
+    GI_CONST_BITMAP(SQL_OU_DML_STATEMENTS),
+    GI_CONST_BITMAP(SQL_OU_INDEX_DEFINITION),
+    GI_CONST_BITMAP(SQL_OU_PRIVILEGE_DEFINITION),
+    GI_CONST_BITMAP(SQL_OU_PROCEDURE_INVOCATION),
+    GI_CONST_BITMAP(SQL_OU_TABLE_DEFINITION),
+    GI_CONST_BITMAP(SQL_PARC_BATCH),
+    GI_CONST_BITMAP(SQL_PARC_NO_BATCH),
+    GI_CONST_BITMAP(SQL_PAS_BATCH),
+    GI_CONST_BITMAP(SQL_PAS_NO_BATCH),
+    GI_CONST_BITMAP(SQL_PAS_NO_SELECT),
+    GI_CONST_BITMAP(SQL_POS_ADD),
+    GI_CONST_BITMAP(SQL_POS_DELETE),
+    GI_CONST_BITMAP(SQL_POS_POSITION),
+    GI_CONST_BITMAP(SQL_POS_REFRESH),
+    GI_CONST_BITMAP(SQL_POS_UPDATE),
+    GI_CONST_BITMAP(SQL_PS_POSITIONED_DELETE),
+    GI_CONST_BITMAP(SQL_PS_POSITIONED_UPDATE),
+    GI_CONST_BITMAP(SQL_PS_SELECT_FOR_UPDATE),
+    GI_CONST_BITMAP(SQL_QL_END),
+    GI_CONST_BITMAP(SQL_QL_START),
+    GI_CONST_BITMAP(SQL_QU_DML_STATEMENTS),
+    GI_CONST_BITMAP(SQL_QU_INDEX_DEFINITION),
+    GI_CONST_BITMAP(SQL_QU_PRIVILEGE_DEFINITION),
+    GI_CONST_BITMAP(SQL_QU_PROCEDURE_INVOCATION),
+    GI_CONST_BITMAP(SQL_QU_TABLE_DEFINITION),
+    GI_CONST_BITMAP(SQL_SCC_ISO92_CLI),
+    GI_CONST_BITMAP(SQL_SCCO_LOCK),
+    GI_CONST_BITMAP(SQL_SCCO_OPT_ROWVER),
+    GI_CONST_BITMAP(SQL_SCCO_OPT_TIMESTAMP),
     GI_CONST_BITMAP(SQL_SCCO_OPT_VALUES),
     GI_CONST_BITMAP(SQL_SCCO_READ_ONLY),
     GI_CONST_BITMAP(SQL_SCC_XOPEN_CLI_VERSION1),
@@ -3025,4475 +5884,8206 @@ static struct {
 #ifdef SQL_TXN_VERSIONING
     GI_CONST_BITMAP(SQL_TXN_VERSIONING),
 #endif
-    GI_CONST_BITMAP(SQL_US_UNION),
-    GI_CONST_BITMAP(SQL_US_UNION_ALL),
-    GI_CONST_BITMAP(SQL_U_UNION),
-    GI_CONST_BITMAP(SQL_U_UNION_ALL),
+    GI_CONST_BITMAP(SQL_US_UNION),
+    GI_CONST_BITMAP(SQL_US_UNION_ALL),
+    GI_CONST_BITMAP(SQL_U_UNION),
+    GI_CONST_BITMAP(SQL_U_UNION_ALL),
+
+    /* end of table */
+    GI_CONST_BITMAP_END
+};
+
+static VALUE
+dbc_getinfo(int argc, VALUE *argv, VALUE self)
+{
+    DBC *p = get_dbc(self);
+    VALUE which, vtype, vstr;
+    SQLRETURN ret;
+    int i, k, info = -1, maptype = -1, info_found = 0;
+    SQLUSMALLINT sbuffer;
+    SQLUINTEGER lbuffer;
+    SQLSMALLINT len_in, len_out;
+    char *string = NULL, buffer[513];
+
+    rb_scan_args(argc, argv, "11", &which, &vtype);
+    switch (TYPE(which)) {
+    default:
+	vstr = rb_any_to_s(which);
+	string = STR2CSTR(vstr);
+	goto doString;
+    case T_STRING:
+	string = STR2CSTR(which);
+    doString:
+	for (i = 0; get_info_map[i].name != NULL; i++) {
+	    if (strcmp(string, get_info_map[i].name) == 0) {
+		info = get_info_map[i].info;
+		maptype = get_info_map[i].maptype;
+		info_found = 2;
+		break;
+	    }
+	}
+	break;
+    case T_FLOAT:
+    case T_BIGNUM:
+	k = (int) NUM2DBL(which);
+	goto doInt;
+    case T_FIXNUM:
+	k = FIX2INT(which);
+    doInt:
+	info = k;
+	info_found = 1;
+	for (i = 0; get_info_map[i].name != NULL; i++) {
+	    if (k == get_info_map[i].info) {
+		info = get_info_map[i].info;
+		maptype = get_info_map[i].maptype;
+		info_found = 3;
+		break;
+	    }
+	}
+	break;
+    }
+    switch (info_found) {
+    case 0:
+	rb_raise(Cerror, "%s",
+		 set_err("Invalid info type for ODBC::Connection.get_info",
+			 0));
+	return Qnil;
+    case 1:
+	sprintf(buffer, "Unknown info type %d for ODBC::Connection.get_info",
+		info);
+	set_err(buffer, 1);
+	break;
+    }
+    if (vtype != Qnil) {
+	switch (TYPE(vtype)) {
+	case T_FIXNUM:
+	    maptype = FIX2INT(vtype);
+	    break;
+	case T_BIGNUM:
+	case T_FLOAT:
+	    maptype = (int) NUM2DBL(vtype);
+	    break;
+	default:
+	    rb_raise(rb_eTypeError, "need number for sql_type");
+	    return Qnil;
+	}
+	switch (maptype) {
+	case SQL_NUMERIC:
+	case SQL_DECIMAL:
+	case SQL_INTEGER:
+	case SQL_FLOAT:
+	case SQL_REAL:
+	case SQL_DOUBLE:
+	case SQL_C_ULONG:
+#ifdef SQL_BIGINT
+	case SQL_BIGINT:
+#endif
+#ifdef SQL_C_UBIGINT
+	case SQL_C_UBIGINT:
+#endif
+	    maptype = SQL_C_LONG;
+	    break;
+	case SQL_SMALLINT:
+	case SQL_TINYINT:
+	case SQL_C_USHORT:
+	case SQL_C_UTINYINT:
+	    maptype = SQL_C_SHORT;
+	    break;
+	default:
+	    maptype = SQL_C_CHAR;
+	    break;
+	}
+    }
+    switch (maptype) {
+    case SQL_C_SHORT:
+	len_in = sizeof (sbuffer);
+	sbuffer = 0;
+	ret = SQLGetInfo(p->hdbc, (SQLUSMALLINT) info,
+			 (SQLPOINTER) &sbuffer, len_in, &len_out);
+	break;
+    case SQL_C_LONG:
+	len_in = sizeof (lbuffer);
+	lbuffer = 0;
+	ret = SQLGetInfo(p->hdbc, (SQLUSMALLINT) info,
+			 (SQLPOINTER) &lbuffer, len_in, &len_out);
+	break;
+    default:
+    case SQL_C_CHAR:
+	len_in = sizeof (buffer) - 1;
+	memset(buffer, 0, sizeof (buffer));
+	ret = SQLGetInfo(p->hdbc, (SQLUSMALLINT) info,
+			 (SQLPOINTER) buffer, len_in, &len_out);
+	break;
+    }
+    if (!SQL_SUCCEEDED(ret)) {
+	rb_raise(Cerror, "%s",
+		 get_err(SQL_NULL_HENV, p->hdbc, SQL_NULL_HSTMT));
+    }
+    switch (maptype) {
+    case SQL_C_SHORT:
+	return INT2NUM(sbuffer);
+    case SQL_C_LONG:
+	return INT2NUM(lbuffer);
+    default:
+    case SQL_C_CHAR:
+	return rb_str_new(buffer, len_out);
+    }
+    return Qnil;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ *      Fill column type array for statement.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static COLTYPE *
+make_coltypes(SQLHSTMT hstmt, int ncols, char **msgp, int bigdec)
+{
+    int i;
+    COLTYPE *ret = NULL;
+    SQLLEN type, size;
+
+    ret = ALLOC_N(COLTYPE, ncols);
+    if (ret == NULL) {
+	if (msgp != NULL) {
+	    *msgp = set_err("Out of memory", 0);
+	}
+	return NULL;
+    }
+    for (i = 0; i < ncols; i++) {
+	SQLUSMALLINT ic = i + 1;
+
+	if (!succeeded(SQL_NULL_HENV, SQL_NULL_HDBC, hstmt,
+		       SQLColAttributes(hstmt, ic,
+					SQL_COLUMN_TYPE, NULL, 0, NULL,
+					&type),
+		       msgp, "SQLColAttributes(SQL_COLUMN_TYPE)")) {
+	    xfree(ret);
+	    return NULL;
+	}
+	if (!succeeded(SQL_NULL_HENV, SQL_NULL_HDBC, hstmt,
+		       SQLColAttributes(hstmt, ic,
+					SQL_COLUMN_DISPLAY_SIZE,
+					NULL, 0, NULL, &size),
+		       msgp, "SQLColAttributes(SQL_COLUMN_DISPLAY_SIZE)")) {
+	    xfree(ret);
+	    return NULL;
+	}
+	ret[i].sqltype = type;
+	ret[i].conv = COLCONV_NONE;
+	switch (type) {
+#ifdef SQL_BIT
+	case SQL_BIT:
+#endif
+#ifdef SQL_TINYINT
+	case SQL_TINYINT:
+#endif
+	case SQL_SMALLINT:
+	case SQL_INTEGER:
+	    type = SQL_C_LONG;
+	    size = sizeof (SQLINTEGER);
+	    break;
+	case SQL_FLOAT:
+	case SQL_DOUBLE:
+	case SQL_REAL:
+	    type = SQL_C_DOUBLE;
+	    size = sizeof (double);
+	    break;
+	case SQL_DATE:
+#ifdef SQL_TYPE_DATE
+	case SQL_TYPE_DATE:
+#endif
+	    type = SQL_C_DATE;
+	    size = sizeof (DATE_STRUCT);
+	    break;
+	case SQL_TIME:
+#ifdef SQL_TYPE_TIME
+	case SQL_TYPE_TIME:
+#endif
+	    type = SQL_C_TIME;
+	    size = sizeof (TIME_STRUCT);
+	    break;
+	case SQL_TIMESTAMP:
+#ifdef SQL_TYPE_TIMESTAMP
+	case SQL_TYPE_TIMESTAMP:
+#endif
+	    type = SQL_C_TIMESTAMP;
+	    size = sizeof (TIMESTAMP_STRUCT);
+	    break;
+	case SQL_LONGVARBINARY:
+	    type = SQL_C_BINARY;
+	    size = SQL_NO_TOTAL;
+	    break;
+	case SQL_LONGVARCHAR:
+#ifdef UNICODE
+	case SQL_WLONGVARCHAR:
+	    type = SQL_C_WCHAR;
+#else
+	    type = SQL_C_CHAR;
+#endif
+	    size = SQL_NO_TOTAL;
+	    break;
+#ifdef SQL_BIGINT
+	case SQL_BIGINT:
+	    if (sizeof (SQLBIGINT) == sizeof (SQLINTEGER)) {
+		type = SQL_C_LONG;
+		size = sizeof (SQLINTEGER);
+	    } else {
+		type = SQL_C_SBIGINT;
+		size = sizeof (SQLBIGINT);
+	    }
+	    break;
+#endif
+#ifdef SQL_UBIGINT
+	case SQL_UBIGINT:
+	    if (sizeof (SQLBIGINT) == sizeof (SQLINTEGER)) {
+		type = SQL_C_LONG;
+		size = sizeof (SQLINTEGER);
+	    } else {
+		type = SQL_C_UBIGINT;
+		size = sizeof (SQLBIGINT);
+	    }
+	    break;
+#endif
+	case SQL_DECIMAL:
+	case SQL_NUMERIC:
+	    if (bigdec) {
+		SQLLEN prec = 0, scale = -1;
+
+		callsql(SQL_NULL_HENV, SQL_NULL_HDBC, hstmt,
+			SQLColAttributes(hstmt, ic, SQL_COLUMN_PRECISION,
+					 NULL, 0, NULL, &prec),
+			"SQLColAttributes(SQL_COLUMN_PRECISION)");
+		callsql(SQL_NULL_HENV, SQL_NULL_HDBC, hstmt,
+			SQLColAttributes(hstmt, ic, SQL_COLUMN_SCALE,
+					 NULL, 0, NULL, &scale),
+			"SQLColAttributes(SQL_COLUMN_SCALE)");
+#if defined(SQL_C_SBIGINT) && defined(LL2NUM)
+		if ((scale == 0) && (prec > 0) && (prec <= 18) &&
+		    (sizeof (SQLBIGINT) > sizeof (SQLINTEGER))) {
+		    type = SQL_C_SBIGINT;
+		    size = sizeof (SQLBIGINT);
+		    break;
+		}
+#endif
+		if ((size <= 0) || (size > SEGSIZE)) {
+		    size = (prec > 0) && (prec < SEGSIZE) ? prec + 2 : 64;
+		}
+		type = SQL_C_CHAR;
+		size += 1;
+		ret[i].conv = (scale == 0) ? COLCONV_INT : COLCONV_BIGDEC;
+		break;
+	    }
+	    /* FALL THRU */
+	default:
+	    if ((size == 0) || (size > SEGSIZE)) {
+		size = SQL_NO_TOTAL;
+	    }
+#ifdef UNICODE
+	    type = SQL_C_WCHAR;
+	    if (size != SQL_NO_TOTAL) {
+		size *= sizeof (SQLWCHAR);
+		size += sizeof (SQLWCHAR);
+	    }
+#else
+	    type = SQL_C_CHAR;
+	    if (size != SQL_NO_TOTAL) {
+		size += 1;
+	    }
+#endif
+	    break;
+	}
+	ret[i].type = type;
+	ret[i].size = size;
+    }
+    return ret;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ *      Fill parameter info array for statement.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static PARAMINFO *
+make_paraminfo(SQLHSTMT hstmt, int nump, char **msgp)
+{
+    int i;
+    PARAMINFO *paraminfo = NULL;
+
+    paraminfo = ALLOC_N(PARAMINFO, nump);
+    if (paraminfo == NULL) {
+	if (msgp != NULL) {
+	    *msgp = set_err("Out of memory", 0);
+	}
+	return NULL;
+    }
+    for (i = 0; i < nump; i++) {
+	paraminfo[i].iotype = SQL_PARAM_INPUT;
+	paraminfo[i].outsize = 0;
+	paraminfo[i].outbuf = NULL;
+	paraminfo[i].stream = Qnil;
+	paraminfo[i].strval = Qnil;
+#ifdef UNICODE
+	paraminfo[i].tofree = NULL;
+	paraminfo[i].ucbuf = NULL;
+	paraminfo[i].ucsize = 0;
+#endif
+	paraminfo[i].rlen = SQL_NULL_DATA;
+	paraminfo[i].ctype = SQL_C_CHAR;
+#ifdef UNICODE
+	paraminfo[i].outtype = SQL_WCHAR;
+#else
+	paraminfo[i].outtype = SQL_WCHAR;
+#endif
+	paraminfo[i].coldef_max = 0;
+	if (!succeeded(SQL_NULL_HENV, SQL_NULL_HDBC, hstmt,
+		       SQLDescribeParam(hstmt, (SQLUSMALLINT) (i + 1),
+					&paraminfo[i].type,
+					&paraminfo[i].coldef,
+					&paraminfo[i].scale,
+					&paraminfo[i].nullable),
+		       NULL, "SQLDescribeParam")) {
+#ifdef UNICODE
+	    paraminfo[i].type = SQL_WVARCHAR;
+#else
+	    paraminfo[i].type = SQL_VARCHAR;
+#endif
+	    paraminfo[i].coldef = 0;
+	    paraminfo[i].scale = 0;
+	    paraminfo[i].nullable = SQL_NULLABLE_UNKNOWN;
+	    paraminfo[i].override = 0;
+	}
+    }
+    return paraminfo;
+}
+
+static void
+retain_paraminfo_override(STMT *q, int nump, PARAMINFO *paraminfo)
+{
+    if ((q->paraminfo != NULL) && (q->nump == nump)) {
+	int i;
+
+	for (i = 0; i < nump; i++) {
+	    paraminfo[i].iotype = q->paraminfo[i].iotype;
+	    paraminfo[i].rlen = q->paraminfo[i].rlen;
+	    paraminfo[i].ctype = q->paraminfo[i].ctype;
+	    paraminfo[i].outtype = q->paraminfo[i].outtype;
+	    paraminfo[i].outsize = q->paraminfo[i].outsize;
+	    if (q->paraminfo[i].outbuf != NULL) {
+		paraminfo[i].outbuf = q->paraminfo[i].outbuf;
+		q->paraminfo[i].outbuf = NULL;
+	    }
+	    if (q->paraminfo[i].override) {
+		paraminfo[i].override = q->paraminfo[i].override;
+		paraminfo[i].type = q->paraminfo[i].type;
+		paraminfo[i].coldef = q->paraminfo[i].coldef;
+		paraminfo[i].scale = q->paraminfo[i].scale;
+	    }
+	}
+    }
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ *      Wrap SQLHSTMT into struct/VALUE.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static VALUE
+wrap_stmt(VALUE dbc, DBC *p, SQLHSTMT hstmt, STMT **qp)
+{
+    VALUE stmt = Qnil;
+    STMT *q;
+    int i;
+
+    stmt = ODBC_Make_Struct(Cstmt, STMT, stmt_type, mark_stmt, free_stmt, q);
+    tracemsg(2, fprintf(stderr, "ObjAlloc: STMT %p\n", q););
+    list_init(&q->link, offsetof(STMT, link));
+    q->self = stmt;
+    q->hstmt = hstmt;
+    q->dbc = dbc;
+    q->dbcp = NULL;
+    q->paraminfo = NULL;
+    q->coltypes = NULL;
+    q->bigdec = 0;
+    q->ndesc = -1;
+    q->desc = NULL;
+    q->colnames = q->dbufs = NULL;
+    q->colvals = NULL;
+    q->colsyms = NULL;
+    q->rowkv = NULL;
+    q->fetchc = 0;
+    q->upc = p->upc;
+    q->usef = 0;
+    q->rssize = p->rssize;
+    q->rsmode = 0;
+    q->rsbufs = NULL;
+    q->rsbufsize = q->bufsize = 0;
+    q->rsrows = q->rspos = 0;
+    q->sckey = q->scopts = Qnil;
+    q->schash = 0;
+    list_init(&q->sclink, offsetof(STMT, sclink));
+    q->error = q->info = Qnil;
+    q->diagh = SQL_NULL_HSTMT;
+    memset(&q->stats, 0, sizeof (STATS));
+    q->busy = 0;
+    q->lazyinfo = 0;
+    q->async = 0;
+    diag_own_stmt(q);
+    rb_iv_set(q->self, "@_a", rb_ary_new());
+    rb_iv_set(q->self, "@_h", rb_hash_new());
+    for (i = 0; i < 4; i++) {
+	rb_iv_set(q->self, colnamebuf[i], rb_hash_new());
+    }
+    if (hstmt != SQL_NULL_HSTMT) {
+	link_stmt(q, p);
+    } else {
+	q->dbc = Qnil;
+    }
+    if (qp != NULL) {
+	*qp = q;
+    }
+    return stmt;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ *      Create statement with result.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static VALUE
+make_result(VALUE dbc, SQLHSTMT hstmt, VALUE result, int mode)
+{
+    DBC *p;
+    STMT *q;
+    SQLSMALLINT cols = 0, nump;
+    COLTYPE *coltypes = NULL;
+    PARAMINFO *paraminfo = NULL;
+    char *msg = NULL;
+    int keepp = 0;
+
+    ODBC_Get_Struct(dbc, DBC, dbc_type, p);
+    if ((mode & MAKERES_REEXEC) && (result != Qnil) &&
+	(hstmt != SQL_NULL_HSTMT)) {
+	ODBC_Get_Struct(result, STMT, stmt_type, q);
+	if ((q->hstmt == hstmt) && (q->dbc == dbc)) {
+	    /* re-executed prepared statement, parameters are unchanged */
+	    if ((q->ndesc >= 0) && (q->bigdec == p->bigdec)) {
+		/* same result set as before, no need to describe it again */
+		if ((q->coltypes == NULL) && (q->ndesc > 0)) {
+		    q->coltypes = ALLOC_N(COLTYPE, q->ndesc);
+		    memcpy(q->coltypes, q->desc, sizeof (COLTYPE) * q->ndesc);
+		}
+		q->ncols = q->ndesc;
+		q->rsrows = q->rspos = 0;
+		goto done;
+	    }
+	    keepp = 1;
+	}
+    }
+    if (keepp) {
+	nump = q->nump;
+	paraminfo = q->paraminfo;
+    } else {
+	if ((hstmt == SQL_NULL_HSTMT) ||
+	    !succeeded(SQL_NULL_HENV, SQL_NULL_HDBC, hstmt,
+		       SQLNumParams(hstmt, &nump), NULL, "SQLNumParams")) {
+	    nump = 0;
+	}
+	if (nump > 0) {
+	    paraminfo = make_paraminfo(hstmt, nump, &msg);
+	    if (paraminfo == NULL) {
+		goto error;
+	    }
+	}
+    }
+    if ((mode & MAKERES_PREPARE) ||
+	(hstmt == SQL_NULL_HSTMT) ||
+	(!succeeded(SQL_NULL_HENV, SQL_NULL_HDBC, hstmt,
+		   SQLNumResultCols(hstmt, &cols), NULL,
+		   "SQLNumResultCols"))) {
+	cols = 0;
+    }
+    if (cols > 0) {
+	coltypes = make_coltypes(hstmt, cols, &msg, p->bigdec);
+	if (coltypes == NULL) {
+	    goto error;
+	}
+    }
+    if (result == Qnil) {
+	result = wrap_stmt(dbc, p, hstmt, &q);
+    } else {
+	ODBC_Get_Struct(result, STMT, stmt_type, q);
+	if (!keepp) {
+	    retain_paraminfo_override(q, nump, paraminfo);
+	}
+	free_stmt_sub(q, !keepp);
+	if (q->dbc != dbc) {
+	    unlink_stmt(q);
+	    q->dbc = dbc;
+	    if (hstmt != SQL_NULL_HSTMT) {
+		link_stmt(q, p);
+	    }
+	}
+	q->hstmt = hstmt;
+	diag_own_stmt(q);
+    }
+    q->nump = nump;
+    q->paraminfo = paraminfo;
+    q->ncols = cols;
+    q->coltypes = coltypes;
+    q->bigdec = p->bigdec;
+    desc_clear(q);
+    if (mode & MAKERES_REEXEC) {
+	/* kept across close for the next execute */
+	if (cols > 0) {
+	    q->desc = ALLOC_N(COLTYPE, cols);
+	    memcpy(q->desc, coltypes, sizeof (COLTYPE) * cols);
+	}
+	q->ndesc = cols;
+    }
+done:
+    if ((mode & MAKERES_BLOCK) && rb_block_given_p()) {
+	if (mode & MAKERES_NOCLOSE) {
+	    return rb_yield(result);
+	}
+	return rb_ensure(rb_yield, result, stmt_close, result);
+    }
+    return result;
+error:
+    callsql(SQL_NULL_HENV, SQL_NULL_HDBC, hstmt,
+	    SQLFreeStmt(hstmt, SQL_DROP), "SQLFreeStmt(SQL_DROP)");
+    if (result != Qnil) {
+	ODBC_Get_Struct(result, STMT, stmt_type, q);
+	if (q->hstmt == hstmt) {
+	    q->hstmt = SQL_NULL_HSTMT;
+	    unlink_stmt(q);
+	}
+    }
+    if ((paraminfo != NULL) && !keepp) {
+	xfree(paraminfo);
+    }
+    if (coltypes != NULL) {
+	xfree(coltypes);
+    }
+    rb_raise(Cerror, "%s", msg);
+    return Qnil;
+}
+
+static char *
+upcase_if(char *string, int upc)
+{
+    if (upc && (string != NULL)) {
+	unsigned char *p = (unsigned char *) string;
+
+	while (*p != '\0') {
+#ifdef UNICODE
+	    if ((*p < 0x80) && ISLOWER(*p))
+#else
+	    if (ISLOWER(*p))
+#endif
+	    {
+		*p = toupper(*p);
+	    }
+	    ++p;
+	}
+    }
+    return string;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ *      Constructor: make column from statement.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static VALUE
+make_column(SQLHSTMT hstmt, int i, int upc)
+{
+    VALUE obj, v;
+    SQLUSMALLINT ic = i + 1;
+    SQLLEN iv = 0;
+#ifdef UNICODE
+    SQLWCHAR name[SQL_MAX_MESSAGE_LENGTH];
+#else
+    char name[SQL_MAX_MESSAGE_LENGTH];
+#endif
+    char *msg;
+    SQLSMALLINT name_len;
+
+    name[0] = 0;
+    if (!succeeded(SQL_NULL_HENV, SQL_NULL_HDBC, hstmt,
+		   SQLColAttributes(hstmt, ic, SQL_COLUMN_LABEL, name,
+				    (SQLSMALLINT) sizeof (name),
+				    &name_len, NULL),
+		   &msg, "SQLColAttributes(SQL_COLUMN_LABEL)")) {
+	rb_raise(Cerror, "%s", msg);
+    }
+    obj = rb_obj_alloc(Ccolumn);
+    if (name_len >= (SQLSMALLINT) sizeof (name)) {
+	name_len = sizeof (name) - 1;
+    }
+    if (name_len > 0) {
+	name[name_len / sizeof (name[0])] = 0;
+    }
+#ifdef UNICODE
+    if (upc) {
+	int len = uc_strlen(name);
+	char tmpbuf[1];
+	char *tmp = xmalloc(len);
+	VALUE v;
+
+	if (tmp == NULL) {
+	    tmp = tmpbuf;
+	    len = 0;
+	}
+	mkutf(tmp, name, len);
+	v = rb_tainted_str_new2(upcase_if(tmp, 1));
+#ifdef USE_RB_ENC
+	rb_enc_associate(v, rb_enc);
+#endif
+	rb_iv_set(obj, "@name", v);
+	if ((tmp != NULL) && (tmp != tmpbuf)) {
+	    xfree(tmp);
+	}
+    } else {
+	rb_iv_set(obj, "@name", uc_tainted_str_new2(name));
+    }
+#else
+    rb_iv_set(obj, "@name", rb_tainted_str_new2(upcase_if(name, upc)));
+#endif
+    v = Qnil;
+    name[0] = 0;
+    if (succeeded(SQL_NULL_HENV, SQL_NULL_HDBC, hstmt,
+		  SQLColAttributes(hstmt, ic, SQL_COLUMN_TABLE_NAME, name,
+				   (SQLSMALLINT) sizeof (name),
+				   &name_len, NULL),
+		  NULL, "SQLColAttributes(SQL_COLUMN_TABLE_NAME)")) {
+	if (name_len > (SQLSMALLINT) sizeof (name)) {
+	    name_len = sizeof (name) - 1;
+	}
+	if (name_len > 0) {
+	    name[name_len / sizeof (name[0])] = 0;
+	}
+#ifdef UNICODE
+	v = uc_tainted_str_new2(name);
+#else
+	v = rb_tainted_str_new2(name);
+#endif
+    }
+    rb_iv_set(obj, "@table", v);
+    if (succeeded(SQL_NULL_HENV, SQL_NULL_HDBC, hstmt,
+		  SQLColAttributes(hstmt, ic, SQL_COLUMN_TYPE, NULL,
+				   0, NULL, &iv),
+		  NULL, "SQLColAttributes(SQL_COLUMN_TYPE)")) {
+	v = INT2NUM(iv);
+    } else {
+	v = INT2NUM(SQL_UNKNOWN_TYPE);
+    }
+    rb_iv_set(obj, "@type", v);
+    v = Qnil;
+    if (succeeded(SQL_NULL_HENV, SQL_NULL_HDBC, hstmt,
+		  SQLColAttributes(hstmt, ic,
+#if (ODBCVER >= 0x0300)
+				   SQL_DESC_LENGTH,
+#else
+				   SQL_COLUMN_LENGTH,
+#endif
+				   NULL, 0, NULL, &iv),
+		  NULL,
+#if (ODBCVER >= 0x0300)
+		  "SQLColAttributes(SQL_DESC_LENGTH)"
+#else
+		  "SQLColAttributes(SQL_COLUMN_LENGTH)"
+#endif
+	)) {
+	v = INT2NUM(iv);
+    } else if (succeeded(SQL_NULL_HENV, SQL_NULL_HDBC, hstmt,
+			 SQLColAttributes(hstmt, ic,
+					  SQL_COLUMN_DISPLAY_SIZE, NULL,
+					  0, NULL, &iv),
+			 NULL, "SQLColAttributes(SQL_COLUMN_DISPLAY_SIZE)")) {
+	v = INT2NUM(iv);
+    }
+    rb_iv_set(obj, "@length", v);
+    v = Qnil;
+    if (succeeded(SQL_NULL_HENV, SQL_NULL_HDBC, hstmt,
+		  SQLColAttributes(hstmt, ic, SQL_COLUMN_NULLABLE, NULL,
+				   0, NULL, &iv),
+		  NULL, "SQLColAttributes(SQL_COLUMN_NULLABLE)")) {
+	v = (iv == SQL_NO_NULLS) ? Qfalse : Qtrue;
+    }
+    rb_iv_set(obj, "@nullable", v);
+    v = Qnil;
+    if (succeeded(SQL_NULL_HENV, SQL_NULL_HDBC, hstmt,
+		  SQLColAttributes(hstmt, ic, SQL_COLUMN_SCALE, NULL,
+				   0, NULL, &iv),
+		  NULL, "SQLColAttributes(SQL_COLUMN_SCALE)")) {
+	v = INT2NUM(iv);
+    }
+    rb_iv_set(obj, "@scale", v);
+    v = Qnil;
+    if (succeeded(SQL_NULL_HENV, SQL_NULL_HDBC, hstmt,
+		  SQLColAttributes(hstmt, ic, SQL_COLUMN_PRECISION, NULL,
+				   0, NULL, &iv),
+		  NULL, "SQLColAttributes(SQL_COLUMN_PRECISION)")) {
+	v = INT2NUM(iv);
+    }
+    rb_iv_set(obj, "@precision", v);
+    v = Qnil;
+    if (succeeded(SQL_NULL_HENV, SQL_NULL_HDBC, hstmt,
+		  SQLColAttributes(hstmt, ic, SQL_COLUMN_SEARCHABLE, NULL,
+				   0, NULL, &iv),
+		  NULL, "SQLColAttributes(SQL_COLUMN_SEARCHABLE)")) {
+	v = (iv == SQL_NO_NULLS) ? Qfalse : Qtrue;
+    }
+    rb_iv_set(obj, "@searchable", v);
+    v = Qnil;
+    if (succeeded(SQL_NULL_HENV, SQL_NULL_HDBC, hstmt,
+		  SQLColAttributes(hstmt, ic, SQL_COLUMN_UNSIGNED, NULL,
+				   0, NULL, &iv),
+		  NULL, "SQLColAttributes(SQL_COLUMN_UNSIGNED)")) {
+	v = (iv == SQL_NO_NULLS) ? Qfalse : Qtrue;
+    }
+    rb_iv_set(obj, "@unsigned", v);
+    v = Qnil;
+#ifdef SQL_COLUMN_AUTO_INCREMENT
+    if (succeeded(SQL_NULL_HENV, SQL_NULL_HDBC, hstmt,
+		  SQLColAttributes(hstmt, ic, SQL_COLUMN_AUTO_INCREMENT, NULL,
+				   0, NULL, &iv),
+		  NULL, "SQLColAttributes(SQL_COLUMN_AUTO_INCREMENT)")) {
+	v = (iv == SQL_FALSE) ? Qfalse : Qtrue;
+    }
+#endif
+    rb_iv_set(obj, "@autoincrement", v);
+    return obj;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ *      Constructor: make parameter from statement.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static VALUE
+make_param(STMT *q, int i)
+{
+    VALUE obj;
+    int v;
+
+    obj = rb_obj_alloc(Cparam);
+#ifdef UNICODE
+    v = q->paraminfo ? q->paraminfo[i].type : SQL_VARCHAR;
+#else
+    v = q->paraminfo ? q->paraminfo[i].type : SQL_WVARCHAR;
+#endif
+    rb_iv_set(obj, "@type", INT2NUM(v));
+    v = q->paraminfo ? q->paraminfo[i].coldef : 0;
+    rb_iv_set(obj, "@precision", INT2NUM(v));
+    v = q->paraminfo ? q->paraminfo[i].scale : 0;
+    rb_iv_set(obj, "@scale", INT2NUM(v));
+    v = q->paraminfo ? q->paraminfo[i].nullable : SQL_NULLABLE_UNKNOWN;
+    rb_iv_set(obj, "@nullable", INT2NUM(v));
+    v = q->paraminfo ? q->paraminfo[i].iotype : SQL_PARAM_INPUT;
+    rb_iv_set(obj, "@iotype", INT2NUM(v));
+    v = q->paraminfo ? q->paraminfo[i].outsize : 0;
+    rb_iv_set(obj, "@output_size", INT2NUM(v));
+#ifdef UNICODE
+    v = q->paraminfo ? q->paraminfo[i].outtype : SQL_WCHAR;
+#else
+    v = q->paraminfo ? q->paraminfo[i].outtype : SQL_CHAR;
+#endif
+    rb_iv_set(obj, "@output_type", INT2NUM(v));
+    return obj;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ *      Query tables/columns/keys/indexes/types of data source.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static VALUE
+dbc_info(int argc, VALUE *argv, VALUE self, int mode)
+{
+    DBC *p = get_dbc(self);
+    VALUE which = Qnil, which2 = Qnil, which3 = Qnil;
+#ifdef UNICODE
+    SQLWCHAR *swhich = NULL, *swhich2 = NULL;
+#else
+    SQLCHAR *swhich = NULL, *swhich2 = NULL;
+#endif
+    char *msg;
+    const char *argspec = NULL;
+    SQLHSTMT hstmt;
+    int needstr = 1, itype = SQL_ALL_TYPES;
+    int iid = SQL_BEST_ROWID, iscope = SQL_SCOPE_CURROW;
+
+    if (p->hdbc == SQL_NULL_HDBC) {
+	rb_raise(Cerror, "%s", set_err("No connection", 0));
+    }
+    switch (mode) {
+    case INFO_TYPES:
+	needstr = 0;
+	/* FALL THRU */
+    case INFO_TABLES:
+    case INFO_PRIMKEYS:
+    case INFO_TPRIV:
+    case INFO_PROCS:
+	argspec = "01";
+	break;
+    case INFO_COLUMNS:
+	argspec = "02";
+	break;
+    case INFO_INDEXES:
+    case INFO_FORKEYS:
+    case INFO_PROCCOLS:
+	argspec = "11";
+	break;
+    case INFO_SPECCOLS:
+	argspec = "12";
+	break;
+    default:
+	rb_raise(Cerror, "%s", set_err("Invalid info mode", 0));
+	break;
+    }
+    rb_scan_args(argc, argv, argspec, &which, &which2, &which3);
+    if (which != Qnil) {
+	if (needstr) {
+	    Check_Type(which, T_STRING);
+#ifdef UNICODE
+	    swhich = (SQLWCHAR *) which;
+#else
+	    swhich = (SQLCHAR *) STR2CSTR(which);
+#endif
+	} else {
+	    itype = NUM2INT(which);
+	}
+    }
+    if (which2 != Qnil) {
+	if (mode == INFO_SPECCOLS) {
+	    iid = NUM2INT(which2);
+	} else if (mode != INFO_INDEXES) {
+	    Check_Type(which2, T_STRING);
+#ifdef UNICODE
+	    swhich2 = (SQLWCHAR *) which2;
+#else
+	    swhich2 = (SQLCHAR *) STR2CSTR(which2);
+#endif
+	}
+    }
+#ifdef UNICODE
+    if (swhich != NULL) {
+	VALUE val = (VALUE) swhich;
+
+#ifdef USE_RB_ENC
+	val = rb_funcall(val, IDencode, 1, rb_encv);
+#endif
+	swhich = uc_from_utf((unsigned char *) STR2CSTR(val), -1);
+	if (swhich == NULL) {
+	    rb_raise(Cerror, "%s", set_err("Out of memory", 0));
+	}
+    }
+    if (swhich2 != NULL) {
+	VALUE val = (VALUE) swhich2;
+
+#ifdef USE_RB_ENC
+	val = rb_funcall(val, IDencode, 1, rb_encv);
+#endif
+	swhich2 = uc_from_utf((unsigned char *) STR2CSTR(val), -1);
+	if (swhich2 == NULL) {
+	    uc_free(swhich);
+	    rb_raise(Cerror, "%s", set_err("Out of memory", 0));
+	}
+    }
+#endif
+    if (which3 != Qnil) {
+	iscope = NUM2INT(which3);
+    }
+    if (!succeeded(SQL_NULL_HENV, p->hdbc, SQL_NULL_HSTMT,
+		   SQLAllocStmt(p->hdbc, &hstmt), &msg, "SQLAllocStmt")) {
+#ifdef UNICODE
+	uc_free(swhich);
+	uc_free(swhich2);
+#endif
+	rb_raise(Cerror, "%s", msg);
+    }
+    switch (mode) {
+    case INFO_TABLES:
+	if (!succeeded(SQL_NULL_HENV, p->hdbc, hstmt,
+		       SQLTables(hstmt, NULL, 0, NULL, 0,
+				 swhich, (swhich == NULL) ? 0 : SQL_NTS,
+				 NULL, 0),
+		       &msg, "SQLTables")) {
+	    goto error;
+	}
+	break;
+    case INFO_COLUMNS:
+	if (!succeeded(SQL_NULL_HENV, p->hdbc, hstmt,
+		       SQLColumns(hstmt, NULL, 0, NULL, 0,
+				  swhich, (swhich == NULL) ? 0 : SQL_NTS,
+				  swhich2, (swhich2 == NULL) ? 0 : SQL_NTS),
+		       &msg, "SQLColumns")) {
+	    goto error;
+	}
+	break;
+    case INFO_PRIMKEYS:
+	if (!succeeded(SQL_NULL_HENV, p->hdbc, hstmt,
+		       SQLPrimaryKeys(hstmt, NULL, 0, NULL, 0,
+				      swhich, (swhich == NULL) ? 0 : SQL_NTS),
+		       &msg, "SQLPrimaryKeys")) {
+	    goto error;
+	}
+	break;
+    case INFO_INDEXES:
+	if (!succeeded(SQL_NULL_HENV, p->hdbc, hstmt,
+		       SQLStatistics(hstmt, NULL, 0, NULL, 0,
+				     swhich, (swhich == NULL) ? 0 : SQL_NTS,
+				     (SQLUSMALLINT) (RTEST(which2) ?
+				      SQL_INDEX_UNIQUE : SQL_INDEX_ALL),
+				     SQL_ENSURE),
+		       &msg, "SQLStatistics")) {
+	    goto error;
+	}
+	break;
+    case INFO_TYPES:
+	if (!succeeded(SQL_NULL_HENV, p->hdbc, hstmt,
+		       SQLGetTypeInfo(hstmt, (SQLSMALLINT) itype),
+		       &msg, "SQLGetTypeInfo")) {
+	    goto error;
+	}
+	break;
+    case INFO_FORKEYS:
+	if (!succeeded(SQL_NULL_HENV, p->hdbc, hstmt,
+		       SQLForeignKeys(hstmt, NULL, 0, NULL, 0,
+				      swhich, (swhich == NULL) ? 0 : SQL_NTS,
+				      NULL, 0, NULL, 0,
+				      swhich2, (swhich2 == NULL) ? 0 : SQL_NTS),
+		       &msg, "SQLForeignKeys")) {
+	    goto error;
+	}
+	break;
+    case INFO_TPRIV:
+	if (!succeeded(SQL_NULL_HENV, p->hdbc, hstmt,
+		       SQLTablePrivileges(hstmt, NULL, 0, NULL, 0, swhich,
+					  (swhich == NULL) ? 0 : SQL_NTS),
+		       &msg, "SQLTablePrivileges")) {
+	    goto error;
+	}
+	break;
+    case INFO_PROCS:
+	if (!succeeded(SQL_NULL_HENV, p->hdbc, hstmt,
+		       SQLProcedures(hstmt, NULL, 0, NULL, 0,
+				     swhich, (swhich == NULL) ? 0 : SQL_NTS),
+		       &msg, "SQLProcedures")) {
+	    goto error;
+	}
+	break;
+    case INFO_PROCCOLS:
+	if (!succeeded(SQL_NULL_HENV, p->hdbc, hstmt,
+		       SQLProcedureColumns(hstmt, NULL, 0, NULL, 0,
+					   swhich,
+					   (swhich == NULL) ? 0 : SQL_NTS,
+					   swhich2,
+					   (swhich2 == NULL) ? 0 : SQL_NTS),
+		       &msg, "SQLProcedureColumns")) {
+	    goto error;
+	}
+	break;
+    case INFO_SPECCOLS:
+	if (!succeeded(SQL_NULL_HENV, p->hdbc, hstmt,
+		       SQLSpecialColumns(hstmt, (SQLUSMALLINT) iid,
+					 NULL, 0, NULL, 0,
+					 swhich,
+					 (swhich == NULL) ? 0 : SQL_NTS,
+					 (SQLUSMALLINT) iscope,
+					 SQL_NULLABLE),
+		       &msg, "SQLSpecialColumns")) {
+	    goto error;
+	}
+	break;
+    }
+#ifdef UNICODE
+    uc_free(swhich);
+    uc_free(swhich2);
+#endif
+    return make_result(self, hstmt, Qnil, MAKERES_BLOCK);
+error:
+#ifdef UNICODE
+    uc_free(swhich);
+    uc_free(swhich2);
+#endif
+    callsql(SQL_NULL_HENV, SQL_NULL_HDBC, hstmt,
+	    SQLFreeStmt(hstmt, SQL_DROP), "SQLFreeStmt(SQL_DROP)");
+    rb_raise(Cerror, "%s", msg);
+    return Qnil;
+}
+
+static VALUE
+dbc_tables(int argc, VALUE *argv, VALUE self)
+{
+    return dbc_info(argc, argv, self, INFO_TABLES);
+}
+
+static VALUE
+dbc_columns(int argc, VALUE *argv, VALUE self)
+{
+    return dbc_info(argc, argv, self, INFO_COLUMNS);
+}
+
+static VALUE
+dbc_primkeys(int argc, VALUE *argv, VALUE self)
+{
+    return dbc_info(argc, argv, self, INFO_PRIMKEYS);
+}
+
+static VALUE
+dbc_indexes(int argc, VALUE *argv, VALUE self)
+{
+    return dbc_info(argc, argv, self, INFO_INDEXES);
+}
+
+static VALUE
+dbc_types(int argc, VALUE *argv, VALUE self)
+{
+    return dbc_info(argc, argv, self, INFO_TYPES);
+}
+
+static VALUE
+dbc_forkeys(int argc, VALUE *argv, VALUE self)
+{
+    return dbc_info(argc, argv, self, INFO_FORKEYS);
+}
+
+static VALUE
+dbc_tpriv(int argc, VALUE *argv, VALUE self)
+{
+    return dbc_info(argc, argv, self, INFO_TPRIV);
+}
+
+static VALUE
+dbc_procs(int argc, VALUE *argv, VALUE self)
+{
+    return dbc_info(argc, argv, self, INFO_PROCS);
+}
+
+static VALUE
+dbc_proccols(int argc, VALUE *argv, VALUE self)
+{
+    return dbc_info(argc, argv, self, INFO_PROCCOLS);
+}
+
+static VALUE
+dbc_speccols(int argc, VALUE *argv, VALUE self)
+{
+    return dbc_info(argc, argv, self, INFO_SPECCOLS);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ *      Transaction stuff.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static VALUE
+dbc_trans(VALUE self, int what)
+{
+    ENV *e;
+    SQLHDBC dbc = SQL_NULL_HDBC;
+    char *msg;
+
+    e = get_env(self);
+    if (rb_obj_is_kind_of(self, Cdbc) == Qtrue) {
+	DBC *d;
+
+	d = get_dbc(self);
+	dbc = d->hdbc;
+    }
+    if (!succeeded(e->henv, dbc, SQL_NULL_HSTMT,
+#if (ODBCVER >= 0x0300)
+		   SQLEndTran((SQLSMALLINT)
+			      ((dbc == SQL_NULL_HDBC) ? SQL_HANDLE_ENV :
+							SQL_HANDLE_DBC),
+			      (dbc == SQL_NULL_HDBC) ? e->henv : dbc,
+			      (SQLSMALLINT) what),
+		   &msg, "SQLEndTran"
+#else
+		   SQLTransact(e->henv, dbc, (SQLUSMALLINT) what),
+		   &msg, "SQLTransact"
+#endif
+       )) {
+	rb_raise(Cerror, "%s", msg);
+    }
+    return Qnil;
+}
+
+static VALUE
+dbc_commit(VALUE self)
+{
+    return dbc_trans(self, SQL_COMMIT);
+}
+
+static VALUE
+dbc_rollback(VALUE self)
+{
+    return dbc_trans(self, SQL_ROLLBACK);
+}
+
+static VALUE
+dbc_nop(VALUE self)
+{
+    return Qnil;
+}
+
+static VALUE
+dbc_transbody(VALUE self)
+{
+    return rb_yield(rb_ary_entry(self, 0));
+}
+
+static VALUE
+dbc_transfail(VALUE self, VALUE err)
+{
+    rb_ary_store(self, 1, err);
+    dbc_rollback(rb_ary_entry(self, 0));
+    return Qundef;
+}
+
+static VALUE
+dbc_transaction(VALUE self)
+{
+    VALUE a, ret;
+
+    if (!rb_block_given_p()) {
+	rb_raise(rb_eArgError, "block required");
+    }
+    rb_ensure(dbc_commit, self, dbc_nop, self);
+    a = rb_ary_new2(2);
+    rb_ary_store(a, 0, self);
+    rb_ary_store(a, 1, Qnil);
+    if ((ret = rb_rescue2(dbc_transbody, a, dbc_transfail, a,
+			  rb_eException, (VALUE) 0)) != Qundef) {
+	dbc_commit(self);
+	return ret;
+    }
+    ret = rb_ary_entry(a, 1);
+    rb_exc_raise(rb_exc_new3(rb_obj_class(ret),
+			     rb_funcall(ret, IDto_s, 0, 0)));
+    return Qnil;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ *      Environment attribute handling.
+ *
+ *----------------------------------------------------------------------
+ */
+
+#if (ODBCVER >= 0x0300)
+static VALUE
+do_attr(int argc, VALUE *argv, VALUE self, int op)
+{
+    SQLHENV henv = SQL_NULL_HENV;
+    VALUE val;
+    SQLLEN v = 0;
+    SQLPOINTER vp;
+    SQLINTEGER l;
+    char *msg;
+
+    if (self != Modbc) {
+	henv = get_env(self)->henv;
+    }
+    rb_scan_args(argc, argv, "01", &val);
+    if (val == Qnil) {
+	if (!succeeded(henv, SQL_NULL_HDBC, SQL_NULL_HSTMT,
+		       SQLGetEnvAttr(henv, (SQLINTEGER) op,
+				     (SQLPOINTER) &v, sizeof (v), &l),
+		       &msg, "SQLGetEnvAttr(%d)", op)) {
+	    rb_raise(Cerror, "%s", msg);
+	}
+	return rb_int2inum(v);
+    }
+    v = NUM2INT(val);
+    vp = (SQLPOINTER) v;
+    if (!succeeded(henv, SQL_NULL_HDBC, SQL_NULL_HSTMT,
+		   SQLSetEnvAttr(henv, (SQLINTEGER) op, vp, SQL_IS_INTEGER),
+		   &msg, "SQLSetEnvAttr(%d)", op)) {
+	rb_raise(Cerror, "%s", msg);
+    }
+    return Qnil;
+}
+#endif
+
+static VALUE
+env_cpooling(int argc, VALUE *argv, VALUE self)
+{
+#if (ODBCVER >= 0x0300)
+    return do_attr(argc, argv, self, SQL_ATTR_CONNECTION_POOLING);
+#else
+    rb_raise(Cerror, "%s", set_err("Unsupported in ODBC < 3.0", 0));
+    return Qnil;
+#endif
+}
+
+static VALUE
+env_cpmatch(int argc, VALUE *argv, VALUE self)
+{
+#if (ODBCVER >= 0x0300)
+    return do_attr(argc, argv, self, SQL_ATTR_CP_MATCH);
+#else
+    rb_raise(Cerror, "%s", set_err("Unsupported in ODBC < 3.0", 0));
+    return Qnil;
+#endif
+}
+
+static VALUE
+env_odbcver(int argc, VALUE *argv, VALUE self)
+{
+#if (ODBCVER >= 0x0300)
+    return do_attr(argc, argv, self, SQL_ATTR_ODBC_VERSION);
+#else
+    VALUE val;
+
+    rb_scan_args(argc, argv, "01", &val);
+    if (val == Qnil) {
+	return rb_int2inum(ODBCVER >> 8);
+    }
+    rb_raise(Cerror, "%s", set_err("Unsupported in ODBC < 3.0", 0));
+#endif
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ *      Connection/statement option handling.
+ *
+ *      Note:
+ *      ODBC 2 allows statement options to be set using SQLSetConnectOption,
+ *      establishing the statement option as a default for any hstmts
+ *      later allocated for that hdbc. This feature was deprecated in
+ *      ODBC 3.x and may not work with ODBC 3.x drivers.
+ *
+ *      Although the Database class includes attribute accessors for
+ *      statement-level options, a safer alternative, if using an ODBC 3
+ *      driver, is to set the option directly on the Statement instance.
+ *
+ *----------------------------------------------------------------------
+ */
+
+#define OPT_LEVEL_STMT         1
+#define OPT_LEVEL_DBC          2
+#define OPT_LEVEL_BOTH         (OPT_LEVEL_STMT | OPT_LEVEL_DBC)
+
+#define OPT_CONST_INT(x, level) { #x, x, level }
+#define OPT_CONST_END    { NULL, -1 }
+static struct {
+    const char *name;
+    int option;
+    int level;
+} option_map[] = {
+
+    /* yielding ints */
+    OPT_CONST_INT(SQL_AUTOCOMMIT, OPT_LEVEL_DBC),
+    OPT_CONST_INT(SQL_NOSCAN, OPT_LEVEL_BOTH),
+    OPT_CONST_INT(SQL_CONCURRENCY, OPT_LEVEL_BOTH),
+    OPT_CONST_INT(SQL_QUERY_TIMEOUT, OPT_LEVEL_BOTH),
+    OPT_CONST_INT(SQL_MAX_ROWS, OPT_LEVEL_BOTH),
+    OPT_CONST_INT(SQL_MAX_LENGTH, OPT_LEVEL_BOTH),
+    OPT_CONST_INT(SQL_ROWSET_SIZE, OPT_LEVEL_BOTH),
+    OPT_CONST_INT(SQL_CURSOR_TYPE, OPT_LEVEL_BOTH),
+
+    /* end of table */
+    OPT_CONST_END
+};
+
+static VALUE
+do_option(int argc, VALUE *argv, VALUE self, int isstmt, int op)
+{
+    DBC *p = NULL;
+    STMT *q = NULL;
+    VALUE val, val2, vstr;
+    SQLINTEGER v;
+    char *msg;
+    int level = isstmt ? OPT_LEVEL_STMT : OPT_LEVEL_DBC;
+
+    rb_scan_args(argc, argv, (op == -1) ? "11" : "01", &val, &val2);
+    if (isstmt) {
+	ODBC_Get_Struct(self, STMT, stmt_type, q);
+	if (q->dbc == Qnil) {
+	    rb_raise(Cerror, "%s", set_err("Stale ODBC::Statement", 0));
+	}
+	if (q->hstmt == SQL_NULL_HSTMT) {
+	    rb_raise(Cerror, "%s", set_err("No statement", 0));
+	}
+    } else {
+	p = get_dbc(self);
+	if (p->hdbc == SQL_NULL_HDBC) {
+	    rb_raise(Cerror, "%s", set_err("No connection", 0));
+	}
+    }
+    if (op == -1) {
+	char *string;
+	int i, op_found = 0;
+
+	switch (TYPE(val)) {
+	default:
+	    vstr = rb_any_to_s(val);
+	    string = STR2CSTR(vstr);
+	    goto doString;
+	case T_STRING:
+	    string = STR2CSTR(val);
+	doString:
+	    for (i = 0; option_map[i].name != NULL; i++) {
+		if (strcmp(string, option_map[i].name) == 0) {
+		    op = option_map[i].option;
+		    level = option_map[i].level;
+		    op_found = 3;
+		    break;
+		}
+	    }
+	    break;
+	case T_FLOAT:
+	case T_BIGNUM:
+	    op = (int) NUM2DBL(val);
+	    goto doInt;
+	case T_FIXNUM:
+	    op = FIX2INT(val);
+	doInt:
+	    op_found = 1;
+	    for (i = 0; option_map[i].name != NULL; i++) {
+		if (op == option_map[i].option) {
+		    level = option_map[i].level;
+		    op_found = 2;
+		    break;
+		}
+	    }
+	    break;
+	}
+	if (!op_found) {
+	    rb_raise(Cerror, "%s", set_err("Unknown option", 0));
+	    return Qnil;
+	}
+	val = val2;
+    }
+    if ((isstmt && (!(level & OPT_LEVEL_STMT))) ||
+	(!isstmt && (!(level & OPT_LEVEL_DBC)))) {
+	rb_raise(Cerror, "%s",
+		 set_err("Invalid option type for this level", 0));
+	return Qnil;
+    }
+    if (op == SQL_ROWSET_SIZE) {
+	/* kept here, applied to block cursor on first fetch */
+	int *sizep = (q != NULL) ? &q->rssize : &p->rssize;
+
+	if (val == Qnil) {
+	    return INT2NUM(*sizep);
+	}
+	v = NUM2INT(val);
+	if (v < 1) {
+	    rb_raise(Cerror, "%s", set_err("Invalid row set size", 0));
+	}
+	if ((q != NULL) && (v != *sizep)) {
+	    desc_clear(q);
+	}
+	*sizep = v;
+	return Qnil;
+    }
+    if (val == Qnil) {
+	if (p != NULL) {
+	    if (!succeeded(SQL_NULL_HENV, p->hdbc, SQL_NULL_HSTMT,
+			   SQLGetConnectOption(p->hdbc, (SQLUSMALLINT) op,
+					       (SQLPOINTER) &v),
+			   &msg, "SQLGetConnectOption(%d)", op)) {
+		rb_raise(Cerror, "%s", msg);
+	    }
+	} else {
+	    if (!succeeded(SQL_NULL_HENV, SQL_NULL_HSTMT, q->hstmt,
+			   SQLGetStmtOption(q->hstmt, (SQLUSMALLINT) op,
+					    (SQLPOINTER) &v),
+			   &msg, "SQLGetStmtOption(%d)", op)) {
+		rb_raise(Cerror, "%s", msg);
+	    }
+	}
+    }
+    switch (op) {
+    case SQL_AUTOCOMMIT:
+	if (val == Qnil) {
+	    return v ? Qtrue : Qfalse;
+	}
+	v = (TYPE(val) == T_FIXNUM) ?
+	    (FIX2INT(val) ? SQL_AUTOCOMMIT_ON : SQL_AUTOCOMMIT_OFF) :
+	    (RTEST(val) ? SQL_AUTOCOMMIT_ON : SQL_AUTOCOMMIT_OFF);
+	break;
+
+    case SQL_NOSCAN:
+	if (val == Qnil) {
+	    return v ? Qtrue : Qfalse;
+	}
+	v = (TYPE(val) == T_FIXNUM) ?
+	    (FIX2INT(val) ? SQL_NOSCAN_ON : SQL_NOSCAN_OFF) :
+	    (RTEST(val) ? SQL_NOSCAN_ON : SQL_NOSCAN_OFF);
+	break;
+
+    case SQL_CONCURRENCY:
+    case SQL_QUERY_TIMEOUT:
+    case SQL_MAX_ROWS:
+    case SQL_MAX_LENGTH:
+    case SQL_ROWSET_SIZE:
+    case SQL_CURSOR_TYPE:
+    default:
+	if (val == Qnil) {
+	    return rb_int2inum(v);
+	}
+	Check_Type(val, T_FIXNUM);
+	v = FIX2INT(val);
+	break;
+    }
+    if (p != NULL) {
+	if (!succeeded(SQL_NULL_HENV, p->hdbc, SQL_NULL_HSTMT,
+		       SQLSetConnectOption(p->hdbc, (SQLUSMALLINT) op,
+					   (SQLUINTEGER) v),
+		       &msg, "SQLSetConnectOption(%d)", op)) {
+	    rb_raise(Cerror, "%s", msg);
+	}
+    } else {
+	scache_saveopt(q, op);
+	if (!succeeded(SQL_NULL_HENV, SQL_NULL_HDBC, q->hstmt,
+		       SQLSetStmtOption(q->hstmt, (SQLUSMALLINT) op,
+					(SQLUINTEGER) v),
+		       &msg, "SQLSetStmtOption(%d)", op)) {
+	    rb_raise(Cerror, "%s", msg);
+	}
+    }
+    return Qnil;
+}
+
+static VALUE
+dbc_autocommit(int argc, VALUE *argv, VALUE self)
+{
+    return do_option(argc, argv, self, 0, SQL_AUTOCOMMIT);
+}
+
+static VALUE
+dbc_concurrency(int argc, VALUE *argv, VALUE self)
+{
+    return do_option(argc, argv, self, 0, SQL_CONCURRENCY);
+}
+
+static VALUE
+dbc_maxrows(int argc, VALUE *argv, VALUE self)
+{
+    return do_option(argc, argv, self, 0, SQL_MAX_ROWS);
+}
+
+static VALUE
+dbc_timeout(int argc, VALUE *argv, VALUE self)
+{
+    return do_option(argc, argv, self, 0, SQL_QUERY_TIMEOUT);
+}
+
+static VALUE
+dbc_maxlength(int argc, VALUE *argv, VALUE self)
+{
+    return do_option(argc, argv, self, 0, SQL_MAX_LENGTH);
+}
+
+static VALUE
+dbc_rowsetsize(int argc, VALUE *argv, VALUE self)
+{
+    return do_option(argc, argv, self, 0, SQL_ROWSET_SIZE);
+}
+
+static VALUE
+dbc_cursortype(int argc, VALUE *argv, VALUE self)
+{
+    return do_option(argc, argv, self, 0, SQL_CURSOR_TYPE);
+}
+
+static VALUE
+dbc_noscan(int argc, VALUE *argv, VALUE self)
+{
+    return do_option(argc, argv, self, 0, SQL_NOSCAN);
+}
+
+static VALUE
+dbc_getsetoption(int argc, VALUE *argv, VALUE self)
+{
+    return do_option(argc, argv, self, 0, -1);
+}
+
+static VALUE
+stmt_concurrency(int argc, VALUE *argv, VALUE self)
+{
+    return do_option(argc, argv, self, 1, SQL_CONCURRENCY);
+}
+
+static VALUE
+stmt_maxrows(int argc, VALUE *argv, VALUE self)
+{
+    return do_option(argc, argv, self, 1, SQL_MAX_ROWS);
+}
+
+static VALUE
+stmt_timeout(int argc, VALUE *argv, VALUE self)
+{
+    return do_option(argc, argv, self, 1, SQL_QUERY_TIMEOUT);
+}
+
+static VALUE
+stmt_maxlength(int argc, VALUE *argv, VALUE self)
+{
+    return do_option(argc, argv, self, 1, SQL_MAX_LENGTH);
+}
+
+static VALUE
+stmt_rowsetsize(int argc, VALUE *argv, VALUE self)
+{
+    return do_option(argc, argv, self, 1, SQL_ROWSET_SIZE);
+}
+
+static VALUE
+stmt_cursortype(int argc, VALUE *argv, VALUE self)
+{
+    return do_option(argc, argv, self, 1, SQL_CURSOR_TYPE);
+}
+
+static VALUE
+stmt_noscan(int argc, VALUE *argv, VALUE self)
+{
+    return do_option(argc, argv, self, 1, SQL_NOSCAN);
+}
+
+static VALUE
+stmt_getsetoption(int argc, VALUE *argv, VALUE self)
+{
+    return do_option(argc, argv, self, 1, -1);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ *      Scan literal date/time/timestamp to TIMESTAMP_STRUCT.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+scan_dtts(VALUE str, int do_d, int do_t, TIMESTAMP_STRUCT *ts)
+{
+    int yy = 0, mm = 0, dd = 0, hh = 0, mmm = 0, ss = 0, ff = 0, i;
+    char c, *cstr = STR2CSTR(str);
+
+    memset(ts, 0, sizeof (TIMESTAMP_STRUCT));
+    if (((sscanf(cstr, "{ts '%d-%d-%d %d:%d:%d.%d' %c",
+		 &yy, &mm, &dd, &hh, &mmm, &ss, &ff, &c) == 8) ||
+	 (sscanf(cstr, "{ts '%d-%d-%d %d:%d:%d' %c",
+		 &yy, &mm, &dd, &hh, &mmm, &ss, &c) == 7)) &&
+	(c == '}')) {
+	ts->year = yy;
+	ts->month = mm;
+	ts->day = dd;
+	ts->hour = hh;
+	ts->minute = mmm;
+	ts->second = ss;
+	ts->fraction = ff;
+	return 1;
+    }
+    if (do_d &&
+	(sscanf(cstr, "{d '%d-%d-%d' %c", &yy, &mm, &dd, &c) == 4) &&
+	(c == '}')) {
+	ts->year = yy;
+	ts->month = mm;
+	ts->day = dd;
+	return 1;
+    }
+    if (do_t &&
+	(sscanf(cstr, "{t '%d:%d:%d' %c", &hh, &mmm, &ss, &c) == 4) &&
+	(c == '}')) {
+	ts->hour = yy;
+	ts->minute = mmm;
+	ts->second = ss;
+	return 1;
+    }
+    ff = ss = 0;
+    i = sscanf(cstr, "%d-%d-%d %d:%d:%d%c%d",
+	       &yy, &mm, &dd, &hh, &mmm, &ss, &c, &ff);
+    if (i >= 5) {
+	if ((i > 6) && (c != 0) && (strchr(". \t", c) == NULL)) {
+	    goto next;
+	}
+	ts->year = yy;
+	ts->month = mm;
+	ts->day = dd;
+	ts->hour = hh;
+	ts->minute = mmm;
+	ts->second = ss;
+	ts->fraction = ff;
+	return 1;
+    }
+next:
+    ff = ss = 0;
+    if (do_d && (sscanf(cstr, "%d-%d-%d", &yy, &mm, &dd) == 3)) {
+	ts->year = yy;
+	ts->month = mm;
+	ts->day = dd;
+	return 1;
+    }
+    if (do_t && (sscanf(cstr, "%d:%d:%d", &hh, &mmm, &ss) == 3)) {
+	ts->hour = hh;
+	ts->minute = mmm;
+	ts->second = ss;
+	return 1;
+    }
+    return 0;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ *      Date methods.
+ *
+ *----------------------------------------------------------------------
+ */
+
+#ifdef HAVE_RB_DEFINE_ALLOC_FUNC
+static VALUE
+date_alloc(VALUE self)
+{
+    DATE_STRUCT *date;
+    VALUE obj = Data_Make_Struct(self, DATE_STRUCT, 0, xfree, date);
+
+    memset(date, 0, sizeof (*date));
+    return obj;
+}
+#else
+static VALUE
+date_new(int argc, VALUE *argv, VALUE self)
+{
+    DATE_STRUCT *date;
+    VALUE obj = Data_Make_Struct(self, DATE_STRUCT, 0, xfree, date);
+
+    rb_obj_call_init(obj, argc, argv);
+    return obj;
+}
+#endif
 
-    /* end of table */
-    GI_CONST_BITMAP_END
-};
+static VALUE
+date_load1(VALUE self, VALUE str, int load)
+{
+    TIMESTAMP_STRUCT tss;
+
+    if (scan_dtts(str, 1, 0, &tss)) {
+	DATE_STRUCT *date;
+	VALUE obj;
+
+	if (load) {
+	    obj = Data_Make_Struct(self, DATE_STRUCT, 0, xfree, date);
+	} else {
+	    obj = self;
+	    Data_Get_Struct(self, DATE_STRUCT, date);
+	}
+	date->year = tss.year;
+	date->month = tss.month;
+	date->day = tss.day;
+	return obj;
+    }
+    if (load > 0) {
+	rb_raise(rb_eTypeError, "marshaled ODBC::Date format error");
+    }
+    return Qnil;
+}
 
 static VALUE
-dbc_getinfo(int argc, VALUE *argv, VALUE self)
+date_load(VALUE self, VALUE str)
 {
-    DBC *p = get_dbc(self);
-    VALUE which, vtype, vstr;
-    SQLRETURN ret;
-    int i, k, info = -1, maptype = -1, info_found = 0;
-    SQLUSMALLINT sbuffer;
-    SQLUINTEGER lbuffer;
-    SQLSMALLINT len_in, len_out;
-    char *string = NULL, buffer[513];
+    return date_load1(self, str, 1);
+}
 
-    rb_scan_args(argc, argv, "11", &which, &vtype);
-    switch (TYPE(which)) {
-    default:
-	vstr = rb_any_to_s(which);
-	string = STR2CSTR(vstr);
-	goto doString;
-    case T_STRING:
-	string = STR2CSTR(which);
-    doString:
-	for (i = 0; get_info_map[i].name != NULL; i++) {
-	    if (strcmp(string, get_info_map[i].name) == 0) {
-		info = get_info_map[i].info;
-		maptype = get_info_map[i].maptype;
-		info_found = 2;
-		break;
-	    }
+static VALUE
+date_init(int argc, VALUE *argv, VALUE self)
+{
+    DATE_STRUCT *date;
+    VALUE d, m, y;
+
+    rb_scan_args(argc, argv, "03", &y, &m, &d);
+    if (rb_obj_is_kind_of(y, Cdate) == Qtrue) {
+	DATE_STRUCT *date2;
+
+	if (argc > 1) {
+	    rb_raise(rb_eArgError, "wrong # arguments");
 	}
-	break;
-    case T_FLOAT:
-    case T_BIGNUM:
-	k = (int) NUM2DBL(which);
-	goto doInt;
-    case T_FIXNUM:
-	k = FIX2INT(which);
-    doInt:
-	info = k;
-	info_found = 1;
-	for (i = 0; get_info_map[i].name != NULL; i++) {
-	    if (k == get_info_map[i].info) {
-		info = get_info_map[i].info;
-		maptype = get_info_map[i].maptype;
-		info_found = 3;
-		break;
-	    }
+	Data_Get_Struct(self, DATE_STRUCT, date);
+	Data_Get_Struct(y, DATE_STRUCT, date2);
+	*date = *date2;
+	return self;
+    }
+    if (rb_obj_is_kind_of(y, Ctimestamp) == Qtrue) {
+	TIMESTAMP_STRUCT *ts;
+
+	if (argc > 1) {
+	    rb_raise(rb_eArgError, "wrong # arguments");
 	}
-	break;
+	Data_Get_Struct(self, DATE_STRUCT, date);
+	Data_Get_Struct(y, TIMESTAMP_STRUCT, ts);
+	date->year  = ts->year;
+	date->month = ts->month;
+	date->day   = ts->day;
+	return self;
     }
-    switch (info_found) {
-    case 0:
-	rb_raise(Cerror, "%s",
-		 set_err("Invalid info type for ODBC::Connection.get_info",
-			 0));
-	return Qnil;
-    case 1:
-	sprintf(buffer, "Unknown info type %d for ODBC::Connection.get_info",
-		info);
-	set_err(buffer, 1);
-	break;
+    if (rb_obj_is_kind_of(y, rb_cTime) == Qtrue) {
+	if (argc > 1) {
+	    rb_raise(rb_eArgError, "wrong # arguments");
+	}
+	d = rb_funcall(y, IDday, 0, NULL);
+	m = rb_funcall(y, IDmonth, 0, NULL);
+	y = rb_funcall(y, IDyear, 0, NULL);
+    } else if (rb_obj_is_kind_of(y, rb_cDate) == Qtrue) {
+	if (argc > 1) {
+	    rb_raise(rb_eArgError, "wrong # arguments");
+	}
+	d = rb_funcall(y, IDmday, 0, NULL);
+	m = rb_funcall(y, IDmonth, 0, NULL);
+	y = rb_funcall(y, IDyear, 0, NULL);
+    } else if ((argc == 1) && (rb_obj_is_kind_of(y, rb_cString) == Qtrue)) {
+	if (date_load1(self, y, 0) != Qnil) {
+	    return self;
+	}
+    }
+    Data_Get_Struct(self, DATE_STRUCT, date);
+    date->year  = (y == Qnil) ? 0 : NUM2INT(y);
+    date->month = (m == Qnil) ? 0 : NUM2INT(m);
+    date->day   = (d == Qnil) ? 0 : NUM2INT(d);
+    return self;
+}
+
+static VALUE
+date_clone(VALUE self)
+{
+#ifdef HAVE_RB_DEFINE_ALLOC_FUNC
+    VALUE obj = rb_obj_alloc(CLASS_OF(self));
+    DATE_STRUCT *date1, *date2;
+
+    Data_Get_Struct(self, DATE_STRUCT, date1);
+    Data_Get_Struct(obj, DATE_STRUCT, date2);
+    *date2 = *date1;
+    return obj;
+#else
+    return date_new(1, &self, CLASS_OF(self));
+#endif
+}
+
+static VALUE
+date_to_s(VALUE self)
+{
+    DATE_STRUCT *date;
+    char buf[128];
+
+    Data_Get_Struct(self, DATE_STRUCT, date);
+    sprintf(buf, "%04d-%02d-%02d", date->year, date->month, date->day);
+    return rb_str_new2(buf);
+}
+
+static VALUE
+date_dump(VALUE self, VALUE depth)
+{
+    return date_to_s(self);
+}
+
+static VALUE
+date_inspect(VALUE self)
+{
+    VALUE s = rb_str_new2("#<ODBC::Date: ");
+
+    s = rb_str_append(s, date_to_s(self));
+    return rb_str_append(s, rb_str_new2(">"));
+}
+
+static VALUE
+date_year(int argc, VALUE *argv, VALUE self)
+{
+    DATE_STRUCT *date;
+    VALUE v;
+
+    rb_scan_args(argc, argv, "01", &v);
+    Data_Get_Struct(self, DATE_STRUCT, date);
+    if (v == Qnil) {
+	return INT2NUM(date->year);
     }
-    if (vtype != Qnil) {
-	switch (TYPE(vtype)) {
-	case T_FIXNUM:
-	    maptype = FIX2INT(vtype);
-	    break;
-	case T_BIGNUM:
-	case T_FLOAT:
-	    maptype = (int) NUM2DBL(vtype);
-	    break;
-	default:
-	    rb_raise(rb_eTypeError, "need number for sql_type");
-	    return Qnil;
-	}
-	switch (maptype) {
-	case SQL_NUMERIC:
-	case SQL_DECIMAL:
-	case SQL_INTEGER:
-	case SQL_FLOAT:
-	case SQL_REAL:
-	case SQL_DOUBLE:
-	case SQL_C_ULONG:
-#ifdef SQL_BIGINT
-	case SQL_BIGINT:
-#endif
-#ifdef SQL_C_UBIGINT
-	case SQL_C_UBIGINT:
-#endif
-	    maptype = SQL_C_LONG;
-	    break;
-	case SQL_SMALLINT:
-	case SQL_TINYINT:
-	case SQL_C_USHORT:
-	case SQL_C_UTINYINT:
-	    maptype = SQL_C_SHORT;
-	    break;
-	default:
-	    maptype = SQL_C_CHAR;
-	    break;
-	}
+    date->year = NUM2INT(v);
+    return self;
+}
+
+static VALUE
+date_month(int argc, VALUE *argv, VALUE self)
+{
+    DATE_STRUCT *date;
+    VALUE v;
+
+    rb_scan_args(argc, argv, "01", &v);
+    Data_Get_Struct(self, DATE_STRUCT, date);
+    if (v == Qnil) {
+	return INT2NUM(date->month);
     }
-    switch (maptype) {
-    case SQL_C_SHORT:
-	len_in = sizeof (sbuffer);
-	sbuffer = 0;
-	ret = SQLGetInfo(p->hdbc, (SQLUSMALLINT) info,
-			 (SQLPOINTER) &sbuffer, len_in, &len_out);
-	break;
-    case SQL_C_LONG:
-	len_in = sizeof (lbuffer);
-	lbuffer = 0;
-	ret = SQLGetInfo(p->hdbc, (SQLUSMALLINT) info,
-			 (SQLPOINTER) &lbuffer, len_in, &len_out);
-	break;
-    default:
-    case SQL_C_CHAR:
-	len_in = sizeof (buffer) - 1;
-	memset(buffer, 0, sizeof (buffer));
-	ret = SQLGetInfo(p->hdbc, (SQLUSMALLINT) info,
-			 (SQLPOINTER) buffer, len_in, &len_out);
-	break;
+    date->month = NUM2INT(v);
+    return self;
+}
+
+static VALUE
+date_day(int argc, VALUE *argv, VALUE self)
+{
+    DATE_STRUCT *date;
+    VALUE v;
+
+    rb_scan_args(argc, argv, "01", &v);
+    Data_Get_Struct(self, DATE_STRUCT, date);
+    if (v == Qnil) {
+	return INT2NUM(date->day);
     }
-    if (!SQL_SUCCEEDED(ret)) {
-	rb_raise(Cerror, "%s",
-		 get_err(SQL_NULL_HENV, p->hdbc, SQL_NULL_HSTMT));
+    date->day = NUM2INT(v);
+    return self;
+}
+
+static VALUE
+date_cmp(VALUE self, VALUE date)
+{
+    DATE_STRUCT *date1, *date2;
+
+    if (rb_obj_is_kind_of(date, Cdate) != Qtrue) {
+	rb_raise(rb_eTypeError, "need ODBC::Date as argument");
     }
-    switch (maptype) {
-    case SQL_C_SHORT:
-	return INT2NUM(sbuffer);
-    case SQL_C_LONG:
-	return INT2NUM(lbuffer);
-    default:
-    case SQL_C_CHAR:
-	return rb_str_new(buffer, len_out);
+    Data_Get_Struct(self, DATE_STRUCT, date1);
+    Data_Get_Struct(date, DATE_STRUCT, date2);
+    if (date1->year < date2->year) {
+	return INT2FIX(-1);
     }
-    return Qnil;
+    if (date1->year == date2->year) {
+	if (date1->month < date2->month) {
+	    return INT2FIX(-1);
+	}
+	if (date1->month == date2->month) {
+	    if (date1->day < date2->day) {
+		return INT2FIX(-1);
+	    }
+	    if (date1->day == date2->day) {
+		return INT2FIX(0);
+	    }
+	}
+    }
+    return INT2FIX(1);
 }
 
 /*
  *----------------------------------------------------------------------
  *
- *      Fill column type array for statement.
+ *      Time methods.
  *
  *----------------------------------------------------------------------
  */
 
-static COLTYPE *
-make_coltypes(SQLHSTMT hstmt, int ncols, char **msgp)
+#ifdef HAVE_RB_DEFINE_ALLOC_FUNC
+static VALUE
+time_alloc(VALUE self)
 {
-    int i;
-    COLTYPE *ret = NULL;
-    SQLLEN type, size;
-
-    for (i = 0; i < ncols; i++) {
-	SQLUSMALLINT ic = i + 1;
-
-	if (!succeeded(SQL_NULL_HENV, SQL_NULL_HDBC, hstmt,
-		       SQLColAttributes(hstmt, ic,
-					SQL_COLUMN_TYPE, NULL, 0, NULL,
-					&type),
-		       msgp, "SQLColAttributes(SQL_COLUMN_TYPE)")) {
-	    return ret;
-	}
-	if (!succeeded(SQL_NULL_HENV, SQL_NULL_HDBC, hstmt,
-		       SQLColAttributes(hstmt, ic,
-					SQL_COLUMN_DISPLAY_SIZE,
-					NULL, 0, NULL, &size),
-		       msgp, "SQLColAttributes(SQL_COLUMN_DISPLAY_SIZE)")) {
-	    return ret;
-	}
-    }
-    ret = ALLOC_N(COLTYPE, ncols);
-    if (ret == NULL) {
-	if (msgp != NULL) {
-	    *msgp = set_err("Out of memory", 0);
-	}
-	return NULL;
-    }
-    for (i = 0; i < ncols; i++) {
-	SQLUSMALLINT ic = i + 1;
+    TIME_STRUCT *time;
+    VALUE obj = Data_Make_Struct(self, TIME_STRUCT, 0, xfree, time);
 
-	callsql(SQL_NULL_HENV, SQL_NULL_HDBC, hstmt,
-		SQLColAttributes(hstmt, ic,
-				 SQL_COLUMN_TYPE,
-				 NULL, 0, NULL, &type),
-		"SQLColAttributes(SQL_COLUMN_TYPE)");
-	callsql(SQL_NULL_HENV, SQL_NULL_HDBC, hstmt,
-		SQLColAttributes(hstmt, ic,
-				 SQL_COLUMN_DISPLAY_SIZE,
-				 NULL, 0, NULL, &size),
-		"SQLColAttributes(SQL_COLUMN_DISPLAY_SIZE)");
-	switch (type) {
-#ifdef SQL_BIT
-	case SQL_BIT:
-#endif
-#ifdef SQL_TINYINT
-	case SQL_TINYINT:
-#endif
-	case SQL_SMALLINT:
-	case SQL_INTEGER:
-	    type = SQL_C_LONG;
-	    size = sizeof (SQLINTEGER);
-	    break;
-	case SQL_FLOAT:
-	case SQL_DOUBLE:
-	case SQL_REAL:
-	    type = SQL_C_DOUBLE;
-	    size = sizeof (double);
-	    break;
-	case SQL_DATE:
-#ifdef SQL_TYPE_DATE
-	case SQL_TYPE_DATE:
-#endif
-	    type = SQL_C_DATE;
-	    size = sizeof (DATE_STRUCT);
-	    break;
-	case SQL_TIME:
-#ifdef SQL_TYPE_TIME
-	case SQL_TYPE_TIME:
-#endif
-	    type = SQL_C_TIME;
-	    size = sizeof (TIME_STRUCT);
-	    break;
-	case SQL_TIMESTAMP:
-#ifdef SQL_TYPE_TIMESTAMP
-	case SQL_TYPE_TIMESTAMP:
-#endif
-	    type = SQL_C_TIMESTAMP;
-	    size = sizeof (TIMESTAMP_STRUCT);
-	    break;
-	case SQL_LONGVARBINARY:
-	    type = SQL_C_BINARY;
-	    size = SQL_NO_TOTAL;
-	    break;
-	case SQL_LONGVARCHAR:
-#ifdef UNICODE
-	case SQL_WLONGVARCHAR:
-	    type = SQL_C_WCHAR;
-#else
-	    type = SQL_C_CHAR;
-#endif
-	    size = SQL_NO_TOTAL;
-	    break;
-#ifdef SQL_BIGINT
-	case SQL_BIGINT:
-	    if (sizeof (SQLBIGINT) == sizeof (SQLINTEGER)) {
-		type = SQL_C_LONG;
-		size = sizeof (SQLINTEGER);
-	    } else {
-		type = SQL_C_SBIGINT;
-		size = sizeof (SQLBIGINT);
-	    }
-	    break;
-#endif
-#ifdef SQL_UBIGINT
-	case SQL_UBIGINT:
-	    if (sizeof (SQLBIGINT) == sizeof (SQLINTEGER)) {
-		type = SQL_C_LONG;
-		size = sizeof (SQLINTEGER);
-	    } else {
-		type = SQL_C_UBIGINT;
-		size = sizeof (SQLBIGINT);
-	    }
-	    break;
-#endif
-	default:
-	    if ((size == 0) || (size > SEGSIZE)) {
-		size = SQL_NO_TOTAL;
-	    }
-#ifdef UNICODE
-	    type = SQL_C_WCHAR;
-	    if (size != SQL_NO_TOTAL) {
-		size *= sizeof (SQLWCHAR);
-		size += sizeof (SQLWCHAR);
-	    }
+    memset(time, 0, sizeof (*time));
+    return obj;
+}
 #else
-	    type = SQL_C_CHAR;
-	    if (size != SQL_NO_TOTAL) {
-		size += 1;
-	    }
+static VALUE
+time_new(int argc, VALUE *argv, VALUE self)
+{
+    TIME_STRUCT *time;
+    VALUE obj = Data_Make_Struct(self, TIME_STRUCT, 0, xfree, time);
+
+    rb_obj_call_init(obj, argc, argv);
+    return obj;
+}
 #endif
-	    break;
+
+static VALUE
+time_load1(VALUE self, VALUE str, int load)
+{
+    TIMESTAMP_STRUCT tss;
+
+    if (scan_dtts(str, 0, 1, &tss)) {
+	TIME_STRUCT *time;
+	VALUE obj;
+
+	if (load) {
+	    obj = Data_Make_Struct(self, TIME_STRUCT, 0, xfree, time);
+	} else {
+	    obj = self;
+	    Data_Get_Struct(self, TIME_STRUCT, time);
 	}
-	ret[i].type = type;
-	ret[i].size = size;
+	time->hour = tss.hour;
+	time->minute = tss.minute;
+	time->second = tss.second;
+	return obj;
     }
-    return ret;
+    if (load > 0) {
+	rb_raise(rb_eTypeError, "marshaled ODBC::Time format error");
+    }
+    return Qnil;
 }
 
-/*
- *----------------------------------------------------------------------
- *
- *      Fill parameter info array for statement.
- *
- *----------------------------------------------------------------------
- */
+static VALUE
+time_load(VALUE self, VALUE str)
+{
+    return time_load1(self, str, 1);
+}
 
-static PARAMINFO *
-make_paraminfo(SQLHSTMT hstmt, int nump, char **msgp)
+static VALUE
+time_init(int argc, VALUE *argv, VALUE self)
 {
-    int i;
-    PARAMINFO *paraminfo = NULL;
+    TIME_STRUCT *time;
+    VALUE h, m, s;
 
-    paraminfo = ALLOC_N(PARAMINFO, nump);
-    if (paraminfo == NULL) {
-	if (msgp != NULL) {
-	    *msgp = set_err("Out of memory", 0);
+    rb_scan_args(argc, argv, "03", &h, &m, &s);
+    if (rb_obj_is_kind_of(h, Ctime) == Qtrue) {
+	TIME_STRUCT *time2;
+
+	if (argc > 1) {
+	    rb_raise(rb_eArgError, "wrong # arguments");
 	}
-	return NULL;
+	Data_Get_Struct(self, TIME_STRUCT, time);
+	Data_Get_Struct(h, TIME_STRUCT, time2);
+	*time = *time2;
+	return self;
     }
-    for (i = 0; i < nump; i++) {
-	paraminfo[i].iotype = SQL_PARAM_INPUT;
-	paraminfo[i].outsize = 0;
-	paraminfo[i].outbuf = NULL;
-	paraminfo[i].rlen = SQL_NULL_DATA;
-	paraminfo[i].ctype = SQL_C_CHAR;
-#ifdef UNICODE
-	paraminfo[i].outtype = SQL_WCHAR;
-#else
-	paraminfo[i].outtype = SQL_WCHAR;
-#endif
-	paraminfo[i].coldef_max = 0;
-	if (!succeeded(SQL_NULL_HENV, SQL_NULL_HDBC, hstmt,
-		       SQLDescribeParam(hstmt, (SQLUSMALLINT) (i + 1),
-					&paraminfo[i].type,
-					&paraminfo[i].coldef,
-					&paraminfo[i].scale,
-					&paraminfo[i].nullable),
-		       NULL, "SQLDescribeParam")) {
-#ifdef UNICODE
-	    paraminfo[i].type = SQL_WVARCHAR;
+    if (rb_obj_is_kind_of(h, Ctimestamp) == Qtrue) {
+	TIMESTAMP_STRUCT *ts;
+
+	if (argc > 1) {
+	    rb_raise(rb_eArgError, "wrong # arguments");
+	}
+	Data_Get_Struct(self, TIME_STRUCT, time);
+	Data_Get_Struct(h, TIMESTAMP_STRUCT, ts);
+	time->hour   = ts->hour;
+	time->minute = ts->minute;
+	time->second = ts->second;
+	return self;
+    }
+    if (rb_obj_is_kind_of(h, rb_cTime) == Qtrue) {
+	if (argc > 1) {
+	    rb_raise(rb_eArgError, "wrong # arguments");
+	}
+	s = rb_funcall(h, IDsec, 0, NULL);
+	m = rb_funcall(h, IDmin, 0, NULL);
+	h = rb_funcall(h, IDhour, 0, NULL);
+    } else if ((argc == 1) && (rb_obj_is_kind_of(h, rb_cString) == Qtrue)) {
+	if (time_load1(self, h, 0) != Qnil) {
+	    return self;
+	}
+    }
+    Data_Get_Struct(self, TIME_STRUCT, time);
+    time->hour   = (h == Qnil) ? 0 : NUM2INT(h);
+    time->minute = (m == Qnil) ? 0 : NUM2INT(m);
+    time->second = (s == Qnil) ? 0 : NUM2INT(s);
+    return self;
+}
+
+static VALUE
+time_clone(VALUE self)
+{
+#ifdef HAVE_RB_DEFINE_ALLOC_FUNC
+    VALUE obj = rb_obj_alloc(CLASS_OF(self));
+    TIME_STRUCT *time1, *time2;
+
+    Data_Get_Struct(self, TIME_STRUCT, time1);
+    Data_Get_Struct(obj, TIME_STRUCT, time2);
+    *time2 = *time1;
+    return obj;
 #else
-	    paraminfo[i].type = SQL_VARCHAR;
+    return time_new(1, &self, CLASS_OF(self));
 #endif
-	    paraminfo[i].coldef = 0;
-	    paraminfo[i].scale = 0;
-	    paraminfo[i].nullable = SQL_NULLABLE_UNKNOWN;
-	    paraminfo[i].override = 0;
-	}
+}
+
+static VALUE
+time_to_s(VALUE self)
+{
+    TIME_STRUCT *time;
+    char buf[128];
+
+    Data_Get_Struct(self, TIME_STRUCT, time);
+    sprintf(buf, "%02d:%02d:%02d", time->hour, time->minute, time->second);
+    return rb_str_new2(buf);
+}
+
+static VALUE
+time_dump(VALUE self, VALUE depth)
+{
+    return time_to_s(self);
+}
+
+static VALUE
+time_inspect(VALUE self)
+{
+    VALUE s = rb_str_new2("#<ODBC::Time: ");
+
+    s = rb_str_append(s, time_to_s(self));
+    return rb_str_append(s, rb_str_new2(">"));
+}
+
+static VALUE
+time_hour(int argc, VALUE *argv, VALUE self)
+{
+    TIME_STRUCT *time;
+    VALUE v;
+
+    rb_scan_args(argc, argv, "01", &v);
+    Data_Get_Struct(self, TIME_STRUCT, time);
+    if (v == Qnil) {
+	return INT2NUM(time->hour);
     }
-    return paraminfo;
+    time->hour = NUM2INT(v);
+    return self;
 }
 
-static void
-retain_paraminfo_override(STMT *q, int nump, PARAMINFO *paraminfo)
+static VALUE
+time_min(int argc, VALUE *argv, VALUE self)
 {
-    if ((q->paraminfo != NULL) && (q->nump == nump)) {
-	int i;
+    TIME_STRUCT *time;
+    VALUE v;
 
-	for (i = 0; i < nump; i++) {
-	    paraminfo[i].iotype = q->paraminfo[i].iotype;
-	    paraminfo[i].rlen = q->paraminfo[i].rlen;
-	    paraminfo[i].ctype = q->paraminfo[i].ctype;
-	    paraminfo[i].outtype = q->paraminfo[i].outtype;
-	    paraminfo[i].outsize = q->paraminfo[i].outsize;
-	    if (q->paraminfo[i].outbuf != NULL) {
-		paraminfo[i].outbuf = q->paraminfo[i].outbuf;
-		q->paraminfo[i].outbuf = NULL;
+    rb_scan_args(argc, argv, "01", &v);
+    Data_Get_Struct(self, TIME_STRUCT, time);
+    if (v == Qnil) {
+	return INT2NUM(time->minute);
+    }
+    time->minute = NUM2INT(v);
+    return self;
+}
+
+static VALUE
+time_sec(int argc, VALUE *argv, VALUE self)
+{
+    TIME_STRUCT *time;
+    VALUE v;
+
+    rb_scan_args(argc, argv, "01", &v);
+    Data_Get_Struct(self, TIME_STRUCT, time);
+    if (v == Qnil) {
+	return INT2NUM(time->second);
+    }
+    time->second = NUM2INT(v);
+    return self;
+}
+
+static VALUE
+time_cmp(VALUE self, VALUE time)
+{
+    TIME_STRUCT *time1, *time2;
+
+    if (rb_obj_is_kind_of(time, Ctime) != Qtrue) {
+	rb_raise(rb_eTypeError, "need ODBC::Time as argument");
+    }
+    Data_Get_Struct(self, TIME_STRUCT, time1);
+    Data_Get_Struct(time, TIME_STRUCT, time2);
+    if (time1->hour < time2->hour) {
+	return INT2FIX(-1);
+    }
+    if (time1->hour == time2->hour) {
+	if (time1->minute < time2->minute) {
+	    return INT2FIX(-1);
+	}
+	if (time1->minute == time2->minute) {
+	    if (time1->second < time2->second) {
+		return INT2FIX(-1);
 	    }
-	    if (q->paraminfo[i].override) {
-		paraminfo[i].override = q->paraminfo[i].override;
-		paraminfo[i].type = q->paraminfo[i].type;
-		paraminfo[i].coldef = q->paraminfo[i].coldef;
-		paraminfo[i].scale = q->paraminfo[i].scale;
+	    if (time1->second == time2->second) {
+		return INT2FIX(0);
 	    }
 	}
     }
+    return INT2FIX(1);
 }
 
 /*
  *----------------------------------------------------------------------
  *
- *      Wrap SQLHSTMT into struct/VALUE.
+ *      TimeStamp methods.
  *
  *----------------------------------------------------------------------
  */
 
+#ifdef HAVE_RB_DEFINE_ALLOC_FUNC
 static VALUE
-wrap_stmt(VALUE dbc, DBC *p, SQLHSTMT hstmt, STMT **qp)
+timestamp_alloc(VALUE self)
 {
-    VALUE stmt = Qnil;
-    STMT *q;
-    int i;
+    TIMESTAMP_STRUCT *ts;
+    VALUE obj = Data_Make_Struct(self, TIMESTAMP_STRUCT, 0, xfree, ts);
 
-    stmt = Data_Make_Struct(Cstmt, STMT, mark_stmt, free_stmt, q);
-    tracemsg(2, fprintf(stderr, "ObjAlloc: STMT %p\n", q););
-    list_init(&q->link, offsetof(STMT, link));
-    q->self = stmt;
-    q->hstmt = hstmt;
-    q->dbc = dbc;
-    q->dbcp = NULL;
-    q->paraminfo = NULL;
-    q->coltypes = NULL;
-    q->colnames = q->dbufs = NULL;
-    q->colvals = NULL;
-    q->fetchc = 0;
-    q->upc = p->upc;
-    q->usef = 0;
-    rb_iv_set(q->self, "@_a", rb_ary_new());
-    rb_iv_set(q->self, "@_h", rb_hash_new());
-    for (i = 0; i < 4; i++) {
-	rb_iv_set(q->self, colnamebuf[i], rb_hash_new());
-    }
-    if (hstmt != SQL_NULL_HSTMT) {
-	link_stmt(q, p);
-    } else {
-	q->dbc = Qnil;
-    }
-    if (qp != NULL) {
-	*qp = q;
-    }
-    return stmt;
+    memset(ts, 0, sizeof (*ts));
+    return obj;
 }
+#else
+static VALUE
+timestamp_new(int argc, VALUE *argv, VALUE self)
+{
+    TIMESTAMP_STRUCT *ts;
+    VALUE obj = Data_Make_Struct(self, TIMESTAMP_STRUCT, 0, xfree, ts);
 
-/*
- *----------------------------------------------------------------------
- *
- *      Create statement with result.
- *
- *----------------------------------------------------------------------
- */
+    rb_obj_call_init(obj, argc, argv);
+    return obj;
+}
+#endif
 
 static VALUE
-make_result(VALUE dbc, SQLHSTMT hstmt, VALUE result, int mode)
+timestamp_load1(VALUE self, VALUE str, int load)
 {
-    DBC *p;
-    STMT *q;
-    SQLSMALLINT cols = 0, nump;
-    COLTYPE *coltypes = NULL;
-    PARAMINFO *paraminfo = NULL;
-    char *msg = NULL;
+    TIMESTAMP_STRUCT tss;
 
-    Data_Get_Struct(dbc, DBC, p);
-    if ((hstmt == SQL_NULL_HSTMT) ||
-	!succeeded(SQL_NULL_HENV, SQL_NULL_HDBC, hstmt,
-		   SQLNumParams(hstmt, &nump), NULL, "SQLNumParams")) {
-	nump = 0;
-    }
-    if (nump > 0) {
-	paraminfo = make_paraminfo(hstmt, nump, &msg);
-	if (paraminfo == NULL) {
-	    goto error;
+    if (scan_dtts(str, !load, !load, &tss)) {
+	TIMESTAMP_STRUCT *ts;
+	VALUE obj;
+
+	if (load) {
+	    obj = Data_Make_Struct(self, TIMESTAMP_STRUCT, 0, xfree, ts);
+	} else {
+	    obj = self;
+	    Data_Get_Struct(self, TIMESTAMP_STRUCT, ts);
 	}
+	*ts = tss;
+	return obj;
     }
-    if ((mode & MAKERES_PREPARE) ||
-	(hstmt == SQL_NULL_HSTMT) ||
-	(!succeeded(SQL_NULL_HENV, SQL_NULL_HDBC, hstmt,
-		   SQLNumResultCols(hstmt, &cols), NULL,
-		   "SQLNumResultCols"))) {
-	cols = 0;
+    if (load > 0) {
+	rb_raise(rb_eTypeError, "marshaled ODBC::TimeStamp format error");
     }
-    if (cols > 0) {
-	coltypes = make_coltypes(hstmt, cols, &msg);
-	if (coltypes == NULL) {
-	    goto error;
+    return Qnil;
+}
+
+static VALUE
+timestamp_load(VALUE self, VALUE str)
+{
+    return timestamp_load1(self, str, 1);
+}
+
+static VALUE
+timestamp_init(int argc, VALUE *argv, VALUE self)
+{
+    TIMESTAMP_STRUCT *ts;
+    VALUE d, m, y, hh, mm, ss, f;
+
+    rb_scan_args(argc, argv, "07", &y, &m, &d, &hh, &mm, &ss, &f);
+    if (rb_obj_is_kind_of(y, Ctimestamp) == Qtrue) {
+	TIMESTAMP_STRUCT *ts2;
+
+	if (argc > 1) {
+	    rb_raise(rb_eArgError, "wrong # arguments");
 	}
+	Data_Get_Struct(self, TIMESTAMP_STRUCT, ts);
+	Data_Get_Struct(y, TIMESTAMP_STRUCT, ts2);
+	*ts = *ts2;
+	return self;
     }
-    if (result == Qnil) {
-	result = wrap_stmt(dbc, p, hstmt, &q);
-    } else {
-	Data_Get_Struct(result, STMT, q);
-	retain_paraminfo_override(q, nump, paraminfo);
-	free_stmt_sub(q, 1);
-	if (q->dbc != dbc) {
-	    unlink_stmt(q);
-	    q->dbc = dbc;
-	    if (hstmt != SQL_NULL_HSTMT) {
-		link_stmt(q, p);
+    if (rb_obj_is_kind_of(y, Cdate) == Qtrue) {
+	DATE_STRUCT *date;
+
+	if (argc > 1) {
+	    if (argc > 2) {
+		rb_raise(rb_eArgError, "wrong # arguments");
+	    }
+	    if (rb_obj_is_kind_of(m, Ctime) == Qtrue) {
+		TIME_STRUCT *time;
+
+		Data_Get_Struct(self, TIMESTAMP_STRUCT, ts);
+		Data_Get_Struct(m, TIME_STRUCT, time);
+		ts->hour   = time->hour;
+		ts->minute = time->minute;
+		ts->second = time->second;
+	    } else {
+		rb_raise(rb_eArgError, "need ODBC::Time argument");
 	    }
 	}
-	q->hstmt = hstmt;
+	Data_Get_Struct(self, TIMESTAMP_STRUCT, ts);
+	Data_Get_Struct(y, DATE_STRUCT, date);
+	ts->year = date->year;
+	ts->year = date->year;
+	ts->year = date->year;
+	ts->fraction = 0;
+	return self;
     }
-    q->nump = nump;
-    q->paraminfo = paraminfo;
-    q->ncols = cols;
-    q->coltypes = coltypes;
-    if ((mode & MAKERES_BLOCK) && rb_block_given_p()) {
-	if (mode & MAKERES_NOCLOSE) {
-	    return rb_yield(result);
+    if (rb_obj_is_kind_of(y, rb_cTime) == Qtrue) {
+	if (argc > 1) {
+	    rb_raise(rb_eArgError, "wrong # arguments");
 	}
-	return rb_ensure(rb_yield, result, stmt_close, result);
-    }
-    return result;
-error:
-    callsql(SQL_NULL_HENV, SQL_NULL_HDBC, hstmt,
-	    SQLFreeStmt(hstmt, SQL_DROP), "SQLFreeStmt(SQL_DROP)");
-    if (result != Qnil) {
-	Data_Get_Struct(result, STMT, q);
-	if (q->hstmt == hstmt) {
-	    q->hstmt = SQL_NULL_HSTMT;
-	    unlink_stmt(q);
+	f  = rb_funcall(y, IDusec, 0, NULL);
+	ss = rb_funcall(y, IDsec, 0, NULL);
+	mm = rb_funcall(y, IDmin, 0, NULL);
+	hh = rb_funcall(y, IDhour, 0, NULL);
+	d  = rb_funcall(y, IDday, 0, NULL);
+	m  = rb_funcall(y, IDmonth, 0, NULL);
+	y  = rb_funcall(y, IDyear, 0, NULL);
+	f = INT2NUM(NUM2INT(f) * 1000);
+    } else if (rb_obj_is_kind_of(y, rb_cDate) == Qtrue) {
+	if (argc > 1) {
+	    rb_raise(rb_eArgError, "wrong # arguments");
+	}
+	f  = INT2FIX(0);
+	ss = INT2FIX(0);
+	mm = INT2FIX(0);
+	hh = INT2FIX(0);
+	d  = rb_funcall(y, IDmday, 0, NULL);
+	m  = rb_funcall(y, IDmonth, 0, NULL);
+	y  = rb_funcall(y, IDyear, 0, NULL);
+    } else if ((argc == 1) && (rb_obj_is_kind_of(y, rb_cString) == Qtrue)) {
+	if (timestamp_load1(self, y, 0) != Qnil) {
+	    return self;
 	}
     }
-    if (paraminfo != NULL) {
-	xfree(paraminfo);
-    }
-    if (coltypes != NULL) {
-	xfree(coltypes);
+    Data_Get_Struct(self, TIMESTAMP_STRUCT, ts);
+    ts->year     = (y  == Qnil) ? 0 : NUM2INT(y);
+    ts->month    = (m  == Qnil) ? 0 : NUM2INT(m);
+    ts->day      = (d  == Qnil) ? 0 : NUM2INT(d);
+    ts->hour     = (hh == Qnil) ? 0 : NUM2INT(hh);
+    ts->minute   = (mm == Qnil) ? 0 : NUM2INT(mm);
+    ts->second   = (ss == Qnil) ? 0 : NUM2INT(ss);
+    ts->fraction = (f  == Qnil) ? 0 : NUM2INT(f);
+    return self;
+}
+
+static VALUE
+timestamp_clone(VALUE self)
+{
+#ifdef HAVE_RB_DEFINE_ALLOC_FUNC
+    VALUE obj = rb_obj_alloc(CLASS_OF(self));
+    TIMESTAMP_STRUCT *ts1, *ts2;
+
+    Data_Get_Struct(self, TIMESTAMP_STRUCT, ts1);
+    Data_Get_Struct(obj, TIMESTAMP_STRUCT, ts2);
+    *ts2 = *ts1;
+    return obj;
+#else
+    return timestamp_new(1, &self, CLASS_OF(self));
+#endif
+}
+
+static VALUE
+timestamp_to_s(VALUE self)
+{
+    TIMESTAMP_STRUCT *ts;
+    char buf[256];
+
+    Data_Get_Struct(self, TIMESTAMP_STRUCT, ts);
+    sprintf(buf, "%04d-%02d-%02d %02d:%02d:%02d %u",
+	    ts->year, ts->month, ts->day,
+	    ts->hour, ts->minute, ts->second,
+	    (unsigned int) ts->fraction);
+    return rb_str_new2(buf);
+}
+
+static VALUE
+timestamp_dump(VALUE self, VALUE depth)
+{
+    return timestamp_to_s(self);
+}
+
+static VALUE
+timestamp_inspect(VALUE self)
+{
+    VALUE s = rb_str_new2("#<ODBC::TimeStamp: \"");
+
+    s = rb_str_append(s, timestamp_to_s(self));
+    return rb_str_append(s, rb_str_new2("\">"));
+}
+
+static VALUE
+timestamp_year(int argc, VALUE *argv, VALUE self)
+{
+    TIMESTAMP_STRUCT *ts;
+    VALUE v;
+
+    rb_scan_args(argc, argv, "01", &v);
+    Data_Get_Struct(self, TIMESTAMP_STRUCT, ts);
+    if (v == Qnil) {
+	return INT2NUM(ts->year);
     }
-    rb_raise(Cerror, "%s", msg);
-    return Qnil;
+    ts->year = NUM2INT(v);
+    return self;
 }
 
-static char *
-upcase_if(char *string, int upc)
+static VALUE
+timestamp_month(int argc, VALUE *argv, VALUE self)
 {
-    if (upc && (string != NULL)) {
-	unsigned char *p = (unsigned char *) string;
+    TIMESTAMP_STRUCT *ts;
+    VALUE v;
 
-	while (*p != '\0') {
-#ifdef UNICODE
-	    if ((*p < 0x80) && ISLOWER(*p))
-#else
-	    if (ISLOWER(*p))
-#endif
-	    {
-		*p = toupper(*p);
-	    }
-	    ++p;
-	}
+    rb_scan_args(argc, argv, "01", &v);
+    Data_Get_Struct(self, TIMESTAMP_STRUCT, ts);
+    if (v == Qnil) {
+	return INT2NUM(ts->month);
     }
-    return string;
+    ts->month = NUM2INT(v);
+    return self;
 }
 
-/*
- *----------------------------------------------------------------------
- *
- *      Constructor: make column from statement.
- *
- *----------------------------------------------------------------------
- */
-
 static VALUE
-make_column(SQLHSTMT hstmt, int i, int upc)
+timestamp_day(int argc, VALUE *argv, VALUE self)
 {
-    VALUE obj, v;
-    SQLUSMALLINT ic = i + 1;
-    SQLLEN iv = 0;
-#ifdef UNICODE
-    SQLWCHAR name[SQL_MAX_MESSAGE_LENGTH];
-#else
-    char name[SQL_MAX_MESSAGE_LENGTH];
-#endif
-    char *msg;
-    SQLSMALLINT name_len;
-
-    name[0] = 0;
-    if (!succeeded(SQL_NULL_HENV, SQL_NULL_HDBC, hstmt,
-		   SQLColAttributes(hstmt, ic, SQL_COLUMN_LABEL, name,
-				    (SQLSMALLINT) sizeof (name),
-				    &name_len, NULL),
-		   &msg, "SQLColAttributes(SQL_COLUMN_LABEL)")) {
-	rb_raise(Cerror, "%s", msg);
-    }
-    obj = rb_obj_alloc(Ccolumn);
-    if (name_len >= (SQLSMALLINT) sizeof (name)) {
-	name_len = sizeof (name) - 1;
-    }
-    if (name_len > 0) {
-	name[name_len / sizeof (name[0])] = 0;
-    }
-#ifdef UNICODE
-    if (upc) {
-	int len = uc_strlen(name);
-	char tmpbuf[1];
-	char *tmp = xmalloc(len);
-	VALUE v;
+    TIMESTAMP_STRUCT *ts;
+    VALUE v;
 
-	if (tmp == NULL) {
-	    tmp = tmpbuf;
-	    len = 0;
-	}
-	mkutf(tmp, name, len);
-	v = rb_tainted_str_new2(upcase_if(tmp, 1));
-#ifdef USE_RB_ENC
-	rb_enc_associate(v, rb_enc);
-#endif
-	rb_iv_set(obj, "@name", v);
-	if ((tmp != NULL) && (tmp != tmpbuf)) {
-	    xfree(tmp);
-	}
-    } else {
-	rb_iv_set(obj, "@name", uc_tainted_str_new2(name));
-    }
-#else
-    rb_iv_set(obj, "@name", rb_tainted_str_new2(upcase_if(name, upc)));
-#endif
-    v = Qnil;
-    name[0] = 0;
-    if (succeeded(SQL_NULL_HENV, SQL_NULL_HDBC, hstmt,
-		  SQLColAttributes(hstmt, ic, SQL_COLUMN_TABLE_NAME, name,
-				   (SQLSMALLINT) sizeof (name),
-				   &name_len, NULL),
-		  NULL, "SQLColAttributes(SQL_COLUMN_TABLE_NAME)")) {
-	if (name_len > (SQLSMALLINT) sizeof (name)) {
-	    name_len = sizeof (name) - 1;
-	}
-	if (name_len > 0) {
-	    name[name_len / sizeof (name[0])] = 0;
-	}
-#ifdef UNICODE
-	v = uc_tainted_str_new2(name);
-#else
-	v = rb_tainted_str_new2(name);
-#endif
-    }
-    rb_iv_set(obj, "@table", v);
-    if (succeeded(SQL_NULL_HENV, SQL_NULL_HDBC, hstmt,
-		  SQLColAttributes(hstmt, ic, SQL_COLUMN_TYPE, NULL,
-				   0, NULL, &iv),
-		  NULL, "SQLColAttributes(SQL_COLUMN_TYPE)")) {
-	v = INT2NUM(iv);
-    } else {
-	v = INT2NUM(SQL_UNKNOWN_TYPE);
-    }
-    rb_iv_set(obj, "@type", v);
-    v = Qnil;
-    if (succeeded(SQL_NULL_HENV, SQL_NULL_HDBC, hstmt,
-		  SQLColAttributes(hstmt, ic,
-#if (ODBCVER >= 0x0300)
-				   SQL_DESC_LENGTH,
-#else
-				   SQL_COLUMN_LENGTH,
-#endif
-				   NULL, 0, NULL, &iv),
-		  NULL,
-#if (ODBCVER >= 0x0300)
-		  "SQLColAttributes(SQL_DESC_LENGTH)"
-#else
-		  "SQLColAttributes(SQL_COLUMN_LENGTH)"
-#endif
-	)) {
-	v = INT2NUM(iv);
-    } else if (succeeded(SQL_NULL_HENV, SQL_NULL_HDBC, hstmt,
-			 SQLColAttributes(hstmt, ic,
-					  SQL_COLUMN_DISPLAY_SIZE, NULL,
-					  0, NULL, &iv),
-			 NULL, "SQLColAttributes(SQL_COLUMN_DISPLAY_SIZE)")) {
-	v = INT2NUM(iv);
-    }
-    rb_iv_set(obj, "@length", v);
-    v = Qnil;
-    if (succeeded(SQL_NULL_HENV, SQL_NULL_HDBC, hstmt,
-		  SQLColAttributes(hstmt, ic, SQL_COLUMN_NULLABLE, NULL,
-				   0, NULL, &iv),
-		  NULL, "SQLColAttributes(SQL_COLUMN_NULLABLE)")) {
-	v = (iv == SQL_NO_NULLS) ? Qfalse : Qtrue;
-    }
-    rb_iv_set(obj, "@nullable", v);
-    v = Qnil;
-    if (succeeded(SQL_NULL_HENV, SQL_NULL_HDBC, hstmt,
-		  SQLColAttributes(hstmt, ic, SQL_COLUMN_SCALE, NULL,
-				   0, NULL, &iv),
-		  NULL, "SQLColAttributes(SQL_COLUMN_SCALE)")) {
-	v = INT2NUM(iv);
-    }
-    rb_iv_set(obj, "@scale", v);
-    v = Qnil;
-    if (succeeded(SQL_NULL_HENV, SQL_NULL_HDBC, hstmt,
-		  SQLColAttributes(hstmt, ic, SQL_COLUMN_PRECISION, NULL,
-				   0, NULL, &iv),
-		  NULL, "SQLColAttributes(SQL_COLUMN_PRECISION)")) {
-	v = INT2NUM(iv);
-    }
-    rb_iv_set(obj, "@precision", v);
-    v = Qnil;
-    if (succeeded(SQL_NULL_HENV, SQL_NULL_HDBC, hstmt,
-		  SQLColAttributes(hstmt, ic, SQL_COLUMN_SEARCHABLE, NULL,
-				   0, NULL, &iv),
-		  NULL, "SQLColAttributes(SQL_COLUMN_SEARCHABLE)")) {
-	v = (iv == SQL_NO_NULLS) ? Qfalse : Qtrue;
-    }
-    rb_iv_set(obj, "@searchable", v);
-    v = Qnil;
-    if (succeeded(SQL_NULL_HENV, SQL_NULL_HDBC, hstmt,
-		  SQLColAttributes(hstmt, ic, SQL_COLUMN_UNSIGNED, NULL,
-				   0, NULL, &iv),
-		  NULL, "SQLColAttributes(SQL_COLUMN_UNSIGNED)")) {
-	v = (iv == SQL_NO_NULLS) ? Qfalse : Qtrue;
-    }
-    rb_iv_set(obj, "@unsigned", v);
-    v = Qnil;
-#ifdef SQL_COLUMN_AUTO_INCREMENT
-    if (succeeded(SQL_NULL_HENV, SQL_NULL_HDBC, hstmt,
-		  SQLColAttributes(hstmt, ic, SQL_COLUMN_AUTO_INCREMENT, NULL,
-				   0, NULL, &iv),
-		  NULL, "SQLColAttributes(SQL_COLUMN_AUTO_INCREMENT)")) {
-	v = (iv == SQL_FALSE) ? Qfalse : Qtrue;
+    rb_scan_args(argc, argv, "01", &v);
+    Data_Get_Struct(self, TIMESTAMP_STRUCT, ts);
+    if (v == Qnil) {
+	return INT2NUM(ts->day);
     }
-#endif
-    rb_iv_set(obj, "@autoincrement", v);
-    return obj;
+    ts->day = NUM2INT(v);
+    return self;
 }
 
-/*
- *----------------------------------------------------------------------
- *
- *      Constructor: make parameter from statement.
- *
- *----------------------------------------------------------------------
- */
-
 static VALUE
-make_param(STMT *q, int i)
+timestamp_hour(int argc, VALUE *argv, VALUE self)
 {
-    VALUE obj;
-    int v;
-
-    obj = rb_obj_alloc(Cparam);
-#ifdef UNICODE
-    v = q->paraminfo ? q->paraminfo[i].type : SQL_VARCHAR;
-#else
-    v = q->paraminfo ? q->paraminfo[i].type : SQL_WVARCHAR;
-#endif
-    rb_iv_set(obj, "@type", INT2NUM(v));
-    v = q->paraminfo ? q->paraminfo[i].coldef : 0;
-    rb_iv_set(obj, "@precision", INT2NUM(v));
-    v = q->paraminfo ? q->paraminfo[i].scale : 0;
-    rb_iv_set(obj, "@scale", INT2NUM(v));
-    v = q->paraminfo ? q->paraminfo[i].nullable : SQL_NULLABLE_UNKNOWN;
-    rb_iv_set(obj, "@nullable", INT2NUM(v));
-    v = q->paraminfo ? q->paraminfo[i].iotype : SQL_PARAM_INPUT;
-    rb_iv_set(obj, "@iotype", INT2NUM(v));
-    v = q->paraminfo ? q->paraminfo[i].outsize : 0;
-    rb_iv_set(obj, "@output_size", INT2NUM(v));
-#ifdef UNICODE
-    v = q->paraminfo ? q->paraminfo[i].outtype : SQL_WCHAR;
-#else
-    v = q->paraminfo ? q->paraminfo[i].outtype : SQL_CHAR;
-#endif
-    rb_iv_set(obj, "@output_type", INT2NUM(v));
-    return obj;
-}
+    TIMESTAMP_STRUCT *ts;
+    VALUE v;
 
-/*
- *----------------------------------------------------------------------
- *
- *      Query tables/columns/keys/indexes/types of data source.
- *
- *----------------------------------------------------------------------
- */
+    rb_scan_args(argc, argv, "01", &v);
+    Data_Get_Struct(self, TIMESTAMP_STRUCT, ts);
+    if (v == Qnil) {
+	return INT2NUM(ts->hour);
+    }
+    ts->hour = NUM2INT(v);
+    return self;
+}
 
 static VALUE
-dbc_info(int argc, VALUE *argv, VALUE self, int mode)
+timestamp_min(int argc, VALUE *argv, VALUE self)
 {
-    DBC *p = get_dbc(self);
-    VALUE which = Qnil, which2 = Qnil, which3 = Qnil;
-#ifdef UNICODE
-    SQLWCHAR *swhich = NULL, *swhich2 = NULL;
-#else
-    SQLCHAR *swhich = NULL, *swhich2 = NULL;
-#endif
-    char *msg;
-    const char *argspec = NULL;
-    SQLHSTMT hstmt;
-    int needstr = 1, itype = SQL_ALL_TYPES;
-    int iid = SQL_BEST_ROWID, iscope = SQL_SCOPE_CURROW;
+    TIMESTAMP_STRUCT *ts;
+    VALUE v;
 
-    if (p->hdbc == SQL_NULL_HDBC) {
-	rb_raise(Cerror, "%s", set_err("No connection", 0));
-    }
-    switch (mode) {
-    case INFO_TYPES:
-	needstr = 0;
-	/* FALL THRU */
-    case INFO_TABLES:
-    case INFO_PRIMKEYS:
-    case INFO_TPRIV:
-    case INFO_PROCS:
-	argspec = "01";
-	break;
-    case INFO_COLUMNS:
-	argspec = "02";
-	break;
-    case INFO_INDEXES:
-    case INFO_FORKEYS:
-    case INFO_PROCCOLS:
-	argspec = "11";
-	break;
-    case INFO_SPECCOLS:
-	argspec = "12";
-	break;
-    default:
-	rb_raise(Cerror, "%s", set_err("Invalid info mode", 0));
-	break;
-    }
-    rb_scan_args(argc, argv, argspec, &which, &which2, &which3);
-    if (which != Qnil) {
-	if (needstr) {
-	    Check_Type(which, T_STRING);
-#ifdef UNICODE
-	    swhich = (SQLWCHAR *) which;
-#else
-	    swhich = (SQLCHAR *) STR2CSTR(which);
-#endif
-	} else {
-	    itype = NUM2INT(which);
-	}
-    }
-    if (which2 != Qnil) {
-	if (mode == INFO_SPECCOLS) {
-	    iid = NUM2INT(which2);
-	} else if (mode != INFO_INDEXES) {
-	    Check_Type(which2, T_STRING);
-#ifdef UNICODE
-	    swhich2 = (SQLWCHAR *) which2;
-#else
-	    swhich2 = (SQLCHAR *) STR2CSTR(which2);
-#endif
-	}
+    rb_scan_args(argc, argv, "01", &v);
+    Data_Get_Struct(self, TIMESTAMP_STRUCT, ts);
+    if (v == Qnil) {
+	return INT2NUM(ts->minute);
     }
-#ifdef UNICODE
-    if (swhich != NULL) {
-	VALUE val = (VALUE) swhich;
+    ts->minute = NUM2INT(v);
+    return self;
+}
 
-#ifdef USE_RB_ENC
-	val = rb_funcall(val, IDencode, 1, rb_encv);
-#endif
-	swhich = uc_from_utf((unsigned char *) STR2CSTR(val), -1);
-	if (swhich == NULL) {
-	    rb_raise(Cerror, "%s", set_err("Out of memory", 0));
-	}
+static VALUE
+timestamp_sec(int argc, VALUE *argv, VALUE self)
+{
+    TIMESTAMP_STRUCT *ts;
+    VALUE v;
+
+    rb_scan_args(argc, argv, "01", &v);
+    Data_Get_Struct(self, TIMESTAMP_STRUCT, ts);
+    if (v == Qnil) {
+	return INT2NUM(ts->second);
     }
-    if (swhich2 != NULL) {
-	VALUE val = (VALUE) swhich2;
+    ts->second = NUM2INT(v);
+    return self;
+}
 
-#ifdef USE_RB_ENC
-	val = rb_funcall(val, IDencode, 1, rb_encv);
-#endif
-	swhich2 = uc_from_utf((unsigned char *) STR2CSTR(val), -1);
-	if (swhich2 == NULL) {
-	    uc_free(swhich);
-	    rb_raise(Cerror, "%s", set_err("Out of memory", 0));
-	}
+static VALUE
+timestamp_fraction(int argc, VALUE *argv, VALUE self)
+{
+    TIMESTAMP_STRUCT *ts;
+    VALUE v;
+
+    rb_scan_args(argc, argv, "01", &v);
+    Data_Get_Struct(self, TIMESTAMP_STRUCT, ts);
+    if (v == Qnil) {
+	return INT2NUM(ts->fraction);
     }
-#endif
-    if (which3 != Qnil) {
-	iscope = NUM2INT(which3);
+    ts->fraction = NUM2INT(v);
+    return self;
+}
+
+static VALUE
+timestamp_cmp(VALUE self, VALUE timestamp)
+{
+    TIMESTAMP_STRUCT *ts1, *ts2;
+
+    if (rb_obj_is_kind_of(timestamp, Ctimestamp) != Qtrue) {
+	rb_raise(rb_eTypeError, "need ODBC::TimeStamp as argument");
     }
-    if (!succeeded(SQL_NULL_HENV, p->hdbc, SQL_NULL_HSTMT,
-		   SQLAllocStmt(p->hdbc, &hstmt), &msg, "SQLAllocStmt")) {
-#ifdef UNICODE
-	uc_free(swhich);
-	uc_free(swhich2);
-#endif
-	rb_raise(Cerror, "%s", msg);
+    Data_Get_Struct(self, TIMESTAMP_STRUCT, ts1);
+    Data_Get_Struct(timestamp, TIMESTAMP_STRUCT, ts2);
+    if (ts1->year < ts2->year) {
+	return INT2FIX(-1);
     }
-    switch (mode) {
-    case INFO_TABLES:
-	if (!succeeded(SQL_NULL_HENV, SQL_NULL_HDBC, hstmt,
-		       SQLTables(hstmt, NULL, 0, NULL, 0,
-				 swhich, (swhich == NULL) ? 0 : SQL_NTS,
-				 NULL, 0),
-		       &msg, "SQLTables")) {
-	    goto error;
-	}
-	break;
-    case INFO_COLUMNS:
-	if (!succeeded(SQL_NULL_HENV, SQL_NULL_HDBC, hstmt,
-		       SQLColumns(hstmt, NULL, 0, NULL, 0,
-				  swhich, (swhich == NULL) ? 0 : SQL_NTS,
-				  swhich2, (swhich2 == NULL) ? 0 : SQL_NTS),
-		       &msg, "SQLColumns")) {
-	    goto error;
-	}
-	break;
-    case INFO_PRIMKEYS:
-	if (!succeeded(SQL_NULL_HENV, SQL_NULL_HDBC, hstmt,
-		       SQLPrimaryKeys(hstmt, NULL, 0, NULL, 0,
-				      swhich, (swhich == NULL) ? 0 : SQL_NTS),
-		       &msg, "SQLPrimaryKeys")) {
-	    goto error;
-	}
-	break;
-    case INFO_INDEXES:
-	if (!succeeded(SQL_NULL_HENV, SQL_NULL_HDBC, hstmt,
-		       SQLStatistics(hstmt, NULL, 0, NULL, 0,
-				     swhich, (swhich == NULL) ? 0 : SQL_NTS,
-				     (SQLUSMALLINT) (RTEST(which2) ?
-				      SQL_INDEX_UNIQUE : SQL_INDEX_ALL),
-				     SQL_ENSURE),
-		       &msg, "SQLStatistics")) {
-	    goto error;
-	}
-	break;
-    case INFO_TYPES:
-	if (!succeeded(SQL_NULL_HENV, SQL_NULL_HDBC, hstmt,
-		       SQLGetTypeInfo(hstmt, (SQLSMALLINT) itype),
-		       &msg, "SQLGetTypeInfo")) {
-	    goto error;
-	}
-	break;
-    case INFO_FORKEYS:
-	if (!succeeded(SQL_NULL_HENV, SQL_NULL_HDBC, hstmt,
-		       SQLForeignKeys(hstmt, NULL, 0, NULL, 0,
-				      swhich, (swhich == NULL) ? 0 : SQL_NTS,
-				      NULL, 0, NULL, 0,
-				      swhich2, (swhich2 == NULL) ? 0 : SQL_NTS),
-		       &msg, "SQLForeignKeys")) {
-	    goto error;
-	}
-	break;
-    case INFO_TPRIV:
-	if (!succeeded(SQL_NULL_HENV, SQL_NULL_HDBC, hstmt,
-		       SQLTablePrivileges(hstmt, NULL, 0, NULL, 0, swhich,
-					  (swhich == NULL) ? 0 : SQL_NTS),
-		       &msg, "SQLTablePrivileges")) {
-	    goto error;
-	}
-	break;
-    case INFO_PROCS:
-	if (!succeeded(SQL_NULL_HENV, SQL_NULL_HDBC, hstmt,
-		       SQLProcedures(hstmt, NULL, 0, NULL, 0,
-				     swhich, (swhich == NULL) ? 0 : SQL_NTS),
-		       &msg, "SQLProcedures")) {
-	    goto error;
-	}
-	break;
-    case INFO_PROCCOLS:
-	if (!succeeded(SQL_NULL_HENV, SQL_NULL_HDBC, hstmt,
-		       SQLProcedureColumns(hstmt, NULL, 0, NULL, 0,
-					   swhich,
-					   (swhich == NULL) ? 0 : SQL_NTS,
-					   swhich2,
-					   (swhich2 == NULL) ? 0 : SQL_NTS),
-		       &msg, "SQLProcedureColumns")) {
-	    goto error;
+    if (ts1->year == ts2->year) {
+	if (ts1->month < ts2->month) {
+	    return INT2FIX(-1);
 	}
-	break;
-    case INFO_SPECCOLS:
-	if (!succeeded(SQL_NULL_HENV, SQL_NULL_HDBC, hstmt,
-		       SQLSpecialColumns(hstmt, (SQLUSMALLINT) iid,
-					 NULL, 0, NULL, 0,
-					 swhich,
-					 (swhich == NULL) ? 0 : SQL_NTS,
-					 (SQLUSMALLINT) iscope,
-					 SQL_NULLABLE),
-		       &msg, "SQLSpecialColumns")) {
-	    goto error;
+	if (ts1->month == ts2->month) {
+	    if (ts1->day < ts2->day) {
+		return INT2FIX(-1);
+	    }
+	    if (ts1->day == ts2->day) {
+		if (ts1->hour < ts2->hour) {
+		    return INT2FIX(-1);
+		}
+		if (ts1->hour == ts2->hour) {
+		    if (ts1->minute < ts2->minute) {
+			return INT2FIX(-1);
+		    }
+		    if (ts1->minute == ts2->minute) {
+			if (ts1->second < ts2->second) {
+			    return INT2FIX(-1);
+			}
+			if (ts1->second == ts2->second) {
+			    if (ts1->fraction < ts2->fraction) {
+				return INT2FIX(-1);
+			    }
+			    if (ts1->fraction == ts2->fraction) {
+				return INT2FIX(0);
+			    }
+			}
+		    }
+		}
+	    }
 	}
-	break;
     }
-#ifdef UNICODE
-    uc_free(swhich);
-    uc_free(swhich2);
-#endif
-    return make_result(self, hstmt, Qnil, MAKERES_BLOCK);
-error:
-#ifdef UNICODE
-    uc_free(swhich);
-    uc_free(swhich2);
-#endif
-    callsql(SQL_NULL_HENV, SQL_NULL_HDBC, hstmt,
-	    SQLFreeStmt(hstmt, SQL_DROP), "SQLFreeStmt(SQL_DROP)");
-    rb_raise(Cerror, "%s", msg);
-    return Qnil;
+    return INT2FIX(1);
 }
 
-static VALUE
-dbc_tables(int argc, VALUE *argv, VALUE self)
-{
-    return dbc_info(argc, argv, self, INFO_TABLES);
-}
+/*
+ *----------------------------------------------------------------------
+ *
+ *      Statement methods.
+ *
+ *----------------------------------------------------------------------
+ */
 
 static VALUE
-dbc_columns(int argc, VALUE *argv, VALUE self)
+stmt_drop(VALUE self)
 {
-    return dbc_info(argc, argv, self, INFO_COLUMNS);
-}
+    STMT *q;
 
-static VALUE
-dbc_primkeys(int argc, VALUE *argv, VALUE self)
-{
-    return dbc_info(argc, argv, self, INFO_PRIMKEYS);
+    ODBC_Get_Struct(self, STMT, stmt_type, q);
+    stmt_check_busy(q);
+    diag_drain(q);
+    if (scache_put(q)) {
+	return self;
+    }
+    if (q->hstmt != SQL_NULL_HSTMT) {
+	callsql(SQL_NULL_HENV, SQL_NULL_HDBC, q->hstmt,
+		SQLFreeStmt(q->hstmt, SQL_DROP), "SQLFreeStmt(SQL_DROP)");
+	q->hstmt = SQL_NULL_HSTMT;
+	unlink_stmt(q);
+    }
+    q->async = 0;
+    free_stmt_sub(q, 1);
+    return self;
 }
 
 static VALUE
-dbc_indexes(int argc, VALUE *argv, VALUE self)
+stmt_close(VALUE self)
 {
-    return dbc_info(argc, argv, self, INFO_INDEXES);
-}
+    STMT *q;
 
-static VALUE
-dbc_types(int argc, VALUE *argv, VALUE self)
-{
-    return dbc_info(argc, argv, self, INFO_TYPES);
+    ODBC_Get_Struct(self, STMT, stmt_type, q);
+    stmt_check_busy(q);
+    diag_drain(q);
+    if (q->hstmt != SQL_NULL_HSTMT) {
+	callsql(SQL_NULL_HENV, SQL_NULL_HDBC, q->hstmt,
+		SQLFreeStmt(q->hstmt, SQL_CLOSE), "SQLFreeStmt(SQL_CLOSE)");
+    }
+    /* cached statements keep their parameter info */
+    free_stmt_sub(q, q->sckey == Qnil);
+    return self;
 }
 
 static VALUE
-dbc_forkeys(int argc, VALUE *argv, VALUE self)
+stmt_cancel(VALUE self)
 {
-    return dbc_info(argc, argv, self, INFO_FORKEYS);
+    STMT *q;
+    char *msg;
+
+    ODBC_Get_Struct(self, STMT, stmt_type, q);
+    if (q->hstmt != SQL_NULL_HSTMT) {
+	if (!succeeded(SQL_NULL_HENV, SQL_NULL_HDBC, q->hstmt,
+		       SQLCancel(q->hstmt), &msg, "SQLCancel")) {
+	    rb_raise(Cerror, "%s", msg);
+	}
+    }
+    return self;
 }
 
-static VALUE
-dbc_tpriv(int argc, VALUE *argv, VALUE self)
+static void
+check_ncols(STMT *q)
 {
-    return dbc_info(argc, argv, self, INFO_TPRIV);
+    if ((q->hstmt != SQL_NULL_HSTMT) && (q->ncols <= 0) &&
+	(q->coltypes == NULL)) {
+	COLTYPE *coltypes = NULL;
+	SQLSMALLINT cols = 0;
+
+	if (succeeded(SQL_NULL_HENV, SQL_NULL_HDBC, q->hstmt,
+		      SQLNumResultCols(q->hstmt, &cols), NULL,
+		      "SQLNumResultCols")
+	    && (cols > 0)) {
+	    int bigdec = (q->dbcp != NULL) ? q->dbcp->bigdec : 0;
+
+	    coltypes = make_coltypes(q->hstmt, cols, NULL, bigdec);
+	    if (coltypes != NULL) {
+		q->ncols = cols;
+		q->coltypes = coltypes;
+		q->bigdec = bigdec;
+	    }
+	}
+    }
 }
 
 static VALUE
-dbc_procs(int argc, VALUE *argv, VALUE self)
+stmt_ncols(VALUE self)
 {
-    return dbc_info(argc, argv, self, INFO_PROCS);
+    STMT *q;
+
+    ODBC_Get_Struct(self, STMT, stmt_type, q);
+    check_ncols(q);
+    return INT2FIX(q->ncols);
 }
 
 static VALUE
-dbc_proccols(int argc, VALUE *argv, VALUE self)
+stmt_nrows(VALUE self)
 {
-    return dbc_info(argc, argv, self, INFO_PROCCOLS);
+    STMT *q;
+    SQLLEN rows = -1;
+    char *msg;
+
+    ODBC_Get_Struct(self, STMT, stmt_type, q);
+    if ((q->hstmt != SQL_NULL_HSTMT) &&
+	(!succeeded(SQL_NULL_HENV, SQL_NULL_HDBC, q->hstmt,
+		    SQLRowCount(q->hstmt, &rows), &msg, "SQLRowCount"))) {
+	rb_raise(Cerror, "%s", msg);
+    }
+    return INT2NUM(rows);
 }
 
 static VALUE
-dbc_speccols(int argc, VALUE *argv, VALUE self)
+stmt_nparams(VALUE self)
 {
-    return dbc_info(argc, argv, self, INFO_SPECCOLS);
-}
+    STMT *q;
 
-/*
- *----------------------------------------------------------------------
- *
- *      Transaction stuff.
- *
- *----------------------------------------------------------------------
- */
+    ODBC_Get_Struct(self, STMT, stmt_type, q);
+    return INT2FIX(q->nump);
+}
 
-static VALUE
-dbc_trans(VALUE self, int what)
+static int
+param_num_check(STMT *q, VALUE pnum, int mkparaminfo, int needout)
 {
-    ENV *e;
-    SQLHDBC dbc = SQL_NULL_HDBC;
-    char *msg;
+    int vnum;
 
-    e = get_env(self);
-    if (rb_obj_is_kind_of(self, Cdbc) == Qtrue) {
-	DBC *d;
+    Check_Type(pnum, T_FIXNUM);
+    vnum = NUM2INT(pnum);
+    if (mkparaminfo && (q->paraminfo == NULL)) {
+	char *msg = NULL;
+	SQLSMALLINT nump = 0;
 
-	d = get_dbc(self);
-	dbc = d->hdbc;
+	if (!succeeded(SQL_NULL_HENV, SQL_NULL_HDBC, q->hstmt,
+		       SQLNumParams(q->hstmt, &nump), NULL, "SQLNumParams")) {
+	    nump = 0;
+	}
+	if (nump > 0) {
+	    PARAMINFO *paraminfo = make_paraminfo(q->hstmt, nump, &msg);
+
+	    if (paraminfo == NULL) {
+		rb_raise(Cerror, "%s", msg);
+	    }
+	    q->paraminfo = paraminfo;
+	    if (q->paraminfo != NULL) {
+		q->nump = nump;
+	    }
+	}
     }
-    if (!succeeded(e->henv, dbc, SQL_NULL_HSTMT,
-#if (ODBCVER >= 0x0300)
-		   SQLEndTran((SQLSMALLINT)
-			      ((dbc == SQL_NULL_HDBC) ? SQL_HANDLE_ENV :
-							SQL_HANDLE_DBC),
-			      (dbc == SQL_NULL_HDBC) ? e->henv : dbc,
-			      (SQLSMALLINT) what),
-		   &msg, "SQLEndTran"
-#else
-		   SQLTransact(e->henv, dbc, (SQLUSMALLINT) what),
-		   &msg, "SQLTransact"
-#endif
-       )) {
-	rb_raise(Cerror, "%s", msg);
+    if ((q->paraminfo == NULL) || (vnum < 0) || (vnum >= q->nump)) {
+	rb_raise(rb_eArgError, "parameter number out of bounds");
     }
-    return Qnil;
+    if (needout) {
+	if ((q->paraminfo[vnum].iotype != SQL_PARAM_OUTPUT) &&
+	    (q->paraminfo[vnum].iotype != SQL_PARAM_INPUT_OUTPUT)) {
+	    rb_raise(Cerror, "not an output parameter");
+	}
+    }
+    return vnum;
 }
 
 static VALUE
-dbc_commit(VALUE self)
+stmt_param_type(int argc, VALUE *argv, VALUE self)
 {
-    return dbc_trans(self, SQL_COMMIT);
+    VALUE pnum, ptype, pcoldef, pscale;
+    int vnum;
+    STMT *q;
+
+    rb_scan_args(argc, argv, "13", &pnum, &ptype, &pcoldef, &pscale);
+    ODBC_Get_Struct(self, STMT, stmt_type, q);
+    vnum = param_num_check(q, pnum, 1, 0);
+    if (argc > 1) {
+	int vtype, vcoldef, vscale;
+
+	Check_Type(ptype, T_FIXNUM);
+	vtype = NUM2INT(ptype);
+	if (argc > 2) {
+	    Check_Type(pcoldef, T_FIXNUM);
+	    vcoldef = NUM2INT(pcoldef);
+	    if (argc > 3) {
+		Check_Type(pscale, T_FIXNUM);
+		vscale = NUM2INT(pscale);
+		q->paraminfo[vnum].scale = vscale;
+	    }
+	    q->paraminfo[vnum].coldef = vcoldef;
+	}
+	q->paraminfo[vnum].type = vtype;
+	q->paraminfo[vnum].override = 1;
+	return Qnil;
+    }
+    return INT2NUM(q->paraminfo[vnum].type);
 }
 
 static VALUE
-dbc_rollback(VALUE self)
+stmt_param_iotype(int argc, VALUE *argv, VALUE self)
 {
-    return dbc_trans(self, SQL_ROLLBACK);
+    VALUE pnum, piotype;
+    int vnum, viotype;
+    STMT *q;
+
+    rb_scan_args(argc, argv, "11", &pnum, &piotype);
+    ODBC_Get_Struct(self, STMT, stmt_type, q);
+    vnum = param_num_check(q, pnum, 1, 0);
+    if (argc > 1) {
+	Check_Type(piotype, T_FIXNUM);
+	viotype = NUM2INT(piotype);
+	switch (viotype) {
+	case SQL_PARAM_INPUT:
+	case SQL_PARAM_INPUT_OUTPUT:
+	case SQL_PARAM_OUTPUT:
+	    q->paraminfo[vnum].iotype = viotype;
+	    break;
+	}
+    }
+    return INT2NUM(q->paraminfo[vnum].iotype);
 }
 
-static VALUE
-dbc_nop(VALUE self)
-{
-    return Qnil;
-}
+/*
+ *----------------------------------------------------------------------
+ *
+ *      Conversion of DATE/TIME/TIMESTAMP_STRUCT to Ruby Date/Time.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static const int mdays[12] = {
+    31, 29, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31
+};
 
-static VALUE
-dbc_transbody(VALUE self)
+static int
+civil_valid(int y, int m, int d)
 {
-    return rb_yield(rb_ary_entry(self, 0));
+    if ((y < 1) || (y > 9999) || (m < 1) || (m > 12) || (d < 1) ||
+	(d > mdays[m - 1])) {
+	return 0;
+    }
+    if ((m == 2) && (d == 29)) {
+	return ((y % 4) == 0) && (((y % 100) != 0) || ((y % 400) == 0));
+    }
+    return 1;
 }
 
-static VALUE
-dbc_transfail(VALUE self, VALUE err)
+/* Days since 1970-01-01 in the proleptic Gregorian calendar. */
+
+static time_t
+civil_days(int y, int m, int d)
 {
-    rb_ary_store(self, 1, err);
-    dbc_rollback(rb_ary_entry(self, 0));
-    return Qundef;
+    time_t yy = (m <= 2) ? (y - 1) : y;
+    time_t era = yy / 400, yoe, doy;
+
+    yoe = yy - era * 400;
+    doy = (153 * ((m > 2) ? (m - 3) : (m + 9)) + 2) / 5 + d - 1;
+    return era * 146097 + yoe * 365 + yoe / 4 - yoe / 100 + doy - 719468;
 }
 
-static VALUE
-dbc_transaction(VALUE self)
+static struct tm *
+local_tm(time_t t, struct tm *tm)
 {
-    VALUE a, ret;
+#ifdef HAVE_LOCALTIME_R
+    return localtime_r(&t, tm);
+#else
+    struct tm *tmp = localtime(&t);
 
-    if (!rb_block_given_p()) {
-	rb_raise(rb_eArgError, "block required");
-    }
-    rb_ensure(dbc_commit, self, dbc_nop, self);
-    a = rb_ary_new2(2);
-    rb_ary_store(a, 0, self);
-    rb_ary_store(a, 1, Qnil);
-    if ((ret = rb_rescue2(dbc_transbody, a, dbc_transfail, a,
-			  rb_eException, (VALUE) 0)) != Qundef) {
-	dbc_commit(self);
-	return ret;
+    if (tmp != NULL) {
+	*tm = *tmp;
+	tmp = tm;
     }
-    ret = rb_ary_entry(a, 1);
-    rb_exc_raise(rb_exc_new3(rb_obj_class(ret),
-			     rb_funcall(ret, IDto_s, 0, 0)));
-    return Qnil;
+    return tmp;
+#endif
 }
 
+#ifdef HAVE_RB_TIME_NANO_NEW
 /*
- *----------------------------------------------------------------------
- *
- *      Environment attribute handling.
- *
- *----------------------------------------------------------------------
+ * UTC offset of the local time given as seconds since the epoch as if
+ * it were UTC. mktime() is consulted once per hour of local time, the
+ * result is cached in the connection.
  */
 
-#if (ODBCVER >= 0x0300)
-static VALUE
-do_attr(int argc, VALUE *argv, VALUE self, int op)
-{
-    SQLHENV henv = SQL_NULL_HENV;
-    VALUE val;
-    SQLLEN v = 0;
-    SQLPOINTER vp;
-    SQLINTEGER l;
-    char *msg;
-
-    if (self != Modbc) {
-	henv = get_env(self)->henv;
-    }
-    rb_scan_args(argc, argv, "01", &val);
-    if (val == Qnil) {
-	if (!succeeded(henv, SQL_NULL_HDBC, SQL_NULL_HSTMT,
-		       SQLGetEnvAttr(henv, (SQLINTEGER) op,
-				     (SQLPOINTER) &v, sizeof (v), &l),
-		       &msg, "SQLGetEnvAttr(%d)", op)) {
-	    rb_raise(Cerror, "%s", msg);
+static int
+local_offset(DBC *p, time_t lsecs, int y, int mo, int d, int h, int mi,
+	     int s, time_t *offp)
+{
+    time_t hour = lsecs / 3600;
+
+    if (!p->tzvalid || (p->tzhour != hour)) {
+	struct tm tm;
+	time_t t;
+
+	memset(&tm, 0, sizeof (tm));
+	tm.tm_year = y - 1900;
+	tm.tm_mon = mo - 1;
+	tm.tm_mday = d;
+	tm.tm_hour = h;
+	tm.tm_min = mi;
+	tm.tm_sec = s;
+	tm.tm_isdst = -1;
+	t = mktime(&tm);
+	if (t == (time_t) -1) {
+	    return 0;
+	}
+	if (tm.tm_isdst > 0) {
+	    struct tm tm2, tm3;
+	    time_t t2;
+
+	    /* ambiguous at end of DST: prefer the later time like Time.local */
+	    memset(&tm2, 0, sizeof (tm2));
+	    tm2.tm_year = y - 1900;
+	    tm2.tm_mon = mo - 1;
+	    tm2.tm_mday = d;
+	    tm2.tm_hour = h;
+	    tm2.tm_min = mi;
+	    tm2.tm_sec = s;
+	    tm2.tm_isdst = 0;
+	    t2 = mktime(&tm2);
+	    if ((t2 > t) && (local_tm(t2, &tm3) != NULL) &&
+		(tm3.tm_isdst == 0) && (tm3.tm_hour == h) &&
+		(tm3.tm_min == mi) && (tm3.tm_mday == d)) {
+		t = t2;
+	    }
 	}
-	return rb_int2inum(v);
-    }
-    v = NUM2INT(val);
-    vp = (SQLPOINTER) v;
-    if (!succeeded(henv, SQL_NULL_HDBC, SQL_NULL_HSTMT,
-		   SQLSetEnvAttr(henv, (SQLINTEGER) op, vp, SQL_IS_INTEGER),
-		   &msg, "SQLSetEnvAttr(%d)", op)) {
-	rb_raise(Cerror, "%s", msg);
+	p->tzoff = lsecs - t;
+	p->tzhour = hour;
+	p->tzvalid = 1;
     }
-    return Qnil;
+    *offp = p->tzoff;
+    return 1;
 }
 #endif
 
 static VALUE
-env_cpooling(int argc, VALUE *argv, VALUE self)
+make_rbtime(DBC *p, int y, int mo, int d, int h, int mi, int s, long nsec)
 {
-#if (ODBCVER >= 0x0300)
-    return do_attr(argc, argv, self, SQL_ATTR_CONNECTION_POOLING);
+#ifdef HAVE_RB_TIME_NANO_NEW
+    if ((y >= 1970) && civil_valid(y, mo, d) &&
+	(h >= 0) && (h < 24) && (mi >= 0) && (mi < 60) &&
+	(s >= 0) && (s < 61) && (nsec >= 0) && (nsec < 1000000000L)) {
+	time_t secs = civil_days(y, mo, d) * 86400 + h * 3600 + mi * 60 + s;
+	time_t off;
+
+	if (p->gmtime == Qtrue) {
+#ifdef HAVE_RB_TIME_TIMESPEC_NEW
+	    struct timespec ts;
+
+	    ts.tv_sec = secs;
+	    ts.tv_nsec = nsec;
+	    return rb_time_timespec_new(&ts, INT_MAX - 1);
 #else
-    rb_raise(Cerror, "%s", set_err("Unsupported in ODBC < 3.0", 0));
-    return Qnil;
+	    return rb_funcall(rb_time_nano_new(secs, nsec), IDutc, 0, NULL);
+#endif
+	}
+	if (local_offset(p, secs, y, mo, d, h, mi, s, &off)) {
+	    return rb_time_nano_new(secs - off, nsec);
+	}
+    }
 #endif
+    return rb_funcall(rb_cTime, (p->gmtime == Qtrue) ? IDutc : IDlocal, 7,
+		      INT2NUM(y), INT2NUM(mo), INT2NUM(d),
+		      INT2NUM(h), INT2NUM(mi), INT2NUM(s),
+		      rb_float_new((double) 1.0e-3 * nsec));
 }
 
 static VALUE
-env_cpmatch(int argc, VALUE *argv, VALUE self)
+date_to_rb(DATE_STRUCT *date)
 {
-#if (ODBCVER >= 0x0300)
-    return do_attr(argc, argv, self, SQL_ATTR_CP_MATCH);
-#else
-    rb_raise(Cerror, "%s", set_err("Unsupported in ODBC < 3.0", 0));
-    return Qnil;
-#endif
+    int y = date->year, m = date->month, d = date->day;
+
+    /* Date.jd() counts in the Julian calendar before 1582-10-15 */
+    if (civil_valid(y, m, d) &&
+	(y * 10000 + m * 100 + d >= 15821015)) {
+	time_t jd = civil_days(y, m, d) + 2440588;
+
+	return rb_funcall(rb_cDate, IDjd, 1, LONG2NUM((long) jd));
+    }
+    return rb_funcall(rb_cDate, IDnew, 3, INT2NUM(y), INT2NUM(m), INT2NUM(d));
 }
 
 static VALUE
-env_odbcver(int argc, VALUE *argv, VALUE self)
+time_to_rb(DBC *p, TIME_STRUCT *tp)
 {
-#if (ODBCVER >= 0x0300)
-    return do_attr(argc, argv, self, SQL_ATTR_ODBC_VERSION);
-#else
-    VALUE val;
+    struct tm tm;
 
-    rb_scan_args(argc, argv, "01", &val);
-    if (val == Qnil) {
-	return rb_int2inum(ODBCVER >> 8);
+    if (local_tm(time(NULL), &tm) == NULL) {
+	VALUE t = rb_funcall(rb_cTime, IDnow, 0, NULL);
+
+	memset(&tm, 0, sizeof (tm));
+	tm.tm_year = NUM2INT(rb_funcall(t, IDyear, 0, NULL)) - 1900;
+	tm.tm_mon = NUM2INT(rb_funcall(t, IDmonth, 0, NULL)) - 1;
+	tm.tm_mday = NUM2INT(rb_funcall(t, IDday, 0, NULL));
     }
-    rb_raise(Cerror, "%s", set_err("Unsupported in ODBC < 3.0", 0));
-#endif
+    return make_rbtime(p, tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday,
+		       tp->hour, tp->minute, tp->second, 0);
+}
+
+static VALUE
+timestamp_to_rb(DBC *p, TIMESTAMP_STRUCT *ts)
+{
+    return make_rbtime(p, ts->year, ts->month, ts->day,
+		       ts->hour, ts->minute, ts->second, (long) ts->fraction);
 }
 
 /*
  *----------------------------------------------------------------------
  *
- *      Connection/statement option handling.
- *
- *      Note:
- *      ODBC 2 allows statement options to be set using SQLSetConnectOption,
- *      establishing the statement option as a default for any hstmts
- *      later allocated for that hdbc. This feature was deprecated in
- *      ODBC 3.x and may not work with ODBC 3.x drivers.
- *
- *      Although the Database class includes attribute accessors for
- *      statement-level options, a safer alternative, if using an ODBC 3
- *      driver, is to set the option directly on the Statement instance.
+ *      Conversion of Ruby Time/Date to DATE/TIME/TIMESTAMP_STRUCT.
  *
  *----------------------------------------------------------------------
  */
 
-#define OPT_LEVEL_STMT         1
-#define OPT_LEVEL_DBC          2
-#define OPT_LEVEL_BOTH         (OPT_LEVEL_STMT | OPT_LEVEL_DBC)
+static struct tm *
+gm_tm(time_t t, struct tm *tm)
+{
+#ifdef HAVE_GMTIME_R
+    return gmtime_r(&t, tm);
+#else
+    struct tm *tmp = gmtime(&t);
 
-#define OPT_CONST_INT(x, level) { #x, x, level }
-#define OPT_CONST_END    { NULL, -1 }
-static struct {
-    const char *name;
-    int option;
-    int level;
-} option_map[] = {
+    if (tmp != NULL) {
+	*tm = *tmp;
+	tmp = tm;
+    }
+    return tmp;
+#endif
+}
 
-    /* yielding ints */
-    OPT_CONST_INT(SQL_AUTOCOMMIT, OPT_LEVEL_DBC),
-    OPT_CONST_INT(SQL_NOSCAN, OPT_LEVEL_BOTH),
-    OPT_CONST_INT(SQL_CONCURRENCY, OPT_LEVEL_BOTH),
-    OPT_CONST_INT(SQL_QUERY_TIMEOUT, OPT_LEVEL_BOTH),
-    OPT_CONST_INT(SQL_MAX_ROWS, OPT_LEVEL_BOTH),
-    OPT_CONST_INT(SQL_MAX_LENGTH, OPT_LEVEL_BOTH),
-    OPT_CONST_INT(SQL_ROWSET_SIZE, OPT_LEVEL_BOTH),
-    OPT_CONST_INT(SQL_CURSOR_TYPE, OPT_LEVEL_BOTH),
+static SQLSMALLINT
+rbtime_ctype(SQLSMALLINT type)
+{
+    switch (type) {
+    case SQL_TIME:
+#ifdef SQL_TYPE_TIME
+    case SQL_TYPE_TIME:
+#endif
+	return SQL_C_TIME;
+    case SQL_DATE:
+#ifdef SQL_TYPE_DATE
+    case SQL_TYPE_DATE:
+#endif
+	return SQL_C_DATE;
+    }
+    return SQL_C_TIMESTAMP;
+}
 
-    /* end of table */
-    OPT_CONST_END
-};
+/*
+ * Fill the structure for ctype from a Ruby Time. The wall clock of
+ * the Time in its own UTC offset is broken down by a single gmtime(),
+ * method calls are used only when the C API is missing.
+ */
 
-static VALUE
-do_option(int argc, VALUE *argv, VALUE self, int isstmt, int op)
+static void
+rbtime_to_struct(VALUE arg, SQLSMALLINT ctype, SQLPOINTER buf)
 {
-    DBC *p = NULL;
-    STMT *q = NULL;
-    VALUE val, val2, vstr;
-    SQLINTEGER v;
-    char *msg;
-    int level = isstmt ? OPT_LEVEL_STMT : OPT_LEVEL_DBC;
+    struct tm tm;
+    long nsec = 0;
+    int ok = 0;
 
-    rb_scan_args(argc, argv, (op == -1) ? "11" : "01", &val, &val2);
-    if (isstmt) {
-	Data_Get_Struct(self, STMT, q);
-	if (q->dbc == Qnil) {
-	    rb_raise(Cerror, "%s", set_err("Stale ODBC::Statement", 0));
-	}
-	if (q->hstmt == SQL_NULL_HSTMT) {
-	    rb_raise(Cerror, "%s", set_err("No statement", 0));
-	}
-    } else {
-	p = get_dbc(self);
-	if (p->hdbc == SQL_NULL_HDBC) {
-	    rb_raise(Cerror, "%s", set_err("No connection", 0));
-	}
-    }
-    if (op == -1) {
-	char *string;
-	int i, op_found = 0;
+#if defined(HAVE_RB_TIME_TIMESPEC) && defined(HAVE_RB_TIME_UTC_OFFSET)
+    if (rb_obj_class(arg) == rb_cTime) {
+	struct timespec ts = rb_time_timespec(arg);
+	VALUE off = rb_time_utc_offset(arg);
 
-	switch (TYPE(val)) {
-	default:
-	    vstr = rb_any_to_s(val);
-	    string = STR2CSTR(vstr);
-	    goto doString;
-	case T_STRING:
-	    string = STR2CSTR(val);
-	doString:
-	    for (i = 0; option_map[i].name != NULL; i++) {
-		if (strcmp(string, option_map[i].name) == 0) {
-		    op = option_map[i].option;
-		    level = option_map[i].level;
-		    op_found = 3;
-		    break;
-		}
-	    }
-	    break;
-	case T_FLOAT:
-	case T_BIGNUM:
-	    op = (int) NUM2DBL(val);
-	    goto doInt;
-	case T_FIXNUM:
-	    op = FIX2INT(val);
-	doInt:
-	    op_found = 1;
-	    for (i = 0; option_map[i].name != NULL; i++) {
-		if (op == option_map[i].option) {
-		    level = option_map[i].level;
-		    op_found = 2;
-		    break;
-		}
-	    }
-	    break;
-	}
-	if (!op_found) {
-	    rb_raise(Cerror, "%s", set_err("Unknown option", 0));
-	    return Qnil;
+	if (FIXNUM_P(off) &&
+	    (gm_tm(ts.tv_sec + FIX2LONG(off), &tm) != NULL)) {
+	    nsec = ts.tv_nsec;
+	    ok = 1;
 	}
-	val = val2;
-    }
-    if ((isstmt && (!(level & OPT_LEVEL_STMT))) ||
-	(!isstmt && (!(level & OPT_LEVEL_DBC)))) {
-	rb_raise(Cerror, "%s",
-		 set_err("Invalid option type for this level", 0));
-	return Qnil;
     }
-    if (val == Qnil) {
-	if (p != NULL) {
-	    if (!succeeded(SQL_NULL_HENV, p->hdbc, SQL_NULL_HSTMT,
-			   SQLGetConnectOption(p->hdbc, (SQLUSMALLINT) op,
-					       (SQLPOINTER) &v),
-			   &msg, "SQLGetConnectOption(%d)", op)) {
-		rb_raise(Cerror, "%s", msg);
-	    }
-	} else {
-	    if (!succeeded(SQL_NULL_HENV, SQL_NULL_HSTMT, q->hstmt,
-			   SQLGetStmtOption(q->hstmt, (SQLUSMALLINT) op,
-					    (SQLPOINTER) &v),
-			   &msg, "SQLGetStmtOption(%d)", op)) {
-		rb_raise(Cerror, "%s", msg);
-	    }
+#endif
+    if (!ok) {
+	memset(&tm, 0, sizeof (tm));
+	tm.tm_year = NUM2INT(rb_funcall(arg, IDyear, 0, NULL)) - 1900;
+	tm.tm_mon = NUM2INT(rb_funcall(arg, IDmonth, 0, NULL)) - 1;
+	tm.tm_mday = NUM2INT(rb_funcall(arg, IDday, 0, NULL));
+	if (ctype != SQL_C_DATE) {
+	    tm.tm_hour = NUM2INT(rb_funcall(arg, IDhour, 0, NULL));
+	    tm.tm_min = NUM2INT(rb_funcall(arg, IDmin, 0, NULL));
+	    tm.tm_sec = NUM2INT(rb_funcall(arg, IDsec, 0, NULL));
+	}
+	if (ctype == SQL_C_TIMESTAMP) {
+#ifdef TIME_USE_USEC
+	    nsec = NUM2LONG(rb_funcall(arg, IDusec, 0, NULL)) * 1000;
+#else
+	    nsec = NUM2LONG(rb_funcall(arg, IDnsec, 0, NULL));
+#endif
 	}
     }
-    switch (op) {
-    case SQL_AUTOCOMMIT:
-	if (val == Qnil) {
-	    return v ? Qtrue : Qfalse;
+    switch (ctype) {
+    case SQL_C_DATE:
+	{
+	    DATE_STRUCT *date = (DATE_STRUCT *) buf;
+
+	    memset(date, 0, sizeof (DATE_STRUCT));
+	    date->year = tm.tm_year + 1900;
+	    date->month = tm.tm_mon + 1;
+	    date->day = tm.tm_mday;
 	}
-	v = (TYPE(val) == T_FIXNUM) ?
-	    (FIX2INT(val) ? SQL_AUTOCOMMIT_ON : SQL_AUTOCOMMIT_OFF) :
-	    (RTEST(val) ? SQL_AUTOCOMMIT_ON : SQL_AUTOCOMMIT_OFF);
 	break;
+    case SQL_C_TIME:
+	{
+	    TIME_STRUCT *time = (TIME_STRUCT *) buf;
 
-    case SQL_NOSCAN:
-	if (val == Qnil) {
-	    return v ? Qtrue : Qfalse;
+	    memset(time, 0, sizeof (TIME_STRUCT));
+	    time->hour = tm.tm_hour;
+	    time->minute = tm.tm_min;
+	    time->second = tm.tm_sec;
 	}
-	v = (TYPE(val) == T_FIXNUM) ?
-	    (FIX2INT(val) ? SQL_NOSCAN_ON : SQL_NOSCAN_OFF) :
-	    (RTEST(val) ? SQL_NOSCAN_ON : SQL_NOSCAN_OFF);
 	break;
-
-    case SQL_CONCURRENCY:
-    case SQL_QUERY_TIMEOUT:
-    case SQL_MAX_ROWS:
-    case SQL_MAX_LENGTH:
-    case SQL_ROWSET_SIZE:
-    case SQL_CURSOR_TYPE:
     default:
-	if (val == Qnil) {
-	    return rb_int2inum(v);
-	}
-	Check_Type(val, T_FIXNUM);
-	v = FIX2INT(val);
-	if (op == SQL_ROWSET_SIZE) {
-	    rb_raise(Cerror, "%s", set_err("Read only attribute", 0));
+	{
+	    TIMESTAMP_STRUCT *ts = (TIMESTAMP_STRUCT *) buf;
+
+	    memset(ts, 0, sizeof (TIMESTAMP_STRUCT));
+	    ts->year = tm.tm_year + 1900;
+	    ts->month = tm.tm_mon + 1;
+	    ts->day = tm.tm_mday;
+	    ts->hour = tm.tm_hour;
+	    ts->minute = tm.tm_min;
+	    ts->second = tm.tm_sec;
+	    ts->fraction = nsec;
 	}
 	break;
     }
-    if (p != NULL) {
-	if (!succeeded(SQL_NULL_HENV, p->hdbc, SQL_NULL_HSTMT,
-		       SQLSetConnectOption(p->hdbc, (SQLUSMALLINT) op,
-					   (SQLUINTEGER) v),
-		       &msg, "SQLSetConnectOption(%d)", op)) {
-	    rb_raise(Cerror, "%s", msg);
-	}
-    } else {
-	if (!succeeded(SQL_NULL_HENV, SQL_NULL_HDBC, q->hstmt,
-		       SQLSetStmtOption(q->hstmt, (SQLUSMALLINT) op,
-					(SQLUINTEGER) v),
-		       &msg, "SQLSetStmtOption(%d)", op)) {
-	    rb_raise(Cerror, "%s", msg);
-	}
+}
+
+/*
+ * Fill DATE_STRUCT from a Ruby Date, using the Julian day number
+ * for dates in the Gregorian calendar.
+ */
+
+static void
+rbdate_to_struct(VALUE arg, DATE_STRUCT *date)
+{
+    VALUE jd = rb_funcall(arg, IDjd, 0, NULL);
+
+    memset(date, 0, sizeof (DATE_STRUCT));
+    if (FIXNUM_P(jd) && (FIX2LONG(jd) >= 2299161) &&
+	(FIX2LONG(jd) <= 5373484)) {
+	/* civil from days since 1970-01-01, inverse of civil_days() */
+	long z = FIX2LONG(jd) - 2440588 + 719468;
+	long era = z / 146097, doe, yoe, doy, mp;
+
+	doe = z - era * 146097;
+	yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+	doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+	mp = (5 * doy + 2) / 153;
+	date->day = (SQLUSMALLINT) (doy - (153 * mp + 2) / 5 + 1);
+	date->month = (SQLUSMALLINT) ((mp < 10) ? (mp + 3) : (mp - 9));
+	date->year = (SQLSMALLINT) (yoe + era * 400 + (date->month <= 2));
+	return;
     }
-    return Qnil;
+    date->year = NUM2INT(rb_funcall(arg, IDyear, 0, NULL));
+    date->month = NUM2INT(rb_funcall(arg, IDmonth, 0, NULL));
+    date->day = NUM2INT(rb_funcall(arg, IDmday, 0, NULL));
 }
 
 static VALUE
-dbc_autocommit(int argc, VALUE *argv, VALUE self)
+stmt_param_output_value(int argc, VALUE *argv, VALUE self)
 {
-    return do_option(argc, argv, self, 0, SQL_AUTOCOMMIT);
+    VALUE pnum, v;
+    int vnum;
+    STMT *q;
+
+    rb_scan_args(argc, argv, "10", &pnum);
+    ODBC_Get_Struct(self, STMT, stmt_type, q);
+    vnum = param_num_check(q, pnum, 0, 1);
+    v = Qnil;
+    if (q->paraminfo[vnum].rlen == SQL_NULL_DATA) {
+	return v;
+    }
+    if (q->paraminfo[vnum].outbuf == NULL) {
+	rb_raise(Cerror, "no output value available");
+    }
+    switch (q->paraminfo[vnum].ctype) {
+    case SQL_C_LONG:
+	v = INT2NUM(*((SQLINTEGER *) q->paraminfo[vnum].outbuf));
+	break;
+    case SQL_C_DOUBLE:
+	v = rb_float_new(*((double *) q->paraminfo[vnum].outbuf));
+	break;
+    case SQL_C_DATE:
+	{
+	    DATE_STRUCT *date;
+
+	    if (q->dbcp != NULL && q->dbcp->rbtime == Qtrue) {
+		v = date_to_rb((DATE_STRUCT *) q->paraminfo[vnum].outbuf);
+	    } else {
+		v = Data_Make_Struct(Cdate, DATE_STRUCT, 0, xfree, date);
+		*date = *((DATE_STRUCT *) q->paraminfo[vnum].outbuf);
+	    }
+	}
+	break;
+    case SQL_C_TIME:
+	{
+	    TIME_STRUCT *time;
+
+	    if (q->dbcp != NULL && q->dbcp->rbtime == Qtrue) {
+		v = time_to_rb(q->dbcp,
+			       (TIME_STRUCT *) q->paraminfo[vnum].outbuf);
+	    } else {
+		v = Data_Make_Struct(Ctime, TIME_STRUCT, 0, xfree, time);
+		*time = *((TIME_STRUCT *) q->paraminfo[vnum].outbuf);
+	    }
+	}
+	break;
+    case SQL_C_TIMESTAMP:
+	{
+	    TIMESTAMP_STRUCT *ts;
+
+	    if (q->dbcp != NULL && q->dbcp->rbtime == Qtrue) {
+		v = timestamp_to_rb(q->dbcp, (TIMESTAMP_STRUCT *)
+				    q->paraminfo[vnum].outbuf);
+	    } else {
+		v = Data_Make_Struct(Ctimestamp, TIMESTAMP_STRUCT,
+				     0, xfree, ts);
+		*ts = *((TIMESTAMP_STRUCT *) q->paraminfo[vnum].outbuf);
+	    }
+	}
+	break;
+#ifdef UNICODE
+    case SQL_C_WCHAR:
+	v = uc_tainted_str_new((SQLWCHAR *) q->paraminfo[vnum].outbuf,
+			       q->paraminfo[vnum].rlen / sizeof (SQLWCHAR));
+	break;
+#endif
+    case SQL_C_CHAR:
+	v = rb_tainted_str_new(q->paraminfo[vnum].outbuf,
+			       q->paraminfo[vnum].rlen);
+	break;
+    }
+    return v;
 }
 
 static VALUE
-dbc_concurrency(int argc, VALUE *argv, VALUE self)
+stmt_param_output_size(int argc, VALUE *argv, VALUE self)
 {
-    return do_option(argc, argv, self, 0, SQL_CONCURRENCY);
+    VALUE pnum, psize;
+    int vnum, vsize;
+    STMT *q;
+
+    rb_scan_args(argc, argv, "11", &pnum, &psize);
+    ODBC_Get_Struct(self, STMT, stmt_type, q);
+    vnum = param_num_check(q, pnum, 0, 1);
+    if (argc > 1) {
+	Check_Type(psize, T_FIXNUM);
+	vsize = NUM2INT(psize);
+	if ((vsize > 0) && (vsize < (int) (4 * sizeof (double)))) {
+	    vsize = 4 * sizeof (double);
+	}
+	q->paraminfo[vnum].outsize = (vsize > 0) ? vsize : 0;
+    }
+    return INT2NUM(q->paraminfo[vnum].outsize);
 }
 
 static VALUE
-dbc_maxrows(int argc, VALUE *argv, VALUE self)
+stmt_param_output_type(int argc, VALUE *argv, VALUE self)
 {
-    return do_option(argc, argv, self, 0, SQL_MAX_ROWS);
+    VALUE pnum, ptype;
+    int vnum, vtype;
+    STMT *q;
+
+    rb_scan_args(argc, argv, "11", &pnum, &ptype);
+    ODBC_Get_Struct(self, STMT, stmt_type, q);
+    vnum = param_num_check(q, pnum, 0, 1);
+    if (argc > 1) {
+	Check_Type(ptype, T_FIXNUM);
+	vtype = NUM2INT(ptype);
+	q->paraminfo[vnum].outtype = vtype;
+    }
+    return INT2NUM(q->paraminfo[vnum].outtype);
 }
 
 static VALUE
-dbc_timeout(int argc, VALUE *argv, VALUE self)
+stmt_cursorname(int argc, VALUE *argv, VALUE self)
 {
-    return do_option(argc, argv, self, 0, SQL_QUERY_TIMEOUT);
+    VALUE cn = Qnil;
+    STMT *q;
+#ifdef UNICODE
+    SQLWCHAR cname[SQL_MAX_MESSAGE_LENGTH];
+    SQLWCHAR *cp;
+#else
+    SQLCHAR cname[SQL_MAX_MESSAGE_LENGTH];
+    SQLCHAR *cp;
+#endif
+    char *msg;
+    SQLSMALLINT cnLen = 0;
+
+    rb_scan_args(argc, argv, "01", &cn);
+    ODBC_Get_Struct(self, STMT, stmt_type, q);
+    if (cn == Qnil) {
+	if (!succeeded(SQL_NULL_HENV, SQL_NULL_HDBC, q->hstmt,
+		       SQLGetCursorName(q->hstmt, (SQLTCHAR *) cname,
+					(SQLSMALLINT) sizeof (cname), &cnLen),
+		       &msg, "SQLGetCursorName")) {
+	    rb_raise(Cerror, "%s", msg);
+	}
+#ifdef UNICODE
+	cnLen = (cnLen == 0) ? (SQLSMALLINT) uc_strlen(cname) :
+	    (SQLSMALLINT) (cnLen / sizeof (SQLWCHAR));
+	return uc_tainted_str_new(cname, cnLen);
+#else
+	cnLen = (cnLen == 0) ? (SQLSMALLINT) strlen((char *) cname) : cnLen;
+	return rb_tainted_str_new((char *) cname, cnLen);
+#endif
+    }
+    if (TYPE(cn) != T_STRING) {
+	cn = rb_any_to_s(cn);
+    }
+#ifdef UNICODE
+#ifdef USE_RB_ENC
+    cn = rb_funcall(cn, IDencode, 1, rb_encv);
+#endif
+    cp = uc_from_utf((unsigned char *) STR2CSTR(cn), -1);
+    if (cp == NULL) {
+	rb_raise(Cerror, "%s", set_err("Out of memory", 0));
+    }
+#else
+    cp = (SQLCHAR *) STR2CSTR(cn);
+#endif
+    if (!succeeded(SQL_NULL_HENV, SQL_NULL_HDBC, q->hstmt,
+		   SQLSetCursorName(q->hstmt, cp, SQL_NTS),
+		   &msg, "SQLSetCursorName")) {
+#ifdef UNICODE
+	uc_free(cp);
+#endif
+	rb_raise(Cerror, "%s", msg);
+    }
+#ifdef UNICODE
+    uc_free(cp);
+#endif
+    return cn;
 }
 
 static VALUE
-dbc_maxlength(int argc, VALUE *argv, VALUE self)
+stmt_column(int argc, VALUE *argv, VALUE self)
 {
-    return do_option(argc, argv, self, 0, SQL_MAX_LENGTH);
+    STMT *q;
+    VALUE col;
+
+    rb_scan_args(argc, argv, "1", &col);
+    Check_Type(col, T_FIXNUM);
+    ODBC_Get_Struct(self, STMT, stmt_type, q);
+    check_ncols(q);
+    return make_column(q->hstmt, FIX2INT(col), q->upc);
 }
 
 static VALUE
-dbc_rowsetsize(int argc, VALUE *argv, VALUE self)
+stmt_columns(int argc, VALUE *argv, VALUE self)
 {
-    return do_option(argc, argv, self, 0, SQL_ROWSET_SIZE);
+    STMT *q;
+    int i;
+    VALUE res, as_ary = Qfalse;
+
+    rb_scan_args(argc, argv, "01", &as_ary);
+    ODBC_Get_Struct(self, STMT, stmt_type, q);
+    check_ncols(q);
+    if (rb_block_given_p()) {
+	for (i = 0; i < q->ncols; i++) {
+	    rb_yield(make_column(q->hstmt, i, q->upc));
+	}
+	return self;
+    }
+    if (RTEST(as_ary)) {
+	res = rb_ary_new2(q->ncols);
+    } else {
+	res = rb_hash_new();
+    }
+    for (i = 0; i < q->ncols; i++) {
+	VALUE obj;
+
+	obj = make_column(q->hstmt, i, q->upc);
+	if (RTEST(as_ary)) {
+	    rb_ary_store(res, i, obj);
+	} else {
+	    VALUE name = rb_iv_get(obj, "@name");
+
+	    if (rb_funcall(res, IDkeyp, 1, name) == Qtrue) {
+		char buf[32];
+
+		sprintf(buf, "#%d", i);
+		name = rb_str_dup(name);
+		name = rb_obj_taint(rb_str_cat2(name, buf));
+	    }
+	    rb_hash_aset(res, name, obj);
+	}
+    }
+    return res;
 }
 
 static VALUE
-dbc_cursortype(int argc, VALUE *argv, VALUE self)
+stmt_param(int argc, VALUE *argv, VALUE self)
 {
-    return do_option(argc, argv, self, 0, SQL_CURSOR_TYPE);
-}
+    STMT *q;
+    VALUE par;
+    int i;
 
-static VALUE
-dbc_noscan(int argc, VALUE *argv, VALUE self)
-{
-    return do_option(argc, argv, self, 0, SQL_NOSCAN);
+    rb_scan_args(argc, argv, "1", &par);
+    Check_Type(par, T_FIXNUM);
+    ODBC_Get_Struct(self, STMT, stmt_type, q);
+    i = FIX2INT(par);
+    if ((i < 0) || (i >= q->nump)) {
+	rb_raise(Cerror, "%s", set_err("Parameter out of bounds", 0));
+    }
+    return make_param(q, i);
 }
 
 static VALUE
-dbc_getsetoption(int argc, VALUE *argv, VALUE self)
+stmt_params(VALUE self)
 {
-    return do_option(argc, argv, self, 0, -1);
-}
+    STMT *q;
+    int i;
+    VALUE res;
 
-static VALUE
-stmt_concurrency(int argc, VALUE *argv, VALUE self)
-{
-    return do_option(argc, argv, self, 1, SQL_CONCURRENCY);
-}
+    ODBC_Get_Struct(self, STMT, stmt_type, q);
+    if (rb_block_given_p()) {
+	for (i = 0; i < q->nump; i++) {
+	    rb_yield(make_param(q, i));
+	}
+	return self;
+    }
+    res = rb_ary_new2(q->nump);
+    for (i = 0; i < q->nump; i++) {
+	VALUE obj;
 
-static VALUE
-stmt_maxrows(int argc, VALUE *argv, VALUE self)
-{
-    return do_option(argc, argv, self, 1, SQL_MAX_ROWS);
+	obj = make_param(q, i);
+	rb_ary_store(res, i, obj);
+    }
+    return res;
 }
 
-static VALUE
-stmt_timeout(int argc, VALUE *argv, VALUE self)
-{
-    return do_option(argc, argv, self, 1, SQL_QUERY_TIMEOUT);
-}
+/*
+ *----------------------------------------------------------------------
+ *
+ *      Symbol keys of columns for fetch_hash and friends, computed
+ *      once per result set with the same layout as q->colvals and
+ *      the "#n" suffixes of duplicate names already applied.
+ *
+ *----------------------------------------------------------------------
+ */
 
 static VALUE
-stmt_maxlength(int argc, VALUE *argv, VALUE self)
+colname_sym(char *name)
 {
-    return do_option(argc, argv, self, 1, SQL_MAX_LENGTH);
+#ifdef USE_RB_ENC
+    return ID2SYM(rb_intern3(name, strlen(name), rb_enc));
+#else
+    return ID2SYM(rb_intern(name));
+#endif
 }
 
-static VALUE
-stmt_rowsetsize(int argc, VALUE *argv, VALUE self)
+static VALUE *
+make_colsyms(STMT *q)
 {
-    return do_option(argc, argv, self, 1, SQL_ROWSET_SIZE);
-}
+    int i;
+    VALUE seen = Qnil;
 
-static VALUE
-stmt_cursortype(int argc, VALUE *argv, VALUE self)
-{
-    return do_option(argc, argv, self, 1, SQL_CURSOR_TYPE);
-}
+    if (q->colsyms != NULL) {
+	return q->colsyms;
+    }
+    q->colsyms = ALLOC_N(VALUE, 4 * q->ncols);
+    for (i = 0; i < 4 * q->ncols; i++) {
+	char *valp = q->colnames[i];
+	VALUE name;
 
-static VALUE
-stmt_noscan(int argc, VALUE *argv, VALUE self)
-{
-    return do_option(argc, argv, self, 1, SQL_NOSCAN);
-}
+	if ((i % q->ncols) == 0) {
+	    seen = rb_hash_new();
+	}
+	name = colname_sym(valp);
+	if (rb_hash_aref(seen, name) != Qnil) {
+	    char *p = q->colnames[4 * q->ncols];
 
-static VALUE
-stmt_getsetoption(int argc, VALUE *argv, VALUE self)
-{
-    return do_option(argc, argv, self, 1, -1);
+	    sprintf(p, "%s#%d", valp, i % q->ncols);
+	    name = colname_sym(p);
+	}
+	rb_hash_aset(seen, name, Qtrue);
+	q->colsyms[i] = name;
+    }
+    return q->colsyms;
 }
 
 /*
- *----------------------------------------------------------------------
- *
- *      Scan literal date/time/timestamp to TIMESTAMP_STRUCT.
- *
- *----------------------------------------------------------------------
+ * Convert the column value at valp having length curlen (or
+ * SQL_NULL_DATA) of column i to a Ruby object.
  */
 
-static int
-scan_dtts(VALUE str, int do_d, int do_t, TIMESTAMP_STRUCT *ts)
+static VALUE
+col_value(STMT *q, int i, char *valp, SQLLEN curlen)
 {
-    int yy = 0, mm = 0, dd = 0, hh = 0, mmm = 0, ss = 0, ff = 0, i;
-    char c, *cstr = STR2CSTR(str);
+    VALUE v;
 
-    memset(ts, 0, sizeof (TIMESTAMP_STRUCT));
-    if (((sscanf(cstr, "{ts '%d-%d-%d %d:%d:%d.%d' %c",
-		 &yy, &mm, &dd, &hh, &mmm, &ss, &ff, &c) == 8) ||
-	 (sscanf(cstr, "{ts '%d-%d-%d %d:%d:%d' %c",
-		 &yy, &mm, &dd, &hh, &mmm, &ss, &c) == 7)) &&
-	(c == '}')) {
-	ts->year = yy;
-	ts->month = mm;
-	ts->day = dd;
-	ts->hour = hh;
-	ts->minute = mmm;
-	ts->second = ss;
-	ts->fraction = ff;
-	return 1;
-    }
-    if (do_d &&
-	(sscanf(cstr, "{d '%d-%d-%d' %c", &yy, &mm, &dd, &c) == 4) &&
-	(c == '}')) {
-	ts->year = yy;
-	ts->month = mm;
-	ts->day = dd;
-	return 1;
-    }
-    if (do_t &&
-	(sscanf(cstr, "{t '%d:%d:%d' %c", &hh, &mmm, &ss, &c) == 4) &&
-	(c == '}')) {
-	ts->hour = yy;
-	ts->minute = mmm;
-	ts->second = ss;
-	return 1;
+    if (curlen == SQL_NULL_DATA) {
+	return Qnil;
     }
-    ff = ss = 0;
-    i = sscanf(cstr, "%d-%d-%d %d:%d:%d%c%d",
-	       &yy, &mm, &dd, &hh, &mmm, &ss, &c, &ff);
-    if (i >= 5) {
-	if ((i > 6) && (c != 0) && (strchr(". \t", c) == NULL)) {
-	    goto next;
+    switch (q->coltypes[i].type) {
+    case SQL_C_LONG:
+	v = INT2NUM(*((SQLINTEGER *) valp));
+	break;
+    case SQL_C_DOUBLE:
+	v = rb_float_new(*((double *) valp));
+	break;
+#ifdef SQL_C_SBIGINT
+    case SQL_C_SBIGINT:
+#ifdef LL2NUM
+	v = LL2NUM(*((SQLBIGINT *) valp));
+#else
+	v = INT2NUM(*((SQLBIGINT *) valp));
+#endif
+	break;
+#endif
+#ifdef SQL_C_UBIGINT
+    case SQL_C_UBIGINT:
+#ifdef LL2NUM
+	v = ULL2NUM(*((SQLBIGINT *) valp));
+#else
+	v = UINT2NUM(*((SQLBIGINT *) valp));
+#endif
+	break;
+#endif
+    case SQL_C_DATE:
+	{
+	    DATE_STRUCT *date;
+
+	    if (q->dbcp != NULL && q->dbcp->rbtime == Qtrue) {
+		v = date_to_rb((DATE_STRUCT *) valp);
+	    } else {
+		v = Data_Make_Struct(Cdate, DATE_STRUCT, 0, xfree, date);
+		*date = *(DATE_STRUCT *) valp;
+	    }
 	}
-	ts->year = yy;
-	ts->month = mm;
-	ts->day = dd;
-	ts->hour = hh;
-	ts->minute = mmm;
-	ts->second = ss;
-	ts->fraction = ff;
-	return 1;
+	break;
+    case SQL_C_TIME:
+	{
+	    TIME_STRUCT *time;
+
+	    if (q->dbcp != NULL && q->dbcp->rbtime == Qtrue) {
+		v = time_to_rb(q->dbcp, (TIME_STRUCT *) valp);
+	    } else {
+		v = Data_Make_Struct(Ctime, TIME_STRUCT, 0, xfree, time);
+		*time = *(TIME_STRUCT *) valp;
+	    }
+	}
+	break;
+    case SQL_C_TIMESTAMP:
+	{
+	    TIMESTAMP_STRUCT *ts;
+
+	    if (q->dbcp != NULL && q->dbcp->rbtime == Qtrue) {
+		v = timestamp_to_rb(q->dbcp, (TIMESTAMP_STRUCT *) valp);
+	    } else {
+		v = Data_Make_Struct(Ctimestamp, TIMESTAMP_STRUCT,
+				     0, xfree, ts);
+		*ts = *(TIMESTAMP_STRUCT *) valp;
+	    }
+	}
+	break;
+#ifdef UNICODE
+    case SQL_C_WCHAR:
+	v = uc_tainted_str_new((SQLWCHAR *) valp, curlen / sizeof (SQLWCHAR));
+	break;
+#endif
+    default:
+	if ((q->coltypes[i].conv != COLCONV_NONE) &&
+	    (curlen >= q->coltypes[i].size)) {
+	    curlen = q->coltypes[i].size - 1;
+	}
+	switch (q->coltypes[i].conv) {
+	case COLCONV_INT:
+	    valp[curlen] = '\0';
+	    v = rb_cstr2inum(valp, 10);
+	    break;
+	case COLCONV_BIGDEC:
+	    /* bigdecimal has no public C API, parse by Kernel#BigDecimal */
+	    v = rb_funcall(rb_mKernel, IDBigDecimal, 1,
+			   rb_str_new(valp, curlen));
+	    break;
+	default:
+	    v = rb_tainted_str_new(valp, curlen);
+	    break;
+	}
+	break;
     }
-next:
-    ff = ss = 0;
-    if (do_d && (sscanf(cstr, "%d-%d-%d", &yy, &mm, &dd) == 3)) {
-	ts->year = yy;
-	ts->month = mm;
-	ts->day = dd;
-	return 1;
+    return v;
+}
+
+static VALUE
+do_fetch(STMT *q, int mode)
+{
+    int i, offc;
+    char **bufs, *msg;
+    VALUE res, *keys = NULL, *kv = NULL;
+    double t0 = stats_now(), d0 = q->stats.drvtime;
+
+    if (q->ncols <= 0) {
+	rb_raise(Cerror, "%s", set_err("No columns in result set", 0));
     }
-    if (do_t && (sscanf(cstr, "%d:%d:%d", &hh, &mmm, &ss) == 3)) {
-	ts->hour = hh;
-	ts->minute = mmm;
-	ts->second = ss;
-	return 1;
+    if ((gcinterval > 0) && (++q->fetchc >= gcinterval)) {
+	q->fetchc = 0;
+	start_gc();
+    }
+    bufs = q->dbufs;
+    if (bufs == NULL) {
+	int need = sizeof (char *) * q->ncols, needp;
+	char *p;
+
+	need = LEN_ALIGN(need);
+	needp = need;
+	for (i = 0; i < q->ncols; i++) {
+	    if (q->coltypes[i].size != SQL_NO_TOTAL) {
+		need += LEN_ALIGN(q->coltypes[i].size);
+	    }
+	}
+	p = ALLOC_N(char, need);
+	if (p == NULL) {
+	    rb_raise(Cerror, "%s", set_err("Out of memory", 0));
+	}
+	q->dbufs = bufs = (char **) p;
+	q->bufsize += need;
+	p += needp;
+	for (i = 0; i < q->ncols; i++) {
+	    int len = q->coltypes[i].size;
+
+	    if (len == SQL_NO_TOTAL) {
+		bufs[i] = NULL;
+	    } else {
+		bufs[i] = p;
+		p += LEN_ALIGN(len);
+	    }
+	}
     }
-    return 0;
-}
-
-/*
- *----------------------------------------------------------------------
- *
- *      Date methods.
- *
- *----------------------------------------------------------------------
- */
+    switch (mode & DOFETCH_MODES) {
+    case DOFETCH_HASH:
+    case DOFETCH_HASH2:
+    case DOFETCH_HASHK:
+    case DOFETCH_HASHK2:
+	if (q->colnames == NULL) {
+	    int need = sizeof (char *) * 4 * q->ncols + sizeof (char *);
+	    int max_len[2] = { 0, 0 };
+	    char **na, *p;
+#ifdef UNICODE
+	    SQLWCHAR name[SQL_MAX_MESSAGE_LENGTH];
+#else
+	    char name[SQL_MAX_MESSAGE_LENGTH];
+#endif
+	    SQLSMALLINT name_len;
 
-#ifdef HAVE_RB_DEFINE_ALLOC_FUNC
-static VALUE
-date_alloc(VALUE self)
-{
-    DATE_STRUCT *date;
-    VALUE obj = Data_Make_Struct(self, DATE_STRUCT, 0, xfree, date);
+	    for (i = 0; i < q->ncols; i++) {
+		int need_len;
 
-    memset(date, 0, sizeof (*date));
-    return obj;
-}
+		name[0] = 0;
+		if (!succeeded(SQL_NULL_HENV, SQL_NULL_HDBC, q->hstmt,
+			       SQLColAttributes(q->hstmt,
+						(SQLUSMALLINT) (i + 1),
+						SQL_COLUMN_TABLE_NAME,
+						name,
+						sizeof (name),
+						&name_len, NULL),
+			       &msg,
+			       "SQLColAttributes(SQL_COLUMN_TABLE_NAME)")) {
+		    rb_raise(Cerror, "%s", msg);
+		}
+		if (name_len >= (SQLSMALLINT) sizeof (name)) {
+		    name_len = sizeof (name) - 1;
+		}
+		if (name_len > 0) {
+		    name[name_len / sizeof (name[0])] = 0;
+		}
+#ifdef UNICODE
+		need_len = 6 * (uc_strlen(name) + 1);
 #else
-static VALUE
-date_new(int argc, VALUE *argv, VALUE self)
-{
-    DATE_STRUCT *date;
-    VALUE obj = Data_Make_Struct(self, DATE_STRUCT, 0, xfree, date);
-
-    rb_obj_call_init(obj, argc, argv);
-    return obj;
-}
+		need_len = 2 * (strlen(name) + 1);
+#endif
+		need += need_len;
+		if (max_len[0] < need_len) {
+		    max_len[0] = need_len;
+		}
+		name[0] = 0;
+		if (!succeeded(SQL_NULL_HENV, SQL_NULL_HDBC, q->hstmt,
+			       SQLColAttributes(q->hstmt,
+						(SQLUSMALLINT) (i + 1),
+						SQL_COLUMN_LABEL, name,
+						sizeof (name),
+						&name_len, NULL),
+			       &msg, "SQLColAttributes(SQL_COLUMN_LABEL)")) {
+		    rb_raise(Cerror, "%s", msg);
+		}
+		if (name_len >= (SQLSMALLINT) sizeof (name)) {
+		    name_len = sizeof (name) - 1;
+		}
+		if (name_len > 0) {
+		    name[name_len / sizeof (name[0])] = 0;
+		}
+#ifdef UNICODE
+		need_len = 6 * 2 * (uc_strlen(name) + 1);
+#else
+		need_len = 2 * (strlen(name) + 1);
 #endif
+		need += need_len;
+		if (max_len[1] < need_len) {
+		    max_len[1] = need_len;
+		}
+	    }
+	    need += max_len[0] + max_len[1] + 32;
+	    p = ALLOC_N(char, need);
+	    if (p == NULL) {
+		rb_raise(Cerror, "%s", set_err("Out of memory", 0));
+	    }
+	    na = (char **) p;
+	    q->bufsize += need;
+	    p += sizeof (char *) * 4 * q->ncols + sizeof (char *);
+	    for (i = 0; i < q->ncols; i++) {
+		char *p0;
 
-static VALUE
-date_load1(VALUE self, VALUE str, int load)
-{
-    TIMESTAMP_STRUCT tss;
+		name[0] = 0;
+		callsql(SQL_NULL_HENV, SQL_NULL_HDBC, q->hstmt,
+			SQLColAttributes(q->hstmt, (SQLUSMALLINT) (i + 1),
+					 SQL_COLUMN_TABLE_NAME, name,
+					 sizeof (name), &name_len, NULL),
+			"SQLColAttributes(SQL_COLUMN_TABLE_NAME)");
+		if (name_len >= (SQLSMALLINT) sizeof (name)) {
+		    name_len = sizeof (name) - 1;
+		}
+		if (name_len > 0) {
+		    name[name_len / sizeof (name[0])] = 0;
+		}
+		na[i + q->ncols] = p;
+#ifdef UNICODE
+		p += mkutf(p, name, uc_strlen(name));
+#else
+		strcpy(p, name);
+#endif
+		strcat(p, ".");
+		p += strlen(p);
+		p0 = p;
+		name[0] = 0;
+		callsql(SQL_NULL_HENV, SQL_NULL_HDBC, q->hstmt,
+			SQLColAttributes(q->hstmt, (SQLUSMALLINT) (i + 1),
+					 SQL_COLUMN_LABEL, name,
+					 sizeof (name), &name_len, NULL),
+			"SQLColAttributes(SQL_COLUMN_LABEL)");
+		if (name_len >= (SQLSMALLINT) sizeof (name)) {
+		    name_len = sizeof (name) - 1;
+		}
+		if (name_len > 0) {
+		    name[name_len / sizeof (name[0])] = 0;
+		}
+		na[i] = p;
+#ifdef UNICODE
+		p += mkutf(p, name, uc_strlen(name)) + 1;
+#else
+		strcpy(p, name);
+		p += strlen(p) + 1;
+#endif
+		na[i + 3 * q->ncols] = p;
+		strcpy(p, na[i + q->ncols]);
+		p += p0 - na[i + q->ncols];
+		na[i + 2 * q->ncols] = upcase_if(p, 1);
+		p += strlen(p) + 1;
+	    }
+	    /* reserved space for later adjustments */
+	    na[4 * q->ncols] = p;
+	    q->colnames = na;
+	    if (q->colvals == NULL) {
+		q->colvals = ALLOC_N(VALUE, 4 * q->ncols);
+		if (q->colvals != NULL) {
+		    VALUE cname;
+		    VALUE colbuf[4];
 
-    if (scan_dtts(str, 1, 0, &tss)) {
-	DATE_STRUCT *date;
-	VALUE obj;
+		    for (i = 0; i < 4 * q->ncols; i++) {
+			q->colvals[i] = Qnil;
+		    }
+		    for (i = 0; i < 4; i++) {
+			colbuf[i] = rb_iv_get(q->self, colnamebuf[i]);
+			if (colbuf[i] == Qnil) {
+			    res = rb_hash_new();
+			    rb_iv_set(q->self, colnamebuf[i], res);
+			}
+		    }
+		    for (i = 0; i < 4 * q->ncols; i++) {
+			res = colbuf[i / q->ncols];
+			cname = rb_tainted_str_new2(q->colnames[i]);
+#ifdef USE_RB_ENC
+			rb_enc_associate(cname, rb_enc);
+#endif
+			q->colvals[i] = cname;
+			if (rb_funcall(res, IDkeyp, 1, cname) == Qtrue) {
+			    char *p;
 
-	if (load) {
-	    obj = Data_Make_Struct(self, DATE_STRUCT, 0, xfree, date);
+			    cname = rb_tainted_str_new2(q->colnames[i]);
+#ifdef USE_RB_ENC
+			    rb_enc_associate(cname, rb_enc);
+#endif
+			    p = q->colnames[4 * q->ncols];
+			    sprintf(p, "#%d", i);
+			    cname = rb_str_cat2(cname, p);
+			    q->colvals[i] = cname;
+			}
+#ifdef HAVE_RB_STR_TO_INTERNED_STR
+			cname = rb_str_to_interned_str(cname);
+			q->colvals[i] = cname;
+#else
+			rb_obj_freeze(cname);
+#endif
+			rb_hash_aset(res, cname, Qtrue);
+		    }
+		}
+	    }
+	}
+	/* FALL THRU */
+    case DOFETCH_HASHN:
+	if (mode & DOFETCH_BANG) {
+	    res = rb_iv_get(q->self, "@_h");
+	    if (res == Qnil) {
+		res = rb_hash_new();
+		rb_iv_set(q->self, "@_h", res);
+	    }
 	} else {
-	    obj = self;
-	    Data_Get_Struct(self, DATE_STRUCT, date);
+	    res = rb_hash_new();
+	}
+	break;
+    default:
+	if (mode & DOFETCH_BANG) {
+	    res = rb_iv_get(q->self, "@_a");
+	    if (res == Qnil) {
+		res = rb_ary_new2(q->ncols);
+		rb_iv_set(q->self, "@_a", res);
+	    } else {
+		rb_ary_clear(res);
+	    }
+	} else {
+	    res = rb_ary_new2(q->ncols);
 	}
-	date->year = tss.year;
-	date->month = tss.month;
-	date->day = tss.day;
-	return obj;
     }
-    if (load > 0) {
-	rb_raise(rb_eTypeError, "marshaled ODBC::Date format error");
+    offc = q->upc ? (2 * q->ncols) : 0;
+    switch (mode & DOFETCH_MODES) {
+    case DOFETCH_HASHK2:
+    case DOFETCH_HASH2:
+	offc += q->ncols;
+	break;
+    }
+    switch (mode & DOFETCH_MODES) {
+    case DOFETCH_HASH:
+    case DOFETCH_HASH2:
+	keys = q->colvals + offc;
+	break;
+    case DOFETCH_HASHK:
+    case DOFETCH_HASHK2:
+	keys = make_colsyms(q) + offc;
+	break;
+    }
+    if ((keys != NULL) || ((mode & DOFETCH_MODES) == DOFETCH_HASHN)) {
+	if (q->rowkv == NULL) {
+	    kv = ALLOC_N(VALUE, 2 * q->ncols);
+	    for (i = 0; i < 2 * q->ncols; i++) {
+		kv[i] = Qnil;
+	    }
+	    q->rowkv = kv;
+	}
+	kv = q->rowkv;
+    }
+#if (ODBCVER >= 0x0300)
+    if ((q->rsmode > 0) && q->rsgd && (q->rspos > 0)) {
+	/* position on row in row set for SQLGetData() */
+	diag_drain(q);
+	if (!succeeded(SQL_NULL_HENV, SQL_NULL_HDBC, q->hstmt,
+		       SQLSetPos(q->hstmt, q->rspos + 1, SQL_POSITION,
+				 SQL_LOCK_NO_CHANGE),
+		       &msg, "SQLSetPos(%d)", (int) (q->rspos + 1))) {
+	    rb_raise(Cerror, "%s", msg);
+	}
     }
-    return Qnil;
-}
+#endif
+    for (i = 0; i < q->ncols; i++) {
+	SQLLEN totlen;
+	SQLLEN curlen = q->coltypes[i].size;
+	SQLSMALLINT type = q->coltypes[i].type;
+	VALUE v;
+	char *valp, *freep = NULL;
 
-static VALUE
-date_load(VALUE self, VALUE str)
-{
-    return date_load1(self, str, 1);
-}
+	if (curlen == SQL_NO_TOTAL) {
+	    SQLLEN chunksize = SEGSIZE;
 
-static VALUE
-date_init(int argc, VALUE *argv, VALUE self)
-{
-    DATE_STRUCT *date;
-    VALUE d, m, y;
+	    totlen = 0;
+#ifdef UNICODE
+	    valp = ALLOC_N(char, chunksize + sizeof (SQLWCHAR));
+#else
+	    valp = ALLOC_N(char, chunksize + 1);
+#endif
+	    freep = valp;
+	    while ((curlen == SQL_NO_TOTAL) || (curlen > chunksize)) {
+		SQLRETURN rc;
+		int ret;
 
-    rb_scan_args(argc, argv, "03", &y, &m, &d);
-    if (rb_obj_is_kind_of(y, Cdate) == Qtrue) {
-	DATE_STRUCT *date2;
+		rc = nogvl_getdata(q->hstmt, (SQLUSMALLINT) (i + 1),
+				type, (SQLPOINTER) (valp + totlen),
+#ifdef UNICODE
+				((type == SQL_C_CHAR) || (type == SQL_C_WCHAR)) ?
+				(chunksize + (int) sizeof (SQLWCHAR)) :
+				chunksize,
+#else
+				(type == SQL_C_CHAR) ?
+				(chunksize + 1) : chunksize,
+#endif
+				&curlen);
+		if (rc == SQL_NO_DATA) {
+		    if (curlen == SQL_NO_TOTAL) {
+			curlen = totlen;
+		    }
+		    break;
+		}
+		ret = succeeded(SQL_NULL_HENV, SQL_NULL_HDBC, q->hstmt,
+				rc, &msg, "SQLGetData");
+		if (!ret) {
+		    xfree(valp);
+		    rb_raise(Cerror, "%s", msg);
+		}
+		if (curlen == SQL_NULL_DATA) {
+		    break;
+		}
+		if (curlen == SQL_NO_TOTAL) {
+		    totlen += chunksize;
+		} else if (curlen > chunksize) {
+		    totlen += chunksize;
+		    chunksize = curlen - chunksize;
+		} else {
+		    totlen += curlen;
+		    break;
+		}
+#ifdef UNICODE
+		REALLOC_N(valp, char, totlen + chunksize + sizeof (SQLWCHAR));
+#else
+		REALLOC_N(valp, char, totlen + chunksize + 1);
+#endif
+		if (valp == NULL) {
+		    if (freep != NULL) {
+			xfree(freep);
+		    }
+		    rb_raise(Cerror, "%s", set_err("Out of memory", 0));
+		}
+		freep = valp;
+	    }
+	    if (totlen > 0) {
+		curlen = totlen;
+	    }
+	} else if (q->rsmode > 0) {
+	    SQLLEN maxlen = curlen;
 
-	if (argc > 1) {
-	    rb_raise(rb_eArgError, "wrong # arguments");
-	}
-	Data_Get_Struct(self, DATE_STRUCT, date);
-	Data_Get_Struct(y, DATE_STRUCT, date2);
-	*date = *date2;
-	return self;
-    }
-    if (rb_obj_is_kind_of(y, Ctimestamp) == Qtrue) {
-	TIMESTAMP_STRUCT *ts;
+	    valp = q->rsbufs[i] + q->rspos * curlen;
+	    curlen = q->rslens[i * q->rsmax + q->rspos];
+	    if (type == SQL_C_CHAR) {
+		maxlen -= 1;
+#ifdef UNICODE
+	    } else if (type == SQL_C_WCHAR) {
+		maxlen -= sizeof (SQLWCHAR);
+#endif
+	    }
+	    if ((curlen == SQL_NO_TOTAL) || (curlen > maxlen)) {
+		/* truncated */
+		curlen = maxlen;
+	    }
+	} else {
+	    SQLRETURN ret;
+	    double t1 = stats_now();
 
-	if (argc > 1) {
-	    rb_raise(rb_eArgError, "wrong # arguments");
+	    totlen = curlen;
+	    valp = bufs[i];
+	    diag_drain(q);
+	    ret = SQLGetData(q->hstmt, (SQLUSMALLINT) (i + 1), type,
+			     (SQLPOINTER) valp, totlen, &curlen);
+	    stats_rec(q->dbcp, q, NOGVL_GETDATA, stats_now() - t1, 0,
+		      stats_getlen(ret, totlen, &curlen));
+	    if (!succeeded(SQL_NULL_HENV, SQL_NULL_HDBC, q->hstmt, ret,
+			   &msg, "SQLGetData")) {
+		rb_raise(Cerror, "%s", msg);
+	    }
 	}
-	Data_Get_Struct(self, DATE_STRUCT, date);
-	Data_Get_Struct(y, TIMESTAMP_STRUCT, ts);
-	date->year  = ts->year;
-	date->month = ts->month;
-	date->day   = ts->day;
-	return self;
-    }
-    if (rb_obj_is_kind_of(y, rb_cTime) == Qtrue) {
-	if (argc > 1) {
-	    rb_raise(rb_eArgError, "wrong # arguments");
+	v = col_value(q, i, valp, curlen);
+	if (freep != NULL) {
+	    xfree(freep);
 	}
-	d = rb_funcall(y, IDday, 0, NULL);
-	m = rb_funcall(y, IDmonth, 0, NULL);
-	y = rb_funcall(y, IDyear, 0, NULL);
-    } else if (rb_obj_is_kind_of(y, rb_cDate) == Qtrue) {
-	if (argc > 1) {
-	    rb_raise(rb_eArgError, "wrong # arguments");
+	if (kv != NULL) {
+	    kv[2 * i] = (keys != NULL) ? keys[i] : INT2FIX(i);
+	    kv[2 * i + 1] = v;
+	} else {
+	    rb_ary_push(res, v);
 	}
-	d = rb_funcall(y, IDmday, 0, NULL);
-	m = rb_funcall(y, IDmonth, 0, NULL);
-	y = rb_funcall(y, IDyear, 0, NULL);
-    } else if ((argc == 1) && (rb_obj_is_kind_of(y, rb_cString) == Qtrue)) {
-	if (date_load1(self, y, 0) != Qnil) {
-	    return self;
+    }
+    if (kv != NULL) {
+#ifdef HAVE_RB_HASH_BULK_INSERT
+	rb_hash_bulk_insert(2 * q->ncols, kv, res);
+#else
+	for (i = 0; i < q->ncols; i++) {
+	    rb_hash_aset(res, kv[2 * i], kv[2 * i + 1]);
+	}
+#endif
+	for (i = 0; i < 2 * q->ncols; i++) {
+	    kv[i] = Qnil;
 	}
     }
-    Data_Get_Struct(self, DATE_STRUCT, date);
-    date->year  = (y == Qnil) ? 0 : NUM2INT(y);
-    date->month = (m == Qnil) ? 0 : NUM2INT(m);
-    date->day   = (d == Qnil) ? 0 : NUM2INT(d);
-    return self;
+    stats_conv(q, stats_now() - t0 - (q->stats.drvtime - d0));
+    return res;
 }
 
 static VALUE
-date_clone(VALUE self)
+stmt_fetch1(VALUE self, int bang)
 {
-#ifdef HAVE_RB_DEFINE_ALLOC_FUNC
-    VALUE obj = rb_obj_alloc(CLASS_OF(self));
-    DATE_STRUCT *date1, *date2;
+    STMT *q;
+    SQLRETURN ret;
+    const char *msg;
+    char *err;
 
-    Data_Get_Struct(self, DATE_STRUCT, date1);
-    Data_Get_Struct(obj, DATE_STRUCT, date2);
-    *date2 = *date1;
-    return obj;
+    ODBC_Get_Struct(self, STMT, stmt_type, q);
+    if (q->ncols <= 0) {
+	return Qnil;
+    }
+    if (q->usef) {
+	goto usef;
+    }
+#if (ODBCVER < 0x0300)
+    msg = "SQLExtendedFetch(SQL_FETCH_NEXT)";
 #else
-    return date_new(1, &self, CLASS_OF(self));
+    msg = "SQLFetchScroll(SQL_FETCH_NEXT)";
 #endif
+    ret = fetch_rowset(q, SQL_FETCH_NEXT, 0, 0);
+    if (ret == SQL_NO_DATA) {
+	(void) tracesql(SQL_NULL_HENV, SQL_NULL_HDBC, q->hstmt, ret, msg);
+	return Qnil;
+    }
+    if (succeeded(SQL_NULL_HENV, SQL_NULL_HDBC, q->hstmt, ret, &err, msg)) {
+	return do_fetch(q, DOFETCH_ARY | (bang ? DOFETCH_BANG : 0));
+    }
+    if ((err != NULL) &&
+	((strncmp(err, "IM001", 5) == 0) ||
+	 (strncmp(err, "HYC00", 5) == 0))) {
+usef:
+	/* Fallback to SQLFetch() when others not implemented */
+	msg = "SQLFetch";
+	q->usef = 1;
+	ret = fetch_rowset(q, SQL_FETCH_NEXT, 0, 1);
+	if (ret == SQL_NO_DATA) {
+	    (void) tracesql(SQL_NULL_HENV, SQL_NULL_HDBC, q->hstmt, ret, msg);
+	    return Qnil;
+	}
+	if (succeeded(SQL_NULL_HENV, SQL_NULL_HDBC, q->hstmt, ret,
+		      &err, msg)) {
+	    return do_fetch(q, DOFETCH_ARY | (bang ? DOFETCH_BANG : 0));
+	}
+    }
+    rb_raise(Cerror, "%s", err);
+    return Qnil;
 }
 
 static VALUE
-date_to_s(VALUE self)
-{
-    DATE_STRUCT *date;
-    char buf[128];
-
-    Data_Get_Struct(self, DATE_STRUCT, date);
-    sprintf(buf, "%04d-%02d-%02d", date->year, date->month, date->day);
-    return rb_str_new2(buf);
-}
-
-static VALUE
-date_dump(VALUE self, VALUE depth)
+stmt_fetch(VALUE self)
 {
-    return date_to_s(self);
+    if (rb_block_given_p()) {
+	return stmt_each(self);
+    }
+    return stmt_fetch1(self, 0);
 }
 
 static VALUE
-date_inspect(VALUE self)
+stmt_fetch_bang(VALUE self)
 {
-    VALUE s = rb_str_new2("#<ODBC::Date: ");
-
-    s = rb_str_append(s, date_to_s(self));
-    return rb_str_append(s, rb_str_new2(">"));
+    if (rb_block_given_p()) {
+	return stmt_each(self);
+    }
+    return stmt_fetch1(self, 1);
 }
 
 static VALUE
-date_year(int argc, VALUE *argv, VALUE self)
+stmt_fetch_first1(VALUE self, int bang, int nopos)
 {
-    DATE_STRUCT *date;
-    VALUE v;
+    STMT *q;
+    SQLRETURN ret;
+    const char *msg;
+    char *err;
 
-    rb_scan_args(argc, argv, "01", &v);
-    Data_Get_Struct(self, DATE_STRUCT, date);
-    if (v == Qnil) {
-	return INT2NUM(date->year);
+    ODBC_Get_Struct(self, STMT, stmt_type, q);
+    if (q->ncols <= 0) {
+	return Qnil;
     }
-    date->year = NUM2INT(v);
-    return self;
+    if (nopos) {
+	goto dofetch;
+    }
+#if (ODBCVER < 0x0300)
+    msg = "SQLExtendedFetch(SQL_FETCH_FIRST)";
+#else
+    msg = "SQLFetchScroll(SQL_FETCH_FIRST)";
+#endif
+    ret = fetch_rowset(q, SQL_FETCH_FIRST, 0, 0);
+    if (ret == SQL_NO_DATA) {
+	(void) tracesql(SQL_NULL_HENV, SQL_NULL_HDBC, q->hstmt, ret, msg);
+	return Qnil;
+    }
+    if (succeeded(SQL_NULL_HENV, SQL_NULL_HDBC, q->hstmt, ret, &err, msg)) {
+dofetch:
+	return do_fetch(q, DOFETCH_ARY | (bang ? DOFETCH_BANG : 0));
+    }
+    rb_raise(Cerror, "%s", err);
+    return Qnil;
 }
 
 static VALUE
-date_month(int argc, VALUE *argv, VALUE self)
+stmt_fetch_first(VALUE self)
 {
-    DATE_STRUCT *date;
-    VALUE v;
-
-    rb_scan_args(argc, argv, "01", &v);
-    Data_Get_Struct(self, DATE_STRUCT, date);
-    if (v == Qnil) {
-	return INT2NUM(date->month);
-    }
-    date->month = NUM2INT(v);
-    return self;
+    return stmt_fetch_first1(self, 0, 0);
 }
 
 static VALUE
-date_day(int argc, VALUE *argv, VALUE self)
+stmt_fetch_first_bang(VALUE self)
 {
-    DATE_STRUCT *date;
-    VALUE v;
-
-    rb_scan_args(argc, argv, "01", &v);
-    Data_Get_Struct(self, DATE_STRUCT, date);
-    if (v == Qnil) {
-	return INT2NUM(date->day);
-    }
-    date->day = NUM2INT(v);
-    return self;
+    return stmt_fetch_first1(self, 1, 0);
 }
 
 static VALUE
-date_cmp(VALUE self, VALUE date)
+stmt_fetch_scroll1(int argc, VALUE *argv, VALUE self, int bang)
 {
-    DATE_STRUCT *date1, *date2;
+    STMT *q;
+    VALUE dir, offs;
+    SQLRETURN ret;
+    int idir, ioffs = 1;
+    char msg[128], *err;
 
-    if (rb_obj_is_kind_of(date, Cdate) != Qtrue) {
-	rb_raise(rb_eTypeError, "need ODBC::Date as argument");
+    rb_scan_args(argc, argv, "11", &dir, &offs);
+    idir = NUM2INT(dir);
+    if (offs != Qnil) {
+	ioffs = NUM2INT(offs);
     }
-    Data_Get_Struct(self, DATE_STRUCT, date1);
-    Data_Get_Struct(date, DATE_STRUCT, date2);
-    if (date1->year < date2->year) {
-	return INT2FIX(-1);
+    ODBC_Get_Struct(self, STMT, stmt_type, q);
+    if (q->ncols <= 0) {
+	return Qnil;
     }
-    if (date1->year == date2->year) {
-	if (date1->month < date2->month) {
-	    return INT2FIX(-1);
-	}
-	if (date1->month == date2->month) {
-	    if (date1->day < date2->day) {
-		return INT2FIX(-1);
-	    }
-	    if (date1->day == date2->day) {
-		return INT2FIX(0);
-	    }
-	}
+#if (ODBCVER < 0x0300)
+    sprintf(msg, "SQLExtendedFetch(%d)", idir);
+#else
+    sprintf(msg, "SQLFetchScroll(%d)", idir);
+#endif
+    ret = fetch_rowset(q, idir, ioffs, 0);
+    if (ret == SQL_NO_DATA) {
+	(void) tracesql(SQL_NULL_HENV, SQL_NULL_HDBC, q->hstmt, ret, msg);
+	return Qnil;
     }
-    return INT2FIX(1);
+    if (succeeded(SQL_NULL_HENV, SQL_NULL_HDBC, q->hstmt, ret, &err, msg)) {
+	return do_fetch(q, DOFETCH_ARY | (bang ? DOFETCH_BANG : 0));
+    }
+    rb_raise(Cerror, "%s", err);
+    return Qnil;
 }
 
-/*
- *----------------------------------------------------------------------
- *
- *      Time methods.
- *
- *----------------------------------------------------------------------
- */
-
-#ifdef HAVE_RB_DEFINE_ALLOC_FUNC
 static VALUE
-time_alloc(VALUE self)
+stmt_fetch_scroll(int argc, VALUE *argv, VALUE self)
 {
-    TIME_STRUCT *time;
-    VALUE obj = Data_Make_Struct(self, TIME_STRUCT, 0, xfree, time);
-
-    memset(time, 0, sizeof (*time));
-    return obj;
+    return stmt_fetch_scroll1(argc, argv, self, 0);
 }
-#else
+
 static VALUE
-time_new(int argc, VALUE *argv, VALUE self)
+stmt_fetch_scroll_bang(int argc, VALUE *argv, VALUE self)
 {
-    TIME_STRUCT *time;
-    VALUE obj = Data_Make_Struct(self, TIME_STRUCT, 0, xfree, time);
-
-    rb_obj_call_init(obj, argc, argv);
-    return obj;
+    return stmt_fetch_scroll1(argc, argv, self, 1);
 }
-#endif
 
 static VALUE
-time_load1(VALUE self, VALUE str, int load)
+stmt_fetch_many(VALUE self, VALUE arg)
 {
-    TIMESTAMP_STRUCT tss;
+    int i, max = 0, all = arg == Qnil;
+    VALUE res;
 
-    if (scan_dtts(str, 0, 1, &tss)) {
-	TIME_STRUCT *time;
-	VALUE obj;
+    if (!all) {
+	max = NUM2INT(arg);
+    }
+    res = rb_ary_new();
+    for (i = 0; all || (i < max); i++) {
+	VALUE v = stmt_fetch1(self, 0);
 
-	if (load) {
-	    obj = Data_Make_Struct(self, TIME_STRUCT, 0, xfree, time);
-	} else {
-	    obj = self;
-	    Data_Get_Struct(self, TIME_STRUCT, time);
+	if (v == Qnil) {
+	    break;
 	}
-	time->hour = tss.hour;
-	time->minute = tss.minute;
-	time->second = tss.second;
-	return obj;
-    }
-    if (load > 0) {
-	rb_raise(rb_eTypeError, "marshaled ODBC::Time format error");
+	rb_ary_push(res, v);
     }
-    return Qnil;
+    return (i == 0) ? Qnil : res;
 }
 
 static VALUE
-time_load(VALUE self, VALUE str)
+stmt_fetch_all(VALUE self)
 {
-    return time_load1(self, str, 1);
+    return stmt_fetch_many(self, Qnil);
 }
 
+/*
+ *----------------------------------------------------------------------
+ *
+ *      Streaming retrieval of long columns.
+ *
+ *      Statement.next_row positions the cursor on the next row
+ *      without retrieving any column, Statement.get_data then
+ *      reads a column piecewise by SQLGetData() into a buffer of
+ *      fixed size which is reused for all chunks.
+ *
+ *----------------------------------------------------------------------
+ */
+
 static VALUE
-time_init(int argc, VALUE *argv, VALUE self)
+stmt_next_row(VALUE self)
 {
-    TIME_STRUCT *time;
-    VALUE h, m, s;
-
-    rb_scan_args(argc, argv, "03", &h, &m, &s);
-    if (rb_obj_is_kind_of(h, Ctime) == Qtrue) {
-	TIME_STRUCT *time2;
+    STMT *q;
+    SQLRETURN ret;
+    const char *msg;
+    char *err;
 
-	if (argc > 1) {
-	    rb_raise(rb_eArgError, "wrong # arguments");
+    ODBC_Get_Struct(self, STMT, stmt_type, q);
+    if (q->ncols <= 0) {
+	return Qfalse;
+    }
+    if (q->usef) {
+	goto usef;
+    }
+#if (ODBCVER < 0x0300)
+    msg = "SQLExtendedFetch(SQL_FETCH_NEXT)";
+#else
+    msg = "SQLFetchScroll(SQL_FETCH_NEXT)";
+#endif
+    ret = fetch_rowset(q, SQL_FETCH_NEXT, 0, 0);
+    if (ret == SQL_NO_DATA) {
+	(void) tracesql(SQL_NULL_HENV, SQL_NULL_HDBC, q->hstmt, ret, msg);
+	return Qfalse;
+    }
+    if (succeeded(SQL_NULL_HENV, SQL_NULL_HDBC, q->hstmt, ret, &err, msg)) {
+	return Qtrue;
+    }
+    if ((err != NULL) &&
+	((strncmp(err, "IM001", 5) == 0) ||
+	 (strncmp(err, "HYC00", 5) == 0))) {
+usef:
+	msg = "SQLFetch";
+	q->usef = 1;
+	ret = fetch_rowset(q, SQL_FETCH_NEXT, 0, 1);
+	if (ret == SQL_NO_DATA) {
+	    (void) tracesql(SQL_NULL_HENV, SQL_NULL_HDBC, q->hstmt, ret, msg);
+	    return Qfalse;
+	}
+	if (succeeded(SQL_NULL_HENV, SQL_NULL_HDBC, q->hstmt, ret,
+		      &err, msg)) {
+	    return Qtrue;
 	}
-	Data_Get_Struct(self, TIME_STRUCT, time);
-	Data_Get_Struct(h, TIME_STRUCT, time2);
-	*time = *time2;
-	return self;
     }
-    if (rb_obj_is_kind_of(h, Ctimestamp) == Qtrue) {
-	TIMESTAMP_STRUCT *ts;
+    rb_raise(Cerror, "%s", err);
+    return Qnil;
+}
 
-	if (argc > 1) {
-	    rb_raise(rb_eArgError, "wrong # arguments");
+typedef struct {
+    STMT *q;
+    VALUE io;
+    VALUE res;
+    SQLUSMALLINT col;
+    SQLSMALLINT type;
+    SQLLEN chunksize;
+    long total;
+    char *buf;
+} GETDATA;
+
+static void
+get_data_emit(GETDATA *g, char *p, SQLLEN len)
+{
+    VALUE v;
+
+#ifdef UNICODE
+    if (g->type == SQL_C_WCHAR) {
+	v = uc_tainted_str_new((SQLWCHAR *) p, len / sizeof (SQLWCHAR));
+    } else
+#endif
+    {
+	v = rb_tainted_str_new(p, len);
+#ifdef USE_RB_ENC
+	if (g->type == SQL_C_CHAR) {
+	    rb_enc_associate(v, rb_enc);
 	}
-	Data_Get_Struct(self, TIME_STRUCT, time);
-	Data_Get_Struct(h, TIMESTAMP_STRUCT, ts);
-	time->hour   = ts->hour;
-	time->minute = ts->minute;
-	time->second = ts->second;
-	return self;
+#endif
     }
-    if (rb_obj_is_kind_of(h, rb_cTime) == Qtrue) {
-	if (argc > 1) {
-	    rb_raise(rb_eArgError, "wrong # arguments");
-	}
-	s = rb_funcall(h, IDsec, 0, NULL);
-	m = rb_funcall(h, IDmin, 0, NULL);
-	h = rb_funcall(h, IDhour, 0, NULL);
-    } else if ((argc == 1) && (rb_obj_is_kind_of(h, rb_cString) == Qtrue)) {
-	if (time_load1(self, h, 0) != Qnil) {
-	    return self;
-	}
+    g->total += RSTRING_LEN(v);
+    if (g->res != Qnil) {
+	rb_str_append(g->res, v);
+    } else if (g->io != Qnil) {
+	rb_funcall(g->io, IDwrite, 1, v);
+    } else {
+	rb_yield(v);
     }
-    Data_Get_Struct(self, TIME_STRUCT, time);
-    time->hour   = (h == Qnil) ? 0 : NUM2INT(h);
-    time->minute = (m == Qnil) ? 0 : NUM2INT(m);
-    time->second = (s == Qnil) ? 0 : NUM2INT(s);
-    return self;
 }
 
 static VALUE
-time_clone(VALUE self)
+get_data_body(VALUE arg)
 {
-#ifdef HAVE_RB_DEFINE_ALLOC_FUNC
-    VALUE obj = rb_obj_alloc(CLASS_OF(self));
-    TIME_STRUCT *time1, *time2;
+    GETDATA *g = (GETDATA *) arg;
+    STMT *q = g->q;
+    SQLLEN curlen, len, avail, keep = 0, term = 0;
+    SQLRETURN rc;
+    char *msg;
+    int more;
 
-    Data_Get_Struct(self, TIME_STRUCT, time1);
-    Data_Get_Struct(obj, TIME_STRUCT, time2);
-    *time2 = *time1;
-    return obj;
-#else
-    return time_new(1, &self, CLASS_OF(self));
+    if (g->type == SQL_C_CHAR) {
+	term = 1;
+#ifdef UNICODE
+    } else if (g->type == SQL_C_WCHAR) {
+	term = sizeof (SQLWCHAR);
+#endif
+    }
+    do {
+	rc = nogvl_getdata(q->hstmt, g->col, g->type,
+			   (SQLPOINTER) (g->buf + keep),
+			   g->chunksize + term - keep, &curlen);
+	if (rc == SQL_NO_DATA) {
+	    /* column already read completely */
+	    break;
+	}
+	if (!succeeded(SQL_NULL_HENV, SQL_NULL_HDBC, q->hstmt, rc,
+		       &msg, "SQLGetData")) {
+	    rb_raise(Cerror, "%s", msg);
+	}
+	if (curlen == SQL_NULL_DATA) {
+	    return Qnil;
+	}
+	avail = g->chunksize - keep;
+	more = (curlen == SQL_NO_TOTAL) || (curlen > avail);
+	len = keep + (more ? avail : curlen);
+	keep = 0;
+#ifdef UNICODE
+	if (more && (g->type == SQL_C_WCHAR) &&
+	    (sizeof (SQLWCHAR) == (2 * sizeof (char)))) {
+	    SQLWCHAR c = ((SQLWCHAR *) g->buf)[len / sizeof (SQLWCHAR) - 1];
+
+	    /* don't split surrogate pair across chunks */
+	    if ((c >= 0xd800) && (c <= 0xdbff)) {
+		keep = sizeof (SQLWCHAR);
+		len -= keep;
+	    }
+	}
 #endif
+	get_data_emit(g, g->buf, len);
+	if (keep > 0) {
+	    memmove(g->buf, g->buf + len, keep);
+	}
+    } while (more);
+    if (keep > 0) {
+	get_data_emit(g, g->buf, keep);
+    }
+    if (g->res != Qnil) {
+	return g->res;
+    }
+    return LONG2NUM(g->total);
 }
 
 static VALUE
-time_to_s(VALUE self)
+get_data_ensure(VALUE arg)
 {
-    TIME_STRUCT *time;
-    char buf[128];
-
-    Data_Get_Struct(self, TIME_STRUCT, time);
-    sprintf(buf, "%02d:%02d:%02d", time->hour, time->minute, time->second);
-    return rb_str_new2(buf);
-}
+    GETDATA *g = (GETDATA *) arg;
 
-static VALUE
-time_dump(VALUE self, VALUE depth)
-{
-    return time_to_s(self);
+    if (g->buf != NULL) {
+	xfree(g->buf);
+	g->buf = NULL;
+    }
+    return Qnil;
 }
 
 static VALUE
-time_inspect(VALUE self)
+stmt_get_data(int argc, VALUE *argv, VALUE self)
 {
-    VALUE s = rb_str_new2("#<ODBC::Time: ");
+    STMT *q;
+    GETDATA g;
+    VALUE col, io, size;
+    int c;
+    char *msg;
 
-    s = rb_str_append(s, time_to_s(self));
-    return rb_str_append(s, rb_str_new2(">"));
+    rb_scan_args(argc, argv, "12", &col, &io, &size);
+    ODBC_Get_Struct(self, STMT, stmt_type, q);
+    if (q->ncols <= 0) {
+	rb_raise(Cerror, "%s", set_err("No columns in result set", 0));
+    }
+    Check_Type(col, T_FIXNUM);
+    c = FIX2INT(col);
+    if ((c < 0) || (c >= q->ncols)) {
+	rb_raise(rb_eArgError, "invalid column number");
+    }
+    g.q = q;
+    g.io = io;
+    g.res = Qnil;
+    g.col = (SQLUSMALLINT) (c + 1);
+    g.total = 0;
+    g.buf = NULL;
+    g.chunksize = SEGSIZE;
+    if (size != Qnil) {
+	g.chunksize = NUM2INT(size);
+	if (g.chunksize < 16) {
+	    g.chunksize = 16;
+	}
+    }
+    if ((io == Qnil) && !rb_block_given_p()) {
+	g.res = rb_tainted_str_new("", 0);
+#ifdef USE_RB_ENC
+	if (q->coltypes[c].type != SQL_C_BINARY) {
+	    rb_enc_associate(g.res, rb_enc);
+	}
+#endif
+    }
+    if (q->coltypes[c].type == SQL_C_BINARY) {
+	g.type = SQL_C_BINARY;
+    } else {
+#ifdef UNICODE
+	g.type = SQL_C_WCHAR;
+	g.chunksize -= g.chunksize % sizeof (SQLWCHAR);
+#else
+	g.type = SQL_C_CHAR;
+#endif
+    }
+#if (ODBCVER >= 0x0300)
+    if (q->rsmode > 0) {
+	if (q->rsbufs[c] != NULL) {
+	    rb_raise(Cerror, "%s",
+		     set_err("Column is bound in row set, use fetch", 0));
+	}
+	if (q->rspos > 0) {
+	    /* position on row in row set for SQLGetData() */
+	    diag_drain(q);
+	    if (!succeeded(SQL_NULL_HENV, SQL_NULL_HDBC, q->hstmt,
+			   SQLSetPos(q->hstmt, q->rspos + 1, SQL_POSITION,
+				     SQL_LOCK_NO_CHANGE),
+			   &msg, "SQLSetPos(%d)", (int) (q->rspos + 1))) {
+		rb_raise(Cerror, "%s", msg);
+	    }
+	}
+    }
+#endif
+    g.buf = ALLOC_N(char, g.chunksize + sizeof (SQLWCHAR));
+    if (g.buf == NULL) {
+	rb_raise(Cerror, "%s", set_err("Out of memory", 0));
+    }
+    return rb_ensure(get_data_body, (VALUE) &g, get_data_ensure, (VALUE) &g);
 }
 
-static VALUE
-time_hour(int argc, VALUE *argv, VALUE self)
-{
-    TIME_STRUCT *time;
-    VALUE v;
+/*
+ *----------------------------------------------------------------------
+ *
+ *      Columnar retrieval.
+ *
+ *      Statement.fetch_columns collects rows into one Array per
+ *      column. With a row set (see Statement.rowsetsize) values are
+ *      taken column by column from the bound row set buffers, fixed
+ *      width numeric columns can be returned as packed Strings.
+ *
+ *----------------------------------------------------------------------
+ */
 
-    rb_scan_args(argc, argv, "01", &v);
-    Data_Get_Struct(self, TIME_STRUCT, time);
-    if (v == Qnil) {
-	return INT2NUM(time->hour);
+static int
+col_packsize(SQLSMALLINT type)
+{
+    switch (type) {
+    case SQL_C_LONG:
+	return sizeof (SQLINTEGER);
+    case SQL_C_DOUBLE:
+	return sizeof (double);
+#ifdef SQL_C_SBIGINT
+    case SQL_C_SBIGINT:
+	return sizeof (SQLBIGINT);
+#endif
+#ifdef SQL_C_UBIGINT
+    case SQL_C_UBIGINT:
+	return sizeof (SQLBIGINT);
+#endif
     }
-    time->hour = NUM2INT(v);
-    return self;
+    return 0;
 }
 
-static VALUE
-time_min(int argc, VALUE *argv, VALUE self)
+static void
+col_pack(VALUE col, SQLSMALLINT type, char *valp, SQLLEN curlen)
 {
-    TIME_STRUCT *time;
-    VALUE v;
+    union {
+	SQLINTEGER l;
+	double d;
+#ifdef SQL_C_SBIGINT
+	SQLBIGINT b;
+#endif
+    } zero;
 
-    rb_scan_args(argc, argv, "01", &v);
-    Data_Get_Struct(self, TIME_STRUCT, time);
-    if (v == Qnil) {
-	return INT2NUM(time->minute);
+    if (curlen == SQL_NULL_DATA) {
+	memset(&zero, 0, sizeof (zero));
+#ifdef NAN
+	if (type == SQL_C_DOUBLE) {
+	    zero.d = NAN;
+	}
+#endif
+	valp = (char *) &zero;
     }
-    time->minute = NUM2INT(v);
-    return self;
+    rb_str_cat(col, valp, col_packsize(type));
 }
 
-static VALUE
-time_sec(int argc, VALUE *argv, VALUE self)
+static void
+col_pack_value(VALUE col, SQLSMALLINT type, VALUE v)
 {
-    TIME_STRUCT *time;
-    VALUE v;
+    union {
+	SQLINTEGER l;
+	double d;
+#ifdef SQL_C_SBIGINT
+	SQLBIGINT b;
+#endif
+    } val;
 
-    rb_scan_args(argc, argv, "01", &v);
-    Data_Get_Struct(self, TIME_STRUCT, time);
     if (v == Qnil) {
-	return INT2NUM(time->second);
+	col_pack(col, type, NULL, SQL_NULL_DATA);
+	return;
     }
-    time->second = NUM2INT(v);
-    return self;
+    switch (type) {
+    case SQL_C_LONG:
+	val.l = NUM2INT(v);
+	break;
+    case SQL_C_DOUBLE:
+	val.d = NUM2DBL(v);
+	break;
+#ifdef SQL_C_SBIGINT
+    case SQL_C_SBIGINT:
+	val.b = NUM2LL(v);
+	break;
+#endif
+#ifdef SQL_C_UBIGINT
+    case SQL_C_UBIGINT:
+	val.b = (SQLBIGINT) NUM2ULL(v);
+	break;
+#endif
+    }
+    col_pack(col, type, (char *) &val, 0);
 }
 
 static VALUE
-time_cmp(VALUE self, VALUE time)
+stmt_fetch_columns(int argc, VALUE *argv, VALUE self)
 {
-    TIME_STRUCT *time1, *time2;
+    STMT *q;
+    VALUE max, packed, res;
+    long nrows = 0, limit = 0;
+    int i, *packs;
 
-    if (rb_obj_is_kind_of(time, Ctime) != Qtrue) {
-	rb_raise(rb_eTypeError, "need ODBC::Time as argument");
+    rb_scan_args(argc, argv, "02", &max, &packed);
+    if (max != Qnil) {
+	limit = NUM2LONG(max);
+	if (limit <= 0) {
+	    rb_raise(rb_eArgError, "max_rows must be positive");
+	}
     }
-    Data_Get_Struct(self, TIME_STRUCT, time1);
-    Data_Get_Struct(time, TIME_STRUCT, time2);
-    if (time1->hour < time2->hour) {
-	return INT2FIX(-1);
+    ODBC_Get_Struct(self, STMT, stmt_type, q);
+    if (q->ncols <= 0) {
+	return Qnil;
     }
-    if (time1->hour == time2->hour) {
-	if (time1->minute < time2->minute) {
-	    return INT2FIX(-1);
-	}
-	if (time1->minute == time2->minute) {
-	    if (time1->second < time2->second) {
-		return INT2FIX(-1);
+    res = rb_ary_new2(q->ncols);
+    packs = ALLOCA_N(int, q->ncols);
+    for (i = 0; i < q->ncols; i++) {
+	packs[i] = RTEST(packed) ? col_packsize(q->coltypes[i].type) : 0;
+	rb_ary_push(res, packs[i] ? rb_str_new(NULL, 0) : rb_ary_new());
+    }
+    while (((max == Qnil) || (nrows < limit)) &&
+	   (stmt_next_row(self) == Qtrue)) {
+	if ((q->rsmode > 0) && !q->rsgd) {
+	    SQLULEN r, last = q->rspos;
+
+	    /* take the rest of the row set column by column */
+	    for (r = q->rspos; r < q->rsrows; r++) {
+		if (q->rsstat[r] == SQL_ROW_NOROW) {
+		    continue;
+		}
+		if (q->rsstat[r] == SQL_ROW_ERROR) {
+		    rb_raise(Cerror, "%s",
+			     set_err("Error in row of row set", 0));
+		}
+		last = r;
+		nrows++;
+		if ((max != Qnil) && (nrows >= limit)) {
+		    break;
+		}
 	    }
-	    if (time1->second == time2->second) {
-		return INT2FIX(0);
+	    for (i = 0; i < q->ncols; i++) {
+		VALUE col = rb_ary_entry(res, i);
+		SQLLEN size = q->coltypes[i].size;
+		SQLLEN *lens = q->rslens + i * q->rsmax;
+
+		for (r = q->rspos; r <= last; r++) {
+		    char *valp = q->rsbufs[i] + r * size;
+		    SQLLEN curlen = lens[r];
+
+		    if (q->rsstat[r] == SQL_ROW_NOROW) {
+			continue;
+		    }
+		    if (packs[i]) {
+			col_pack(col, q->coltypes[i].type, valp, curlen);
+			continue;
+		    }
+		    if (curlen != SQL_NULL_DATA) {
+			SQLLEN maxlen = size;
+
+			if (q->coltypes[i].type == SQL_C_CHAR) {
+			    maxlen -= 1;
+#ifdef UNICODE
+			} else if (q->coltypes[i].type == SQL_C_WCHAR) {
+			    maxlen -= sizeof (SQLWCHAR);
+#endif
+			}
+			if ((curlen == SQL_NO_TOTAL) || (curlen > maxlen)) {
+			    /* truncated */
+			    curlen = maxlen;
+			}
+		    }
+		    rb_ary_push(col, col_value(q, i, valp, curlen));
+		}
+	    }
+	    q->rspos = last;
+	} else {
+	    VALUE row = do_fetch(q, DOFETCH_ARY | DOFETCH_BANG);
+
+	    for (i = 0; i < q->ncols; i++) {
+		VALUE col = rb_ary_entry(res, i);
+
+		if (packs[i]) {
+		    col_pack_value(col, q->coltypes[i].type,
+				   rb_ary_entry(row, i));
+		} else {
+		    rb_ary_push(col, rb_ary_entry(row, i));
+		}
 	    }
+	    nrows++;
 	}
     }
-    return INT2FIX(1);
+    return (nrows == 0) ? Qnil : res;
 }
 
 /*
  *----------------------------------------------------------------------
  *
- *      TimeStamp methods.
+ *      Apache Arrow IPC stream export.
+ *
+ *      Statement.to_arrow_ipc writes the remaining rows of the result
+ *      set to an IO in the Arrow IPC streaming format: a Schema
+ *      message, one RecordBatch message per batch_rows rows and the
+ *      end-of-stream marker. Values are copied from the fetch buffers
+ *      into the Arrow buffers without Ruby objects, the flatbuffer
+ *      metadata is produced by the minimal writer below.
  *
  *----------------------------------------------------------------------
  */
 
-#ifdef HAVE_RB_DEFINE_ALLOC_FUNC
-static VALUE
-timestamp_alloc(VALUE self)
+/* Arrow type of a column */
+#define ARROW_INT32     0
+#define ARROW_INT64     1
+#define ARROW_UINT64    2
+#define ARROW_FLOAT64   3
+#define ARROW_TIMESTAMP 4
+#define ARROW_DATE32    5
+#define ARROW_TIME32    6
+#define ARROW_UTF8      7
+#define ARROW_BINARY    8
+
+/* Message header types */
+#define ARROW_MSG_SCHEMA 1
+#define ARROW_MSG_BATCH  3
+
+/* Growable byte buffer */
+typedef struct {
+    char *ptr;
+    size_t len;
+    size_t cap;
+} ABUF;
+
+typedef struct {
+    SQLSMALLINT ctype;
+    int atype;
+    int width;
+    long nulls;
+    ABUF valid;
+    ABUF data;
+    ABUF offs;
+} ARROWCOL;
+
+typedef struct {
+    STMT *q;
+    VALUE self;
+    VALUE io;
+    VALUE names;
+    long batch;
+    long total;
+    ARROWCOL *cols;
+    ABUF fb;
+    ABUF scratch;
+} ARROW;
+
+static char *
+abuf_grow(ABUF *b, size_t n)
 {
-    TIMESTAMP_STRUCT *ts;
-    VALUE obj = Data_Make_Struct(self, TIMESTAMP_STRUCT, 0, xfree, ts);
+    if (b->len + n > b->cap) {
+	size_t cap = (b->cap < 256) ? 256 : b->cap;
 
-    memset(ts, 0, sizeof (*ts));
-    return obj;
+	while (cap < b->len + n) {
+	    cap *= 2;
+	}
+	REALLOC_N(b->ptr, char, cap);
+	b->cap = cap;
+    }
+    return b->ptr + b->len;
 }
-#else
-static VALUE
-timestamp_new(int argc, VALUE *argv, VALUE self)
+
+static size_t
+abuf_put(ABUF *b, const void *data, size_t n)
 {
-    TIMESTAMP_STRUCT *ts;
-    VALUE obj = Data_Make_Struct(self, TIMESTAMP_STRUCT, 0, xfree, ts);
+    size_t pos = b->len;
+    char *p = abuf_grow(b, n);
 
-    rb_obj_call_init(obj, argc, argv);
-    return obj;
+    if (data != NULL) {
+	memcpy(p, data, n);
+    } else {
+	memset(p, 0, n);
+    }
+    b->len += n;
+    return pos;
 }
-#endif
 
-static VALUE
-timestamp_load1(VALUE self, VALUE str, int load)
-{
-    TIMESTAMP_STRUCT tss;
+/* Pad with zeros until length modulo align equals rem. */
 
-    if (scan_dtts(str, !load, !load, &tss)) {
-	TIMESTAMP_STRUCT *ts;
-	VALUE obj;
+static void
+abuf_align(ABUF *b, size_t align, size_t rem)
+{
+    abuf_put(b, NULL, (align + rem - (b->len % align)) % align);
+}
 
-	if (load) {
-	    obj = Data_Make_Struct(self, TIMESTAMP_STRUCT, 0, xfree, ts);
-	} else {
-	    obj = self;
-	    Data_Get_Struct(self, TIMESTAMP_STRUCT, ts);
-	}
-	*ts = tss;
-	return obj;
-    }
-    if (load > 0) {
-	rb_raise(rb_eTypeError, "marshaled ODBC::TimeStamp format error");
+static void
+abuf_free(ABUF *b)
+{
+    if (b->ptr != NULL) {
+	xfree(b->ptr);
     }
-    return Qnil;
+    b->ptr = NULL;
+    b->len = b->cap = 0;
 }
 
-static VALUE
-timestamp_load(VALUE self, VALUE str)
+/* Flatbuffers are always little endian. */
+
+static void
+fb_le(char *p, SQLBIGINT val, int size)
 {
-    return timestamp_load1(self, str, 1);
+    SQLUBIGINT v = (SQLUBIGINT) val;
+    int k;
+
+    for (k = 0; k < size; k++) {
+	p[k] = (char) (v & 0xff);
+	v >>= 8;
+    }
 }
 
-static VALUE
-timestamp_init(int argc, VALUE *argv, VALUE self)
+/* Point the offset field at position at to position target. */
+
+static void
+fb_patch(ABUF *b, size_t at, size_t target)
 {
-    TIMESTAMP_STRUCT *ts;
-    VALUE d, m, y, hh, mm, ss, f;
+    fb_le(b->ptr + at, (SQLBIGINT) (target - at), 4);
+}
 
-    rb_scan_args(argc, argv, "07", &y, &m, &d, &hh, &mm, &ss, &f);
-    if (rb_obj_is_kind_of(y, Ctimestamp) == Qtrue) {
-	TIMESTAMP_STRUCT *ts2;
+typedef struct {
+    int id;
+    int size;
+    SQLBIGINT val;
+} FBFIELD;
 
-	if (argc > 1) {
-	    rb_raise(rb_eArgError, "wrong # arguments");
-	}
-	Data_Get_Struct(self, TIMESTAMP_STRUCT, ts);
-	Data_Get_Struct(y, TIMESTAMP_STRUCT, ts2);
-	*ts = *ts2;
-	return self;
-    }
-    if (rb_obj_is_kind_of(y, Cdate) == Qtrue) {
-	DATE_STRUCT *date;
+#define FB_MAXFIELDS 8
 
-	if (argc > 1) {
-	    if (argc > 2) {
-		rb_raise(rb_eArgError, "wrong # arguments");
-	    }
-	    if (rb_obj_is_kind_of(m, Ctime) == Qtrue) {
-		TIME_STRUCT *time;
+/*
+ * Append a table given by nf fields (size 1, 2, 4, 8 for scalars,
+ * 0 for an offset to be patched later) preceded by its vtable.
+ * Positions of offset fields are stored into offs, indexed like f.
+ * Objects are laid out front to back, thus everything referenced
+ * by offsets must be appended after the table.
+ */
+
+static size_t
+fb_table(ABUF *b, const FBFIELD *f, int nf, size_t *offs)
+{
+    static const int order[] = { 8, 4, 0, 2, 1 };
+    int i, k, nslots = 0, has8 = 0, pos[FB_MAXFIELDS];
+    size_t vt, tbl, tsize = 4;
+    char *p;
 
-		Data_Get_Struct(self, TIMESTAMP_STRUCT, ts);
-		Data_Get_Struct(m, TIME_STRUCT, time);
-		ts->hour   = time->hour;
-		ts->minute = time->minute;
-		ts->second = time->second;
-	    } else {
-		rb_raise(rb_eArgError, "need ODBC::Time argument");
-	    }
+    for (i = 0; i < nf; i++) {
+	if (f[i].id >= nslots) {
+	    nslots = f[i].id + 1;
 	}
-	Data_Get_Struct(self, TIMESTAMP_STRUCT, ts);
-	Data_Get_Struct(y, DATE_STRUCT, date);
-	ts->year = date->year;
-	ts->year = date->year;
-	ts->year = date->year;
-	ts->fraction = 0;
-	return self;
-    }
-    if (rb_obj_is_kind_of(y, rb_cTime) == Qtrue) {
-	if (argc > 1) {
-	    rb_raise(rb_eArgError, "wrong # arguments");
+	if (f[i].size == 8) {
+	    has8 = 1;
 	}
-	f  = rb_funcall(y, IDusec, 0, NULL);
-	ss = rb_funcall(y, IDsec, 0, NULL);
-	mm = rb_funcall(y, IDmin, 0, NULL);
-	hh = rb_funcall(y, IDhour, 0, NULL);
-	d  = rb_funcall(y, IDday, 0, NULL);
-	m  = rb_funcall(y, IDmonth, 0, NULL);
-	y  = rb_funcall(y, IDyear, 0, NULL);
-	f = INT2NUM(NUM2INT(f) * 1000);
-    } else if (rb_obj_is_kind_of(y, rb_cDate) == Qtrue) {
-	if (argc > 1) {
-	    rb_raise(rb_eArgError, "wrong # arguments");
+    }
+    for (k = 0; k < (int) (sizeof (order) / sizeof (order[0])); k++) {
+	for (i = 0; i < nf; i++) {
+	    if (f[i].size == order[k]) {
+		pos[i] = (int) tsize;
+		tsize += (f[i].size == 0) ? 4 : f[i].size;
+	    }
 	}
-	f  = INT2FIX(0);
-	ss = INT2FIX(0);
-	mm = INT2FIX(0);
-	hh = INT2FIX(0);
-	d  = rb_funcall(y, IDmday, 0, NULL);
-	m  = rb_funcall(y, IDmonth, 0, NULL);
-	y  = rb_funcall(y, IDyear, 0, NULL);
-    } else if ((argc == 1) && (rb_obj_is_kind_of(y, rb_cString) == Qtrue)) {
-	if (timestamp_load1(self, y, 0) != Qnil) {
-	    return self;
+    }
+    abuf_align(b, 2, 0);
+    vt = abuf_put(b, NULL, 4 + 2 * nslots);
+    p = b->ptr + vt;
+    fb_le(p, 4 + 2 * nslots, 2);
+    fb_le(p + 2, (SQLBIGINT) tsize, 2);
+    for (i = 0; i < nf; i++) {
+	fb_le(p + 4 + 2 * f[i].id, pos[i], 2);
+    }
+    /* 8 byte fields start right after the 4 byte vtable offset */
+    abuf_align(b, has8 ? 8 : 4, has8 ? 4 : 0);
+    tbl = abuf_put(b, NULL, tsize);
+    p = b->ptr + tbl;
+    fb_le(p, (SQLBIGINT) (tbl - vt), 4);
+    for (i = 0; i < nf; i++) {
+	if (f[i].size == 0) {
+	    offs[i] = tbl + pos[i];
+	} else {
+	    fb_le(p + pos[i], f[i].val, f[i].size);
 	}
     }
-    Data_Get_Struct(self, TIMESTAMP_STRUCT, ts);
-    ts->year     = (y  == Qnil) ? 0 : NUM2INT(y);
-    ts->month    = (m  == Qnil) ? 0 : NUM2INT(m);
-    ts->day      = (d  == Qnil) ? 0 : NUM2INT(d);
-    ts->hour     = (hh == Qnil) ? 0 : NUM2INT(hh);
-    ts->minute   = (mm == Qnil) ? 0 : NUM2INT(mm);
-    ts->second   = (ss == Qnil) ? 0 : NUM2INT(ss);
-    ts->fraction = (f  == Qnil) ? 0 : NUM2INT(f);
-    return self;
+    return tbl;
 }
 
-static VALUE
-timestamp_clone(VALUE self)
+static size_t
+fb_string(ABUF *b, const char *str, size_t len)
 {
-#ifdef HAVE_RB_DEFINE_ALLOC_FUNC
-    VALUE obj = rb_obj_alloc(CLASS_OF(self));
-    TIMESTAMP_STRUCT *ts1, *ts2;
+    size_t pos;
 
-    Data_Get_Struct(self, TIMESTAMP_STRUCT, ts1);
-    Data_Get_Struct(obj, TIMESTAMP_STRUCT, ts2);
-    *ts2 = *ts1;
-    return obj;
-#else
-    return timestamp_new(1, &self, CLASS_OF(self));
-#endif
+    abuf_align(b, 4, 0);
+    pos = abuf_put(b, NULL, 4);
+    fb_le(b->ptr + pos, (SQLBIGINT) len, 4);
+    abuf_put(b, str, len);
+    abuf_put(b, NULL, 1);
+    return pos;
 }
 
-static VALUE
-timestamp_to_s(VALUE self)
+/* Vector of n elements, elements are zeroed and start at result + 4. */
+
+static size_t
+fb_vector(ABUF *b, size_t n, size_t esize, size_t ealign)
 {
-    TIMESTAMP_STRUCT *ts;
-    char buf[256];
+    size_t pos;
 
-    Data_Get_Struct(self, TIMESTAMP_STRUCT, ts);
-    sprintf(buf, "%04d-%02d-%02d %02d:%02d:%02d %u",
-	    ts->year, ts->month, ts->day,
-	    ts->hour, ts->minute, ts->second,
-	    (unsigned int) ts->fraction);
-    return rb_str_new2(buf);
+    if (ealign > 4) {
+	abuf_align(b, ealign, ealign - 4);
+    } else {
+	abuf_align(b, 4, 0);
+    }
+    pos = abuf_put(b, NULL, 4 + n * esize);
+    fb_le(b->ptr + pos, (SQLBIGINT) n, 4);
+    return pos;
 }
 
-static VALUE
-timestamp_dump(VALUE self, VALUE depth)
+/*
+ * Start a Message in a.fb, returns the position of the header offset
+ * to be patched with the Schema or RecordBatch table.
+ */
+
+static size_t
+arrow_msg_begin(ARROW *a, int htype, SQLBIGINT bodylen)
 {
-    return timestamp_to_s(self);
+    FBFIELD f[4];
+    size_t offs[4], tbl;
+
+    a->fb.len = 0;
+    abuf_put(&a->fb, NULL, 4);
+    f[0].id = 0; f[0].size = 2; f[0].val = 4;	/* version V5 */
+    f[1].id = 1; f[1].size = 1; f[1].val = htype;
+    f[2].id = 2; f[2].size = 0; f[2].val = 0;
+    f[3].id = 3; f[3].size = 8; f[3].val = bodylen;
+    tbl = fb_table(&a->fb, f, 4, offs);
+    fb_patch(&a->fb, 0, tbl);
+    return offs[2];
 }
 
+/* Frame metadata in a.fb as encapsulated message, padded to 8 bytes. */
+
 static VALUE
-timestamp_inspect(VALUE self)
+arrow_msg_frame(ARROW *a, size_t bodylen)
 {
-    VALUE s = rb_str_new2("#<ODBC::TimeStamp: \"");
+    size_t metalen = (a->fb.len + 7) & ~((size_t) 7);
+    VALUE str = rb_str_buf_new((long) (8 + metalen + bodylen));
+    char hdr[8];
 
-    s = rb_str_append(s, timestamp_to_s(self));
-    return rb_str_append(s, rb_str_new2("\">"));
+    fb_le(hdr, -1, 4);
+    fb_le(hdr + 4, (SQLBIGINT) metalen, 4);
+    rb_str_buf_cat(str, hdr, 8);
+    rb_str_buf_cat(str, a->fb.ptr, (long) a->fb.len);
+    memset(hdr, 0, sizeof (hdr));
+    rb_str_buf_cat(str, hdr, (long) (metalen - a->fb.len));
+    return str;
 }
 
-static VALUE
-timestamp_year(int argc, VALUE *argv, VALUE self)
+/* Member of the flatbuffer Type union for atype */
+
+static int
+arrow_ttype(int atype)
+{
+    switch (atype) {
+    case ARROW_INT32:
+    case ARROW_INT64:
+    case ARROW_UINT64:
+	return 2;
+    case ARROW_FLOAT64:
+	return 3;
+    case ARROW_BINARY:
+	return 4;
+    case ARROW_DATE32:
+	return 8;
+    case ARROW_TIME32:
+	return 9;
+    case ARROW_TIMESTAMP:
+	return 10;
+    }
+    return 5;
+}
+
+static size_t
+arrow_type(ABUF *b, int atype, int utc)
+{
+    FBFIELD f[2];
+    size_t offs[2], tbl;
+
+    switch (atype) {
+    case ARROW_INT32:
+    case ARROW_INT64:
+    case ARROW_UINT64:
+	f[0].id = 0; f[0].size = 4; f[0].val = (atype == ARROW_INT32) ? 32 : 64;
+	f[1].id = 1; f[1].size = 1; f[1].val = atype != ARROW_UINT64;
+	return fb_table(b, f, 2, offs);
+    case ARROW_FLOAT64:
+	f[0].id = 0; f[0].size = 2; f[0].val = 2;	/* DOUBLE */
+	return fb_table(b, f, 1, offs);
+    case ARROW_TIMESTAMP:
+	f[0].id = 0; f[0].size = 2; f[0].val = 2;	/* MICROSECOND */
+	f[1].id = 1; f[1].size = 0; f[1].val = 0;
+	tbl = fb_table(b, f, utc ? 2 : 1, offs);
+	if (utc) {
+	    fb_patch(b, offs[1], fb_string(b, "UTC", 3));
+	}
+	return tbl;
+    case ARROW_DATE32:
+	f[0].id = 0; f[0].size = 2; f[0].val = 0;	/* DAY */
+	return fb_table(b, f, 1, offs);
+    case ARROW_TIME32:
+	f[0].id = 0; f[0].size = 2; f[0].val = 0;	/* SECOND */
+	f[1].id = 1; f[1].size = 4; f[1].val = 32;
+	return fb_table(b, f, 2, offs);
+    }
+    /* Utf8 and Binary are empty tables */
+    return fb_table(b, f, 0, offs);
+}
+
+static void
+arrow_schema(ARROW *a)
+{
+    STMT *q = a->q;
+    FBFIELD f[5];
+    size_t offs[5], hdr, tbl, fields;
+    int i, one = 1;
+    VALUE str;
+
+    hdr = arrow_msg_begin(a, ARROW_MSG_SCHEMA, 0);
+    f[0].id = 0; f[0].size = 2; f[0].val = (*(char *) &one) ? 0 : 1;
+    f[1].id = 1; f[1].size = 0; f[1].val = 0;
+    tbl = fb_table(&a->fb, f, 2, offs);
+    fb_patch(&a->fb, hdr, tbl);
+    fields = fb_vector(&a->fb, q->ncols, 4, 4);
+    fb_patch(&a->fb, offs[1], fields);
+    for (i = 0; i < q->ncols; i++) {
+	VALUE name = rb_ary_entry(a->names, i);
+	size_t ftbl;
+
+	f[0].id = 0; f[0].size = 0; f[0].val = 0;
+	f[1].id = 1; f[1].size = 1; f[1].val = 1;
+	f[2].id = 2; f[2].size = 1; f[2].val = arrow_ttype(a->cols[i].atype);
+	f[3].id = 3; f[3].size = 0; f[3].val = 0;
+	f[4].id = 5; f[4].size = 0; f[4].val = 0;
+	ftbl = fb_table(&a->fb, f, 5, offs);
+	fb_patch(&a->fb, fields + 4 + 4 * i, ftbl);
+	fb_patch(&a->fb, offs[0],
+		 fb_string(&a->fb, RSTRING_PTR(name), RSTRING_LEN(name)));
+	fb_patch(&a->fb, offs[3],
+		 arrow_type(&a->fb, a->cols[i].atype,
+			    (q->dbcp != NULL) && (q->dbcp->gmtime == Qtrue)));
+	fb_patch(&a->fb, offs[4], fb_vector(&a->fb, 0, 4, 4));
+    }
+    str = arrow_msg_frame(a, 0);
+    rb_funcall(a->io, IDwrite, 1, str);
+}
+
+static void
+arrow_col_init(ARROWCOL *c, SQLSMALLINT ctype)
 {
-    TIMESTAMP_STRUCT *ts;
-    VALUE v;
+    memset(c, 0, sizeof (ARROWCOL));
+    c->ctype = ctype;
+    switch (ctype) {
+    case SQL_C_LONG:
+	c->atype = ARROW_INT32;
+	c->width = 4;
+	break;
+#ifdef SQL_C_SBIGINT
+    case SQL_C_SBIGINT:
+	c->atype = ARROW_INT64;
+	c->width = 8;
+	break;
+#endif
+#ifdef SQL_C_UBIGINT
+    case SQL_C_UBIGINT:
+	c->atype = ARROW_UINT64;
+	c->width = 8;
+	break;
+#endif
+    case SQL_C_DOUBLE:
+	c->atype = ARROW_FLOAT64;
+	c->width = 8;
+	break;
+    case SQL_C_TIMESTAMP:
+	c->atype = ARROW_TIMESTAMP;
+	c->width = 8;
+	break;
+    case SQL_C_DATE:
+	c->atype = ARROW_DATE32;
+	c->width = 4;
+	break;
+    case SQL_C_TIME:
+	c->atype = ARROW_TIME32;
+	c->width = 4;
+	break;
+    case SQL_C_BINARY:
+	c->atype = ARROW_BINARY;
+	break;
+    default:
+	c->atype = ARROW_UTF8;
+	break;
+    }
+}
 
-    rb_scan_args(argc, argv, "01", &v);
-    Data_Get_Struct(self, TIMESTAMP_STRUCT, ts);
-    if (v == Qnil) {
-	return INT2NUM(ts->year);
+static void
+arrow_col_reset(ARROWCOL *c)
+{
+    c->nulls = 0;
+    c->valid.len = c->data.len = c->offs.len = 0;
+    if (c->width == 0) {
+	abuf_put(&c->offs, NULL, 4);
     }
-    ts->year = NUM2INT(v);
-    return self;
 }
 
-static VALUE
-timestamp_month(int argc, VALUE *argv, VALUE self)
+static void
+arrow_col_offset(ARROWCOL *c)
 {
-    TIMESTAMP_STRUCT *ts;
-    VALUE v;
+    int off;
 
-    rb_scan_args(argc, argv, "01", &v);
-    Data_Get_Struct(self, TIMESTAMP_STRUCT, ts);
-    if (v == Qnil) {
-	return INT2NUM(ts->month);
+    if (c->data.len > 0x7fffffff) {
+	rb_raise(Cerror, "%s",
+		 set_err("Arrow batch exceeds 2GB, use smaller batch_rows",
+			 0));
     }
-    ts->month = NUM2INT(v);
-    return self;
+    off = (int) c->data.len;
+    abuf_put(&c->offs, &off, 4);
 }
 
-static VALUE
-timestamp_day(int argc, VALUE *argv, VALUE self)
+/* Append value of length curlen (or SQL_NULL_DATA) as row of batch. */
+
+static void
+arrow_col_append(ARROWCOL *c, long row, char *valp, SQLLEN curlen)
 {
-    TIMESTAMP_STRUCT *ts;
-    VALUE v;
+    if ((row % 8) == 0) {
+	abuf_put(&c->valid, NULL, 1);
+    }
+    if (curlen == SQL_NULL_DATA) {
+	c->nulls++;
+	if (c->width > 0) {
+	    abuf_put(&c->data, NULL, c->width);
+	} else {
+	    arrow_col_offset(c);
+	}
+	return;
+    }
+    c->valid.ptr[row / 8] |= (char) (1 << (row % 8));
+    switch (c->atype) {
+    case ARROW_INT32:
+	{
+	    int v = (int) *(SQLINTEGER *) valp;
 
-    rb_scan_args(argc, argv, "01", &v);
-    Data_Get_Struct(self, TIMESTAMP_STRUCT, ts);
-    if (v == Qnil) {
-	return INT2NUM(ts->day);
+	    abuf_put(&c->data, &v, 4);
+	}
+	return;
+    case ARROW_INT64:
+    case ARROW_UINT64:
+    case ARROW_FLOAT64:
+	abuf_put(&c->data, valp, 8);
+	return;
+    case ARROW_TIMESTAMP:
+	{
+	    TIMESTAMP_STRUCT *ts = (TIMESTAMP_STRUCT *) valp;
+	    SQLBIGINT v;
+
+	    v = (SQLBIGINT) civil_days(ts->year, ts->month, ts->day) * 86400 +
+		ts->hour * 3600 + ts->minute * 60 + ts->second;
+	    v = v * 1000000 + ts->fraction / 1000;
+	    abuf_put(&c->data, &v, 8);
+	}
+	return;
+    case ARROW_DATE32:
+	{
+	    DATE_STRUCT *date = (DATE_STRUCT *) valp;
+	    int v = (int) civil_days(date->year, date->month, date->day);
+
+	    abuf_put(&c->data, &v, 4);
+	}
+	return;
+    case ARROW_TIME32:
+	{
+	    TIME_STRUCT *time = (TIME_STRUCT *) valp;
+	    int v = time->hour * 3600 + time->minute * 60 + time->second;
+
+	    abuf_put(&c->data, &v, 4);
+	}
+	return;
     }
-    ts->day = NUM2INT(v);
-    return self;
+#ifdef UNICODE
+    if (c->ctype == SQL_C_WCHAR) {
+	long n = curlen / sizeof (SQLWCHAR), k;
+	char *p;
+
+	p = abuf_grow(&c->data, n * ((sizeof (SQLWCHAR) == 2) ? 3 : 6) + 1);
+	k = uc_ascii((SQLWCHAR *) valp, n, p);
+	if (k < n) {
+	    k += mkutf(p + k, (SQLWCHAR *) valp + k, (int) (n - k));
+	}
+	c->data.len += k;
+	arrow_col_offset(c);
+	return;
+    }
+#endif
+    abuf_put(&c->data, valp, curlen);
+    arrow_col_offset(c);
 }
 
-static VALUE
-timestamp_hour(int argc, VALUE *argv, VALUE self)
+static void
+arrow_batch(ARROW *a, long nrows)
 {
-    TIMESTAMP_STRUCT *ts;
-    VALUE v;
+    STMT *q = a->q;
+    FBFIELD f[3];
+    size_t offs[3], hdr, tbl, nodes, bufs, body = 0;
+    int i, k, nbufs = 0;
+    char pad[8];
+    VALUE str;
 
-    rb_scan_args(argc, argv, "01", &v);
-    Data_Get_Struct(self, TIMESTAMP_STRUCT, ts);
-    if (v == Qnil) {
-	return INT2NUM(ts->hour);
+    for (i = 0; i < q->ncols; i++) {
+	ARROWCOL *c = &a->cols[i];
+
+	nbufs += (c->width > 0) ? 2 : 3;
+	if (c->nulls > 0) {
+	    body += (c->valid.len + 7) & ~((size_t) 7);
+	}
+	body += (c->data.len + 7) & ~((size_t) 7);
+	body += (c->offs.len + 7) & ~((size_t) 7);
+    }
+    hdr = arrow_msg_begin(a, ARROW_MSG_BATCH, (SQLBIGINT) body);
+    f[0].id = 0; f[0].size = 8; f[0].val = nrows;
+    f[1].id = 1; f[1].size = 0; f[1].val = 0;
+    f[2].id = 2; f[2].size = 0; f[2].val = 0;
+    tbl = fb_table(&a->fb, f, 3, offs);
+    fb_patch(&a->fb, hdr, tbl);
+    nodes = fb_vector(&a->fb, q->ncols, 16, 8);
+    fb_patch(&a->fb, offs[1], nodes);
+    bufs = fb_vector(&a->fb, nbufs, 16, 8);
+    fb_patch(&a->fb, offs[2], bufs);
+    body = 0;
+    for (i = k = 0; i < q->ncols; i++) {
+	ARROWCOL *c = &a->cols[i];
+	char *p;
+	size_t len;
+
+	p = a->fb.ptr + nodes + 4 + 16 * i;
+	fb_le(p, nrows, 8);
+	fb_le(p + 8, c->nulls, 8);
+	/* validity, offsets (variable width only), data */
+	len = (c->nulls > 0) ? c->valid.len : 0;
+	p = a->fb.ptr + bufs + 4 + 16 * k++;
+	fb_le(p, (SQLBIGINT) body, 8);
+	fb_le(p + 8, (SQLBIGINT) len, 8);
+	body += (len + 7) & ~((size_t) 7);
+	if (c->width == 0) {
+	    p = a->fb.ptr + bufs + 4 + 16 * k++;
+	    fb_le(p, (SQLBIGINT) body, 8);
+	    fb_le(p + 8, (SQLBIGINT) c->offs.len, 8);
+	    body += (c->offs.len + 7) & ~((size_t) 7);
+	}
+	p = a->fb.ptr + bufs + 4 + 16 * k++;
+	fb_le(p, (SQLBIGINT) body, 8);
+	fb_le(p + 8, (SQLBIGINT) c->data.len, 8);
+	body += (c->data.len + 7) & ~((size_t) 7);
+    }
+    str = arrow_msg_frame(a, body);
+    memset(pad, 0, sizeof (pad));
+    for (i = 0; i < q->ncols; i++) {
+	ARROWCOL *c = &a->cols[i];
+	ABUF *parts[3];
+	int n = 0;
+
+	if (c->nulls > 0) {
+	    parts[n++] = &c->valid;
+	}
+	if (c->width == 0) {
+	    parts[n++] = &c->offs;
+	}
+	parts[n++] = &c->data;
+	for (k = 0; k < n; k++) {
+	    rb_str_buf_cat(str, parts[k]->ptr, (long) parts[k]->len);
+	    rb_str_buf_cat(str, pad, (long) ((8 - parts[k]->len % 8) % 8));
+	}
     }
-    ts->hour = NUM2INT(v);
-    return self;
+    rb_funcall(a->io, IDwrite, 1, str);
 }
 
-static VALUE
-timestamp_min(int argc, VALUE *argv, VALUE self)
+/*
+ * Helpers shared by the bulk exporters: read column i of the
+ * current row from the row set buffers or by SQLGetData() into
+ * scratch buffer buf.
+ */
+
+static SQLLEN
+getdata_buf(STMT *q, int i, ABUF *buf, char **valpp)
 {
-    TIMESTAMP_STRUCT *ts;
-    VALUE v;
+    SQLSMALLINT type = q->coltypes[i].type;
+    SQLLEN chunk, curlen, total = 0;
+    int term = 0;
+    char *msg;
 
-    rb_scan_args(argc, argv, "01", &v);
-    Data_Get_Struct(self, TIMESTAMP_STRUCT, ts);
-    if (v == Qnil) {
-	return INT2NUM(ts->minute);
+    switch (type) {
+    case SQL_C_CHAR:
+	term = 1;
+	chunk = SEGSIZE;
+	break;
+#ifdef UNICODE
+    case SQL_C_WCHAR:
+	term = sizeof (SQLWCHAR);
+	chunk = SEGSIZE;
+	break;
+#endif
+    case SQL_C_BINARY:
+	chunk = SEGSIZE;
+	break;
+    default:
+	chunk = q->coltypes[i].size;
+	break;
+    }
+    buf->len = 0;
+    for (;;) {
+	SQLRETURN rc;
+
+	abuf_grow(buf, chunk + term);
+	rc = nogvl_getdata(q->hstmt, (SQLUSMALLINT) (i + 1), type,
+			   (SQLPOINTER) (buf->ptr + total),
+			   chunk + term, &curlen);
+	if ((rc == SQL_NO_DATA) && (total > 0)) {
+	    break;
+	}
+	if (!succeeded(SQL_NULL_HENV, SQL_NULL_HDBC, q->hstmt, rc,
+		       &msg, "SQLGetData")) {
+	    rb_raise(Cerror, "%s", msg);
+	}
+	if (curlen == SQL_NULL_DATA) {
+	    return SQL_NULL_DATA;
+	}
+	if ((term == 0) && (type != SQL_C_BINARY)) {
+	    total = curlen;
+	    break;
+	}
+	if ((curlen != SQL_NO_TOTAL) && (curlen <= chunk)) {
+	    total += curlen;
+	    break;
+	}
+	total += chunk;
+	buf->len = total;
+    }
+    *valpp = buf->ptr;
+    return total;
+}
+
+static SQLLEN
+rowset_curlen(STMT *q, int i, SQLULEN r)
+{
+    SQLLEN curlen = q->rslens[i * q->rsmax + r], maxlen;
+
+    if (curlen == SQL_NULL_DATA) {
+	return curlen;
+    }
+    maxlen = q->coltypes[i].size;
+    if (q->coltypes[i].type == SQL_C_CHAR) {
+	maxlen -= 1;
+#ifdef UNICODE
+    } else if (q->coltypes[i].type == SQL_C_WCHAR) {
+	maxlen -= sizeof (SQLWCHAR);
+#endif
+    }
+    if ((curlen == SQL_NO_TOTAL) || (curlen > maxlen)) {
+	/* truncated */
+	curlen = maxlen;
+    }
+    return curlen;
+}
+
+/*
+ * Position on the current row of the row set when some columns
+ * must be read by SQLGetData().
+ */
+
+static void
+row_position(STMT *q)
+{
+#if (ODBCVER >= 0x0300)
+    if ((q->rsmode > 0) && q->rsgd && (q->rspos > 0)) {
+	char *msg;
+
+	diag_drain(q);
+	if (!succeeded(SQL_NULL_HENV, SQL_NULL_HDBC, q->hstmt,
+		       SQLSetPos(q->hstmt, q->rspos + 1, SQL_POSITION,
+				 SQL_LOCK_NO_CHANGE),
+		       &msg, "SQLSetPos(%d)", (int) (q->rspos + 1))) {
+	    rb_raise(Cerror, "%s", msg);
+	}
     }
-    ts->minute = NUM2INT(v);
-    return self;
+#endif
 }
 
-static VALUE
-timestamp_sec(int argc, VALUE *argv, VALUE self)
+static SQLLEN
+row_getdata(STMT *q, int i, ABUF *buf, char **valpp)
 {
-    TIMESTAMP_STRUCT *ts;
-    VALUE v;
-
-    rb_scan_args(argc, argv, "01", &v);
-    Data_Get_Struct(self, TIMESTAMP_STRUCT, ts);
-    if (v == Qnil) {
-	return INT2NUM(ts->second);
+    if ((q->rsmode > 0) && (q->rsbufs[i] != NULL)) {
+	*valpp = q->rsbufs[i] + q->rspos * q->coltypes[i].size;
+	return rowset_curlen(q, i, q->rspos);
     }
-    ts->second = NUM2INT(v);
-    return self;
+    return getdata_buf(q, i, buf, valpp);
 }
 
-static VALUE
-timestamp_fraction(int argc, VALUE *argv, VALUE self)
+/* Use a row set of up to nrows rows unless one was configured. */
+
+static void
+export_rowset(STMT *q, long nrows)
 {
-    TIMESTAMP_STRUCT *ts;
-    VALUE v;
+    if ((q->rsmode == 0) && (q->rssize <= 1)) {
+	int rssize = q->rssize;
 
-    rb_scan_args(argc, argv, "01", &v);
-    Data_Get_Struct(self, TIMESTAMP_STRUCT, ts);
-    if (v == Qnil) {
-	return INT2NUM(ts->fraction);
+	q->rssize = (int) nrows;
+	rowset_setup(q);
+	q->rssize = rssize;
     }
-    ts->fraction = NUM2INT(v);
-    return self;
 }
 
 static VALUE
-timestamp_cmp(VALUE self, VALUE timestamp)
+arrow_run(VALUE arg)
 {
-    TIMESTAMP_STRUCT *ts1, *ts2;
+    ARROW *a = (ARROW *) arg;
+    STMT *q = a->q;
+    int i, more = 1;
+    char eos[8];
 
-    if (rb_obj_is_kind_of(timestamp, Ctimestamp) != Qtrue) {
-	rb_raise(rb_eTypeError, "need ODBC::TimeStamp as argument");
-    }
-    Data_Get_Struct(self, TIMESTAMP_STRUCT, ts1);
-    Data_Get_Struct(timestamp, TIMESTAMP_STRUCT, ts2);
-    if (ts1->year < ts2->year) {
-	return INT2FIX(-1);
-    }
-    if (ts1->year == ts2->year) {
-	if (ts1->month < ts2->month) {
-	    return INT2FIX(-1);
+    arrow_schema(a);
+    while (more) {
+	long nrows = 0;
+
+	for (i = 0; i < q->ncols; i++) {
+	    arrow_col_reset(&a->cols[i]);
 	}
-	if (ts1->month == ts2->month) {
-	    if (ts1->day < ts2->day) {
-		return INT2FIX(-1);
+	while (nrows < a->batch) {
+	    if (stmt_next_row(a->self) != Qtrue) {
+		more = 0;
+		break;
 	    }
-	    if (ts1->day == ts2->day) {
-		if (ts1->hour < ts2->hour) {
-		    return INT2FIX(-1);
-		}
-		if (ts1->hour == ts2->hour) {
-		    if (ts1->minute < ts2->minute) {
-			return INT2FIX(-1);
+	    if ((q->rsmode > 0) && !q->rsgd) {
+		SQLULEN r, first = q->rspos, last = q->rspos;
+		long n0 = nrows;
+
+		/* take the rest of the row set column by column */
+		for (r = first; (r < q->rsrows) && (nrows < a->batch); r++) {
+		    if (q->rsstat[r] == SQL_ROW_NOROW) {
+			continue;
 		    }
-		    if (ts1->minute == ts2->minute) {
-			if (ts1->second < ts2->second) {
-			    return INT2FIX(-1);
-			}
-			if (ts1->second == ts2->second) {
-			    if (ts1->fraction < ts2->fraction) {
-				return INT2FIX(-1);
-			    }
-			    if (ts1->fraction == ts2->fraction) {
-				return INT2FIX(0);
-			    }
+		    if (q->rsstat[r] == SQL_ROW_ERROR) {
+			rb_raise(Cerror, "%s",
+				 set_err("Error in row of row set", 0));
+		    }
+		    last = r;
+		    nrows++;
+		}
+		for (i = 0; i < q->ncols; i++) {
+		    SQLLEN size = q->coltypes[i].size;
+		    long row = n0;
+
+		    for (r = first; r <= last; r++) {
+			if (q->rsstat[r] == SQL_ROW_NOROW) {
+			    continue;
 			}
+			arrow_col_append(&a->cols[i], row++,
+					 q->rsbufs[i] + r * size,
+					 rowset_curlen(q, i, r));
 		    }
 		}
+		q->rspos = last;
+		continue;
+	    }
+	    row_position(q);
+	    for (i = 0; i < q->ncols; i++) {
+		char *valp = NULL;
+		SQLLEN curlen = row_getdata(q, i, &a->scratch, &valp);
+
+		arrow_col_append(&a->cols[i], nrows, valp, curlen);
 	    }
+	    nrows++;
+	}
+	if (nrows > 0) {
+	    arrow_batch(a, nrows);
+	    a->total += nrows;
 	}
     }
-    return INT2FIX(1);
+    fb_le(eos, -1, 4);
+    fb_le(eos + 4, 0, 4);
+    rb_funcall(a->io, IDwrite, 1, rb_str_new(eos, 8));
+    return Qnil;
+}
+
+static VALUE
+arrow_ensure(VALUE arg)
+{
+    ARROW *a = (ARROW *) arg;
+    int i;
+
+    a->q->busy--;
+    for (i = 0; i < a->q->ncols; i++) {
+	abuf_free(&a->cols[i].valid);
+	abuf_free(&a->cols[i].data);
+	abuf_free(&a->cols[i].offs);
+    }
+    xfree(a->cols);
+    abuf_free(&a->fb);
+    abuf_free(&a->scratch);
+    return Qnil;
+}
+
+static VALUE
+stmt_to_arrow_ipc(int argc, VALUE *argv, VALUE self)
+{
+    STMT *q;
+    ARROW a;
+    VALUE io, opts, v;
+    int i;
+
+    rb_scan_args(argc, argv, "11", &io, &opts);
+    memset(&a, 0, sizeof (a));
+    a.batch = 65536;
+    if (opts != Qnil) {
+	if (FIXNUM_P(opts)) {
+	    a.batch = FIX2LONG(opts);
+	} else {
+	    Check_Type(opts, T_HASH);
+	    if ((v = rb_hash_aref(opts, ID2SYM(IDbatch_rows))) != Qnil) {
+		a.batch = NUM2LONG(v);
+	    }
+	}
+    }
+    if (a.batch <= 0) {
+	rb_raise(rb_eArgError, "batch_rows must be positive");
+    }
+    ODBC_Get_Struct(self, STMT, stmt_type, q);
+    if (q->ncols <= 0) {
+	rb_raise(Cerror, "%s", set_err("No columns in result set", 0));
+    }
+    a.q = q;
+    a.self = self;
+    a.io = io;
+    a.names = rb_ary_new2(q->ncols);
+    for (i = 0; i < q->ncols; i++) {
+	VALUE col = make_column(q->hstmt, i, q->upc);
+
+	rb_ary_push(a.names, rb_iv_get(col, "@name"));
+    }
+    export_rowset(q, (a.batch < 1024) ? a.batch : 1024);
+    a.cols = ALLOC_N(ARROWCOL, q->ncols);
+    for (i = 0; i < q->ncols; i++) {
+	arrow_col_init(&a.cols[i], (SQLSMALLINT) q->coltypes[i].type);
+    }
+    /* IO#write may run other threads, keep them off the statement */
+    q->busy++;
+    rb_ensure(arrow_run, (VALUE) &a, arrow_ensure, (VALUE) &a);
+    return LONG2NUM(a.total);
 }
 
 /*
  *----------------------------------------------------------------------
  *
- *      Statement methods.
+ *      CSV export.
+ *
+ *      Statement.export_csv formats the remaining rows of the result
+ *      set straight from the fetch buffers into an output buffer
+ *      which is written to the IO in chunks of CSV_FLUSH bytes. Files
+ *      in binary mode are written by write(2) outside the GVL.
  *
  *----------------------------------------------------------------------
  */
 
-static VALUE
-stmt_drop(VALUE self)
-{
+#define CSV_FLUSH (1024 * 1024)
+
+typedef struct {
     STMT *q;
+    VALUE self;
+    VALUE io;
+    int fd;
+    int header;
+    int quote;
+    const char *sep;
+    long seplen;
+    const char *null;
+    long nulllen;
+    char special[256];
+    long total;
+    ABUF out;
+    ABUF scratch;
+    ABUF conv;
+} CSVOUT;
 
-    Data_Get_Struct(self, STMT, q);
-    if (q->hstmt != SQL_NULL_HSTMT) {
-	callsql(SQL_NULL_HENV, SQL_NULL_HDBC, q->hstmt,
-		SQLFreeStmt(q->hstmt, SQL_DROP), "SQLFreeStmt(SQL_DROP)");
-	q->hstmt = SQL_NULL_HSTMT;
-	unlink_stmt(q);
+static void
+csv_flush(CSVOUT *c)
+{
+    char *p = c->out.ptr;
+    size_t len = c->out.len;
+
+    c->out.len = 0;
+    if (len == 0) {
+	return;
+    }
+    if (c->fd < 0) {
+	rb_funcall(c->io, IDwrite, 1, rb_str_new(p, (long) len));
+	return;
+    }
+    while (len > 0) {
+	int err;
+	long n = nogvl_write(c->fd, p, len, &err);
+
+	if (n < 0) {
+	    errno = err;
+	    if (err == EINTR) {
+#ifdef USE_NOGVL
+		rb_thread_check_ints();
+#endif
+		continue;
+	    }
+	    if ((err == EAGAIN) || (err == EWOULDBLOCK)) {
+		rb_thread_fd_writable(c->fd);
+		continue;
+	    }
+	    rb_sys_fail("write");
+	}
+	p += n;
+	len -= n;
     }
-    free_stmt_sub(q, 1);
-    return self;
 }
 
-static VALUE
-stmt_close(VALUE self)
+/* Append field, quoted when it contains special characters. */
+
+static void
+csv_field(CSVOUT *c, const char *p, size_t n, int text)
 {
-    STMT *q;
+    size_t k;
+    int quote = 0;
+    char *dst;
 
-    Data_Get_Struct(self, STMT, q);
-    if (q->hstmt != SQL_NULL_HSTMT) {
-	callsql(SQL_NULL_HENV, SQL_NULL_HDBC, q->hstmt,
-		SQLFreeStmt(q->hstmt, SQL_CLOSE), "SQLFreeStmt(SQL_CLOSE)");
+    if (c->quote >= 0) {
+	quote = text && (n == 0);
+	for (k = 0; !quote && (k < n); k++) {
+	    quote = c->special[(unsigned char) p[k]];
+	}
     }
-    free_stmt_sub(q, 1);
-    return self;
+    if (!quote) {
+	abuf_put(&c->out, p, n);
+	return;
+    }
+    dst = abuf_grow(&c->out, 2 * n + 2);
+    *dst++ = (char) c->quote;
+    for (k = 0; k < n; k++) {
+	if (p[k] == (char) c->quote) {
+	    *dst++ = p[k];
+	}
+	*dst++ = p[k];
+    }
+    *dst++ = (char) c->quote;
+    c->out.len = dst - c->out.ptr;
 }
 
-static VALUE
-stmt_cancel(VALUE self)
+static char *
+csv_uint(char *p, SQLUBIGINT v)
 {
-    STMT *q;
-    char *msg;
+    char tmp[24];
+    int n = 0;
 
-    Data_Get_Struct(self, STMT, q);
-    if (q->hstmt != SQL_NULL_HSTMT) {
-	if (!succeeded(SQL_NULL_HENV, SQL_NULL_HDBC, q->hstmt,
-		       SQLCancel(q->hstmt), &msg, "SQLCancel")) {
-	    rb_raise(Cerror, "%s", msg);
+    do {
+	tmp[n++] = (char) ('0' + v % 10);
+	v /= 10;
+    } while (v != 0);
+    while (n > 0) {
+	*p++ = tmp[--n];
+    }
+    return p;
+}
+
+static char *
+csv_int(char *p, SQLBIGINT v)
+{
+    if (v < 0) {
+	*p++ = '-';
+	return csv_uint(p, (SQLUBIGINT) 0 - (SQLUBIGINT) v);
+    }
+    return csv_uint(p, (SQLUBIGINT) v);
+}
+
+/* Zero padded number of n digits. */
+
+static char *
+csv_digits(char *p, unsigned int v, int n)
+{
+    int k;
+
+    for (k = n - 1; k >= 0; k--) {
+	p[k] = (char) ('0' + v % 10);
+	v /= 10;
+    }
+    return p + n;
+}
+
+/* Shortest of %.15g, %.16g, %.17g which reads back unchanged. */
+
+static char *
+csv_double(char *p, double d)
+{
+    int prec, n;
+
+    if (isnan(d)) {
+	memcpy(p, "NaN", 3);
+	return p + 3;
+    }
+    if (isinf(d)) {
+	n = (d < 0) ? 9 : 8;
+	memcpy(p, (d < 0) ? "-Infinity" : "Infinity", n);
+	return p + n;
+    }
+    for (prec = 15; prec < 17; prec++) {
+	sprintf(p, "%.*g", prec, d);
+	if (strtod(p, NULL) == d) {
+	    break;
 	}
     }
-    return self;
+    if (prec == 17) {
+	sprintf(p, "%.17g", d);
+    }
+    n = strlen(p);
+    if (strcspn(p, ".e") == (size_t) n) {
+	p[n++] = '.';
+	p[n++] = '0';
+    }
+    return p + n;
+}
+
+static char *
+csv_date(char *p, DATE_STRUCT *date)
+{
+    if ((date->year >= 0) && (date->year <= 9999)) {
+	p = csv_digits(p, date->year, 4);
+    } else {
+	p = csv_int(p, date->year);
+    }
+    *p++ = '-';
+    p = csv_digits(p, date->month, 2);
+    *p++ = '-';
+    return csv_digits(p, date->day, 2);
+}
+
+static char *
+csv_time(char *p, int hour, int minute, int second)
+{
+    p = csv_digits(p, hour, 2);
+    *p++ = ':';
+    p = csv_digits(p, minute, 2);
+    *p++ = ':';
+    return csv_digits(p, second, 2);
 }
 
 static void
-check_ncols(STMT *q)
+csv_value(CSVOUT *c, int i, char *valp, SQLLEN curlen)
 {
-    if ((q->hstmt != SQL_NULL_HSTMT) && (q->ncols <= 0) &&
-	(q->coltypes == NULL)) {
-	COLTYPE *coltypes = NULL;
-	SQLSMALLINT cols = 0;
+    char buf[64], *p = buf;
 
-	if (succeeded(SQL_NULL_HENV, SQL_NULL_HDBC, q->hstmt,
-		      SQLNumResultCols(q->hstmt, &cols), NULL,
-		      "SQLNumResultCols")
-	    && (cols > 0)) {
-	    coltypes = make_coltypes(q->hstmt, cols, NULL);
-	    if (coltypes != NULL) {
-		q->ncols = cols;
-		q->coltypes = coltypes;
+    if (curlen == SQL_NULL_DATA) {
+	abuf_put(&c->out, c->null, c->nulllen);
+	return;
+    }
+    switch (c->q->coltypes[i].type) {
+    case SQL_C_LONG:
+	p = csv_int(p, *(SQLINTEGER *) valp);
+	break;
+#ifdef SQL_C_SBIGINT
+    case SQL_C_SBIGINT:
+	p = csv_int(p, *(SQLBIGINT *) valp);
+	break;
+#endif
+#ifdef SQL_C_UBIGINT
+    case SQL_C_UBIGINT:
+	p = csv_uint(p, *(SQLUBIGINT *) valp);
+	break;
+#endif
+    case SQL_C_DOUBLE:
+	p = csv_double(p, *(double *) valp);
+	break;
+    case SQL_C_DATE:
+	p = csv_date(p, (DATE_STRUCT *) valp);
+	break;
+    case SQL_C_TIME:
+	{
+	    TIME_STRUCT *time = (TIME_STRUCT *) valp;
+
+	    p = csv_time(p, time->hour, time->minute, time->second);
+	}
+	break;
+    case SQL_C_TIMESTAMP:
+	{
+	    TIMESTAMP_STRUCT *ts = (TIMESTAMP_STRUCT *) valp;
+	    DATE_STRUCT date;
+
+	    date.year = ts->year;
+	    date.month = ts->month;
+	    date.day = ts->day;
+	    p = csv_date(p, &date);
+	    *p++ = ' ';
+	    p = csv_time(p, ts->hour, ts->minute, ts->second);
+	    if (ts->fraction != 0) {
+		/* nanoseconds without trailing zeros */
+		*p++ = '.';
+		p = csv_digits(p, (unsigned int) ts->fraction, 9);
+		while (p[-1] == '0') {
+		    p--;
+		}
 	    }
 	}
+	break;
+#ifdef UNICODE
+    case SQL_C_WCHAR:
+	{
+	    long n = curlen / sizeof (SQLWCHAR), k;
+
+	    c->conv.len = 0;
+	    p = abuf_grow(&c->conv, n * ((sizeof (SQLWCHAR) == 2) ? 3 : 6) + 1);
+	    k = uc_ascii((SQLWCHAR *) valp, n, p);
+	    if (k < n) {
+		k += mkutf(p + k, (SQLWCHAR *) valp + k, (int) (n - k));
+	    }
+	    csv_field(c, p, k, 1);
+	}
+	return;
+#endif
+    default:
+	csv_field(c, valp, curlen, 1);
+	return;
     }
+    csv_field(c, buf, p - buf, 0);
 }
 
 static VALUE
-stmt_ncols(VALUE self)
+csv_run(VALUE arg)
 {
-    STMT *q;
+    CSVOUT *c = (CSVOUT *) arg;
+    STMT *q = c->q;
+    int i;
 
-    Data_Get_Struct(self, STMT, q);
-    check_ncols(q);
-    return INT2FIX(q->ncols);
+    if (c->header) {
+	for (i = 0; i < q->ncols; i++) {
+	    VALUE name = rb_iv_get(make_column(q->hstmt, i, q->upc), "@name");
+
+	    if (i > 0) {
+		abuf_put(&c->out, c->sep, c->seplen);
+	    }
+	    csv_field(c, RSTRING_PTR(name), RSTRING_LEN(name), 1);
+	}
+	abuf_put(&c->out, "\n", 1);
+    }
+    while (stmt_next_row(c->self) == Qtrue) {
+	row_position(q);
+	for (i = 0; i < q->ncols; i++) {
+	    char *valp = NULL;
+	    SQLLEN curlen = row_getdata(q, i, &c->scratch, &valp);
+
+	    if (i > 0) {
+		abuf_put(&c->out, c->sep, c->seplen);
+	    }
+	    csv_value(c, i, valp, curlen);
+	}
+	abuf_put(&c->out, "\n", 1);
+	c->total++;
+	if (c->out.len >= CSV_FLUSH) {
+	    csv_flush(c);
+	}
+    }
+    csv_flush(c);
+    return Qnil;
 }
 
 static VALUE
-stmt_nrows(VALUE self)
+csv_ensure(VALUE arg)
 {
-    STMT *q;
-    SQLLEN rows = -1;
-    char *msg;
+    CSVOUT *c = (CSVOUT *) arg;
 
-    Data_Get_Struct(self, STMT, q);
-    if ((q->hstmt != SQL_NULL_HSTMT) &&
-	(!succeeded(SQL_NULL_HENV, SQL_NULL_HDBC, q->hstmt,
-		    SQLRowCount(q->hstmt, &rows), &msg, "SQLRowCount"))) {
-	rb_raise(Cerror, "%s", msg);
-    }
-    return INT2NUM(rows);
+    c->q->busy--;
+    abuf_free(&c->out);
+    abuf_free(&c->scratch);
+    abuf_free(&c->conv);
+    return Qnil;
 }
 
 static VALUE
-stmt_nparams(VALUE self)
+stmt_export_csv(int argc, VALUE *argv, VALUE self)
 {
     STMT *q;
-
-    Data_Get_Struct(self, STMT, q);
-    return INT2FIX(q->nump);
+    CSVOUT c;
+    VALUE io, opts, sep, quote, null;
+
+    rb_scan_args(argc, argv, "11", &io, &opts);
+    sep = quote = null = Qnil;
+    memset(&c, 0, sizeof (c));
+    if (opts != Qnil) {
+	Check_Type(opts, T_HASH);
+	sep = rb_hash_aref(opts, ID2SYM(IDsep));
+	quote = rb_hash_aref(opts, ID2SYM(IDquote));
+	null = rb_hash_aref(opts, ID2SYM(IDnull));
+	c.header = RTEST(rb_hash_aref(opts, ID2SYM(IDheader)));
+    }
+    sep = (sep == Qnil) ? rb_str_new2(",") : rb_String(sep);
+    quote = (quote == Qnil) ? rb_str_new2("\"") : rb_String(quote);
+    null = (null == Qnil) ? rb_str_new2("") : rb_String(null);
+    if (RSTRING_LEN(sep) < 1) {
+	rb_raise(rb_eArgError, "empty separator");
+    }
+    if (RSTRING_LEN(quote) > 1) {
+	rb_raise(rb_eArgError, "quote must be a single character");
+    }
+    ODBC_Get_Struct(self, STMT, stmt_type, q);
+    if (q->ncols <= 0) {
+	rb_raise(Cerror, "%s", set_err("No columns in result set", 0));
+    }
+    c.q = q;
+    c.self = self;
+    c.io = io;
+    c.sep = RSTRING_PTR(sep);
+    c.seplen = RSTRING_LEN(sep);
+    c.null = RSTRING_PTR(null);
+    c.nulllen = RSTRING_LEN(null);
+    c.quote = -1;
+    if (RSTRING_LEN(quote) > 0) {
+	c.quote = (unsigned char) RSTRING_PTR(quote)[0];
+	c.special[c.quote] = 1;
+	c.special[(unsigned char) c.sep[0]] = 1;
+	c.special['\r'] = 1;
+	c.special['\n'] = 1;
+    }
+    c.fd = -1;
+    if ((TYPE(io) == T_FILE) && rb_respond_to(io, IDbinmodep) &&
+	RTEST(rb_funcall(io, IDbinmodep, 0))) {
+	rb_io_flush(io);
+	c.fd = NUM2INT(rb_funcall(io, IDfileno, 0));
+    }
+    export_rowset(q, 1024);
+    /* IO#write may run other threads, keep them off the statement */
+    q->busy++;
+    rb_ensure(csv_run, (VALUE) &c, csv_ensure, (VALUE) &c);
+    /* c.sep and c.null point into these */
+    RB_GC_GUARD(sep);
+    RB_GC_GUARD(quote);
+    RB_GC_GUARD(null);
+    return LONG2NUM(c.total);
 }
 
 static int
-param_num_check(STMT *q, VALUE pnum, int mkparaminfo, int needout)
+stmt_hash_mode(int argc, VALUE *argv, VALUE self)
 {
-    int vnum;
+    VALUE withtab = Qnil, usesym = Qnil;
+    int mode = DOFETCH_HASH;
 
-    Check_Type(pnum, T_FIXNUM);
-    vnum = NUM2INT(pnum);
-    if (mkparaminfo && (q->paraminfo == NULL)) {
-	char *msg = NULL;
-	SQLSMALLINT nump = 0;
+    rb_scan_args(argc, argv, "02", &withtab, &usesym);
+    if ((withtab != Qtrue) && (withtab != Qfalse) && (withtab != Modbc) &&
+	(rb_obj_is_kind_of(withtab, rb_cHash) == Qtrue)) {
+	VALUE v;
 
-	if (!succeeded(SQL_NULL_HENV, SQL_NULL_HDBC, q->hstmt,
-		       SQLNumParams(q->hstmt, &nump), NULL, "SQLNumParams")) {
-	    nump = 0;
+	v = rb_hash_aref(withtab, ID2SYM(IDkey));
+	if (v == ID2SYM(IDSymbol)) {
+	    mode = DOFETCH_HASHK;
+	} else if (v == ID2SYM(IDString)) {
+	    mode = DOFETCH_HASH;
+	} else if (v == ID2SYM(IDFixnum)) {
+	    mode = DOFETCH_HASHN;
+	} else {
+	    rb_raise(Cerror, "Unsupported key mode");
 	}
-	if (nump > 0) {
-	    PARAMINFO *paraminfo = make_paraminfo(q->hstmt, nump, &msg);
-
-	    if (paraminfo == NULL) {
-		rb_raise(Cerror, "%s", msg);
-	    }
-	    q->paraminfo = paraminfo;
-	    if (q->paraminfo != NULL) {
-		q->nump = nump;
+	if (mode != DOFETCH_HASHN) {
+	    v = rb_hash_aref(withtab, ID2SYM(IDtable_names));
+	    if (RTEST(v)) {
+		mode = (mode == DOFETCH_HASHK)
+		     ? DOFETCH_HASHK2 : DOFETCH_HASH2;
 	    }
 	}
+	return mode;
     }
-    if ((q->paraminfo == NULL) || (vnum < 0) || (vnum >= q->nump)) {
-	rb_raise(rb_eArgError, "parameter number out of bounds");
+    if (withtab == Modbc) {
+	return DOFETCH_HASHN;
     }
-    if (needout) {
-	if ((q->paraminfo[vnum].iotype != SQL_PARAM_OUTPUT) &&
-	    (q->paraminfo[vnum].iotype != SQL_PARAM_INPUT_OUTPUT)) {
-	    rb_raise(Cerror, "not an output parameter");
-	}
+    mode = RTEST(withtab) ? DOFETCH_HASH2 : DOFETCH_HASH;
+    if (RTEST(usesym)) {
+	mode = (mode == DOFETCH_HASH2) ? DOFETCH_HASHK2 : DOFETCH_HASHK;
     }
-    return vnum;
+    return mode;
 }
 
 static VALUE
-stmt_param_type(int argc, VALUE *argv, VALUE self)
+stmt_fetch_hash1(int argc, VALUE *argv, VALUE self, int bang)
 {
-    VALUE pnum, ptype, pcoldef, pscale;
-    int vnum;
     STMT *q;
+    SQLRETURN ret;
+    int mode = stmt_hash_mode(argc, argv, self);
+    const char *msg;
+    char *err;
 
-    rb_scan_args(argc, argv, "13", &pnum, &ptype, &pcoldef, &pscale);
-    Data_Get_Struct(self, STMT, q);
-    vnum = param_num_check(q, pnum, 1, 0);
-    if (argc > 1) {
-	int vtype, vcoldef, vscale;
-
-	Check_Type(ptype, T_FIXNUM);
-	vtype = NUM2INT(ptype);
-	if (argc > 2) {
-	    Check_Type(pcoldef, T_FIXNUM);
-	    vcoldef = NUM2INT(pcoldef);
-	    if (argc > 3) {
-		Check_Type(pscale, T_FIXNUM);
-		vscale = NUM2INT(pscale);
-		q->paraminfo[vnum].scale = vscale;
-	    }
-	    q->paraminfo[vnum].coldef = vcoldef;
-	}
-	q->paraminfo[vnum].type = vtype;
-	q->paraminfo[vnum].override = 1;
+    ODBC_Get_Struct(self, STMT, stmt_type, q);
+    if (q->ncols <= 0) {
 	return Qnil;
     }
-    return INT2NUM(q->paraminfo[vnum].type);
+    if (q->usef) {
+	goto usef;
+    }
+#if (ODBCVER < 0x0300)
+    msg = "SQLExtendedFetch(SQL_FETCH_NEXT)";
+#else
+    msg = "SQLFetchScroll(SQL_FETCH_NEXT)";
+#endif
+    ret = fetch_rowset(q, SQL_FETCH_NEXT, 0, 0);
+    if (ret == SQL_NO_DATA) {
+	(void) tracesql(SQL_NULL_HENV, SQL_NULL_HDBC, q->hstmt, ret, msg);
+	return Qnil;
+    }
+    if (succeeded(SQL_NULL_HENV, SQL_NULL_HDBC, q->hstmt, ret, &err, msg)) {
+	return do_fetch(q, mode | (bang ? DOFETCH_BANG : 0));
+    }
+    if ((err != NULL) &&
+	((strncmp(err, "IM001", 5) == 0) ||
+	 (strncmp(err, "HYC00", 5) == 0))) {
+usef:
+	/* Fallback to SQLFetch() when others not implemented */
+	msg = "SQLFetch";
+	q->usef = 1;
+	ret = fetch_rowset(q, SQL_FETCH_NEXT, 0, 1);
+	if (ret == SQL_NO_DATA) {
+	    (void) tracesql(SQL_NULL_HENV, SQL_NULL_HDBC, q->hstmt, ret, msg);
+	    return Qnil;
+	}
+	if (succeeded(SQL_NULL_HENV, SQL_NULL_HDBC, q->hstmt, ret,
+		      &err, msg)) {
+	    return do_fetch(q, mode | (bang ? DOFETCH_BANG : 0));
+	}
+    }
+    rb_raise(Cerror, "%s", err);
+    return Qnil;
 }
 
 static VALUE
-stmt_param_iotype(int argc, VALUE *argv, VALUE self)
+stmt_fetch_hash(int argc, VALUE *argv, VALUE self)
 {
-    VALUE pnum, piotype;
-    int vnum, viotype;
-    STMT *q;
+    if (rb_block_given_p()) {
+	return stmt_each_hash(argc, argv, self);
+    }
+    return stmt_fetch_hash1(argc, argv, self, 0);
+}
 
-    rb_scan_args(argc, argv, "11", &pnum, &piotype);
-    Data_Get_Struct(self, STMT, q);
-    vnum = param_num_check(q, pnum, 1, 0);
-    if (argc > 1) {
-	Check_Type(piotype, T_FIXNUM);
-	viotype = NUM2INT(piotype);
-	switch (viotype) {
-	case SQL_PARAM_INPUT:
-	case SQL_PARAM_INPUT_OUTPUT:
-	case SQL_PARAM_OUTPUT:
-	    q->paraminfo[vnum].iotype = viotype;
-	    break;
-	}
+static VALUE
+stmt_fetch_hash_bang(int argc, VALUE *argv, VALUE self)
+{
+    if (rb_block_given_p()) {
+	return stmt_each_hash(argc, argv, self);
     }
-    return INT2NUM(q->paraminfo[vnum].iotype);
+    return stmt_fetch_hash1(argc, argv, self, 1);
 }
 
 static VALUE
-stmt_param_output_value(int argc, VALUE *argv, VALUE self)
+stmt_fetch_first_hash1(int argc, VALUE *argv, VALUE self, int bang, int nopos)
 {
-    VALUE pnum, v;
-    int vnum;
     STMT *q;
+    SQLRETURN ret;
+    int mode = stmt_hash_mode(argc, argv, self);
+    const char *msg;
+    char *err;
 
-    rb_scan_args(argc, argv, "10", &pnum);
-    Data_Get_Struct(self, STMT, q);
-    vnum = param_num_check(q, pnum, 0, 1);
-    v = Qnil;
-    if (q->paraminfo[vnum].rlen == SQL_NULL_DATA) {
-	return v;
+    ODBC_Get_Struct(self, STMT, stmt_type, q);
+    if (q->ncols <= 0) {
+	return Qnil;
     }
-    if (q->paraminfo[vnum].outbuf == NULL) {
-	rb_raise(Cerror, "no output value available");
+    if (nopos) {
+	goto dofetch;
     }
-    switch (q->paraminfo[vnum].ctype) {
-    case SQL_C_LONG:
-	v = INT2NUM(*((SQLINTEGER *) q->paraminfo[vnum].outbuf));
-	break;
-    case SQL_C_DOUBLE:
-	v = rb_float_new(*((double *) q->paraminfo[vnum].outbuf));
-	break;
-    case SQL_C_DATE:
-	{
-	    DATE_STRUCT *date;
+#if (ODBCVER < 0x0300)
+    msg = "SQLExtendedFetch(SQL_FETCH_FIRST)";
+#else
+    msg = "SQLFetchScroll(SQL_FETCH_FIRST)";
+#endif
+    ret = fetch_rowset(q, SQL_FETCH_FIRST, 0, 0);
+    if (ret == SQL_NO_DATA) {
+	(void) tracesql(SQL_NULL_HENV, SQL_NULL_HDBC, q->hstmt, ret, msg);
+	return Qnil;
+    }
+    if (succeeded(SQL_NULL_HENV, SQL_NULL_HDBC, q->hstmt, ret, &err, msg)) {
+dofetch:
+	return do_fetch(q, mode | (bang ? DOFETCH_BANG : 0));
+    }
+    rb_raise(Cerror, "%s", err);
+    return Qnil;
+}
 
-	    if (q->dbcp != NULL && q->dbcp->rbtime == Qtrue) {
-		const char *p;
-		char buffer[128];
-		VALUE d;
-
-		date = (DATE_STRUCT *) q->paraminfo[vnum].outbuf;
-		p = (q->dbcp->gmtime == Qtrue) ? "+00:00" : "";
-		sprintf(buffer, "%d-%d-%dT00:00:00%s",
-			date->year, date->month, date->day, p);
-		d = rb_str_new2(buffer);
-		v = rb_funcall(rb_cDate, IDparse, 1, d);
-	    } else {
-		v = Data_Make_Struct(Cdate, DATE_STRUCT, 0, xfree, date);
-		*date = *((DATE_STRUCT *) q->paraminfo[vnum].outbuf);
-	    }
-	}
-	break;
-    case SQL_C_TIME:
-	{
-	    TIME_STRUCT *time;
+static VALUE
+stmt_fetch_first_hash(int argc, VALUE *argv, VALUE self)
+{
+    return stmt_fetch_first_hash1(argc, argv, self, 0, 0);
+}
 
-	    if (q->dbcp != NULL && q->dbcp->rbtime == Qtrue) {
-		VALUE now, frac;
-
-		time = (TIME_STRUCT *) q->paraminfo[vnum].outbuf;
-		frac = rb_float_new(0.0);
-		now = rb_funcall(rb_cTime, IDnow, 0, NULL);
-		v = rb_funcall(rb_cTime,
-			       (q->dbcp->gmtime == Qtrue) ? IDutc : IDlocal,
-			       7,
-			       rb_funcall(now, IDyear, 0, NULL),
-			       rb_funcall(now, IDmonth, 0, NULL),
-			       rb_funcall(now, IDday, 0, NULL),
-			       INT2NUM(time->hour),
-			       INT2NUM(time->minute),
-			       INT2NUM(time->second),
-			       frac);
-	    } else {
-		v = Data_Make_Struct(Ctime, TIME_STRUCT, 0, xfree, time);
-		*time = *((TIME_STRUCT *) q->paraminfo[vnum].outbuf);
-	    }
-	}
-	break;
-    case SQL_C_TIMESTAMP:
-	{
-	    TIMESTAMP_STRUCT *ts;
+static VALUE
+stmt_each(VALUE self)
+{
+    VALUE row, res = Qnil;
+    STMT *q;
 
-	    if (q->dbcp != NULL && q->dbcp->rbtime == Qtrue) {
-		VALUE frac;
-
-		ts = (TIMESTAMP_STRUCT *) q->paraminfo[vnum].outbuf;
-		frac = rb_float_new((double) 1.0e-3 * ts->fraction);
-		v = rb_funcall(rb_cTime,
-			       (q->dbcp->gmtime == Qtrue) ? IDutc : IDlocal,
-			       7,
-			       INT2NUM(ts->year),
-			       INT2NUM(ts->month),
-			       INT2NUM(ts->day),
-			       INT2NUM(ts->hour),
-			       INT2NUM(ts->minute),
-			       INT2NUM(ts->second),
-			       frac);
-	    } else {
-		v = Data_Make_Struct(Ctimestamp, TIMESTAMP_STRUCT,
-				     0, xfree, ts);
-		*ts = *((TIMESTAMP_STRUCT *) q->paraminfo[vnum].outbuf);
-	    }
-	}
-	break;
-#ifdef UNICODE
-    case SQL_C_WCHAR:
-	v = uc_tainted_str_new((SQLWCHAR *) q->paraminfo[vnum].outbuf,
-			       q->paraminfo[vnum].rlen / sizeof (SQLWCHAR));
-	break;
+    ODBC_Get_Struct(self, STMT, stmt_type, q);
+    switch (callsql(SQL_NULL_HENV, SQL_NULL_HDBC, q->hstmt,
+		    fetch_rowset(q, SQL_FETCH_FIRST, 0, 0),
+#if (ODBCVER < 0x0300)
+		    "SQLExtendedFetch(SQL_FETCH_FIRST)"))
+#else
+		    "SQLFetchScroll(SQL_FETCH_FIRST)"))
 #endif
-    case SQL_C_CHAR:
-	v = rb_tainted_str_new(q->paraminfo[vnum].outbuf,
-			       q->paraminfo[vnum].rlen);
+    {
+    case SQL_NO_DATA:
+	row = Qnil;
+	break;
+    case SQL_SUCCESS:
+    case SQL_SUCCESS_WITH_INFO:
+	row = stmt_fetch_first1(self, 0, 1);
 	break;
+    default:
+	row = stmt_fetch1(self, 0);
     }
-    return v;
+    if (rb_block_given_p()) {
+	while (row != Qnil) {
+	    rb_yield(row);
+	    row = stmt_fetch1(self, 0);
+	}
+	return self;
+    }
+    if (row != Qnil) {
+	res = rb_ary_new();
+	while (row != Qnil) {
+	    rb_ary_push(res, row);
+	    row = stmt_fetch1(self, 0);
+	}
+    }
+    return res;
 }
 
 static VALUE
-stmt_param_output_size(int argc, VALUE *argv, VALUE self)
+stmt_each_hash(int argc, VALUE *argv, VALUE self)
 {
-    VALUE pnum, psize;
-    int vnum, vsize;
+    VALUE row, res = Qnil, withtab[2];
     STMT *q;
+    int mode = stmt_hash_mode(argc, argv, self);
 
-    rb_scan_args(argc, argv, "11", &pnum, &psize);
-    Data_Get_Struct(self, STMT, q);
-    vnum = param_num_check(q, pnum, 0, 1);
-    if (argc > 1) {
-	Check_Type(psize, T_FIXNUM);
-	vsize = NUM2INT(psize);
-	if ((vsize > 0) && (vsize < (int) (4 * sizeof (double)))) {
-	    vsize = 4 * sizeof (double);
+    if (mode == DOFETCH_HASHN) {
+	withtab[0] = Modbc;
+	withtab[1] = Qfalse;
+    } else {
+	withtab[0] = ((mode == DOFETCH_HASH2) || (mode == DOFETCH_HASHK2))
+		   ? Qtrue : Qfalse;
+	withtab[1] = ((mode == DOFETCH_HASHK) || (mode == DOFETCH_HASHK2))
+		   ? Qtrue : Qfalse;
+    }
+    ODBC_Get_Struct(self, STMT, stmt_type, q);
+    switch (callsql(SQL_NULL_HENV, SQL_NULL_HDBC, q->hstmt,
+		    fetch_rowset(q, SQL_FETCH_FIRST, 0, 0),
+#if (ODBCVER < 0x0300)
+		    "SQLExtendedFetch(SQL_FETCH_FIRST)"))
+#else
+		    "SQLFetchScroll(SQL_FETCH_FIRST)"))
+#endif
+    {
+    case SQL_NO_DATA:
+	row = Qnil;
+	break;
+    case SQL_SUCCESS:
+    case SQL_SUCCESS_WITH_INFO:
+	row = stmt_fetch_first_hash1(2, withtab, self, 0, 1);
+	break;
+    default:
+	row = stmt_fetch_hash1(2, withtab, self, 0);
+    }
+    if (rb_block_given_p()) {
+	while (row != Qnil) {
+	    rb_yield(row);
+	    row = stmt_fetch_hash1(2, withtab, self, 0);
 	}
-	q->paraminfo[vnum].outsize = (vsize > 0) ? vsize : 0;
+	return self;
     }
-    return INT2NUM(q->paraminfo[vnum].outsize);
+    if (row != Qnil) {
+	res = rb_ary_new();
+	while (row != Qnil) {
+	    rb_ary_push(res, row);
+	    row = stmt_fetch_hash1(2, withtab, self, 0);
+	}
+    }
+    return res;
 }
 
 static VALUE
-stmt_param_output_type(int argc, VALUE *argv, VALUE self)
+stmt_more_results(VALUE self)
 {
-    VALUE pnum, ptype;
-    int vnum, vtype;
     STMT *q;
+    SQLRETURN ret;
+    char *msg;
 
-    rb_scan_args(argc, argv, "11", &pnum, &ptype);
-    Data_Get_Struct(self, STMT, q);
-    vnum = param_num_check(q, pnum, 0, 1);
-    if (argc > 1) {
-	Check_Type(ptype, T_FIXNUM);
-	vtype = NUM2INT(ptype);
-	q->paraminfo[vnum].outtype = vtype;
+    if (rb_block_given_p()) {
+	rb_raise(rb_eArgError, "block not allowed");
     }
-    return INT2NUM(q->paraminfo[vnum].outtype);
+    ODBC_Get_Struct(self, STMT, stmt_type, q);
+    if (q->hstmt == SQL_NULL_HSTMT) {
+	return Qfalse;
+    }
+    ret = nogvl_moreresults(q->hstmt);
+    if (ret == SQL_NO_DATA) {
+	(void) tracesql(SQL_NULL_HENV, SQL_NULL_HDBC, q->hstmt, ret,
+			"SQLMoreResults");
+	return Qfalse;
+    }
+    if (!succeeded(SQL_NULL_HENV, SQL_NULL_HDBC, q->hstmt, ret,
+		   &msg, "SQLMoreResults")) {
+	rb_raise(Cerror, "%s", msg);
+    }
+    free_stmt_sub(q, 0);
+    desc_clear(q);
+    make_result(q->dbc, q->hstmt, self, 0);
+    return Qtrue;
 }
 
 static VALUE
-stmt_cursorname(int argc, VALUE *argv, VALUE self)
+stmt_prep_int(int argc, VALUE *argv, VALUE self, int mode)
 {
-    VALUE cn = Qnil;
-    STMT *q;
+    DBC *p = get_dbc(self);
+    STMT *q = NULL;
+    VALUE sql, dbc, stmt;
+    SQLHSTMT hstmt;
 #ifdef UNICODE
-    SQLWCHAR cname[SQL_MAX_MESSAGE_LENGTH];
-    SQLWCHAR *cp;
+    SQLWCHAR *ssql = NULL, sqlbuf[512];
 #else
-    SQLCHAR cname[SQL_MAX_MESSAGE_LENGTH];
-    SQLCHAR *cp;
+    SQLCHAR *ssql = NULL;
 #endif
-    char *msg;
-    SQLSMALLINT cnLen = 0;
+    char *csql = NULL, *msg = NULL;
 
-    rb_scan_args(argc, argv, "01", &cn);
-    Data_Get_Struct(self, STMT, q);
-    if (cn == Qnil) {
-	if (!succeeded(SQL_NULL_HENV, SQL_NULL_HDBC, q->hstmt,
-		       SQLGetCursorName(q->hstmt, (SQLTCHAR *) cname,
-					(SQLSMALLINT) sizeof (cname), &cnLen),
-		       &msg, "SQLGetCursorName")) {
+    if (rb_obj_is_kind_of(self, Cstmt) == Qtrue) {
+	ODBC_Get_Struct(self, STMT, stmt_type, q);
+	stmt_check_busy(q);
+	if (q->sclink.head != NULL) {
+	    list_del(&q->sclink);
+	    p->sccount--;
+	}
+	q->sckey = Qnil;
+	free_stmt_sub(q, 0);
+	desc_clear(q);
+	if (q->hstmt == SQL_NULL_HSTMT) {
+	    if (!succeeded(SQL_NULL_HENV, p->hdbc, q->hstmt,
+			   SQLAllocStmt(p->hdbc, &q->hstmt),
+			   &msg, "SQLAllocStmt")) {
+		rb_raise(Cerror, "%s", msg);
+	    }
+	    diag_own_stmt(q);
+	} else if (!succeeded(SQL_NULL_HENV, SQL_NULL_HDBC, q->hstmt,
+			      SQLFreeStmt(q->hstmt, SQL_CLOSE),
+			      &msg, "SQLFreeStmt(SQL_CLOSE)")) {
 	    rb_raise(Cerror, "%s", msg);
 	}
-#ifdef UNICODE
-	cnLen = (cnLen == 0) ? (SQLSMALLINT) uc_strlen(cname) :
-	    (SQLSMALLINT) (cnLen / sizeof (SQLWCHAR));
-	return uc_tainted_str_new(cname, cnLen);
-#else
-	cnLen = (cnLen == 0) ? (SQLSMALLINT) strlen((char *) cname) : cnLen;
-	return rb_tainted_str_new((char *) cname, cnLen);
-#endif
-    }
-    if (TYPE(cn) != T_STRING) {
-	cn = rb_any_to_s(cn);
+	hstmt = q->hstmt;
+	stmt = self;
+	dbc = q->dbc;
+    } else {
+	if ((p->sccap > 0) &&
+	    !(mode & (MAKERES_EXECD | MAKERES_NOCACHE))) {
+	    return scache_prep(argc, argv, self, mode);
+	}
+	if (!succeeded(SQL_NULL_HENV, p->hdbc, SQL_NULL_HSTMT,
+		       SQLAllocStmt(p->hdbc, &hstmt),
+		       &msg, "SQLAllocStmt")) {
+	    rb_raise(Cerror, "%s", msg);
+	}
+	stmt = Qnil;
+	dbc = self;
     }
+    rb_scan_args(argc, argv, "1", &sql);
+    Check_Type(sql, T_STRING);
 #ifdef UNICODE
 #ifdef USE_RB_ENC
-    cn = rb_funcall(cn, IDencode, 1, rb_encv);
+    sql = rb_funcall(sql, IDencode, 1, rb_encv);
 #endif
-    cp = uc_from_utf((unsigned char *) STR2CSTR(cn), -1);
-    if (cp == NULL) {
+    csql = STR2CSTR(sql);
+    ssql = uc_from_utf_buf((unsigned char *) csql, -1, sqlbuf,
+			   sizeof (sqlbuf) / sizeof (sqlbuf[0]));
+    if (ssql == NULL) {
 	rb_raise(Cerror, "%s", set_err("Out of memory", 0));
     }
 #else
-    cp = (SQLCHAR *) STR2CSTR(cn);
-#endif
-    if (!succeeded(SQL_NULL_HENV, SQL_NULL_HDBC, q->hstmt,
-		   SQLSetCursorName(q->hstmt, cp, SQL_NTS),
-		   &msg, "SQLSetCursorName")) {
-#ifdef UNICODE
-	uc_free(cp);
-#endif
-	rb_raise(Cerror, "%s", msg);
-    }
-#ifdef UNICODE
-    uc_free(cp);
+    csql = STR2CSTR(sql);
+    ssql = (SQLCHAR *) csql;
 #endif
-    return cn;
-}
-
-static VALUE
-stmt_column(int argc, VALUE *argv, VALUE self)
-{
-    STMT *q;
-    VALUE col;
-
-    rb_scan_args(argc, argv, "1", &col);
-    Check_Type(col, T_FIXNUM);
-    Data_Get_Struct(self, STMT, q);
-    check_ncols(q);
-    return make_column(q->hstmt, FIX2INT(col), q->upc);
-}
-
-static VALUE
-stmt_columns(int argc, VALUE *argv, VALUE self)
-{
-    STMT *q;
-    int i;
-    VALUE res, as_ary = Qfalse;
+    if ((mode & MAKERES_EXECD)) {
+	SQLRETURN ret;
 
-    rb_scan_args(argc, argv, "01", &as_ary);
-    Data_Get_Struct(self, STMT, q);
-    check_ncols(q);
-    if (rb_block_given_p()) {
-	for (i = 0; i < q->ncols; i++) {
-	    rb_yield(make_column(q->hstmt, i, q->upc));
+	if (!succeeded_nodata(SQL_NULL_HENV, p->hdbc, hstmt,
+			      (ret = nogvl_execdirect(p->hdbc, hstmt, ssql)),
+			      &msg, "SQLExecDirect('%s')", csql)) {
+	    goto sqlerr;
 	}
-	return self;
-    }
-    if (RTEST(as_ary)) {
-	res = rb_ary_new2(q->ncols);
-    } else {
-	res = rb_hash_new();
-    }
-    for (i = 0; i < q->ncols; i++) {
-	VALUE obj;
-
-	obj = make_column(q->hstmt, i, q->upc);
-	if (RTEST(as_ary)) {
-	    rb_ary_store(res, i, obj);
-	} else {
-	    VALUE name = rb_iv_get(obj, "@name");
-
-	    if (rb_funcall(res, IDkeyp, 1, name) == Qtrue) {
-		char buf[32];
-
-		sprintf(buf, "#%d", i);
-		name = rb_str_dup(name);
-		name = rb_obj_taint(rb_str_cat2(name, buf));
+	if (ret == SQL_NO_DATA) {
+	    callsql(SQL_NULL_HENV, SQL_NULL_HDBC, hstmt,
+		    SQLFreeStmt(hstmt, SQL_CLOSE), "SQLFreeStmt(SQL_DROP)");
+	    if (q != NULL) {
+		q->hstmt = SQL_NULL_HSTMT;
+		unlink_stmt(q);
 	    }
-	    rb_hash_aset(res, name, obj);
+	    hstmt = SQL_NULL_HSTMT;
+	}
+    } else if (!succeeded(SQL_NULL_HENV, p->hdbc, hstmt,
+			  nogvl_prepare(p->hdbc, hstmt, ssql),
+			  &msg, "SQLPrepare('%s')", csql)) {
+sqlerr:
+#ifdef UNICODE
+	uc_free_buf(ssql, sqlbuf);
+#endif
+	callsql(SQL_NULL_HENV, SQL_NULL_HDBC, hstmt,
+		SQLFreeStmt(hstmt, SQL_DROP), "SQLFreeStmt(SQL_DROP)");
+	if (q != NULL) {
+	    q->hstmt = SQL_NULL_HSTMT;
+	    unlink_stmt(q);
 	}
+	rb_raise(Cerror, "%s", msg);
+    } else {
+	mode |= MAKERES_PREPARE;
     }
-    return res;
+#ifdef UNICODE
+    uc_free_buf(ssql, sqlbuf);
+#endif
+    return make_result(dbc, hstmt, stmt, mode);
 }
 
 static VALUE
-stmt_param(int argc, VALUE *argv, VALUE self)
+stmt_prep(int argc, VALUE *argv, VALUE self)
 {
-    STMT *q;
-    VALUE par;
-    int i;
+    return stmt_prep_int(argc, argv, self, MAKERES_BLOCK);
+}
 
-    rb_scan_args(argc, argv, "1", &par);
-    Check_Type(par, T_FIXNUM);
-    Data_Get_Struct(self, STMT, q);
-    i = FIX2INT(par);
-    if ((i < 0) || (i >= q->nump)) {
-	rb_raise(Cerror, "%s", set_err("Parameter out of bounds", 0));
-    }
-    return make_param(q, i);
+/*
+ *----------------------------------------------------------------------
+ *
+ *      Parameters given as IO or Enumerable are bound as
+ *      SQL_DATA_AT_EXEC and sent piecewise using SQLPutData()
+ *      when the driver asks for them during execution.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+is_stream_param(VALUE arg)
+{
+    /* IO, StringIO and alike, other objects are bound by to_s */
+    return rb_respond_to(arg, IDread);
 }
 
-static VALUE
-stmt_params(VALUE self)
+static int
+bind_stream_param(int pnum, VALUE arg, STMT *q, char **msgp)
 {
-    STMT *q;
-    int i;
-    VALUE res;
+    PARAMINFO *pi = &q->paraminfo[pnum];
+    SQLSMALLINT ctype, stype = pi->type;
+    SQLULEN coldef = pi->coldef;
 
-    Data_Get_Struct(self, STMT, q);
-    if (rb_block_given_p()) {
-	for (i = 0; i < q->nump; i++) {
-	    rb_yield(make_param(q, i));
+    if (pi->iotype != SQL_PARAM_INPUT) {
+	*msgp = set_err("Stream parameter must be input parameter", 0);
+	return -1;
+    }
+    switch (stype) {
+    case SQL_BINARY:
+    case SQL_VARBINARY:
+	stype = SQL_LONGVARBINARY;
+	/* FALL THRU */
+    case SQL_LONGVARBINARY:
+	ctype = SQL_C_BINARY;
+	break;
+    case SQL_CHAR:
+    case SQL_VARCHAR:
+	stype = SQL_LONGVARCHAR;
+	/* FALL THRU */
+    default:
+#ifdef UNICODE
+	if ((stype == SQL_WCHAR) || (stype == SQL_WVARCHAR)) {
+	    stype = SQL_WLONGVARCHAR;
 	}
-	return self;
+	ctype = SQL_C_WCHAR;
+#else
+	ctype = SQL_C_CHAR;
+#endif
+	break;
     }
-    res = rb_ary_new2(q->nump);
-    for (i = 0; i < q->nump; i++) {
-	VALUE obj;
-
-	obj = make_param(q, i);
-	rb_ary_store(res, i, obj);
+    if (coldef == 0) {
+	coldef = 0x7fffffff;
     }
-    return res;
+    pi->ctype = ctype;
+    pi->stream = arg;
+    pi->rlen = SQL_LEN_DATA_AT_EXEC(0);
+    if (!succeeded(SQL_NULL_HENV, SQL_NULL_HDBC, q->hstmt,
+		   SQLBindParameter(q->hstmt, (SQLUSMALLINT) (pnum + 1),
+				    SQL_PARAM_INPUT, ctype, stype, coldef,
+				    pi->scale, (SQLPOINTER) pi, 0, &pi->rlen),
+		   msgp, "SQLBindParameter(%d)", pnum + 1)) {
+	pi->stream = Qnil;
+	return -1;
+    }
+    return 0;
 }
 
-static VALUE
-do_fetch(STMT *q, int mode)
+/*
+ * Bind an Integer which doesn't fit into SQL_C_LONG: as SQL_C_SBIGINT or
+ * SQL_C_UBIGINT when it fits into 64 bits, else as SQL_C_NUMERIC when
+ * it has at most 38 decimal digits. Returns the buffer length or 0 when
+ * the value must be bound as a string.
+ */
+
+static SQLINTEGER
+bind_integer(VALUE arg, char *buffer, SQLSMALLINT *ctypep)
 {
-    int i, offc;
-    char **bufs, *msg;
-    VALUE res;
+#ifdef HAVE_RB_INTEGER_PACK
+    unsigned char mag[16];
+    unsigned long long u = 0;
+    int i, sign, wide = 0;
 
-    if (q->ncols <= 0) {
-	rb_raise(Cerror, "%s", set_err("No columns in result set", 0));
+    sign = rb_integer_pack(arg, mag, sizeof (mag), 1, 0,
+			   INTEGER_PACK_LITTLE_ENDIAN);
+    if ((sign < -1) || (sign > 1)) {
+	return 0;
     }
-    if (++q->fetchc >= 500) {
-	q->fetchc = 0;
-	start_gc();
+    for (i = sizeof (mag) - 1; i >= 8; i--) {
+	wide |= mag[i];
     }
-    bufs = q->dbufs;
-    if (bufs == NULL) {
-	int need = sizeof (char *) * q->ncols, needp;
-	char *p;
-
-	need = LEN_ALIGN(need);
-	needp = need;
-	for (i = 0; i < q->ncols; i++) {
-	    if (q->coltypes[i].size != SQL_NO_TOTAL) {
-		need += LEN_ALIGN(q->coltypes[i].size);
-	    }
+    for (i = 7; i >= 0; i--) {
+	u = (u << 8) | mag[i];
+    }
+#ifdef SQL_C_SBIGINT
+    if (!wide) {
+	if ((sign >= 0) && (u <= 0x7fffffffffffffffULL)) {
+	    *(SQLBIGINT *) buffer = (SQLBIGINT) u;
+	    *ctypep = SQL_C_SBIGINT;
+	    return sizeof (SQLBIGINT);
 	}
-	p = ALLOC_N(char, need);
-	if (p == NULL) {
-	    rb_raise(Cerror, "%s", set_err("Out of memory", 0));
+	if ((sign < 0) && (u <= 0x8000000000000000ULL)) {
+	    *(SQLBIGINT *) buffer = (SQLBIGINT) (0 - u);
+	    *ctypep = SQL_C_SBIGINT;
+	    return sizeof (SQLBIGINT);
 	}
-	q->dbufs = bufs = (char **) p;
-	p += needp;
-	for (i = 0; i < q->ncols; i++) {
-	    int len = q->coltypes[i].size;
-
-	    if (len == SQL_NO_TOTAL) {
-		bufs[i] = NULL;
-	    } else {
-		bufs[i] = p;
-		p += LEN_ALIGN(len);
-	    }
+#ifdef SQL_C_UBIGINT
+	if (sign > 0) {
+	    *(SQLUBIGINT *) buffer = (SQLUBIGINT) u;
+	    *ctypep = SQL_C_UBIGINT;
+	    return sizeof (SQLUBIGINT);
 	}
-    }
-    switch (mode & DOFETCH_MODES) {
-    case DOFETCH_HASH:
-    case DOFETCH_HASH2:
-    case DOFETCH_HASHK:
-    case DOFETCH_HASHK2:
-	if (q->colnames == NULL) {
-	    int need = sizeof (char *) * 4 * q->ncols + sizeof (char *);
-	    int max_len[2] = { 0, 0 };
-	    char **na, *p;
-#ifdef UNICODE
-	    SQLWCHAR name[SQL_MAX_MESSAGE_LENGTH];
-#else
-	    char name[SQL_MAX_MESSAGE_LENGTH];
-#endif
-	    SQLSMALLINT name_len;
-
-	    for (i = 0; i < q->ncols; i++) {
-		int need_len;
-
-		name[0] = 0;
-		if (!succeeded(SQL_NULL_HENV, SQL_NULL_HDBC, q->hstmt,
-			       SQLColAttributes(q->hstmt,
-						(SQLUSMALLINT) (i + 1),
-						SQL_COLUMN_TABLE_NAME,
-						name,
-						sizeof (name),
-						&name_len, NULL),
-			       &msg,
-			       "SQLColAttributes(SQL_COLUMN_TABLE_NAME)")) {
-		    rb_raise(Cerror, "%s", msg);
-		}
-		if (name_len >= (SQLSMALLINT) sizeof (name)) {
-		    name_len = sizeof (name) - 1;
-		}
-		if (name_len > 0) {
-		    name[name_len / sizeof (name[0])] = 0;
-		}
-#ifdef UNICODE
-		need_len = 6 * (uc_strlen(name) + 1);
-#else
-		need_len = 2 * (strlen(name) + 1);
 #endif
-		need += need_len;
-		if (max_len[0] < need_len) {
-		    max_len[0] = need_len;
-		}
-		name[0] = 0;
-		if (!succeeded(SQL_NULL_HENV, SQL_NULL_HDBC, q->hstmt,
-			       SQLColAttributes(q->hstmt,
-						(SQLUSMALLINT) (i + 1),
-						SQL_COLUMN_LABEL, name,
-						sizeof (name),
-						&name_len, NULL),
-			       &msg, "SQLColAttributes(SQL_COLUMN_LABEL)")) {
-		    rb_raise(Cerror, "%s", msg);
-		}
-		if (name_len >= (SQLSMALLINT) sizeof (name)) {
-		    name_len = sizeof (name) - 1;
-		}
-		if (name_len > 0) {
-		    name[name_len / sizeof (name[0])] = 0;
-		}
-#ifdef UNICODE
-		need_len = 6 * 2 * (uc_strlen(name) + 1);
-#else
-		need_len = 2 * (strlen(name) + 1);
+    }
 #endif
-		need += need_len;
-		if (max_len[1] < need_len) {
-		    max_len[1] = need_len;
-		}
-	    }
-	    need += max_len[0] + max_len[1] + 32;
-	    p = ALLOC_N(char, need);
-	    if (p == NULL) {
-		rb_raise(Cerror, "%s", set_err("Out of memory", 0));
-	    }
-	    na = (char **) p;
-	    p += sizeof (char *) * 4 * q->ncols + sizeof (char *);
-	    for (i = 0; i < q->ncols; i++) {
-		char *p0;
+#if (ODBCVER >= 0x0300) && defined(SQL_C_NUMERIC)
+    {
+	SQL_NUMERIC_STRUCT *num = (SQL_NUMERIC_STRUCT *) buffer;
+	VALUE str = rb_big2str(arg, 10);
+	long ndigits = RSTRING_LEN(str) - ((sign < 0) ? 1 : 0);
 
-		name[0] = 0;
-		callsql(SQL_NULL_HENV, SQL_NULL_HDBC, q->hstmt,
-			SQLColAttributes(q->hstmt, (SQLUSMALLINT) (i + 1),
-					 SQL_COLUMN_TABLE_NAME, name,
-					 sizeof (name), &name_len, NULL),
-			"SQLColAttributes(SQL_COLUMN_TABLE_NAME)");
-		if (name_len >= (SQLSMALLINT) sizeof (name)) {
-		    name_len = sizeof (name) - 1;
-		}
-		if (name_len > 0) {
-		    name[name_len / sizeof (name[0])] = 0;
-		}
-		na[i + q->ncols] = p;
-#ifdef UNICODE
-		p += mkutf(p, name, uc_strlen(name));
-#else
-		strcpy(p, name);
+	if (ndigits > 38) {
+	    return 0;
+	}
+	memset(num, 0, sizeof (SQL_NUMERIC_STRUCT));
+	num->precision = (SQLCHAR) ndigits;
+	num->scale = 0;
+	num->sign = (sign < 0) ? 0 : 1;
+	memcpy(num->val, mag, sizeof (num->val));
+	*ctypep = SQL_C_NUMERIC;
+	return sizeof (SQL_NUMERIC_STRUCT);
+    }
 #endif
-		strcat(p, ".");
-		p += strlen(p);
-		p0 = p;
-		name[0] = 0;
-		callsql(SQL_NULL_HENV, SQL_NULL_HDBC, q->hstmt,
-			SQLColAttributes(q->hstmt, (SQLUSMALLINT) (i + 1),
-					 SQL_COLUMN_LABEL, name,
-					 sizeof (name), &name_len, NULL),
-			"SQLColAttributes(SQL_COLUMN_LABEL)");
-		if (name_len >= (SQLSMALLINT) sizeof (name)) {
-		    name_len = sizeof (name) - 1;
-		}
-		if (name_len > 0) {
-		    name[name_len / sizeof (name[0])] = 0;
-		}
-		na[i] = p;
-#ifdef UNICODE
-		p += mkutf(p, name, uc_strlen(name)) + 1;
-#else
-		strcpy(p, name);
-		p += strlen(p) + 1;
 #endif
-		na[i + 3 * q->ncols] = p;
-		strcpy(p, na[i + q->ncols]);
-		p += p0 - na[i + q->ncols];
-		na[i + 2 * q->ncols] = upcase_if(p, 1);
-		p += strlen(p) + 1;
-	    }
-	    /* reserved space for later adjustments */
-	    na[4 * q->ncols] = p;
-	    q->colnames = na;
-	    if (q->colvals == NULL) {
-		q->colvals = ALLOC_N(VALUE, 4 * q->ncols);
-		if (q->colvals != NULL) {
-		    VALUE cname;
-		    VALUE colbuf[4];
+    return 0;
+}
 
-		    for (i = 0; i < 4 * q->ncols; i++) {
-			q->colvals[i] = Qnil;
-		    }
-		    for (i = 0; i < 4; i++) {
-			colbuf[i] = rb_iv_get(q->self, colnamebuf[i]);
-			if (colbuf[i] == Qnil) {
-			    res = rb_hash_new();
-			    rb_iv_set(q->self, colnamebuf[i], res);
-			}
-		    }
-		    for (i = 0; i < 4 * q->ncols; i++) {
-			res = colbuf[i / q->ncols];
-			cname = rb_tainted_str_new2(q->colnames[i]);
-#ifdef USE_RB_ENC
-			rb_enc_associate(cname, rb_enc);
+static int
+bind_one_param(int pnum, VALUE arg, STMT *q, char **msgp, int *outpp)
+{
+    SQLPOINTER valp = (SQLPOINTER) &q->paraminfo[pnum].buffer;
+    SQLSMALLINT ctype, stype;
+    SQLINTEGER vlen, rlen;
+    SQLUINTEGER coldef;
+#ifdef NO_RB_STR2CSTR
+    VALUE val;
 #endif
-			q->colvals[i] = cname;
-			if (rb_funcall(res, IDkeyp, 1, cname) == Qtrue) {
-			    char *p;
+    long llen;
+    int retry = 1;
+#ifdef UNICODE
+    SQLWCHAR *up;
 
-			    cname = rb_tainted_str_new2(q->colnames[i]);
+    q->paraminfo[pnum].tofree = NULL;
+#endif
+    q->paraminfo[pnum].stream = Qnil;
+    q->paraminfo[pnum].strval = Qnil;
+    switch (TYPE(arg)) {
+    case T_STRING:
+#ifdef UNICODE
+	ctype = SQL_C_WCHAR;
 #ifdef USE_RB_ENC
-			    rb_enc_associate(cname, rb_enc);
+	arg = rb_funcall(arg, IDencode, 1, rb_encv);
 #endif
-			    p = q->colnames[4 * q->ncols];
-			    sprintf(p, "#%d", i);
-			    cname = rb_str_cat2(cname, p);
-			    q->colvals[i] = cname;
-			}
-			rb_obj_freeze(cname);
-			rb_hash_aset(res, cname, Qtrue);
-		    }
-		}
-	    }
+#ifndef NO_RB_STR2CSTR
+	up = (SQLWCHAR *) rb_str2cstr(arg, &llen);
+	if (llen != (long) strlen((char *) up)) {
+	    ctype = SQL_C_BINARY;
+	    valp = (SQLPOINTER) up;
+	    rlen = llen;
+	    vlen = rlen + 1;
+	    break;
 	}
-	/* FALL THRU */
-    case DOFETCH_HASHN:
-	if (mode & DOFETCH_BANG) {
-	    res = rb_iv_get(q->self, "@_h");
-	    if (res == Qnil) {
-		res = rb_hash_new();
-		rb_iv_set(q->self, "@_h", res);
-	    }
-	} else {
-	    res = rb_hash_new();
+#else
+	val = rb_string_value(&arg);
+	up = (SQLWCHAR *) RSTRING_PTR(val);
+	llen = RSTRING_LEN(val);
+	if (up == NULL) {
+	    goto oom;
+	}
+	if (memchr((char *) up, 0, llen)) {
+	    ctype = SQL_C_BINARY;
+	    valp = (SQLPOINTER) up;
+	    rlen = llen;
+	    vlen = rlen + 1;
+	    break;
 	}
+	up = (SQLWCHAR *) rb_string_value_cstr(&arg);
+#endif
+	up = uc_from_utf_scratch(&q->paraminfo[pnum].ucbuf,
+				 &q->paraminfo[pnum].ucsize,
+				 (unsigned char *) up, llen);
+	if (up == NULL) {
+	    goto oom;
+	}
+	*(SQLWCHAR **) valp = up;
+	rlen = uc_strlen(up) * sizeof (SQLWCHAR);
+	vlen = rlen + sizeof (SQLWCHAR);
+	if (up != q->paraminfo[pnum].ucbuf) {
+	    q->paraminfo[pnum].tofree = up;
+	}
+#else
+	ctype = SQL_C_CHAR;
+#ifndef NO_RB_STR2CSTR
+	valp = (SQLPOINTER) rb_str2cstr(arg, &llen);
+	rlen = llen;
+	if (rlen != (SQLINTEGER) strlen((char *) valp)) {
+	    ctype = SQL_C_BINARY;
+	}
+	vlen = rlen + 1;
+#else
+	val = rb_string_value(&arg);
+	valp = (SQLPOINTER) RSTRING_PTR(val);
+	llen = RSTRING_LEN(val);
+	if (valp == NULL) {
+	    goto oom;
+	}
+	rlen = llen;
+	vlen = rlen + 1;
+	if (memchr((char *) valp, 0, llen)) {
+	    ctype = SQL_C_BINARY;
+	    break;
+	}
+	valp = (SQLPOINTER) rb_string_value_cstr(&arg);
+#endif
+#endif
 	break;
-    default:
-	if (mode & DOFETCH_BANG) {
-	    res = rb_iv_get(q->self, "@_a");
-	    if (res == Qnil) {
-		res = rb_ary_new2(q->ncols);
-		rb_iv_set(q->self, "@_a", res);
-	    } else {
-		rb_ary_clear(res);
-	    }
+    case T_FIXNUM:
+#if defined(SQL_C_SBIGINT) && (SIZEOF_LONG > 4)
+	if ((FIX2LONG(arg) > 0x7fffffffL) ||
+	    (FIX2LONG(arg) < -0x7fffffffL - 1)) {
+	    ctype = SQL_C_SBIGINT;
+	    *(SQLBIGINT *) valp = FIX2LONG(arg);
+	    rlen = 1;
+	    vlen = sizeof (SQLBIGINT);
+	    break;
+	}
+#endif
+	ctype = SQL_C_LONG;
+	*(SQLINTEGER *) valp = FIX2INT(arg);
+	rlen = 1;
+	vlen = sizeof (SQLINTEGER);
+	break;
+    case T_BIGNUM:
+	vlen = bind_integer(arg, q->paraminfo[pnum].buffer, &ctype);
+	if (vlen > 0) {
+	    rlen = 1;
+	    break;
 	} else {
-	    res = rb_ary_new2(q->ncols);
+	    VALUE str = rb_big2str(arg, 10);
+
+	    /* keep string alive until executed */
+	    q->paraminfo[pnum].strval = str;
+	    ctype = SQL_C_CHAR;
+	    valp = (SQLPOINTER) RSTRING_PTR(str);
+	    rlen = RSTRING_LEN(str);
+	    vlen = rlen + 1;
 	}
-    }
-    offc = q->upc ? (2 * q->ncols) : 0;
-    switch (mode & DOFETCH_MODES) {
-    case DOFETCH_HASHK2:
-    case DOFETCH_HASH2:
-	offc += q->ncols;
 	break;
-    }
-    for (i = 0; i < q->ncols; i++) {
-	SQLLEN totlen;
-	SQLLEN curlen = q->coltypes[i].size;
-	SQLSMALLINT type = q->coltypes[i].type;
-	VALUE v, name;
-	char *valp, *freep = NULL;
+    case T_FLOAT:
+	ctype = SQL_C_DOUBLE;
+	*(double *) valp = NUM2DBL(arg);
+	rlen = 1;
+	vlen = sizeof (double);
+	break;
+    case T_NIL:
+	ctype = SQL_C_CHAR;
+	valp = NULL;
+	rlen = SQL_NULL_DATA;
+	vlen = 0;
+	break;
+    case T_SYMBOL:
+	ctype = SQL_C_CHAR;
+	valp = NULL;
+	vlen = 0;
+	if (arg == ID2SYM(IDNULL)) {
+	    rlen = SQL_NULL_DATA;
+	} else if (arg == ID2SYM(IDdefault)) {
+	    rlen = SQL_DEFAULT_PARAM;
+	}
+	/* fall through */
+    default:
+	/* Time first, the most frequent and unrelated to the ODBC types */
+	if (rb_obj_is_kind_of(arg, rb_cTime) == Qtrue) {
+	    ctype = rbtime_ctype(q->paraminfo[pnum].type);
+	    rbtime_to_struct(arg, ctype, valp);
+	    rlen = 1;
+	    vlen = (ctype == SQL_C_DATE) ? sizeof (DATE_STRUCT) :
+		((ctype == SQL_C_TIME) ? sizeof (TIME_STRUCT) :
+		 sizeof (TIMESTAMP_STRUCT));
+	    break;
+	}
+	if (rb_obj_is_kind_of(arg, Cdate) == Qtrue) {
+	    DATE_STRUCT *date;
 
-	if (curlen == SQL_NO_TOTAL) {
-	    SQLLEN chunksize = SEGSIZE;
+	    ctype = SQL_C_DATE;
+	    Data_Get_Struct(arg, DATE_STRUCT, date);
+	    valp = (SQLPOINTER) date;
+	    rlen = 1;
+	    vlen = sizeof (DATE_STRUCT);
+	    break;
+	}
+	if (rb_obj_is_kind_of(arg, Ctime) == Qtrue) {
+	    TIME_STRUCT *time;
 
-	    totlen = 0;
-#ifdef UNICODE
-	    valp = ALLOC_N(char, chunksize + sizeof (SQLWCHAR));
-#else
-	    valp = ALLOC_N(char, chunksize + 1);
-#endif
-	    freep = valp;
-	    while ((curlen == SQL_NO_TOTAL) || (curlen > chunksize)) {
-		SQLRETURN rc;
-		int ret;
+	    ctype = SQL_C_TIME;
+	    Data_Get_Struct(arg, TIME_STRUCT, time);
+	    valp = (SQLPOINTER) time;
+	    rlen = 1;
+	    vlen = sizeof (TIME_STRUCT);
+	    break;
+	}
+	if (rb_obj_is_kind_of(arg, Ctimestamp) == Qtrue) {
+	    TIMESTAMP_STRUCT *ts;
 
-		rc = SQLGetData(q->hstmt, (SQLUSMALLINT) (i + 1),
-				type, (SQLPOINTER) (valp + totlen),
-#ifdef UNICODE
-				((type == SQL_C_CHAR) || (type == SQL_C_WCHAR)) ?
-				(chunksize + (int) sizeof (SQLWCHAR)) :
-				chunksize,
-#else
-				(type == SQL_C_CHAR) ?
-				(chunksize + 1) : chunksize,
-#endif
-				&curlen);
-		if (rc == SQL_NO_DATA) {
-		    if (curlen == SQL_NO_TOTAL) {
-			curlen = totlen;
-		    }
-		    break;
-		}
-		ret = succeeded(SQL_NULL_HENV, SQL_NULL_HDBC, q->hstmt,
-				rc, &msg, "SQLGetData");
-		if (!ret) {
-		    xfree(valp);
-		    rb_raise(Cerror, "%s", msg);
-		}
-		if (curlen == SQL_NULL_DATA) {
-		    break;
-		}
-		if (curlen == SQL_NO_TOTAL) {
-		    totlen += chunksize;
-		} else if (curlen > chunksize) {
-		    totlen += chunksize;
-		    chunksize = curlen - chunksize;
-		} else {
-		    totlen += curlen;
-		    break;
-		}
-#ifdef UNICODE
-		REALLOC_N(valp, char, totlen + chunksize + sizeof (SQLWCHAR));
+	    ctype = SQL_C_TIMESTAMP;
+	    Data_Get_Struct(arg, TIMESTAMP_STRUCT, ts);
+	    valp = (SQLPOINTER) ts;
+	    rlen = 1;
+	    vlen = sizeof (TIMESTAMP_STRUCT);
+	    break;
+	}
+	if (rb_obj_is_kind_of(arg, rb_cDate) == Qtrue) {
+	    ctype = SQL_C_DATE;
+	    rbdate_to_struct(arg, (DATE_STRUCT *) valp);
+	    rlen = 1;
+	    vlen = sizeof (DATE_STRUCT);
+	    break;
+	}
+	if (rb_const_defined(rb_cObject, IDBigDecimal) &&
+	    (rb_obj_is_kind_of(arg, rb_const_get(rb_cObject, IDBigDecimal))
+	     == Qtrue)) {
+	    VALUE str = rb_funcall(arg, IDto_s, 1, rb_str_new2("F"));
+
+	    /* keep string alive until executed */
+	    q->paraminfo[pnum].strval = str;
+	    ctype = SQL_C_CHAR;
+	    valp = (SQLPOINTER) RSTRING_PTR(str);
+	    rlen = RSTRING_LEN(str);
+	    vlen = rlen + 1;
+	    break;
+	}
+	if (is_stream_param(arg)) {
+	    return bind_stream_param(pnum, arg, q, msgp);
+	}
+	ctype = SQL_C_CHAR;
+#ifndef NO_RB_STR2CSTR
+	valp = (SQLPOINTER *) rb_str2cstr(rb_str_to_str(arg), &llen);
+	rlen = llen;
+	if (rlen != (SQLINTEGER) strlen((char *) valp)) {
+	    ctype = SQL_C_BINARY;
+	}
+	vlen = rlen + 1;
 #else
-		REALLOC_N(valp, char, totlen + chunksize + 1);
+	val = rb_string_value(&arg);
+	valp = (SQLPOINTER) RSTRING_PTR(val);
+	llen = RSTRING_LEN(val);
+	if (valp == NULL) {
+	    goto oom;
+	}
+	rlen = llen;
+	vlen = rlen + 1;
+	if (memchr((char *) valp, 0, llen)) {
+	    ctype = SQL_C_BINARY;
+	    break;
+	}
+	valp = (SQLPOINTER) rb_string_value_cstr(&arg);
 #endif
-		if (valp == NULL) {
-		    if (freep != NULL) {
-			xfree(freep);
-		    }
-		    rb_raise(Cerror, "%s", set_err("Out of memory", 0));
-		}
-		freep = valp;
-	    }
-	    if (totlen > 0) {
-		curlen = totlen;
-	    }
-	} else {
-	    totlen = curlen;
-	    valp = bufs[i];
-	    if (!succeeded(SQL_NULL_HENV, SQL_NULL_HDBC, q->hstmt,
-			   SQLGetData(q->hstmt, (SQLUSMALLINT) (i + 1), type,
-				      (SQLPOINTER) valp, totlen, &curlen),
-			   &msg, "SQLGetData")) {
-		rb_raise(Cerror, "%s", msg);
+	break;
+    }
+    stype = q->paraminfo[pnum].type;
+    coldef = q->paraminfo[pnum].coldef;
+    q->paraminfo[pnum].rlen = rlen;
+    q->paraminfo[pnum].ctype = ctype;
+    if (coldef == 0) {
+	switch (ctype) {
+	case SQL_C_LONG:
+	    coldef = 10;
+	    break;
+	case SQL_C_DOUBLE:
+	    coldef = 15;
+	    if (stype == SQL_VARCHAR) {
+		stype = SQL_DOUBLE;
 	    }
-	}
-	if (curlen == SQL_NULL_DATA) {
-	    v = Qnil;
-	} else {
-	    switch (type) {
-	    case SQL_C_LONG:
-		v = INT2NUM(*((SQLINTEGER *) valp));
-		break;
-	    case SQL_C_DOUBLE:
-		v = rb_float_new(*((double *) valp));
-		break;
+	    break;
 #ifdef SQL_C_SBIGINT
-	    case SQL_C_SBIGINT:
-#ifdef LL2NUM
-		v = LL2NUM(*((SQLBIGINT *) valp));
-#else
-		v = INT2NUM(*((SQLBIGINT *) valp));
-#endif
-		break;
+	case SQL_C_SBIGINT:
+	    coldef = 19;
+	    if (stype == SQL_VARCHAR) {
+		stype = SQL_BIGINT;
+	    }
+	    break;
 #endif
 #ifdef SQL_C_UBIGINT
-	    case SQL_C_UBIGINT:
-#ifdef LL2NUM
-		v = ULL2NUM(*((SQLBIGINT *) valp));
-#else
-		v = UINT2NUM(*((SQLBIGINT *) valp));
+	case SQL_C_UBIGINT:
+	    coldef = 20;
+	    if (stype == SQL_VARCHAR) {
+		stype = SQL_BIGINT;
+	    }
+	    break;
 #endif
-		break;
+#if (ODBCVER >= 0x0300) && defined(SQL_C_NUMERIC)
+	case SQL_C_NUMERIC:
+	    coldef = 38;
+	    if (stype == SQL_VARCHAR) {
+		stype = SQL_NUMERIC;
+	    }
+	    break;
 #endif
-	    case SQL_C_DATE:
-		{
-		    DATE_STRUCT *date;
-
-		    if (q->dbcp != NULL && q->dbcp->rbtime == Qtrue) {
-			const char *p;
-			char buffer[128];
-			VALUE d;
-
-			date = (DATE_STRUCT *) valp;
-			p = (q->dbcp->gmtime == Qtrue) ? "+00:00" : "";
-			sprintf(buffer, "%d-%d-%dT00:00:00%s",
-				date->year, date->month, date->day, p);
-			d = rb_str_new2(buffer);
-			v = rb_funcall(rb_cDate, IDparse, 1, d);
-		    } else {
-			v = Data_Make_Struct(Cdate, DATE_STRUCT, 0, xfree,
-					     date);
-			*date = *(DATE_STRUCT *) valp;
+	case SQL_C_DATE:
+	    coldef = 10;
+	    break;
+	case SQL_C_TIME:
+	    coldef = 8;
+	    break;
+	case SQL_C_TIMESTAMP:
+	    coldef = 19;
+	    break;
+	default:
+	    /*
+	     * Patch adopted from the Perl DBD::ODBC module ...
+	     * per patch from Paul G. Weiss, who was experiencing re-preparing
+	     * of queries when the size of the bound string's were increasing
+	     * for example select * from tabtest where name = ?
+	     * then executing with 'paul' and then 'thomas' would cause
+	     * SQLServer to prepare the query twice, but if we ran 'thomas'
+	     * then 'paul', it would not re-prepare the query.  The key seems
+	     * to be allocating enough space for the largest parameter.
+	     * TBD: the default for this should be a tunable parameter.
+	     */
+	    if ((stype == SQL_VARCHAR) &&
+		(q->paraminfo[pnum].iotype != SQL_PARAM_INPUT_OUTPUT) &&
+		(q->paraminfo[pnum].iotype != SQL_PARAM_OUTPUT)) {
+		if (q->paraminfo[pnum].coldef_max == 0) {
+		    q->paraminfo[pnum].coldef_max = (vlen > 128) ? vlen : 128;
+		} else {
+		    /* bump up max, if needed */
+		    if (vlen > (SQLINTEGER) q->paraminfo[pnum].coldef_max) {
+			q->paraminfo[pnum].coldef_max = vlen;
 		    }
 		}
-		break;
-	    case SQL_C_TIME:
-		{
-		    TIME_STRUCT *time;
-
-		    if (q->dbcp != NULL && q->dbcp->rbtime == Qtrue) {
-			VALUE now, frac;
-
-			time = (TIME_STRUCT *) valp;
-			frac = rb_float_new(0.0);
-			now = rb_funcall(rb_cTime, IDnow, 0, NULL);
-			v = rb_funcall(rb_cTime,
-				       (q->dbcp->gmtime == Qtrue) ?
-				       IDutc : IDlocal,
-				       7,
-				       rb_funcall(now, IDyear, 0, NULL),
-				       rb_funcall(now, IDmonth, 0, NULL),
-				       rb_funcall(now, IDday, 0, NULL),
-				       INT2NUM(time->hour),
-				       INT2NUM(time->minute),
-				       INT2NUM(time->second),
-				       frac);
-		    } else {
-			v = Data_Make_Struct(Ctime, TIME_STRUCT, 0, xfree,
-					     time);
-			*time = *(TIME_STRUCT *) valp;
-		    }
+		coldef = q->paraminfo[pnum].coldef_max;
+	    } else {
+		coldef = vlen;
+	    }
+	    break;
+	}
+    }
+    if ((q->paraminfo[pnum].iotype == SQL_PARAM_INPUT_OUTPUT) ||
+	(q->paraminfo[pnum].iotype == SQL_PARAM_OUTPUT)) {
+	if (valp == NULL) {
+	    if (q->paraminfo[pnum].outsize > 0) {
+		if (q->paraminfo[pnum].outbuf != NULL) {
+		    xfree(q->paraminfo[pnum].outbuf);
 		}
-		break;
-	    case SQL_C_TIMESTAMP:
-		{
-		    TIMESTAMP_STRUCT *ts;
-
-		    if (q->dbcp != NULL && q->dbcp->rbtime == Qtrue) {
-			VALUE frac;
-
-			ts = (TIMESTAMP_STRUCT *) valp;
-			frac = rb_float_new((double) 1.0e-3 * ts->fraction);
-			v = rb_funcall(rb_cTime,
-				       (q->dbcp->gmtime == Qtrue) ?
-				       IDutc : IDlocal,
-				       7,
-				       INT2NUM(ts->year),
-				       INT2NUM(ts->month),
-				       INT2NUM(ts->day),
-				       INT2NUM(ts->hour),
-				       INT2NUM(ts->minute),
-				       INT2NUM(ts->second),
-				       frac);
-		    } else {
-			v = Data_Make_Struct(Ctimestamp, TIMESTAMP_STRUCT,
-					     0, xfree, ts);
-			*ts = *(TIMESTAMP_STRUCT *) valp;
-		    }
+		q->paraminfo[pnum].outbuf = xmalloc(q->paraminfo[pnum].outsize);
+		if (q->paraminfo[pnum].outbuf == NULL) {
+		    goto oom;
 		}
-		break;
-#ifdef UNICODE
-	    case SQL_C_WCHAR:
-		v = uc_tainted_str_new((SQLWCHAR *) valp,
-				       curlen / sizeof (SQLWCHAR));
-		break;
-#endif
-	    default:
-		v = rb_tainted_str_new(valp, curlen);
-		break;
+		ctype = q->paraminfo[pnum].ctype = q->paraminfo[pnum].outtype;
+		outpp[0]++;
+		valp = q->paraminfo[pnum].outbuf;
+		vlen = q->paraminfo[pnum].outsize;
 	    }
-	}
-	if (freep != NULL) {
-	    xfree(freep);
-	}
-	switch (mode & DOFETCH_MODES) {
-	case DOFETCH_HASH:
-	case DOFETCH_HASH2:
-	    valp = q->colnames[i + offc];
-	    name = (q->colvals == NULL) ? Qnil : q->colvals[i + offc];
-	    if (name == Qnil) {
-		name = rb_tainted_str_new2(valp);
-#ifdef USE_RB_ENC
-		rb_enc_associate(name, rb_enc);
-#endif
-		if (rb_funcall(res, IDkeyp, 1, name) == Qtrue) {
-		    char *p;
-
-		    name = rb_tainted_str_new2(valp);
-#ifdef USE_RB_ENC
-		    rb_enc_associate(name, rb_enc);
-#endif
-		    p = q->colnames[4 * q->ncols];
-		    sprintf(p, "#%d", i);
-		    name = rb_str_cat2(name, p);
+	} else {
+	    if (q->paraminfo[pnum].outbuf != NULL) {
+		xfree(q->paraminfo[pnum].outbuf);
+	    }
+	    q->paraminfo[pnum].outbuf = xmalloc(vlen);
+	    if (q->paraminfo[pnum].outbuf == NULL) {
+oom:
+#ifdef UNICODE
+		if (q->paraminfo[pnum].tofree != NULL) {
+		    uc_free(q->paraminfo[pnum].tofree);
+		    q->paraminfo[pnum].tofree = NULL;
 		}
+#endif
+		*msgp = set_err("Out of memory", 0);
+		return -1;
 	    }
-	    rb_hash_aset(res, name, v);
-	    break;
-	case DOFETCH_HASHK:
-	case DOFETCH_HASHK2:
-	    valp = q->colnames[i + offc];
-#ifdef USE_RB_ENC
-	    name = ID2SYM(rb_intern3(valp, strlen(valp), rb_enc));
-#else
-	    name = ID2SYM(rb_intern(valp));
+#ifdef UNICODE
+	    if (ctype == SQL_C_WCHAR) {
+		memcpy(q->paraminfo[pnum].outbuf, *(SQLWCHAR **) valp, vlen);
+	    } else
 #endif
-	    if (rb_funcall(res, IDkeyp, 1, name) == Qtrue) {
-		char *p;
-
-		p = q->colnames[4 * q->ncols];
-		sprintf(p, "%s#%d", valp, i);
-#ifdef USE_RB_ENC
-		name = ID2SYM(rb_intern3(p, strlen(p), rb_enc));
-#else
-		name = ID2SYM(rb_intern(p));
+	    memcpy(q->paraminfo[pnum].outbuf, valp, vlen);
+#ifdef UNICODE
+	    if (ctype == SQL_C_WCHAR) {
+		*(SQLWCHAR **) valp = (SQLWCHAR *) q->paraminfo[pnum].outbuf;
+	    } else
 #endif
-	    }
-	    rb_hash_aset(res, name, v);
-	    break;
-	case DOFETCH_HASHN:
-	    name = INT2NUM(i);
-	    rb_hash_aset(res, name, v);
-	    break;
-	default:
-	    rb_ary_push(res, v);
+	    valp = q->paraminfo[pnum].outbuf;
+	    outpp[0]++;
 	}
     }
-    return res;
-}
-
-static VALUE
-stmt_fetch1(VALUE self, int bang)
-{
-    STMT *q;
-    SQLRETURN ret;
-    const char *msg;
-    char *err;
-#if (ODBCVER < 0x0300)
-    SQLUINTEGER nRows;
-    SQLUSMALLINT rowStat[1];
-#endif
-
-    Data_Get_Struct(self, STMT, q);
-    if (q->ncols <= 0) {
-	return Qnil;
-    }
-    if (q->usef) {
-	goto usef;
-    }
-#if (ODBCVER < 0x0300)
-    msg = "SQLExtendedFetch(SQL_FETCH_NEXT)";
-    ret = SQLExtendedFetch(q->hstmt, SQL_FETCH_NEXT, 0, &nRows, rowStat);
+retry:
+#ifdef UNICODE
+    if (!succeeded(SQL_NULL_HENV, SQL_NULL_HDBC, q->hstmt,
+		   SQLBindParameter(q->hstmt, (SQLUSMALLINT) (pnum + 1),
+				    q->paraminfo[pnum].iotype,
+				    ctype, stype, coldef,
+				    q->paraminfo[pnum].scale,
+				    (ctype == SQL_C_WCHAR) ?
+				    *(SQLWCHAR **) valp : valp,
+				    vlen, &q->paraminfo[pnum].rlen),
+		   msgp, "SQLBindParameter(%d)", pnum + 1))
 #else
-    msg = "SQLFetchScroll(SQL_FETCH_NEXT)";
-    ret = SQLFetchScroll(q->hstmt, SQL_FETCH_NEXT, 0);
+    if (!succeeded(SQL_NULL_HENV, SQL_NULL_HDBC, q->hstmt,
+		   SQLBindParameter(q->hstmt, (SQLUSMALLINT) (pnum + 1),
+				    q->paraminfo[pnum].iotype,
+				    ctype, stype, coldef,
+				    q->paraminfo[pnum].scale,
+				    valp, vlen, &q->paraminfo[pnum].rlen),
+		   msgp, "SQLBindParameter(%d)", pnum + 1))
+#endif
+    {
+	if (retry) {
+	    retry = 0;
+	    if (stype == SQL_VARCHAR) {
+		/* maybe MS Jet memo field */
+		stype = SQL_LONGVARCHAR;
+		goto retry;
+	    }
+#ifdef UNICODE
+	    if (stype == SQL_WVARCHAR) {
+		stype = SQL_WLONGVARCHAR;
+		goto retry;
+	    }
 #endif
-    if (ret == SQL_NO_DATA) {
-	(void) tracesql(SQL_NULL_HENV, SQL_NULL_HDBC, q->hstmt, ret, msg);
-	return Qnil;
-    }
-    if (succeeded(SQL_NULL_HENV, SQL_NULL_HDBC, q->hstmt, ret, &err, msg)) {
-	return do_fetch(q, DOFETCH_ARY | (bang ? DOFETCH_BANG : 0));
-    }
-    if ((err != NULL) &&
-	((strncmp(err, "IM001", 5) == 0) ||
-	 (strncmp(err, "HYC00", 5) == 0))) {
-usef:
-	/* Fallback to SQLFetch() when others not implemented */
-	msg = "SQLFetch";
-	q->usef = 1;
-	ret = SQLFetch(q->hstmt);
-	if (ret == SQL_NO_DATA) {
-	    (void) tracesql(SQL_NULL_HENV, SQL_NULL_HDBC, q->hstmt, ret, msg);
-	    return Qnil;
-	}
-	if (succeeded(SQL_NULL_HENV, SQL_NULL_HDBC, q->hstmt, ret,
-		      &err, msg)) {
-	    return do_fetch(q, DOFETCH_ARY | (bang ? DOFETCH_BANG : 0));
 	}
+	return -1;
     }
-    rb_raise(Cerror, "%s", err);
-    return Qnil;
-}
-
-static VALUE
-stmt_fetch(VALUE self)
-{
-    if (rb_block_given_p()) {
-	return stmt_each(self);
-    }
-    return stmt_fetch1(self, 0);
-}
-
-static VALUE
-stmt_fetch_bang(VALUE self)
-{
-    if (rb_block_given_p()) {
-	return stmt_each(self);
+#if (ODBCVER >= 0x0300) && defined(SQL_C_NUMERIC)
+    if (ctype == SQL_C_NUMERIC) {
+	SQLHDESC hdesc;
+	SQL_NUMERIC_STRUCT *num = (SQL_NUMERIC_STRUCT *) valp;
+
+	/*
+	 * Precision and scale of SQL_C_NUMERIC are taken from the
+	 * application parameter descriptor, not from SQLBindParameter.
+	 * DATA_PTR must be set last since setting other fields unbinds.
+	 */
+	if (SQL_SUCCEEDED(SQLGetStmtAttr(q->hstmt, SQL_ATTR_APP_PARAM_DESC,
+					 &hdesc, 0, NULL))) {
+	    SQLSMALLINT pno = (SQLSMALLINT) (pnum + 1);
+
+	    callsql(SQL_NULL_HENV, SQL_NULL_HDBC, q->hstmt,
+		    SQLSetDescField(hdesc, pno, SQL_DESC_TYPE,
+				    (SQLPOINTER) SQL_C_NUMERIC, 0),
+		    "SQLSetDescField(SQL_DESC_TYPE)");
+	    callsql(SQL_NULL_HENV, SQL_NULL_HDBC, q->hstmt,
+		    SQLSetDescField(hdesc, pno, SQL_DESC_PRECISION,
+				    (SQLPOINTER) (SQLLEN) num->precision, 0),
+		    "SQLSetDescField(SQL_DESC_PRECISION)");
+	    callsql(SQL_NULL_HENV, SQL_NULL_HDBC, q->hstmt,
+		    SQLSetDescField(hdesc, pno, SQL_DESC_SCALE,
+				    (SQLPOINTER) (SQLLEN) num->scale, 0),
+		    "SQLSetDescField(SQL_DESC_SCALE)");
+	    callsql(SQL_NULL_HENV, SQL_NULL_HDBC, q->hstmt,
+		    SQLSetDescField(hdesc, pno, SQL_DESC_DATA_PTR, valp, 0),
+		    "SQLSetDescField(SQL_DESC_DATA_PTR)");
+	}
     }
-    return stmt_fetch1(self, 1);
+#endif
+    return 0;
 }
 
-static VALUE
-stmt_fetch_first1(VALUE self, int bang, int nopos)
-{
+typedef struct {
     STMT *q;
+    PARAMINFO *pi;
+    VALUE buf;
+    long nput;
+    int ncarry;
+    char carry[8];
     SQLRETURN ret;
-    const char *msg;
-    char *err;
-#if (ODBCVER < 0x0300)
-    SQLUINTEGER nRows;
-    SQLUSMALLINT rowStat[1];
-#endif
+} PUTDATA;
 
-    Data_Get_Struct(self, STMT, q);
-    if (q->ncols <= 0) {
-	return Qnil;
-    }
-    if (nopos) {
-	goto dofetch;
-    }
-#if (ODBCVER < 0x0300)
-    msg = "SQLExtendedFetch(SQL_FETCH_FIRST)";
-    ret = SQLExtendedFetch(q->hstmt, SQL_FETCH_FIRST, 0, &nRows, rowStat);
-#else
-    msg = "SQLFetchScroll(SQL_FETCH_FIRST)";
-    ret = SQLFetchScroll(q->hstmt, SQL_FETCH_FIRST, 0);
-#endif
-    if (ret == SQL_NO_DATA) {
-	(void) tracesql(SQL_NULL_HENV, SQL_NULL_HDBC, q->hstmt, ret, msg);
-	return Qnil;
-    }
-    if (succeeded(SQL_NULL_HENV, SQL_NULL_HDBC, q->hstmt, ret, &err, msg)) {
-dofetch:
-	return do_fetch(q, DOFETCH_ARY | (bang ? DOFETCH_BANG : 0));
+static void
+put_raw(PUTDATA *p, SQLPOINTER data, SQLLEN len)
+{
+    char *msg;
+
+    p->nput++;
+    if (!succeeded(SQL_NULL_HENV, SQL_NULL_HDBC, p->q->hstmt,
+		   nogvl_putdata(p->q->hstmt, data, len),
+		   &msg, "SQLPutData(%d)", (int) (p->pi - p->q->paraminfo) + 1)) {
+	rb_raise(Cerror, "%s", msg);
     }
-    rb_raise(Cerror, "%s", err);
-    return Qnil;
 }
 
-static VALUE
-stmt_fetch_first(VALUE self)
+#ifdef UNICODE
+static long
+utf8_complete(unsigned char *str, long len)
 {
-    return stmt_fetch_first1(self, 0, 0);
-}
+    long i = len;
+    int k;
 
-static VALUE
-stmt_fetch_first_bang(VALUE self)
-{
-    return stmt_fetch_first1(self, 1, 0);
+    /* length of prefix which holds complete UTF-8 sequences only */
+    for (k = 0; (k < 4) && (i > 0); k++) {
+	unsigned char c = str[--i];
+
+	if ((c & 0xc0) != 0x80) {
+	    int n = (c < 0xc0) ? 1 : (c < 0xe0) ? 2 : (c < 0xf0) ? 3 : 4;
+
+	    return ((len - i) >= n) ? len : i;
+	}
+    }
+    return len;
 }
 
-static VALUE
-stmt_fetch_scroll1(int argc, VALUE *argv, VALUE self, int bang)
+static void
+put_wchunk(PUTDATA *p, char *data, long len, int last)
 {
-    STMT *q;
-    VALUE dir, offs;
-    SQLRETURN ret;
-    int idir, ioffs = 1;
-    char msg[128], *err;
-#if (ODBCVER < 0x0300)
-    SQLUINTEGER nRows;
-    SQLUSMALLINT rowStat[1];
-#endif
+    unsigned char *str = (unsigned char *) data;
+    char *tmp = NULL;
+    char *msg;
+    long n = len, m;
+    SQLWCHAR *up;
 
-    rb_scan_args(argc, argv, "11", &dir, &offs);
-    idir = NUM2INT(dir);
-    if (offs != Qnil) {
-	ioffs = NUM2INT(offs);
+    if (p->ncarry > 0) {
+	tmp = ALLOC_N(char, p->ncarry + len);
+	memcpy(tmp, p->carry, p->ncarry);
+	memcpy(tmp + p->ncarry, data, len);
+	str = (unsigned char *) tmp;
+	n += p->ncarry;
+	p->ncarry = 0;
     }
-    Data_Get_Struct(self, STMT, q);
-    if (q->ncols <= 0) {
-	return Qnil;
+    m = last ? n : utf8_complete(str, n);
+    if (n > m) {
+	memcpy(p->carry, str + m, n - m);
+	p->ncarry = n - m;
     }
-#if (ODBCVER < 0x0300)
-    sprintf(msg, "SQLExtendedFetch(%d)", idir);
-    ret = SQLExtendedFetch(q->hstmt, (SQLSMALLINT) idir, (SQLINTEGER) ioffs,
-			   &nRows, rowStat);
-#else
-    sprintf(msg, "SQLFetchScroll(%d)", idir);
-    ret = SQLFetchScroll(q->hstmt, (SQLSMALLINT) idir, (SQLINTEGER) ioffs);
-#endif
-    if (ret == SQL_NO_DATA) {
-	(void) tracesql(SQL_NULL_HENV, SQL_NULL_HDBC, q->hstmt, ret, msg);
-	return Qnil;
+    up = uc_from_utf_scratch(&p->pi->ucbuf, &p->pi->ucsize, str, m);
+    if (tmp != NULL) {
+	xfree(tmp);
     }
-    if (succeeded(SQL_NULL_HENV, SQL_NULL_HDBC, q->hstmt, ret, &err, msg)) {
-	return do_fetch(q, DOFETCH_ARY | (bang ? DOFETCH_BANG : 0));
+    if (up == NULL) {
+	rb_raise(Cerror, "%s", set_err("Out of memory", 0));
     }
-    rb_raise(Cerror, "%s", err);
-    return Qnil;
+    if ((m > 0) || (p->nput == 0)) {
+	p->nput++;
+	if (!succeeded(SQL_NULL_HENV, SQL_NULL_HDBC, p->q->hstmt,
+		       nogvl_putdata(p->q->hstmt, (SQLPOINTER) up,
+				     uc_strlen(up) * sizeof (SQLWCHAR)),
+		       &msg, "SQLPutData(%d)",
+		       (int) (p->pi - p->q->paraminfo) + 1)) {
+	    uc_free_buf(up, p->pi->ucbuf);
+	    rb_raise(Cerror, "%s", msg);
+	}
+    }
+    uc_free_buf(up, p->pi->ucbuf);
 }
+#endif
 
-static VALUE
-stmt_fetch_scroll(int argc, VALUE *argv, VALUE self)
+static void
+put_chunk(PUTDATA *p, VALUE chunk)
 {
-    return stmt_fetch_scroll1(argc, argv, self, 0);
+    StringValue(chunk);
+    if (RSTRING_LEN(chunk) <= 0) {
+	return;
+    }
+#ifdef UNICODE
+    if (p->pi->ctype == SQL_C_WCHAR) {
+	put_wchunk(p, RSTRING_PTR(chunk), RSTRING_LEN(chunk), 0);
+	return;
+    }
+#endif
+    put_raw(p, (SQLPOINTER) RSTRING_PTR(chunk), RSTRING_LEN(chunk));
 }
 
 static VALUE
-stmt_fetch_scroll_bang(int argc, VALUE *argv, VALUE self)
+put_streams_body(VALUE arg)
 {
-    return stmt_fetch_scroll1(argc, argv, self, 1);
-}
+    PUTDATA *p = (PUTDATA *) arg;
+    STMT *q = p->q;
+    SQLPOINTER token;
+    SQLRETURN ret;
 
-static VALUE
-stmt_fetch_many(VALUE self, VALUE arg)
-{
-    int i, max = 0, all = arg == Qnil;
-    VALUE res;
+    while ((ret = nogvl_paramdata(q->hstmt, &token)) == SQL_NEED_DATA) {
+	VALUE stream;
 
-    if (!all) {
-	max = NUM2INT(arg);
-    }
-    res = rb_ary_new();
-    for (i = 0; all || (i < max); i++) {
-	VALUE v = stmt_fetch1(self, 0);
+	p->pi = (PARAMINFO *) token;
+	if ((p->pi < q->paraminfo) || (p->pi >= q->paraminfo + q->nump) ||
+	    (p->pi->stream == Qnil)) {
+	    rb_raise(Cerror, "%s", set_err("Unknown data-at-exec parameter", 0));
+	}
+	stream = p->pi->stream;
+	p->nput = 0;
+	p->ncarry = 0;
+	for (;;) {
+	    VALUE chunk;
 
-	if (v == Qnil) {
-	    break;
+	    if (rb_obj_is_kind_of(stream, rb_cIO) == Qtrue) {
+		chunk = rb_funcall(stream, IDread, 2,
+				   INT2FIX(SEGSIZE), p->buf);
+	    } else {
+		chunk = rb_funcall(stream, IDread, 1, INT2FIX(SEGSIZE));
+	    }
+	    if (chunk == Qnil) {
+		break;
+	    }
+	    put_chunk(p, chunk);
+	}
+#ifdef UNICODE
+	if ((p->pi->ctype == SQL_C_WCHAR) &&
+	    ((p->ncarry > 0) || (p->nput == 0))) {
+	    put_wchunk(p, "", 0, 1);
+	    continue;
+	}
+#endif
+	if (p->nput == 0) {
+	    /* empty stream, send zero length value */
+	    put_raw(p, (SQLPOINTER) "", 0);
 	}
-	rb_ary_push(res, v);
     }
-    return (i == 0) ? Qnil : res;
-}
-
-static VALUE
-stmt_fetch_all(VALUE self)
-{
-    return stmt_fetch_many(self, Qnil);
+    p->ret = ret;
+    return Qnil;
 }
 
-static int
-stmt_hash_mode(int argc, VALUE *argv, VALUE self)
+static SQLRETURN
+put_streams(STMT *q, int *statep)
 {
-    VALUE withtab = Qnil, usesym = Qnil;
-    int mode = DOFETCH_HASH;
-
-    rb_scan_args(argc, argv, "02", &withtab, &usesym);
-    if ((withtab != Qtrue) && (withtab != Qfalse) && (withtab != Modbc) &&
-	(rb_obj_is_kind_of(withtab, rb_cHash) == Qtrue)) {
-	VALUE v;
+    PUTDATA p;
 
-	v = rb_hash_aref(withtab, ID2SYM(IDkey));
-	if (v == ID2SYM(IDSymbol)) {
-	    mode = DOFETCH_HASHK;
-	} else if (v == ID2SYM(IDString)) {
-	    mode = DOFETCH_HASH;
-	} else if (v == ID2SYM(IDFixnum)) {
-	    mode = DOFETCH_HASHN;
-	} else {
-	    rb_raise(Cerror, "Unsupported key mode");
-	}
-	if (mode != DOFETCH_HASHN) {
-	    v = rb_hash_aref(withtab, ID2SYM(IDtable_names));
-	    if (RTEST(v)) {
-		mode = (mode == DOFETCH_HASHK)
-		     ? DOFETCH_HASHK2 : DOFETCH_HASH2;
-	    }
-	}
-	return mode;
-    }
-    if (withtab == Modbc) {
-	return DOFETCH_HASHN;
-    }
-    mode = RTEST(withtab) ? DOFETCH_HASH2 : DOFETCH_HASH;
-    if (RTEST(usesym)) {
-	mode = (mode == DOFETCH_HASH2) ? DOFETCH_HASHK2 : DOFETCH_HASHK;
+    p.q = q;
+    p.pi = NULL;
+    p.buf = rb_str_buf_new(SEGSIZE);
+    p.ret = SQL_ERROR;
+    rb_protect(put_streams_body, (VALUE) &p, statep);
+    if (*statep) {
+	SQLCancel(q->hstmt);
     }
-    return mode;
+    return p.ret;
 }
 
 static VALUE
-stmt_fetch_hash1(int argc, VALUE *argv, VALUE self, int bang)
+stmt_exec_int(int argc, VALUE *argv, VALUE self, int mode)
 {
     STMT *q;
+    int i, argnum, has_out_parms = 0, state = 0;
+    char *msg = NULL;
     SQLRETURN ret;
-    int mode = stmt_hash_mode(argc, argv, self);
-    const char *msg;
-    char *err;
-#if (ODBCVER < 0x0300)
-    SQLUINTEGER nRows;
-    SQLUSMALLINT rowStat[1];
-#endif
 
-    Data_Get_Struct(self, STMT, q);
-    if (q->ncols <= 0) {
-	return Qnil;
+    ODBC_Get_Struct(self, STMT, stmt_type, q);
+    stmt_check_busy(q);
+    if (argc > q->nump - ((EXEC_PARMXOUT(mode) < 0) ? 0 : 1)) {
+	rb_raise(Cerror, "%s", set_err("Too much parameters", 0));
     }
-    if (q->usef) {
-	goto usef;
+    if (q->hstmt == SQL_NULL_HSTMT) {
+	rb_raise(Cerror, "%s", set_err("Stale ODBC::Statement", 0));
     }
-#if (ODBCVER < 0x0300)
-    msg = "SQLExtendedFetch(SQL_FETCH_NEXT)";
-    ret = SQLExtendedFetch(q->hstmt, SQL_FETCH_NEXT, 0, &nRows, rowStat);
-#else
-    msg = "SQLFetchScroll(SQL_FETCH_NEXT)";
-    ret = SQLFetchScroll(q->hstmt, SQL_FETCH_NEXT, 0);
-#endif
-    if (ret == SQL_NO_DATA) {
-	(void) tracesql(SQL_NULL_HENV, SQL_NULL_HDBC, q->hstmt, ret, msg);
-	return Qnil;
+    if (!succeeded(SQL_NULL_HENV, SQL_NULL_HDBC, q->hstmt,
+		   SQLFreeStmt(q->hstmt, SQL_CLOSE),
+		   &msg, "SQLFreeStmt(SQL_CLOSE)")) {
+	goto error;
     }
-    if (succeeded(SQL_NULL_HENV, SQL_NULL_HDBC, q->hstmt, ret, &err, msg)) {
-	return do_fetch(q, mode | (bang ? DOFETCH_BANG : 0));
+    callsql(SQL_NULL_HENV, SQL_NULL_HDBC, q->hstmt,
+	    SQLFreeStmt(q->hstmt, SQL_RESET_PARAMS),
+	    "SQLFreeStmt(SQL_RESET_PARMS)");
+    for (i = argnum = 0; i < q->nump; i++) {
+	VALUE arg;
+
+	if (i == EXEC_PARMXOUT(mode)) {
+	    if (bind_one_param(i, Qnil, q, &msg, &has_out_parms) < 0) {
+		goto error;
+	    }
+	    continue;
+	}
+	arg = (argnum < argc) ? argv[argnum++] : Qnil;
+	if (bind_one_param(i, arg, q, &msg, &has_out_parms) < 0) {
+	    goto error;
+	}
     }
-    if ((err != NULL) &&
-	((strncmp(err, "IM001", 5) == 0) ||
-	 (strncmp(err, "HYC00", 5) == 0))) {
-usef:
-	/* Fallback to SQLFetch() when others not implemented */
-	msg = "SQLFetch";
-	q->usef = 1;
-	ret = SQLFetch(q->hstmt);
-	if (ret == SQL_NO_DATA) {
-	    (void) tracesql(SQL_NULL_HENV, SQL_NULL_HDBC, q->hstmt, ret, msg);
-	    return Qnil;
+    ret = nogvl_execute(q->hstmt);
+    if (ret == SQL_NEED_DATA) {
+	ret = put_streams(q, &state);
+	if (state) {
+	    goto error;
+	}
+    }
+    if (!succeeded_nodata(SQL_NULL_HENV, SQL_NULL_HDBC, q->hstmt,
+			  ret, &msg, "SQLExecute")) {
+error:
+	for (i = 0; i < q->nump; i++) {
+#ifdef UNICODE
+	    if (q->paraminfo[i].tofree != NULL) {
+		uc_free(q->paraminfo[i].tofree);
+		q->paraminfo[i].tofree = NULL;
+	    }
+#endif
+	    q->paraminfo[i].stream = Qnil;
+	    q->paraminfo[i].strval = Qnil;
 	}
-	if (succeeded(SQL_NULL_HENV, SQL_NULL_HDBC, q->hstmt, ret,
-		      &err, msg)) {
-	    return do_fetch(q, mode | (bang ? DOFETCH_BANG : 0));
+	callsql(SQL_NULL_HENV, SQL_NULL_HDBC, q->hstmt,
+		SQLFreeStmt(q->hstmt, SQL_DROP), "SQLFreeStmt(SQL_DROP)");
+	q->hstmt = SQL_NULL_HSTMT;
+	unlink_stmt(q);
+	if (state) {
+	    rb_jump_tag(state);
 	}
+	rb_raise(Cerror, "%s", msg);
     }
-    rb_raise(Cerror, "%s", err);
-    return Qnil;
-}
-
-static VALUE
-stmt_fetch_hash(int argc, VALUE *argv, VALUE self)
-{
-    if (rb_block_given_p()) {
-	return stmt_each_hash(argc, argv, self);
-    }
-    return stmt_fetch_hash1(argc, argv, self, 0);
-}
-
-static VALUE
-stmt_fetch_hash_bang(int argc, VALUE *argv, VALUE self)
-{
-    if (rb_block_given_p()) {
-	return stmt_each_hash(argc, argv, self);
-    }
-    return stmt_fetch_hash1(argc, argv, self, 1);
-}
-
-static VALUE
-stmt_fetch_first_hash1(int argc, VALUE *argv, VALUE self, int bang, int nopos)
-{
-    STMT *q;
-    SQLRETURN ret;
-    int mode = stmt_hash_mode(argc, argv, self);
-    const char *msg;
-    char *err;
-#if (ODBCVER < 0x0300)
-    SQLUINTEGER nRows;
-    SQLUSMALLINT rowStat[1];
+    for (i = 0; i < q->nump; i++) {
+#ifdef UNICODE
+	if (q->paraminfo[i].tofree != NULL) {
+	    uc_free(q->paraminfo[i].tofree);
+	    q->paraminfo[i].tofree = NULL;
+	}
 #endif
-
-    Data_Get_Struct(self, STMT, q);
-    if (q->ncols <= 0) {
-	return Qnil;
+	q->paraminfo[i].stream = Qnil;
+	q->paraminfo[i].strval = Qnil;
     }
-    if (nopos) {
-	goto dofetch;
+    if (!has_out_parms) {
+	callsql(SQL_NULL_HENV, SQL_NULL_HDBC, q->hstmt,
+		SQLFreeStmt(q->hstmt, SQL_RESET_PARAMS),
+		"SQLFreeStmt(SQL_RESET_PARAMS)");
     }
-#if (ODBCVER < 0x0300)
-    msg = "SQLExtendedFetch(SQL_FETCH_FIRST)";
-    ret = SQLExtendedFetch(q->hstmt, SQL_FETCH_FIRST, 0, &nRows, rowStat);
-#else
-    msg = "SQLFetchScroll(SQL_FETCH_FIRST)";
-    ret = SQLFetchScroll(q->hstmt, SQL_FETCH_FIRST, 0);
-#endif
     if (ret == SQL_NO_DATA) {
-	(void) tracesql(SQL_NULL_HENV, SQL_NULL_HDBC, q->hstmt, ret, msg);
 	return Qnil;
     }
-    if (succeeded(SQL_NULL_HENV, SQL_NULL_HDBC, q->hstmt, ret, &err, msg)) {
-dofetch:
-	return do_fetch(q, mode | (bang ? DOFETCH_BANG : 0));
-    }
-    rb_raise(Cerror, "%s", err);
-    return Qnil;
+    return make_result(q->dbc, q->hstmt, self, mode | MAKERES_REEXEC);
 }
 
 static VALUE
-stmt_fetch_first_hash(int argc, VALUE *argv, VALUE self)
+stmt_exec(int argc, VALUE *argv, VALUE self)
 {
-    return stmt_fetch_first_hash1(argc, argv, self, 0, 0);
+    return stmt_exec_int(argc, argv, self, MAKERES_BLOCK);
 }
 
 static VALUE
-stmt_each(VALUE self)
+stmt_run(int argc, VALUE *argv, VALUE self)
 {
-    VALUE row, res = Qnil;
-    STMT *q;
-#if (ODBCVER < 0x0300)
-    SQLUINTEGER nRows;
-    SQLUSMALLINT rowStat[1];
-#endif
-
-    Data_Get_Struct(self, STMT, q);
-#if (ODBCVER < 0x0300)
-    switch (callsql(SQL_NULL_HENV, SQL_NULL_HDBC, q->hstmt,
-		    SQLExtendedFetch(q->hstmt, SQL_FETCH_FIRST, 0, &nRows,
-				     rowStat),
-		    "SQLExtendedFetch(SQL_FETCH_FIRST)"))
-#else
-    switch (callsql(SQL_NULL_HENV, SQL_NULL_HDBC, q->hstmt,
-		    SQLFetchScroll(q->hstmt, SQL_FETCH_FIRST, 0),
-		    "SQLFetchScroll(SQL_FETCH_FIRST)"))
-#endif
-    {
-    case SQL_NO_DATA:
-	row = Qnil;
-	break;
-    case SQL_SUCCESS:
-    case SQL_SUCCESS_WITH_INFO:
-	row = stmt_fetch_first1(self, 0, 1);
-	break;
-    default:
-	row = stmt_fetch1(self, 0);
-    }
-    if (rb_block_given_p()) {
-	while (row != Qnil) {
-	    rb_yield(row);
-	    row = stmt_fetch1(self, 0);
-	}
-	return self;
+    if (argc < 1) {
+	rb_raise(rb_eArgError, "wrong # of arguments");
     }
-    if (row != Qnil) {
-	res = rb_ary_new();
-	while (row != Qnil) {
-	    rb_ary_push(res, row);
-	    row = stmt_fetch1(self, 0);
-	}
+    if (argc == 1) {
+	return stmt_prep_int(1, argv, self,
+			     MAKERES_EXECD | MAKERES_BLOCK);
     }
-    return res;
+    return stmt_exec(argc - 1, argv + 1, stmt_prep_int(1, argv, self, 0));
 }
 
 static VALUE
-stmt_each_hash(int argc, VALUE *argv, VALUE self)
+stmt_do(int argc, VALUE *argv, VALUE self)
 {
-    VALUE row, res = Qnil, withtab[2];
-    STMT *q;
-    int mode = stmt_hash_mode(argc, argv, self);
-#if (ODBCVER < 0x0300)
-    SQLUINTEGER nRows;
-    SQLUSMALLINT rowStat[1];
-#endif
+    VALUE stmt;
 
-    if (mode == DOFETCH_HASHN) {
-	withtab[0] = Modbc;
-	withtab[1] = Qfalse;
+    if (argc < 1) {
+	rb_raise(rb_eArgError, "wrong # of arguments");
+    }
+    if (argc == 1) {
+	stmt = stmt_prep_int(1, argv, self,
+			     MAKERES_EXECD | MAKERES_BLOCK | MAKERES_NOCLOSE);
     } else {
-	withtab[0] = ((mode == DOFETCH_HASH2) || (mode == DOFETCH_HASHK2))
-		   ? Qtrue : Qfalse;
-	withtab[1] = ((mode == DOFETCH_HASHK) || (mode == DOFETCH_HASHK2))
-		   ? Qtrue : Qfalse;
+	stmt = stmt_prep_int(1, argv, self, 0);
+	stmt_exec_int(argc - 1, argv + 1, stmt,
+		      MAKERES_BLOCK | MAKERES_NOCLOSE);
     }
-    Data_Get_Struct(self, STMT, q);
-#if (ODBCVER < 0x0300)
-    switch (callsql(SQL_NULL_HENV, SQL_NULL_HDBC, q->hstmt,
-		    SQLExtendedFetch(q->hstmt, SQL_FETCH_FIRST, 0, &nRows,
-				     rowStat),
-		    "SQLExtendedFetch(SQL_FETCH_FIRST)"))
-#else
-    switch (callsql(SQL_NULL_HENV, SQL_NULL_HDBC, q->hstmt,
-		    SQLFetchScroll(q->hstmt, SQL_FETCH_FIRST, 0),
-		    "SQLFetchScroll(SQL_FETCH_FIRST)"))
-#endif
-    {
-    case SQL_NO_DATA:
-	row = Qnil;
-	break;
-    case SQL_SUCCESS:
-    case SQL_SUCCESS_WITH_INFO:
-	row = stmt_fetch_first_hash1(2, withtab, self, 0, 1);
-	break;
-    default:
-	row = stmt_fetch_hash1(2, withtab, self, 0);
+    return rb_ensure(stmt_nrows, stmt, stmt_drop, stmt);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ *      Execute prepared statement with an array of parameter rows
+ *      using column-wise bound parameter arrays.
+ *
+ *----------------------------------------------------------------------
+ */
+
+#if (ODBCVER >= 0x0300)
+
+typedef struct {
+    SQLSMALLINT ctype;
+    SQLLEN width;
+    char *data;
+    SQLLEN *lens;
+} BATCHCOL;
+
+typedef struct {
+    STMT *q;
+    VALUE rows;
+    long nrows;
+    BATCHCOL *cols;
+    SQLUSMALLINT *stat;
+    SQLULEN processed;
+    int bound;
+} BATCH;
+
+static void
+batch_check(STMT *q)
+{
+    int i;
+
+    stmt_check_busy(q);
+    if (q->hstmt == SQL_NULL_HSTMT) {
+	rb_raise(Cerror, "%s", set_err("Stale ODBC::Statement", 0));
     }
-    if (rb_block_given_p()) {
-	while (row != Qnil) {
-	    rb_yield(row);
-	    row = stmt_fetch_hash1(2, withtab, self, 0);
-	}
-	return self;
+    if (q->nump <= 0) {
+	rb_raise(Cerror, "%s", set_err("No parameters", 0));
     }
-    if (row != Qnil) {
-	res = rb_ary_new();
-	while (row != Qnil) {
-	    rb_ary_push(res, row);
-	    row = stmt_fetch_hash1(2, withtab, self, 0);
+    for (i = 0; i < q->nump; i++) {
+	if (q->paraminfo[i].iotype != SQL_PARAM_INPUT) {
+	    rb_raise(Cerror, "%s",
+		     set_err("Output parameters not supported", 0));
 	}
     }
-    return res;
 }
 
-static VALUE
-stmt_more_results(VALUE self)
+/* Close cursor and drop bindings before array execution. */
+
+static void
+batch_reset(STMT *q)
 {
-    STMT *q;
+    char *msg = NULL;
 
-    if (rb_block_given_p()) {
-	rb_raise(rb_eArgError, "block not allowed");
-    }
-    Data_Get_Struct(self, STMT, q);
-    if (q->hstmt == SQL_NULL_HSTMT) {
-	return Qfalse;
-    }
-    switch (tracesql(SQL_NULL_HENV, SQL_NULL_HDBC, q->hstmt,
-		     SQLMoreResults(q->hstmt), "SQLMoreResults")) {
-    case SQL_NO_DATA:
-	return Qfalse;
-    case SQL_SUCCESS:
-    case SQL_SUCCESS_WITH_INFO:
-	free_stmt_sub(q, 0);
-	make_result(q->dbc, q->hstmt, self, 0);
-	break;
-    default:
-	rb_raise(Cerror, "%s",
-		 get_err(SQL_NULL_HENV, SQL_NULL_HDBC, q->hstmt));
+    if (!succeeded(SQL_NULL_HENV, SQL_NULL_HDBC, q->hstmt,
+		   SQLFreeStmt(q->hstmt, SQL_CLOSE),
+		   &msg, "SQLFreeStmt(SQL_CLOSE)")) {
+	rb_raise(Cerror, "%s", msg);
     }
-    return Qtrue;
+    callsql(SQL_NULL_HENV, SQL_NULL_HDBC, q->hstmt,
+	    SQLFreeStmt(q->hstmt, SQL_RESET_PARAMS),
+	    "SQLFreeStmt(SQL_RESET_PARAMS)");
+    rowset_free(q);
 }
 
-static VALUE
-stmt_prep_int(int argc, VALUE *argv, VALUE self, int mode)
+static SQLSMALLINT
+batch_ctype(VALUE arg, PARAMINFO *pinfo)
 {
-    DBC *p = get_dbc(self);
-    STMT *q = NULL;
-    VALUE sql, dbc, stmt;
-    SQLHSTMT hstmt;
-#ifdef UNICODE
-    SQLWCHAR *ssql = NULL;
-#else
-    SQLCHAR *ssql = NULL;
+    switch (TYPE(arg)) {
+    case T_NIL:
+    case T_SYMBOL:
+	return 0;
+    case T_FIXNUM:
+#if defined(SQL_C_SBIGINT) && (SIZEOF_LONG > 4)
+	if ((FIX2LONG(arg) > 0x7fffffffL) ||
+	    (FIX2LONG(arg) < -0x7fffffffL - 1)) {
+	    return SQL_C_SBIGINT;
+	}
 #endif
-    char *csql = NULL, *msg = NULL;
-
-    if (rb_obj_is_kind_of(self, Cstmt) == Qtrue) {
-	Data_Get_Struct(self, STMT, q);
-	free_stmt_sub(q, 0);
-	if (q->hstmt == SQL_NULL_HSTMT) {
-	    if (!succeeded(SQL_NULL_HENV, p->hdbc, q->hstmt,
-			   SQLAllocStmt(p->hdbc, &q->hstmt),
-			   &msg, "SQLAllocStmt")) {
-		rb_raise(Cerror, "%s", msg);
-	    }
-	} else if (!succeeded(SQL_NULL_HENV, SQL_NULL_HDBC, q->hstmt,
-			      SQLFreeStmt(q->hstmt, SQL_CLOSE),
-			      &msg, "SQLFreeStmt(SQL_CLOSE)")) {
-	    rb_raise(Cerror, "%s", msg);
+	return SQL_C_LONG;
+    case T_FLOAT:
+	return SQL_C_DOUBLE;
+    case T_STRING:
+	if (memchr(RSTRING_PTR(arg), 0, RSTRING_LEN(arg))) {
+	    return SQL_C_BINARY;
+	}
+	break;
+    default:
+	if (rb_obj_is_kind_of(arg, Cdate) == Qtrue) {
+	    return SQL_C_DATE;
+	}
+	if (rb_obj_is_kind_of(arg, Ctime) == Qtrue) {
+	    return SQL_C_TIME;
 	}
-	hstmt = q->hstmt;
-	stmt = self;
-	dbc = q->dbc;
-    } else {
-	if (!succeeded(SQL_NULL_HENV, p->hdbc, SQL_NULL_HSTMT,
-		       SQLAllocStmt(p->hdbc, &hstmt),
-		       &msg, "SQLAllocStmt")) {
-	    rb_raise(Cerror, "%s", msg);
+	if (rb_obj_is_kind_of(arg, Ctimestamp) == Qtrue) {
+	    return SQL_C_TIMESTAMP;
 	}
-	stmt = Qnil;
-	dbc = self;
+	if (rb_obj_is_kind_of(arg, rb_cTime) == Qtrue) {
+	    return rbtime_ctype(pinfo->type);
+	}
+	if (rb_obj_is_kind_of(arg, rb_cDate) == Qtrue) {
+	    return SQL_C_DATE;
+	}
+	break;
     }
-    rb_scan_args(argc, argv, "1", &sql);
-    Check_Type(sql, T_STRING);
 #ifdef UNICODE
-#ifdef USE_RB_ENC
-    sql = rb_funcall(sql, IDencode, 1, rb_encv);
-#endif
-    csql = STR2CSTR(sql);
-    ssql = uc_from_utf((unsigned char *) csql, -1);
-    if (ssql == NULL) {
-	rb_raise(Cerror, "%s", set_err("Out of memory", 0));
-    }
+    return SQL_C_WCHAR;
 #else
-    csql = STR2CSTR(sql);
-    ssql = (SQLCHAR *) csql;
+    return SQL_C_CHAR;
 #endif
-    if ((mode & MAKERES_EXECD)) {
-	SQLRETURN ret;
+}
 
-	if (!succeeded_nodata(SQL_NULL_HENV, SQL_NULL_HDBC, hstmt,
-			      (ret = SQLExecDirect(hstmt, ssql, SQL_NTS)),
-			      &msg, "SQLExecDirect('%s')", csql)) {
-	    goto sqlerr;
-	}
-	if (ret == SQL_NO_DATA) {
-	    callsql(SQL_NULL_HENV, SQL_NULL_HDBC, hstmt,
-		    SQLFreeStmt(hstmt, SQL_CLOSE), "SQLFreeStmt(SQL_DROP)");
-	    if (q != NULL) {
-		q->hstmt = SQL_NULL_HSTMT;
-		unlink_stmt(q);
-	    }
-	    hstmt = SQL_NULL_HSTMT;
-	}
-    } else if (!succeeded(SQL_NULL_HENV, SQL_NULL_HDBC, hstmt,
-			  SQLPrepare(hstmt, ssql, SQL_NTS),
-			  &msg, "SQLPrepare('%s')", csql)) {
-sqlerr:
-#ifdef UNICODE
-	uc_free(ssql);
+static SQLSMALLINT
+batch_merge_ctype(SQLSMALLINT ctype, SQLSMALLINT ctype2)
+{
+    if ((ctype == 0) || (ctype == ctype2)) {
+	return ctype2;
+    }
+    if (ctype2 == 0) {
+	return ctype;
+    }
+    if (((ctype == SQL_C_LONG) && (ctype2 == SQL_C_DOUBLE)) ||
+	((ctype == SQL_C_DOUBLE) && (ctype2 == SQL_C_LONG))) {
+	return SQL_C_DOUBLE;
+    }
+#ifdef SQL_C_SBIGINT
+    if (((ctype == SQL_C_LONG) && (ctype2 == SQL_C_SBIGINT)) ||
+	((ctype == SQL_C_SBIGINT) && (ctype2 == SQL_C_LONG))) {
+	return SQL_C_SBIGINT;
+    }
+    if (((ctype == SQL_C_SBIGINT) && (ctype2 == SQL_C_DOUBLE)) ||
+	((ctype == SQL_C_DOUBLE) && (ctype2 == SQL_C_SBIGINT))) {
+	return SQL_C_DOUBLE;
+    }
 #endif
-	callsql(SQL_NULL_HENV, SQL_NULL_HDBC, hstmt,
-		SQLFreeStmt(hstmt, SQL_DROP), "SQLFreeStmt(SQL_DROP)");
-	if (q != NULL) {
-	    q->hstmt = SQL_NULL_HSTMT;
-	    unlink_stmt(q);
-	}
-	rb_raise(Cerror, "%s", msg);
-    } else {
-	mode |= MAKERES_PREPARE;
+    if ((ctype == SQL_C_BINARY) || (ctype2 == SQL_C_BINARY)) {
+	return SQL_C_BINARY;
     }
 #ifdef UNICODE
-    uc_free(ssql);
+    return SQL_C_WCHAR;
+#else
+    return SQL_C_CHAR;
 #endif
-    return make_result(dbc, hstmt, stmt, mode);
 }
 
-static VALUE
-stmt_prep(int argc, VALUE *argv, VALUE self)
+static int
+batch_fixed_width(SQLSMALLINT ctype)
 {
-    return stmt_prep_int(argc, argv, self, MAKERES_BLOCK);
+    switch (ctype) {
+    case SQL_C_LONG:
+	return sizeof (SQLINTEGER);
+#ifdef SQL_C_SBIGINT
+    case SQL_C_SBIGINT:
+	return sizeof (SQLBIGINT);
+#endif
+    case SQL_C_DOUBLE:
+	return sizeof (double);
+    case SQL_C_DATE:
+	return sizeof (DATE_STRUCT);
+    case SQL_C_TIME:
+	return sizeof (TIME_STRUCT);
+    case SQL_C_TIMESTAMP:
+	return sizeof (TIMESTAMP_STRUCT);
+    }
+    return 0;
 }
 
-static int
-bind_one_param(int pnum, VALUE arg, STMT *q, char **msgp, int *outpp)
+static void
+batch_grow(BATCHCOL *col, long nrows, long filled, SQLLEN need)
 {
-    SQLPOINTER valp = (SQLPOINTER) &q->paraminfo[pnum].buffer;
-    SQLSMALLINT ctype, stype;
-    SQLINTEGER vlen, rlen;
-    SQLUINTEGER coldef;
-#ifdef NO_RB_STR2CSTR
-    VALUE val;
-#endif
-    long llen;
-    int retry = 1;
-#ifdef UNICODE
-    SQLWCHAR *up;
+    SQLLEN width = col->width * 2;
+    char *data;
+    long k;
 
-    q->paraminfo[pnum].tofree = NULL;
+    if (width < need) {
+	width = need;
+    }
+    data = ALLOC_N(char, width * nrows);
+    for (k = 0; k < filled; k++) {
+	memcpy(data + k * width, col->data + k * col->width, col->width);
+    }
+    xfree(col->data);
+    col->data = data;
+    col->width = width;
+}
+
+static void
+batch_put(BATCH *b, int pnum, long row, VALUE arg)
+{
+    BATCHCOL *col = &b->cols[pnum];
+    char *valp = col->data + row * col->width;
+    SQLLEN *lenp = &col->lens[row];
+
+    if ((arg == Qnil) || (arg == ID2SYM(IDNULL))) {
+	*lenp = SQL_NULL_DATA;
+	return;
+    }
+    if (arg == ID2SYM(IDdefault)) {
+	*lenp = SQL_DEFAULT_PARAM;
+	return;
+    }
+    switch (col->ctype) {
+    case SQL_C_LONG:
+	*(SQLINTEGER *) valp = NUM2INT(arg);
+	*lenp = sizeof (SQLINTEGER);
+	return;
+#ifdef SQL_C_SBIGINT
+    case SQL_C_SBIGINT:
+	*(SQLBIGINT *) valp = NUM2LL(arg);
+	*lenp = sizeof (SQLBIGINT);
+	return;
 #endif
-    switch (TYPE(arg)) {
-    case T_STRING:
+    case SQL_C_DOUBLE:
+	*(double *) valp = NUM2DBL(arg);
+	*lenp = sizeof (double);
+	return;
+    case SQL_C_DATE:
+	if (rb_obj_is_kind_of(arg, Cdate) == Qtrue) {
+	    DATE_STRUCT *date;
+
+	    Data_Get_Struct(arg, DATE_STRUCT, date);
+	    memcpy(valp, date, sizeof (DATE_STRUCT));
+	} else if (rb_obj_is_kind_of(arg, rb_cTime) == Qtrue) {
+	    rbtime_to_struct(arg, SQL_C_DATE, valp);
+	} else {
+	    rbdate_to_struct(arg, (DATE_STRUCT *) valp);
+	}
+	*lenp = sizeof (DATE_STRUCT);
+	return;
+    case SQL_C_TIME:
+	if (rb_obj_is_kind_of(arg, Ctime) == Qtrue) {
+	    TIME_STRUCT *time;
+
+	    Data_Get_Struct(arg, TIME_STRUCT, time);
+	    memcpy(valp, time, sizeof (TIME_STRUCT));
+	} else {
+	    rbtime_to_struct(arg, SQL_C_TIME, valp);
+	}
+	*lenp = sizeof (TIME_STRUCT);
+	return;
+    case SQL_C_TIMESTAMP:
+	if (rb_obj_is_kind_of(arg, Ctimestamp) == Qtrue) {
+	    TIMESTAMP_STRUCT *ts;
+
+	    Data_Get_Struct(arg, TIMESTAMP_STRUCT, ts);
+	    memcpy(valp, ts, sizeof (TIMESTAMP_STRUCT));
+	} else {
+	    rbtime_to_struct(arg, SQL_C_TIMESTAMP, valp);
+	}
+	*lenp = sizeof (TIMESTAMP_STRUCT);
+	return;
+    }
+    if (TYPE(arg) != T_STRING) {
+	arg = rb_obj_as_string(arg);
+    }
 #ifdef UNICODE
-	ctype = SQL_C_WCHAR;
+    if (col->ctype == SQL_C_WCHAR) {
+	SQLWCHAR *up;
+	SQLLEN len;
+
 #ifdef USE_RB_ENC
 	arg = rb_funcall(arg, IDencode, 1, rb_encv);
 #endif
-#ifndef NO_RB_STR2CSTR
-	up = (SQLWCHAR *) rb_str2cstr(arg, &llen);
-	if (llen != (long) strlen((char *) up)) {
-	    ctype = SQL_C_BINARY;
-	    valp = (SQLPOINTER) up;
-	    rlen = llen;
-	    vlen = rlen + 1;
-	    break;
-	}
-#else
-	val = rb_string_value(&arg);
-	up = (SQLWCHAR *) RSTRING_PTR(val);
-	llen = RSTRING_LEN(val);
+	up = uc_from_utf_scratch(&b->q->paraminfo[pnum].ucbuf,
+				 &b->q->paraminfo[pnum].ucsize,
+				 (unsigned char *) RSTRING_PTR(arg),
+				 RSTRING_LEN(arg));
 	if (up == NULL) {
-	    goto oom;
+	    rb_raise(Cerror, "%s", set_err("Out of memory", 0));
 	}
-	if (memchr((char *) up, 0, llen)) {
-	    ctype = SQL_C_BINARY;
-	    valp = (SQLPOINTER) up;
-	    rlen = llen;
-	    vlen = rlen + 1;
-	    break;
+	len = uc_strlen(up) * sizeof (SQLWCHAR);
+	if (len + (SQLLEN) sizeof (SQLWCHAR) > col->width) {
+	    batch_grow(col, b->nrows, row, len + sizeof (SQLWCHAR));
+	    valp = col->data + row * col->width;
 	}
-	up = (SQLWCHAR *) rb_string_value_cstr(&arg);
+	memcpy(valp, up, len + sizeof (SQLWCHAR));
+	uc_free_buf(up, b->q->paraminfo[pnum].ucbuf);
+	*lenp = len;
+	return;
+    }
 #endif
-	up = uc_from_utf((unsigned char *) up, llen);
-	if (up == NULL) {
-	    goto oom;
-	}
-	*(SQLWCHAR **) valp = up;
-	rlen = uc_strlen(up) * sizeof (SQLWCHAR);
-	vlen = rlen + sizeof (SQLWCHAR);
-	q->paraminfo[pnum].tofree = up;
-#else
-	ctype = SQL_C_CHAR;
-#ifndef NO_RB_STR2CSTR
-	valp = (SQLPOINTER) rb_str2cstr(arg, &llen);
-	rlen = llen;
-	if (rlen != (SQLINTEGER) strlen((char *) valp)) {
-	    ctype = SQL_C_BINARY;
-	}
-	vlen = rlen + 1;
-#else
-	val = rb_string_value(&arg);
-	valp = (SQLPOINTER) RSTRING_PTR(val);
-	llen = RSTRING_LEN(val);
-	if (valp == NULL) {
-	    goto oom;
+    if (RSTRING_LEN(arg) + 1 > col->width) {
+	batch_grow(col, b->nrows, row, RSTRING_LEN(arg) + 1);
+	valp = col->data + row * col->width;
+    }
+    memcpy(valp, RSTRING_PTR(arg), RSTRING_LEN(arg));
+    valp[RSTRING_LEN(arg)] = '\0';
+    *lenp = RSTRING_LEN(arg);
+}
+
+/* Bind the parameter arrays of b for a set of nrows rows. */
+
+static void
+batch_bind(BATCH *b, long nrows)
+{
+    STMT *q = b->q;
+    char *msg = NULL;
+    int i;
+
+    b->bound = 1;
+    if (!succeeded(SQL_NULL_HENV, SQL_NULL_HDBC, q->hstmt,
+		   SQLSetStmtAttr(q->hstmt, SQL_ATTR_PARAM_BIND_TYPE,
+				  (SQLPOINTER) SQL_PARAM_BIND_BY_COLUMN, 0),
+		   &msg, "SQLSetStmtAttr(SQL_ATTR_PARAM_BIND_TYPE)") ||
+	!succeeded(SQL_NULL_HENV, SQL_NULL_HDBC, q->hstmt,
+		   SQLSetStmtAttr(q->hstmt, SQL_ATTR_PARAMSET_SIZE,
+				  (SQLPOINTER) (SQLULEN) nrows, 0),
+		   &msg, "SQLSetStmtAttr(SQL_ATTR_PARAMSET_SIZE)") ||
+	!succeeded(SQL_NULL_HENV, SQL_NULL_HDBC, q->hstmt,
+		   SQLSetStmtAttr(q->hstmt, SQL_ATTR_PARAM_STATUS_PTR,
+				  (SQLPOINTER) b->stat, 0),
+		   &msg, "SQLSetStmtAttr(SQL_ATTR_PARAM_STATUS_PTR)") ||
+	!succeeded(SQL_NULL_HENV, SQL_NULL_HDBC, q->hstmt,
+		   SQLSetStmtAttr(q->hstmt, SQL_ATTR_PARAMS_PROCESSED_PTR,
+				  (SQLPOINTER) &b->processed, 0),
+		   &msg, "SQLSetStmtAttr(SQL_ATTR_PARAMS_PROCESSED_PTR)")) {
+	rb_raise(Cerror, "%s", msg);
+    }
+    for (i = 0; i < q->nump; i++) {
+	BATCHCOL *col = &b->cols[i];
+	SQLSMALLINT stype = q->paraminfo[i].type;
+	SQLULEN coldef = q->paraminfo[i].coldef;
+
+	if (coldef == 0) {
+	    switch (col->ctype) {
+	    case SQL_C_LONG:
+		coldef = 10;
+		break;
+	    case SQL_C_DOUBLE:
+		coldef = 15;
+		if (stype == SQL_VARCHAR) {
+		    stype = SQL_DOUBLE;
+		}
+		break;
+#ifdef SQL_C_SBIGINT
+	    case SQL_C_SBIGINT:
+		coldef = 19;
+		if (stype == SQL_VARCHAR) {
+		    stype = SQL_BIGINT;
+		}
+		break;
+#endif
+	    case SQL_C_DATE:
+		coldef = 10;
+		break;
+	    case SQL_C_TIME:
+		coldef = 8;
+		break;
+	    case SQL_C_TIMESTAMP:
+		coldef = 19;
+		break;
+	    default:
+		coldef = col->width;
+		break;
+	    }
 	}
-	rlen = llen;
-	vlen = rlen + 1;
-	if (memchr((char *) valp, 0, llen)) {
-	    ctype = SQL_C_BINARY;
-	    break;
+	if (!succeeded(SQL_NULL_HENV, SQL_NULL_HDBC, q->hstmt,
+		       SQLBindParameter(q->hstmt, (SQLUSMALLINT) (i + 1),
+					SQL_PARAM_INPUT, col->ctype, stype,
+					coldef, q->paraminfo[i].scale,
+					(SQLPOINTER) col->data, col->width,
+					col->lens),
+		       &msg, "SQLBindParameter(%d)", i + 1)) {
+	    rb_raise(Cerror, "%s", msg);
 	}
-	valp = (SQLPOINTER) rb_string_value_cstr(&arg);
-#endif
-#endif
-	break;
-    case T_FIXNUM:
-	ctype = SQL_C_LONG;
-	*(SQLINTEGER *) valp = FIX2INT(arg);
-	rlen = 1;
-	vlen = sizeof (SQLINTEGER);
-	break;
-    case T_FLOAT:
-	ctype = SQL_C_DOUBLE;
-	*(double *) valp = NUM2DBL(arg);
-	rlen = 1;
-	vlen = sizeof (double);
-	break;
-    case T_NIL:
-	ctype = SQL_C_CHAR;
-	valp = NULL;
-	rlen = SQL_NULL_DATA;
-	vlen = 0;
-	break;
-    case T_SYMBOL:
-	ctype = SQL_C_CHAR;
-	valp = NULL;
-	vlen = 0;
-	if (arg == ID2SYM(IDNULL)) {
-	    rlen = SQL_NULL_DATA;
-	} else if (arg == ID2SYM(IDdefault)) {
-	    rlen = SQL_DEFAULT_PARAM;
+    }
+}
+
+static VALUE
+batch_status(BATCH *b)
+{
+    VALUE res = rb_ary_new2(b->nrows);
+    long k;
+
+    for (k = 0; k < b->nrows; k++) {
+	rb_ary_push(res, INT2NUM(((SQLULEN) k < b->processed) ?
+				 b->stat[k] : SQL_PARAM_UNUSED));
+    }
+    return res;
+}
+
+static VALUE
+batch_run(VALUE arg)
+{
+    BATCH *b = (BATCH *) arg;
+    STMT *q = b->q;
+    char *msg = NULL;
+    long k;
+    int i;
+
+    for (i = 0; i < q->nump; i++) {
+	SQLSMALLINT ctype = 0;
+	SQLLEN maxlen = 31;
+
+	for (k = 0; k < b->nrows; k++) {
+	    VALUE row = rb_ary_entry(b->rows, k);
+	    VALUE arg = rb_ary_entry(row, i);
+
+	    ctype = batch_merge_ctype(ctype,
+				      batch_ctype(arg, &q->paraminfo[i]));
+	    if ((TYPE(arg) == T_STRING) && (RSTRING_LEN(arg) > maxlen)) {
+		maxlen = RSTRING_LEN(arg);
+	    }
 	}
-	/* fall through */
-    default:
-	if (rb_obj_is_kind_of(arg, Cdate) == Qtrue) {
-	    DATE_STRUCT *date;
+	if (ctype == 0) {
+	    ctype = SQL_C_CHAR;
+	}
+	b->cols[i].ctype = ctype;
+	b->cols[i].width = batch_fixed_width(ctype);
+	if (b->cols[i].width == 0) {
+	    /*
+	     * Sized for the longest string, UTF-8 bytes yield at most
+	     * one UTF-16 unit each. Only other objects converted by
+	     * to_s may still need batch_grow().
+	     */
+	    SQLLEN width = maxlen + 1;
 
-	    ctype = SQL_C_DATE;
-	    Data_Get_Struct(arg, DATE_STRUCT, date);
-	    valp = (SQLPOINTER) date;
-	    rlen = 1;
-	    vlen = sizeof (DATE_STRUCT);
-	    break;
+#ifdef UNICODE
+	    if (ctype == SQL_C_WCHAR) {
+		width *= sizeof (SQLWCHAR);
+	    }
+#endif
+	    b->cols[i].width = LEN_ALIGN(width);
 	}
-	if (rb_obj_is_kind_of(arg, Ctime) == Qtrue) {
-	    TIME_STRUCT *time;
+	b->cols[i].lens = ALLOC_N(SQLLEN, b->nrows);
+	b->cols[i].data = ALLOC_N(char, b->cols[i].width * b->nrows);
+    }
+    for (k = 0; k < b->nrows; k++) {
+	VALUE row = rb_ary_entry(b->rows, k);
 
-	    ctype = SQL_C_TIME;
-	    Data_Get_Struct(arg, TIME_STRUCT, time);
-	    valp = (SQLPOINTER) time;
-	    rlen = 1;
-	    vlen = sizeof (TIME_STRUCT);
-	    break;
+	for (i = 0; i < q->nump; i++) {
+	    batch_put(b, i, k, rb_ary_entry(row, i));
 	}
-	if (rb_obj_is_kind_of(arg, Ctimestamp) == Qtrue) {
-	    TIMESTAMP_STRUCT *ts;
+    }
+    batch_bind(b, b->nrows);
+    if (!succeeded_nodata(SQL_NULL_HENV, SQL_NULL_HDBC, q->hstmt,
+			  nogvl_execute(q->hstmt), &msg, "SQLExecute")) {
+	VALUE exc = rb_exc_new2(Cerror, msg);
 
-	    ctype = SQL_C_TIMESTAMP;
-	    Data_Get_Struct(arg, TIMESTAMP_STRUCT, ts);
-	    valp = (SQLPOINTER) ts;
-	    rlen = 1;
-	    vlen = sizeof (TIMESTAMP_STRUCT);
-	    break;
+	/* tell which rows failed */
+	rb_iv_set(exc, "@statuses", batch_status(b));
+	rb_exc_raise(exc);
+    }
+    return batch_status(b);
+}
+
+static VALUE
+batch_cleanup(VALUE arg)
+{
+    BATCH *b = (BATCH *) arg;
+    STMT *q = b->q;
+    int i;
+
+    if (b->bound && (q->hstmt != SQL_NULL_HSTMT)) {
+	callsql(SQL_NULL_HENV, SQL_NULL_HDBC, q->hstmt,
+		SQLFreeStmt(q->hstmt, SQL_RESET_PARAMS),
+		"SQLFreeStmt(SQL_RESET_PARAMS)");
+	callsql(SQL_NULL_HENV, SQL_NULL_HDBC, q->hstmt,
+		SQLSetStmtAttr(q->hstmt, SQL_ATTR_PARAMSET_SIZE,
+			       (SQLPOINTER) 1, 0),
+		"SQLSetStmtAttr(SQL_ATTR_PARAMSET_SIZE)");
+	callsql(SQL_NULL_HENV, SQL_NULL_HDBC, q->hstmt,
+		SQLSetStmtAttr(q->hstmt, SQL_ATTR_PARAM_STATUS_PTR, NULL, 0),
+		"SQLSetStmtAttr(SQL_ATTR_PARAM_STATUS_PTR)");
+	callsql(SQL_NULL_HENV, SQL_NULL_HDBC, q->hstmt,
+		SQLSetStmtAttr(q->hstmt, SQL_ATTR_PARAMS_PROCESSED_PTR,
+			       NULL, 0),
+		"SQLSetStmtAttr(SQL_ATTR_PARAMS_PROCESSED_PTR)");
+    }
+    for (i = 0; i < q->nump; i++) {
+	if (b->cols[i].data != NULL) {
+	    xfree(b->cols[i].data);
 	}
-	if (rb_obj_is_kind_of(arg, rb_cTime) == Qtrue) {
-	    if (q->paraminfo[pnum].type == SQL_TIME) {
-		TIME_STRUCT *time;
+	if (b->cols[i].lens != NULL) {
+	    xfree(b->cols[i].lens);
+	}
+    }
+    xfree(b->cols);
+    xfree(b->stat);
+    return Qnil;
+}
 
-		ctype = SQL_C_TIME;
-		time = (TIME_STRUCT *) valp;
-		memset(time, 0, sizeof (TIME_STRUCT));
-		time->hour   = rb_funcall(arg, IDhour, 0, NULL);
-		time->minute = rb_funcall(arg, IDmin, 0, NULL);
-		time->second = rb_funcall(arg, IDsec, 0, NULL);
-		rlen = 1;
-		vlen = sizeof (TIME_STRUCT);
-	    } else if (q->paraminfo[pnum].type == SQL_DATE) {
-		DATE_STRUCT *date;
+/*
+ * CSV import: the file is mapped into memory (read when mmap() is
+ * not available), records are split and unquoted in place, fields
+ * converted by the SQL type of their parameter into the parameter
+ * arrays of a BATCH which is executed every batch rows.
+ */
 
-		ctype = SQL_C_DATE;
-		date = (DATE_STRUCT *) valp;
-		memset(date, 0, sizeof (DATE_STRUCT));
-		date->year  = rb_funcall(arg, IDyear, 0, NULL);
-		date->month = rb_funcall(arg, IDmonth, 0, NULL);
-		date->day   = rb_funcall(arg, IDday, 0, NULL);
-		rlen = 1;
-		vlen = sizeof (TIMESTAMP_STRUCT);
-	    } else {
-		TIMESTAMP_STRUCT *ts;
-
-		ctype = SQL_C_TIMESTAMP;
-		ts = (TIMESTAMP_STRUCT *) valp;
-		memset(ts, 0, sizeof (TIMESTAMP_STRUCT));
-		ts->year     = rb_funcall(arg, IDyear, 0, NULL);
-		ts->month    = rb_funcall(arg, IDmonth, 0, NULL);
-		ts->day      = rb_funcall(arg, IDday, 0, NULL);
-		ts->hour     = rb_funcall(arg, IDhour, 0, NULL);
-		ts->minute   = rb_funcall(arg, IDmin, 0, NULL);
-		ts->second   = rb_funcall(arg, IDsec, 0, NULL);
-#ifdef TIME_USE_USEC
-		ts->fraction = rb_funcall(arg, IDusec, 0, NULL) * 1000;
+typedef struct {
+    BATCH b;
+    VALUE path;
+    VALUE data;
+    char *map;
+    size_t size;
+    int mapped;
+    int header;
+    int quote;
+    const char *sep;
+    long seplen;
+    const char *null;
+    long nulllen;
+    long *cols;
+    long maxf;
+    char **fptr;
+    SQLLEN *flen;
+    char *fnull;
+    long lineno;
+    long *lines;
+    long inserted;
+    VALUE errors;
+} IMPORT;
+
+static SQLSMALLINT
+import_ctype(SQLSMALLINT stype)
+{
+    switch (stype) {
+    case SQL_INTEGER:
+    case SQL_SMALLINT:
+    case SQL_TINYINT:
+    case SQL_BIT:
+	return SQL_C_LONG;
+#ifdef SQL_C_SBIGINT
+    case SQL_BIGINT:
+	return SQL_C_SBIGINT;
+#endif
+    case SQL_REAL:
+    case SQL_FLOAT:
+    case SQL_DOUBLE:
+	return SQL_C_DOUBLE;
+    case SQL_DATE:
+#ifdef SQL_TYPE_DATE
+    case SQL_TYPE_DATE:
+#endif
+	return SQL_C_DATE;
+    case SQL_TIME:
+#ifdef SQL_TYPE_TIME
+    case SQL_TYPE_TIME:
+#endif
+	return SQL_C_TIME;
+    case SQL_TIMESTAMP:
+#ifdef SQL_TYPE_TIMESTAMP
+    case SQL_TYPE_TIMESTAMP:
+#endif
+	return SQL_C_TIMESTAMP;
+    case SQL_BINARY:
+    case SQL_VARBINARY:
+    case SQL_LONGVARBINARY:
+	/* hex digits, converted by the driver */
+	return SQL_C_CHAR;
+    }
+#ifdef UNICODE
+    return SQL_C_WCHAR;
 #else
-		ts->fraction = rb_funcall(arg, IDnsec, 0, NULL);
+    return SQL_C_CHAR;
 #endif
-		rlen = 1;
-		vlen = sizeof (TIMESTAMP_STRUCT);
+}
+
+static int
+import_sep(IMPORT *im, char *p, char *end)
+{
+    return (p < end) && (*p == im->sep[0]) &&
+	((im->seplen == 1) ||
+	 ((end - p >= im->seplen) && (memcmp(p, im->sep, im->seplen) == 0)));
+}
+
+/*
+ * Split the record at *pp into fields, quoted fields are unquoted in
+ * place. Returns the number of fields, the first maxf of them are
+ * stored in fptr/flen/fnull.
+ */
+
+static long
+import_record(IMPORT *im, char **pp, char *end)
+{
+    char *p = *pp;
+    long nf = 0;
+
+    for (;;) {
+	char *start = p;
+	SQLLEN len;
+	int quoted = 0;
+
+	if ((im->quote >= 0) && (p < end) && (*p == (char) im->quote)) {
+	    char *dst = ++p;
+
+	    quoted = 1;
+	    start = dst;
+	    while (p < end) {
+		if (*p == (char) im->quote) {
+		    if ((p + 1 < end) && (p[1] == (char) im->quote)) {
+			*dst++ = *p;
+			p += 2;
+			continue;
+		    }
+		    p++;
+		    break;
+		}
+		if (*p == '\n') {
+		    im->lineno++;
+		}
+		*dst++ = *p++;
+	    }
+	    len = dst - start;
+	    /* ignore anything up to the next separator */
+	    while ((p < end) && (*p != '\n') && !import_sep(im, p, end)) {
+		p++;
 	    }
+	} else {
+	    while ((p < end) && (*p != '\n') && !import_sep(im, p, end)) {
+		p++;
+	    }
+	    len = p - start;
+	    if ((len > 0) && (start[len - 1] == '\r') &&
+		!import_sep(im, p, end)) {
+		len--;
+	    }
+	}
+	if (nf < im->maxf) {
+	    im->fptr[nf] = start;
+	    im->flen[nf] = len;
+	    im->fnull[nf] = !quoted && (len == im->nulllen) &&
+		(memcmp(start, im->null, len) == 0);
+	}
+	nf++;
+	if (!import_sep(im, p, end)) {
 	    break;
 	}
-	if (rb_obj_is_kind_of(arg, rb_cDate) == Qtrue) {
-	    DATE_STRUCT *date;
+	p += im->seplen;
+    }
+    if (p < end) {
+	/* newline */
+	p++;
+    }
+    im->lineno++;
+    *pp = p;
+    return nf;
+}
 
-	    ctype = SQL_C_DATE;
-	    date = (DATE_STRUCT *) valp;
-	    memset(date, 0, sizeof (DATE_STRUCT));
-	    date->year  = rb_funcall(arg, IDyear, 0, NULL);
-	    date->month = rb_funcall(arg, IDmonth, 0, NULL);
-	    date->day   = rb_funcall(arg, IDmday, 0, NULL);
-	    rlen = 1;
-	    vlen = sizeof (DATE_STRUCT);
-	    break;
+static void
+import_trim(char **pp, SQLLEN *lenp)
+{
+    while ((*lenp > 0) && ((**pp == ' ') || (**pp == '\t'))) {
+	++*pp;
+	--*lenp;
+    }
+    while ((*lenp > 0) &&
+	   (((*pp)[*lenp - 1] == ' ') || ((*pp)[*lenp - 1] == '\t'))) {
+	--*lenp;
+    }
+}
+
+static int
+import_int(char *p, SQLLEN len, SQLBIGINT min, SQLBIGINT max,
+	   SQLBIGINT *valp)
+{
+    char *end;
+    SQLUBIGINT v = 0, lim;
+    int neg = 0;
+
+    import_trim(&p, &len);
+    end = p + len;
+    if ((p < end) && ((*p == '-') || (*p == '+'))) {
+	neg = *p++ == '-';
+    }
+    if (p >= end) {
+	return 0;
+    }
+    lim = neg ? (SQLUBIGINT) 0 - (SQLUBIGINT) min : (SQLUBIGINT) max;
+    for (; p < end; p++) {
+	unsigned int d = (unsigned char) *p - '0';
+
+	if ((d > 9) || (v > (lim - d) / 10)) {
+	    return 0;
 	}
-	ctype = SQL_C_CHAR;
-#ifndef NO_RB_STR2CSTR
-	valp = (SQLPOINTER *) rb_str2cstr(rb_str_to_str(arg), &llen);
-	rlen = llen;
-	if (rlen != (SQLINTEGER) strlen((char *) valp)) {
-	    ctype = SQL_C_BINARY;
+	v = v * 10 + d;
+    }
+    *valp = neg ? (SQLBIGINT) ((SQLUBIGINT) 0 - v) : (SQLBIGINT) v;
+    return 1;
+}
+
+/* Read 1 to n digits. */
+
+static int
+import_digits(char **pp, char *end, int n, int *valp)
+{
+    char *p = *pp;
+    int v = 0;
+
+    while ((p < end) && (p - *pp < n) && (*p >= '0') && (*p <= '9')) {
+	v = v * 10 + (*p++ - '0');
+    }
+    if (p == *pp) {
+	return 0;
+    }
+    *pp = p;
+    *valp = v;
+    return 1;
+}
+
+static int
+import_date(char **pp, char *end, DATE_STRUCT *date)
+{
+    int y, m, d;
+
+    if (!import_digits(pp, end, 4, &y) ||
+	(*pp >= end) || (*(*pp)++ != '-') ||
+	!import_digits(pp, end, 2, &m) ||
+	(*pp >= end) || (*(*pp)++ != '-') ||
+	!import_digits(pp, end, 2, &d) ||
+	!civil_valid(y, m, d)) {
+	return 0;
+    }
+    date->year = y;
+    date->month = m;
+    date->day = d;
+    return 1;
+}
+
+/* Time of day with optional fraction, returned in nanoseconds. */
+
+static int
+import_time(char **pp, char *end, TIME_STRUCT *time, SQLUINTEGER *fracp)
+{
+    int h, m, s;
+    SQLUINTEGER frac = 0;
+
+    if (!import_digits(pp, end, 2, &h) ||
+	(*pp >= end) || (*(*pp)++ != ':') ||
+	!import_digits(pp, end, 2, &m) ||
+	(*pp >= end) || (*(*pp)++ != ':') ||
+	!import_digits(pp, end, 2, &s) ||
+	(h > 23) || (m > 59) || (s > 59)) {
+	return 0;
+    }
+    if ((*pp < end) && (**pp == '.')) {
+	int k;
+
+	++*pp;
+	for (k = 0; (k < 9) && (*pp < end) && (**pp >= '0') && (**pp <= '9');
+	     k++) {
+	    frac = frac * 10 + (*(*pp)++ - '0');
 	}
-	vlen = rlen + 1;
-#else
-	val = rb_string_value(&arg);
-	valp = (SQLPOINTER) RSTRING_PTR(val);
-	llen = RSTRING_LEN(val);
-	if (valp == NULL) {
-	    goto oom;
+	if (k == 0) {
+	    return 0;
 	}
-	rlen = llen;
-	vlen = rlen + 1;
-	if (memchr((char *) valp, 0, llen)) {
-	    ctype = SQL_C_BINARY;
-	    break;
+	while (k++ < 9) {
+	    frac *= 10;
 	}
-	valp = (SQLPOINTER) rb_string_value_cstr(&arg);
-#endif
-	break;
     }
-    stype = q->paraminfo[pnum].type;
-    coldef = q->paraminfo[pnum].coldef;
-    q->paraminfo[pnum].rlen = rlen;
-    q->paraminfo[pnum].ctype = ctype;
-    if (coldef == 0) {
-	switch (ctype) {
-	case SQL_C_LONG:
-	    coldef = 10;
-	    break;
-	case SQL_C_DOUBLE:
-	    coldef = 15;
-	    if (stype == SQL_VARCHAR) {
-		stype = SQL_DOUBLE;
+    time->hour = h;
+    time->minute = m;
+    time->second = s;
+    *fracp = frac;
+    return 1;
+}
+
+/* Convert field into row of parameter i, returns 0 on error. */
+
+static int
+import_put(IMPORT *im, int i, long row, char *p, SQLLEN len)
+{
+    BATCHCOL *col = &im->b.cols[i];
+    char *valp = col->data + row * col->width;
+    SQLLEN *lenp = &col->lens[row];
+    char *end;
+    SQLBIGINT v;
+
+    switch (col->ctype) {
+    case SQL_C_LONG:
+	if (!import_int(p, len, -0x7fffffffL - 1, 0x7fffffffL, &v)) {
+	    return 0;
+	}
+	*(SQLINTEGER *) valp = (SQLINTEGER) v;
+	*lenp = sizeof (SQLINTEGER);
+	return 1;
+#ifdef SQL_C_SBIGINT
+    case SQL_C_SBIGINT:
+	if (!import_int(p, len, (SQLBIGINT) ((SQLUBIGINT) 1 << 63),
+			(SQLBIGINT) (((SQLUBIGINT) 1 << 63) - 1), &v)) {
+	    return 0;
+	}
+	*(SQLBIGINT *) valp = v;
+	*lenp = sizeof (SQLBIGINT);
+	return 1;
+#endif
+    case SQL_C_DOUBLE:
+	{
+	    char buf[64];
+
+	    import_trim(&p, &len);
+	    if ((len == 0) || (len >= (SQLLEN) sizeof (buf))) {
+		return 0;
 	    }
-	    break;
-	case SQL_C_DATE:
-	    coldef = 10;
-	    break;
-	case SQL_C_TIME:
-	    coldef = 8;
-	    break;
-	case SQL_C_TIMESTAMP:
-	    coldef = 19;
-	    break;
-	default:
-	    /*
-	     * Patch adopted from the Perl DBD::ODBC module ...
-	     * per patch from Paul G. Weiss, who was experiencing re-preparing
-	     * of queries when the size of the bound string's were increasing
-	     * for example select * from tabtest where name = ?
-	     * then executing with 'paul' and then 'thomas' would cause
-	     * SQLServer to prepare the query twice, but if we ran 'thomas'
-	     * then 'paul', it would not re-prepare the query.  The key seems
-	     * to be allocating enough space for the largest parameter.
-	     * TBD: the default for this should be a tunable parameter.
-	     */
-	    if ((stype == SQL_VARCHAR) &&
-		(q->paraminfo[pnum].iotype != SQL_PARAM_INPUT_OUTPUT) &&
-		(q->paraminfo[pnum].iotype != SQL_PARAM_OUTPUT)) {
-		if (q->paraminfo[pnum].coldef_max == 0) {
-		    q->paraminfo[pnum].coldef_max = (vlen > 128) ? vlen : 128;
-		} else {
-		    /* bump up max, if needed */
-		    if (vlen > (SQLINTEGER) q->paraminfo[pnum].coldef_max) {
-			q->paraminfo[pnum].coldef_max = vlen;
-		    }
-		}
-		coldef = q->paraminfo[pnum].coldef_max;
-	    } else {
-		coldef = vlen;
+	    memcpy(buf, p, len);
+	    buf[len] = '\0';
+	    *(double *) valp = strtod(buf, &end);
+	    if (end != buf + len) {
+		return 0;
 	    }
-	    break;
 	}
-    }
-    if ((q->paraminfo[pnum].iotype == SQL_PARAM_INPUT_OUTPUT) ||
-	(q->paraminfo[pnum].iotype == SQL_PARAM_OUTPUT)) {
-	if (valp == NULL) {
-	    if (q->paraminfo[pnum].outsize > 0) {
-		if (q->paraminfo[pnum].outbuf != NULL) {
-		    xfree(q->paraminfo[pnum].outbuf);
-		}
-		q->paraminfo[pnum].outbuf = xmalloc(q->paraminfo[pnum].outsize);
-		if (q->paraminfo[pnum].outbuf == NULL) {
-		    goto oom;
-		}
-		ctype = q->paraminfo[pnum].ctype = q->paraminfo[pnum].outtype;
-		outpp[0]++;
-		valp = q->paraminfo[pnum].outbuf;
-		vlen = q->paraminfo[pnum].outsize;
+	*lenp = sizeof (double);
+	return 1;
+    case SQL_C_DATE:
+	import_trim(&p, &len);
+	end = p + len;
+	if (!import_date(&p, end, (DATE_STRUCT *) valp) || (p != end)) {
+	    return 0;
+	}
+	*lenp = sizeof (DATE_STRUCT);
+	return 1;
+    case SQL_C_TIME:
+	{
+	    SQLUINTEGER frac;
+
+	    import_trim(&p, &len);
+	    end = p + len;
+	    if (!import_time(&p, end, (TIME_STRUCT *) valp, &frac) ||
+		(p != end)) {
+		return 0;
 	    }
-	} else {
-	    if (q->paraminfo[pnum].outbuf != NULL) {
-		xfree(q->paraminfo[pnum].outbuf);
+	}
+	*lenp = sizeof (TIME_STRUCT);
+	return 1;
+    case SQL_C_TIMESTAMP:
+	{
+	    TIMESTAMP_STRUCT *ts = (TIMESTAMP_STRUCT *) valp;
+	    DATE_STRUCT date;
+	    TIME_STRUCT time;
+	    SQLUINTEGER frac = 0;
+
+	    import_trim(&p, &len);
+	    end = p + len;
+	    if (!import_date(&p, end, &date)) {
+		return 0;
 	    }
-	    q->paraminfo[pnum].outbuf = xmalloc(vlen);
-	    if (q->paraminfo[pnum].outbuf == NULL) {
-oom:
-#ifdef UNICODE
-		if (q->paraminfo[pnum].tofree != NULL) {
-		    uc_free(q->paraminfo[pnum].tofree);
-		    q->paraminfo[pnum].tofree = NULL;
+	    time.hour = time.minute = time.second = 0;
+	    if ((p < end) && ((*p == ' ') || (*p == 'T'))) {
+		p++;
+		if (!import_time(&p, end, &time, &frac)) {
+		    return 0;
 		}
-#endif
-		*msgp = set_err("Out of memory", 0);
-		return -1;
 	    }
-#ifdef UNICODE
-	    if (ctype == SQL_C_WCHAR) {
-		memcpy(q->paraminfo[pnum].outbuf, *(SQLWCHAR **) valp, vlen);
-	    } else
-#endif
-	    memcpy(q->paraminfo[pnum].outbuf, valp, vlen);
-#ifdef UNICODE
-	    if (ctype == SQL_C_WCHAR) {
-		*(SQLWCHAR **) valp = (SQLWCHAR *) q->paraminfo[pnum].outbuf;
-	    } else
-#endif
-	    valp = q->paraminfo[pnum].outbuf;
-	    outpp[0]++;
-	}
-    }
-retry:
-#ifdef UNICODE
-    if (!succeeded(SQL_NULL_HENV, SQL_NULL_HDBC, q->hstmt,
-		   SQLBindParameter(q->hstmt, (SQLUSMALLINT) (pnum + 1),
-				    q->paraminfo[pnum].iotype,
-				    ctype, stype, coldef,
-				    q->paraminfo[pnum].scale,
-				    (ctype == SQL_C_WCHAR) ?
-				    *(SQLWCHAR **) valp : valp,
-				    vlen, &q->paraminfo[pnum].rlen),
-		   msgp, "SQLBindParameter(%d)", pnum + 1))
-#else
-    if (!succeeded(SQL_NULL_HENV, SQL_NULL_HDBC, q->hstmt,
-		   SQLBindParameter(q->hstmt, (SQLUSMALLINT) (pnum + 1),
-				    q->paraminfo[pnum].iotype,
-				    ctype, stype, coldef,
-				    q->paraminfo[pnum].scale,
-				    valp, vlen, &q->paraminfo[pnum].rlen),
-		   msgp, "SQLBindParameter(%d)", pnum + 1))
-#endif
-    {
-	if (retry) {
-	    retry = 0;
-	    if (stype == SQL_VARCHAR) {
-		/* maybe MS Jet memo field */
-		stype = SQL_LONGVARCHAR;
-		goto retry;
+	    if (p != end) {
+		return 0;
 	    }
+	    ts->year = date.year;
+	    ts->month = date.month;
+	    ts->day = date.day;
+	    ts->hour = time.hour;
+	    ts->minute = time.minute;
+	    ts->second = time.second;
+	    ts->fraction = frac;
+	}
+	*lenp = sizeof (TIMESTAMP_STRUCT);
+	return 1;
 #ifdef UNICODE
-	    if (stype == SQL_WVARCHAR) {
-		stype = SQL_WLONGVARCHAR;
-		goto retry;
-	    }
-#endif
+    case SQL_C_WCHAR:
+	if ((SQLLEN) ((len + 1) * sizeof (SQLWCHAR)) > col->width) {
+	    batch_grow(col, im->b.nrows, row, (len + 1) * sizeof (SQLWCHAR));
+	    valp = col->data + row * col->width;
 	}
-	return -1;
+	*lenp = uc_widen((unsigned char *) p, len, (SQLWCHAR *) valp) *
+	    sizeof (SQLWCHAR);
+	return 1;
+#endif
     }
-    return 0;
+    if (len + 1 > col->width) {
+	batch_grow(col, im->b.nrows, row, len + 1);
+	valp = col->data + row * col->width;
+    }
+    memcpy(valp, p, len);
+    valp[len] = '\0';
+    *lenp = len;
+    return 1;
 }
 
-static VALUE
-stmt_exec_int(int argc, VALUE *argv, VALUE self, int mode)
+/* Execute the first nrows rows, count inserted and collect errors. */
+
+static void
+import_exec(IMPORT *im, long nrows)
 {
-    STMT *q;
-    int i, argnum, has_out_parms = 0;
-    char *msg = NULL;
+    BATCH *b = &im->b;
+    STMT *q = b->q;
     SQLRETURN ret;
-
-    Data_Get_Struct(self, STMT, q);
-    if (argc > q->nump - ((EXEC_PARMXOUT(mode) < 0) ? 0 : 1)) {
-	rb_raise(Cerror, "%s", set_err("Too much parameters", 0));
-    }
-    if (q->hstmt == SQL_NULL_HSTMT) {
-	rb_raise(Cerror, "%s", set_err("Stale ODBC::Statement", 0));
+    char *msg = NULL;
+    int ok;
+    long k;
+
+    for (k = 0; k < nrows; k++) {
+	b->stat[k] = SQL_PARAM_UNUSED;
+    }
+    b->processed = 0;
+    batch_bind(b, nrows);
+    ret = nogvl_execute(q->hstmt);
+    ok = succeeded_nodata(SQL_NULL_HENV, SQL_NULL_HDBC, q->hstmt, ret,
+			  &msg, "SQLExecute");
+    if (!ok && (b->processed == 0)) {
+	rb_raise(Cerror, "%s", msg);
     }
-    if (!succeeded(SQL_NULL_HENV, SQL_NULL_HDBC, q->hstmt,
-		   SQLFreeStmt(q->hstmt, SQL_CLOSE),
-		   &msg, "SQLFreeStmt(SQL_CLOSE)")) {
-	goto error;
+    if (ok && (b->processed == 0)) {
+	/* driver doesn't report, all rows done */
+	b->processed = nrows;
     }
-    callsql(SQL_NULL_HENV, SQL_NULL_HDBC, q->hstmt,
-	    SQLFreeStmt(q->hstmt, SQL_RESET_PARAMS),
-	    "SQLFreeStmt(SQL_RESET_PARMS)");
-    for (i = argnum = 0; i < q->nump; i++) {
-	VALUE arg;
+    for (k = 0; k < nrows; k++) {
+	SQLUSMALLINT stat = b->stat[k];
 
-	if (i == EXEC_PARMXOUT(mode)) {
-	    if (bind_one_param(i, Qnil, q, &msg, &has_out_parms) < 0) {
-		goto error;
-	    }
-	    continue;
+	if ((SQLULEN) k >= b->processed) {
+	    stat = SQL_PARAM_UNUSED;
+	} else if ((stat == SQL_PARAM_UNUSED) ||
+		   (stat == SQL_PARAM_DIAG_UNAVAILABLE)) {
+	    stat = ok ? SQL_PARAM_SUCCESS : SQL_PARAM_ERROR;
 	}
-	arg = (argnum < argc) ? argv[argnum++] : Qnil;
-	if (bind_one_param(i, arg, q, &msg, &has_out_parms) < 0) {
-	    goto error;
+	if ((stat == SQL_PARAM_SUCCESS) ||
+	    (stat == SQL_PARAM_SUCCESS_WITH_INFO)) {
+	    im->inserted++;
+	} else {
+	    rb_ary_push(im->errors, LONG2NUM(im->lines[k]));
 	}
     }
-    if (!succeeded_nodata(SQL_NULL_HENV, SQL_NULL_HDBC, q->hstmt,
-			  (ret = SQLExecute(q->hstmt)),
-			  &msg, "SQLExecute")) {
-error:
-#ifdef UNICODE
-	for (i = 0; i < q->nump; i++) {
-	    if (q->paraminfo[i].tofree != NULL) {
-		uc_free(q->paraminfo[i].tofree);
-		q->paraminfo[i].tofree = NULL;
-	    }
+}
+
+static void
+import_map(IMPORT *im)
+{
+#ifdef HAVE_MMAP
+    struct stat st;
+    int fd = open(StringValueCStr(im->path), O_RDONLY);
+
+    if (fd < 0) {
+	rb_sys_fail(RSTRING_PTR(im->path));
+    }
+    if (fstat(fd, &st) < 0) {
+	close(fd);
+	rb_sys_fail(RSTRING_PTR(im->path));
+    }
+    im->size = (size_t) st.st_size;
+    if (im->size > 0) {
+	/* private writable mapping for unquoting in place */
+	im->map = mmap(NULL, im->size, PROT_READ | PROT_WRITE, MAP_PRIVATE,
+		       fd, 0);
+	if (im->map == MAP_FAILED) {
+	    im->map = NULL;
+	    close(fd);
+	    rb_sys_fail(RSTRING_PTR(im->path));
 	}
+	im->mapped = 1;
+#ifdef MADV_SEQUENTIAL
+	madvise(im->map, im->size, MADV_SEQUENTIAL);
 #endif
-	callsql(SQL_NULL_HENV, SQL_NULL_HDBC, q->hstmt,
-		SQLFreeStmt(q->hstmt, SQL_DROP), "SQLFreeStmt(SQL_DROP)");
-	q->hstmt = SQL_NULL_HSTMT;
-	unlink_stmt(q);
-	rb_raise(Cerror, "%s", msg);
     }
-#ifdef UNICODE
+    close(fd);
+#else
+    im->data = rb_funcall(rb_cFile, IDbinread, 1, im->path);
+    rb_str_modify(im->data);
+    im->map = RSTRING_PTR(im->data);
+    im->size = RSTRING_LEN(im->data);
+#endif
+}
+
+static VALUE
+import_run(VALUE arg)
+{
+    IMPORT *im = (IMPORT *) arg;
+    BATCH *b = &im->b;
+    STMT *q = b->q;
+    char *p, *end;
+    long n = 0, nf;
+    int i;
+
+    import_map(im);
+    p = im->map;
+    end = p + im->size;
+
     for (i = 0; i < q->nump; i++) {
-	if (q->paraminfo[i].tofree != NULL) {
-	    uc_free(q->paraminfo[i].tofree);
-	    q->paraminfo[i].tofree = NULL;
+	BATCHCOL *col = &b->cols[i];
+
+	col->ctype = import_ctype(q->paraminfo[i].type);
+	col->width = batch_fixed_width(col->ctype);
+	if (col->width == 0) {
+	    col->width = LEN_ALIGN(32);
 	}
+	col->lens = ALLOC_N(SQLLEN, b->nrows);
+	col->data = ALLOC_N(char, col->width * b->nrows);
     }
-#endif
-    if (!has_out_parms) {
-	callsql(SQL_NULL_HENV, SQL_NULL_HDBC, q->hstmt,
-		SQLFreeStmt(q->hstmt, SQL_RESET_PARAMS),
-		"SQLFreeStmt(SQL_RESET_PARAMS)");
+    if (im->header && (p < end)) {
+	import_record(im, &p, end);
     }
-    if (ret == SQL_NO_DATA) {
-	return Qnil;
+    while (p < end) {
+	long line = im->lineno + 1;
+	int ok = 1;
+
+	if ((*p == '\n') || ((*p == '\r') && (p + 1 < end) && (p[1] == '\n'))) {
+	    /* empty line */
+	    p += (*p == '\n') ? 1 : 2;
+	    im->lineno++;
+	    continue;
+	}
+	nf = import_record(im, &p, end);
+	for (i = 0; ok && (i < q->nump); i++) {
+	    long f = im->cols[i];
+
+	    if (f >= nf) {
+		ok = 0;
+	    } else if (im->fnull[f]) {
+		b->cols[i].lens[n] = SQL_NULL_DATA;
+	    } else {
+		ok = import_put(im, i, n, im->fptr[f], im->flen[f]);
+	    }
+	}
+	if (!ok) {
+	    rb_ary_push(im->errors, LONG2NUM(line));
+	    continue;
+	}
+	im->lines[n++] = line;
+	if (n == b->nrows) {
+	    import_exec(im, n);
+	    n = 0;
+	}
+    }
+    if (n > 0) {
+	import_exec(im, n);
     }
-    return make_result(q->dbc, q->hstmt, self, mode);
+    return Qnil;
 }
 
 static VALUE
-stmt_exec(int argc, VALUE *argv, VALUE self)
+import_ensure(VALUE arg)
 {
-    return stmt_exec_int(argc, argv, self, MAKERES_BLOCK);
+    IMPORT *im = (IMPORT *) arg;
+
+    batch_cleanup((VALUE) &im->b);
+#ifdef HAVE_MMAP
+    if (im->mapped) {
+	munmap(im->map, im->size);
+    }
+#endif
+    xfree(im->cols);
+    xfree(im->fptr);
+    xfree(im->flen);
+    xfree(im->fnull);
+    xfree(im->lines);
+    return Qnil;
 }
 
 static VALUE
-stmt_run(int argc, VALUE *argv, VALUE self)
+import_body(VALUE arg)
 {
-    if (argc < 1) {
-	rb_raise(rb_eArgError, "wrong # of arguments");
+    return rb_ensure(import_run, arg, import_ensure, arg);
+}
+
+/* Rows of earlier batches stay inserted, tell how many. */
+
+static VALUE
+import_failed(VALUE arg, VALUE err)
+{
+    IMPORT *im = (IMPORT *) arg;
+
+    rb_iv_set(err, "@inserted", LONG2NUM(im->inserted));
+    rb_exc_raise(err);
+    return Qnil;
+}
+
+#endif
+
+static VALUE
+stmt_exec_batch(VALUE self, VALUE rows)
+{
+#if (ODBCVER >= 0x0300)
+    STMT *q;
+    BATCH b;
+    long k;
+    int i;
+
+    ODBC_Get_Struct(self, STMT, stmt_type, q);
+    Check_Type(rows, T_ARRAY);
+    batch_check(q);
+    b.nrows = RARRAY_LEN(rows);
+    for (k = 0; k < b.nrows; k++) {
+	VALUE row = rb_ary_entry(rows, k);
+
+	Check_Type(row, T_ARRAY);
+	if (RARRAY_LEN(row) > q->nump) {
+	    rb_raise(Cerror, "%s", set_err("Too much parameters", 0));
+	}
     }
-    if (argc == 1) {
-	return stmt_prep_int(1, argv, self,
-			     MAKERES_EXECD | MAKERES_BLOCK);
+    if (b.nrows == 0) {
+	return rb_ary_new();
     }
-    return stmt_exec(argc - 1, argv + 1, stmt_prep_int(1, argv, self, 0));
+    batch_reset(q);
+    b.q = q;
+    b.rows = rows;
+    b.processed = 0;
+    b.bound = 0;
+    b.stat = ALLOC_N(SQLUSMALLINT, b.nrows);
+    b.cols = ALLOC_N(BATCHCOL, q->nump);
+    for (i = 0; i < q->nump; i++) {
+	b.cols[i].data = NULL;
+	b.cols[i].lens = NULL;
+    }
+    return rb_ensure(batch_run, (VALUE) &b, batch_cleanup, (VALUE) &b);
+#else
+    rb_raise(Cerror, "%s", set_err("Unsupported in ODBC < 3.0", 0));
+    return Qnil;
+#endif
 }
 
 static VALUE
-stmt_do(int argc, VALUE *argv, VALUE self)
+stmt_import_csv(int argc, VALUE *argv, VALUE self)
 {
-    VALUE stmt;
+#if (ODBCVER >= 0x0300)
+    STMT *q;
+    IMPORT im;
+    VALUE path, opts, sep, quote, null, cols, batch;
+    int i;
 
-    if (argc < 1) {
-	rb_raise(rb_eArgError, "wrong # of arguments");
+    rb_scan_args(argc, argv, "11", &path, &opts);
+    sep = quote = null = cols = batch = Qnil;
+    memset(&im, 0, sizeof (im));
+    if (opts != Qnil) {
+	Check_Type(opts, T_HASH);
+	sep = rb_hash_aref(opts, ID2SYM(IDsep));
+	quote = rb_hash_aref(opts, ID2SYM(IDquote));
+	null = rb_hash_aref(opts, ID2SYM(IDnull));
+	cols = rb_hash_aref(opts, ID2SYM(IDcolumns));
+	batch = rb_hash_aref(opts, ID2SYM(IDbatch));
+	im.header = RTEST(rb_hash_aref(opts, ID2SYM(IDheader)));
+    }
+    sep = (sep == Qnil) ? rb_str_new2(",") : rb_String(sep);
+    quote = (quote == Qnil) ? rb_str_new2("\"") : rb_String(quote);
+    null = (null == Qnil) ? rb_str_new2("") : rb_String(null);
+    if (RSTRING_LEN(sep) < 1) {
+	rb_raise(rb_eArgError, "empty separator");
+    }
+    if (RSTRING_LEN(quote) > 1) {
+	rb_raise(rb_eArgError, "quote must be a single character");
+    }
+    im.b.nrows = (batch == Qnil) ? 1000 : NUM2LONG(batch);
+    if (im.b.nrows <= 0) {
+	rb_raise(rb_eArgError, "batch must be positive");
+    }
+    FilePathValue(path);
+    im.path = path;
+    ODBC_Get_Struct(self, STMT, stmt_type, q);
+    batch_check(q);
+    if ((cols != Qnil) &&
+	((TYPE(cols) != T_ARRAY) || (RARRAY_LEN(cols) != q->nump))) {
+	rb_raise(Cerror, "%s",
+		 set_err("Need one column number per parameter", 0));
     }
-    if (argc == 1) {
-	stmt = stmt_prep_int(1, argv, self,
-			     MAKERES_EXECD | MAKERES_BLOCK | MAKERES_NOCLOSE);
-    } else {
-	stmt = stmt_prep_int(1, argv, self, 0);
-	stmt_exec_int(argc - 1, argv + 1, stmt,
-		      MAKERES_BLOCK | MAKERES_NOCLOSE);
+    for (i = 0; i < q->nump; i++) {
+	long f = (cols == Qnil) ? i : NUM2LONG(rb_ary_entry(cols, i));
+
+	if ((f < 0) || (f > 0xffff)) {
+	    rb_raise(rb_eArgError, "invalid column number");
+	}
+	if (f >= im.maxf) {
+	    im.maxf = f + 1;
+	}
     }
-    return rb_ensure(stmt_nrows, stmt, stmt_drop, stmt);
+    batch_reset(q);
+    im.sep = RSTRING_PTR(sep);
+    im.seplen = RSTRING_LEN(sep);
+    im.quote = (RSTRING_LEN(quote) > 0) ?
+	(unsigned char) RSTRING_PTR(quote)[0] : -1;
+    im.null = RSTRING_PTR(null);
+    im.nulllen = RSTRING_LEN(null);
+    im.errors = rb_ary_new();
+    im.cols = ALLOC_N(long, q->nump);
+    for (i = 0; i < q->nump; i++) {
+	im.cols[i] = (cols == Qnil) ? i : NUM2LONG(rb_ary_entry(cols, i));
+    }
+    im.fptr = ALLOC_N(char *, im.maxf);
+    im.flen = ALLOC_N(SQLLEN, im.maxf);
+    im.fnull = ALLOC_N(char, im.maxf);
+    im.lines = ALLOC_N(long, im.b.nrows);
+    im.b.q = q;
+    im.b.rows = Qnil;
+    im.b.processed = 0;
+    im.b.bound = 0;
+    im.b.stat = ALLOC_N(SQLUSMALLINT, im.b.nrows);
+    im.b.cols = ALLOC_N(BATCHCOL, q->nump);
+    for (i = 0; i < q->nump; i++) {
+	im.b.cols[i].data = NULL;
+	im.b.cols[i].lens = NULL;
+    }
+    rb_rescue2(import_body, (VALUE) &im, import_failed, (VALUE) &im,
+	       Cerror, (VALUE) 0);
+    /* the importer points into these */
+    RB_GC_GUARD(opts);
+    RB_GC_GUARD(sep);
+    RB_GC_GUARD(quote);
+    RB_GC_GUARD(null);
+    return rb_ary_new3(2, LONG2NUM(im.inserted), im.errors);
+#else
+    rb_raise(Cerror, "%s", set_err("Unsupported in ODBC < 3.0", 0));
+    return Qnil;
+#endif
 }
 
 static VALUE
@@ -7506,12 +14096,15 @@ stmt_ignorecase(int argc, VALUE *argv, VALUE self)
     if (rb_obj_is_kind_of(self, Cstmt) == Qtrue) {
 	STMT *q;
 
-	Data_Get_Struct(self, STMT, q);
+	ODBC_Get_Struct(self, STMT, stmt_type, q);
+	if ((argc > 0) && (!q->upc != !RTEST(onoff))) {
+	    desc_clear(q);
+	}
 	flag = &q->upc;
     } else if (rb_obj_is_kind_of(self, Cdbc) == Qtrue) {
 	DBC *p;
 
-	Data_Get_Struct(self, DBC, p);
+	ODBC_Get_Struct(self, DBC, dbc_type, p);
 	flag = &p->upc;
     } else {
 	rb_raise(rb_eTypeError, "ODBC::Statement or ODBC::Database expected");
@@ -7537,7 +14130,7 @@ stmt_new(VALUE self)
     SQLHSTMT hstmt;
     char *msg = NULL;
 
-    Data_Get_Struct(self, DBC, p);
+    ODBC_Get_Struct(self, DBC, dbc_type, p);
     if (!succeeded(SQL_NULL_HENV, p->hdbc, SQL_NULL_HSTMT,
 		   SQLAllocStmt(p->hdbc, &hstmt),
 		   &msg, "SQLAllocStmt")) {
@@ -7820,6 +14413,20 @@ mod_trace(int argc, VALUE *argv, VALUE self)
 #endif
 }
 
+static VALUE
+mod_gcinterval(int argc, VALUE *argv, VALUE self)
+{
+    VALUE v = Qnil;
+
+    rb_scan_args(argc, argv, "01", &v);
+    if (argc > 0) {
+	int n = NUM2INT(v);
+
+	gcinterval = (n < 0) ? 0 : n;
+    }
+    return INT2NUM(gcinterval);
+}
+
 /*
  *----------------------------------------------------------------------
  *
@@ -8008,6 +14615,19 @@ static struct {
     O_CONST(SQL_PARAM_OUTPUT),
     O_CONST(SQL_PARAM_INPUT_OUTPUT),
     O_CONST(SQL_DEFAULT_PARAM),
+#ifdef SQL_PARAM_SUCCESS
+    O_CONST(SQL_PARAM_SUCCESS),
+    O_CONST(SQL_PARAM_SUCCESS_WITH_INFO),
+    O_CONST(SQL_PARAM_ERROR),
+    O_CONST(SQL_PARAM_UNUSED),
+    O_CONST(SQL_PARAM_DIAG_UNAVAILABLE),
+#else
+    O_CONST2(SQL_PARAM_SUCCESS, 0),
+    O_CONST2(SQL_PARAM_SUCCESS_WITH_INFO, 6),
+    O_CONST2(SQL_PARAM_ERROR, 5),
+    O_CONST2(SQL_PARAM_UNUSED, 7),
+    O_CONST2(SQL_PARAM_DIAG_UNAVAILABLE, 1),
+#endif
     O_CONST(SQL_RETURN_VALUE),
     O_CONST(SQL_RESULT_COL),
     O_CONST(SQL_PT_UNKNOWN),
@@ -8023,8 +14643,8 @@ static struct {
     const char *str;
 } ids[] = {
     { &IDstart, "start" },
-    { &IDatatinfo, "@@info" },
-    { &IDataterror, "@@error" },
+    { &IDodbcinfo, "__odbc_info__" },
+    { &IDodbcerror, "__odbc_error__" },
     { &IDkeys, "keys" },
     { &IDatattrs, "@attrs" },
     { &IDday, "day" },
@@ -8035,6 +14655,10 @@ static struct {
     { &IDusec, "usec" },
     { &IDsec, "sec" },
     { &IDmin, "min" },
+    { &IDmax, "max" },
+    { &IDtimeout, "timeout" },
+    { &IDidle_timeout, "idle_timeout" },
+    { &IDvalidate, "validate" },
     { &IDhour, "hour" },
     { &IDusec, "usec" },
     { &IDkeyp, "key?" },
@@ -8044,6 +14668,7 @@ static struct {
     { &IDFixnum, "Fixnum" },
     { &IDtable_names, "table_names" },
     { &IDnew, "new" },
+    { &IDjd, "jd" },
     { &IDnow, "now" },
     { &IDlocal, "local" },
     { &IDname, "name" },
@@ -8067,10 +14692,26 @@ static struct {
 #ifdef USE_RB_ENC
     { &IDencode, "encode" },
 #endif
-    { &IDparse, "parse" },
     { &IDutc, "utc" },
     { &IDlocal, "local" },
-    { &IDto_s, "to_s" }
+    { &IDto_s, "to_s" },
+    { &IDwrite, "write" },
+    { &IDread, "read" },
+    { &IDBigDecimal, "BigDecimal" },
+    { &IDbatch_rows, "batch_rows" },
+    { &IDsep, "sep" },
+    { &IDquote, "quote" },
+    { &IDnull, "null" },
+    { &IDheader, "header" },
+    { &IDbinmodep, "binmode?" },
+    { &IDfileno, "fileno" },
+    { &IDcolumns, "columns" },
+    { &IDbatch, "batch" },
+    { &IDbinread, "binread" },
+    { &IDparallelism, "parallelism" },
+    { &IDjoin, "join" },
+    { &IDstatuses, "statuses" },
+    { &IDinserted, "inserted" }
 };
 
 /*
@@ -8113,6 +14754,9 @@ Init_odbc_ext()
     for (i = 0; i < (int) (sizeof (ids) / sizeof (ids[0])); i++) {
 	*(ids[i].idp) = rb_intern(ids[i].str);
     }
+#ifdef UNICODE
+    uc_init_simd();
+#endif
 
     Modbc = rb_define_module(modname);
 
@@ -8120,13 +14764,14 @@ Init_odbc_ext()
     rb_define_const(Modbc, "VERSION", rb_str_new2(VERSION) );
 
     Cobj = rb_define_class_under(Modbc, "Object", rb_cObject);
-    rb_define_class_variable(Cobj, "@@error", Qnil);
-    rb_define_class_variable(Cobj, "@@info", Qnil);
+    diag_dbcs = st_init_numtable();
+    diag_stmts = st_init_numtable();
 
     Cenv = rb_define_class_under(Modbc, "Environment", Cobj);
     Cdbc = rb_define_class_under(Modbc, "Database", Cenv);
     Cstmt = rb_define_class_under(Modbc, "Statement", Cdbc);
     rb_include_module(Cstmt, rb_mEnumerable);
+    Cpool = rb_define_class_under(Modbc, "Pool", Cobj);
 
     Ccolumn = rb_define_class_under(Modbc, "Column", Cobj);
     rb_attr(Ccolumn, IDname, 1, 0, Qfalse);
@@ -8157,6 +14802,8 @@ Init_odbc_ext()
     rb_attr(Cdrv, IDattrs, 1, 1, Qfalse);
 
     Cerror = rb_define_class_under(Modbc, "Error", rb_eStandardError);
+    rb_attr(Cerror, IDstatuses, 1, 0, Qfalse);
+    rb_attr(Cerror, IDinserted, 1, 0, Qfalse);
 
     Cproc = rb_define_class("ODBCProc", rb_cProc);
 
@@ -8170,12 +14817,15 @@ Init_odbc_ext()
     /* module functions */
     rb_define_module_function(Modbc, "trace", mod_trace, -1);
     rb_define_module_function(Modbc, "trace=", mod_trace, -1);
+    rb_define_module_function(Modbc, "gc_interval", mod_gcinterval, -1);
+    rb_define_module_function(Modbc, "gc_interval=", mod_gcinterval, -1);
     rb_define_module_function(Modbc, "connect", mod_connect, -1);
     rb_define_module_function(Modbc, "datasources", dbc_dsns, 0);
     rb_define_module_function(Modbc, "drivers", dbc_drivers, 0);
     rb_define_module_function(Modbc, "error", dbc_error, 0);
     rb_define_module_function(Modbc, "info", dbc_warn, 0);
     rb_define_module_function(Modbc, "clear_error", dbc_clrerror, 0);
+    rb_define_module_function(Modbc, "stats", mod_stats, -1);
     rb_define_module_function(Modbc, "newenv", env_new, 0);
     rb_define_module_function(Modbc, "to_time", mod_2time, -1);
     rb_define_module_function(Modbc, "to_date", mod_2date, 1);
@@ -8209,6 +14859,7 @@ Init_odbc_ext()
 
     /* common (Cenv) methods */
     rb_define_method(Cenv, "connect", dbc_new, -1);
+    rb_define_method(Cenv, "connect_many", env_connect_many, -1);
     rb_define_method(Cenv, "environment", env_of, 0);
     rb_define_method(Cenv, "transaction", dbc_transaction, 0);
     rb_define_method(Cenv, "commit", dbc_commit, 0);
@@ -8217,9 +14868,19 @@ Init_odbc_ext()
     rb_define_method(Cenv, "connection_pooling=", env_cpooling, -1);
     rb_define_method(Cenv, "cp_match", env_cpmatch, -1);
     rb_define_method(Cenv, "cp_match=", env_cpmatch, -1);
+    rb_define_method(Cenv, "pool", pool_new, -1);
     rb_define_method(Cenv, "odbc_version", env_odbcver, -1);
     rb_define_method(Cenv, "odbc_version=", env_odbcver, -1);
 
+    /* connection pool methods */
+    rb_define_singleton_method(Cpool, "new", pool_new, -1);
+    rb_define_method(Cpool, "checkout", pool_checkout, 0);
+    rb_define_method(Cpool, "checkin", pool_checkin, 1);
+    rb_define_method(Cpool, "with", pool_with, 0);
+    rb_define_method(Cpool, "reap", pool_reap, 0);
+    rb_define_method(Cpool, "shutdown", pool_shutdown, 0);
+    rb_define_method(Cpool, "stats", pool_stats, 0);
+
     /* management things (odbcinst.h) */
     rb_define_module_function(Modbc, "add_dsn", dbc_adddsn, -1);
     rb_define_module_function(Modbc, "config_dsn", dbc_confdsn, -1);
@@ -8248,11 +14909,19 @@ Init_odbc_ext()
     rb_define_method(Cdbc, "prepare", stmt_prep, -1);
     rb_define_method(Cdbc, "run", stmt_run, -1);
     rb_define_method(Cdbc, "do", stmt_do, -1);
+    rb_define_method(Cdbc, "stmt_cache_size", dbc_stmtcache, -1);
+    rb_define_method(Cdbc, "stmt_cache_size=", dbc_stmtcache, -1);
+    rb_define_method(Cdbc, "stmt_cache_stats", dbc_stmtcachestats, 0);
+    rb_define_method(Cdbc, "stats", dbc_stats, -1);
     rb_define_method(Cdbc, "proc", stmt_proc, -1);
     rb_define_method(Cdbc, "use_time", dbc_timefmt, -1);
     rb_define_method(Cdbc, "use_time=", dbc_timefmt, -1);
     rb_define_method(Cdbc, "use_utc", dbc_timeutc, -1);
     rb_define_method(Cdbc, "use_utc=", dbc_timeutc, -1);
+    rb_define_method(Cdbc, "use_bigdecimal", dbc_bigdec, -1);
+    rb_define_method(Cdbc, "use_bigdecimal=", dbc_bigdec, -1);
+    rb_define_method(Cdbc, "use_warnings", dbc_warnings, -1);
+    rb_define_method(Cdbc, "use_warnings=", dbc_warnings, -1);
 
     /* connection options */
     rb_define_method(Cdbc, "get_option", dbc_getsetoption, -1);
@@ -8268,6 +14937,7 @@ Init_odbc_ext()
     rb_define_method(Cdbc, "maxlength", dbc_maxlength, -1);
     rb_define_method(Cdbc, "maxlength=", dbc_maxlength, -1);
     rb_define_method(Cdbc, "rowsetsize", dbc_rowsetsize, -1);
+    rb_define_method(Cdbc, "rowsetsize=", dbc_rowsetsize, -1);
     rb_define_method(Cdbc, "cursortype", dbc_cursortype, -1);
     rb_define_method(Cdbc, "cursortype=", dbc_cursortype, -1);
     rb_define_method(Cdbc, "noscan", dbc_noscan, -1);
@@ -8290,6 +14960,7 @@ Init_odbc_ext()
     rb_define_method(Cstmt, "param_output_value", stmt_param_output_value, -1);
     rb_define_method(Cstmt, "ncols", stmt_ncols, 0);
     rb_define_method(Cstmt, "nrows", stmt_nrows, 0);
+    rb_define_method(Cstmt, "stats", stmt_stats, -1);
     rb_define_method(Cstmt, "nparams", stmt_nparams, 0);
     rb_define_method(Cstmt, "cursorname", stmt_cursorname, -1);
     rb_define_method(Cstmt, "cursorname=", stmt_cursorname, -1);
@@ -8304,9 +14975,16 @@ Init_odbc_ext()
     rb_define_method(Cstmt, "fetch_first_hash", stmt_fetch_first_hash, 0);
     rb_define_method(Cstmt, "fetch_many", stmt_fetch_many, 1);
     rb_define_method(Cstmt, "fetch_all", stmt_fetch_all, 0);
+    rb_define_method(Cstmt, "fetch_columns", stmt_fetch_columns, -1);
+    rb_define_method(Cstmt, "to_arrow_ipc", stmt_to_arrow_ipc, -1);
+    rb_define_method(Cstmt, "export_csv", stmt_export_csv, -1);
+    rb_define_method(Cstmt, "next_row", stmt_next_row, 0);
+    rb_define_method(Cstmt, "get_data", stmt_get_data, -1);
     rb_define_method(Cstmt, "each", stmt_each, 0);
     rb_define_method(Cstmt, "each_hash", stmt_each_hash, -1);
     rb_define_method(Cstmt, "execute", stmt_exec, -1);
+    rb_define_method(Cstmt, "execute_batch", stmt_exec_batch, 1);
+    rb_define_method(Cstmt, "import_csv", stmt_import_csv, -1);
     rb_define_method(Cstmt, "make_proc", stmt_procwrap, -1);
     rb_define_method(Cstmt, "more_results", stmt_more_results, 0);
     rb_define_method(Cstmt, "prepare", stmt_prep, -1);
@@ -8329,6 +15007,7 @@ Init_odbc_ext()
     rb_define_method(Cstmt, "noscan", stmt_noscan, -1);
     rb_define_method(Cstmt, "noscan=", stmt_noscan, -1);
     rb_define_method(Cstmt, "rowsetsize", stmt_rowsetsize, -1);
+    rb_define_method(Cstmt, "rowsetsize=", stmt_rowsetsize, -1);
 
     /* data type methods */
 #ifdef HAVE_RB_DEFINE_ALLOC_FUNC
@@ -155,4 +155,32 @@ else
     have_func("SQLInstallerErrorW", "odbcinst.h")
 end
 
+if have_header("ruby/thread.h") then
+  have_func("rb_thread_call_without_gvl2", "ruby/thread.h")
+  have_func("rb_thread_call_without_gvl", "ruby/thread.h")
+end
+
+if have_header("ruby/fiber/scheduler.h") then
+  have_func("rb_fiber_scheduler_current", "ruby/fiber/scheduler.h")
+end
+have_header("ruby/st.h")
+
+if defined? have_struct_member then
+  have_struct_member("rb_data_type_t", "function", "ruby.h")
+end
+
+have_header("emmintrin.h")
+have_header("immintrin.h")
+have_func("rb_hash_bulk_insert", "ruby.h")
+have_func("rb_str_to_interned_str", "ruby.h")
+have_func("rb_integer_pack", "ruby.h")
+have_func("rb_time_nano_new", "ruby.h")
+have_func("rb_time_timespec_new", "ruby.h")
+have_func("localtime_r", "time.h")
+have_func("gmtime_r", "time.h")
+have_func("rb_time_timespec", "ruby.h")
+have_func("rb_time_utc_offset", "ruby.h")
+have_func("mmap", "sys/mman.h")
+have_func("clock_gettime", "time.h")
+
 create_makefile("odbc_utf8_ext")
@@ -4,3 +4,90 @@ $q.run("insert into test (id, str) values (2, 'bar')")
 $p = $c.proc("insert into test (id, str) values (?, ?)") {}
 $p.call(3, "FOO")
 $p[4, "BAR"]
+
+$q = $c.prepare("insert into test (id, str) values (?, ?)")
+if $q.execute_batch([[5, "baz"], [6, "BAZ"]]) !=
+   [ODBC::SQL_PARAM_SUCCESS, ODBC::SQL_PARAM_SUCCESS] then
+  raise "execute_batch: failed"
+end
+if $c.do("delete from test where id > 4") != 2 then
+  raise "execute_batch: failed"
+end
+# str is not null, the second row must fail
+begin
+  st = $q.execute_batch([[5, "baz"], [6, nil]])
+rescue ODBC::Error => e
+  st = e.statuses
+end
+if !st.is_a?(Array) || st.size != 2 || st[1] == ODBC::SQL_PARAM_SUCCESS then
+  raise "execute_batch: failed"
+end
+$q.drop
+$c.do("delete from test where id > 4")
+
+require 'stringio'
+$q = $c.prepare("insert into test (id, str) values (?, ?)")
+$q.execute(5, StringIO.new("baz"))
+# not a stream, bound as string
+o = Object.new
+o.extend(Enumerable)
+def o.each; yield "B"; end
+def o.to_str; "BAZ"; end
+$q.execute(6, o)
+$q.drop
+$q = $c.run("select str from test where id > 4 order by id")
+if $q.fetch_all != [["baz"], ["BAZ"]] then raise "data-at-exec: failed" end
+$q.drop
+if $c.do("delete from test where id > 4") != 2 then
+  raise "data-at-exec: failed"
+end
+
+require 'tempfile'
+f = Tempfile.new("odbc")
+f.write("str;id\n\"b;az\";5\n\nBAZ;6\n")
+f.close
+$q = $c.prepare("insert into test (id, str) values (?, ?)")
+if $q.import_csv(f.path, :sep => ";", :header => true,
+                 :columns => [1, 0], :batch => 1) != [2, []] then
+  raise "import_csv: failed"
+end
+begin
+  $q.import_csv(f.path + "\0x")
+  raise "import_csv: failed"
+rescue ArgumentError
+end
+$q.drop
+f.unlink
+if $c.do("delete from test where id > 4") != 2 then
+  raise "import_csv: failed"
+end
+
+# Integers beyond 32 bits, Bignums and values over 64 bits (SQL_C_NUMERIC)
+big = [[1, 2**40, 2**40], [2, 2**63 - 1, 2**64 + 1], [3, -2**63, -(10**37 + 7)]]
+$c.run("create table test_big (id int not null, b bigint, n decimal(38,0))")
+$q = $c.prepare("insert into test_big (id, b, n) values (?, ?, ?)")
+big.each {|r| $q.execute(*r)}
+$q.drop
+$c.use_bigdecimal = true
+$q = $c.run("select id, b, n from test_big order by id")
+r = $q.fetch_all
+$q.drop
+$c.use_bigdecimal = false
+if r != big then raise "bignum: failed" end
+$c.run("drop table test_big")
+
+# Time parameters are bound with the wall clock fields of their zone
+$c.run("create table test_time (id int not null, d date, ts timestamp)")
+$q = $c.prepare("insert into test_time (id, d, ts) values (?, ?, ?)")
+$q.execute(1, Date.new(2020, 2, 29), Time.local(2021, 3, 4, 5, 6, 7))
+$q.execute(2, Date.new(1969, 12, 31),
+           Time.new(2021, 3, 4, 5, 6, 7, "+09:00"))
+$q.drop
+$q = $c.run("select d, ts from test_time order by id")
+r = $q.fetch_all.map {|d, ts| [d.to_s, ts.to_s[0, 19]]}
+$q.drop
+if r != [["2020-02-29", "2021-03-04 05:06:07"],
+         ["1969-12-31", "2021-03-04 05:06:07"]] then
+  raise "time parameters: failed"
+end
+$c.run("drop table test_time")
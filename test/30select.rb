@@ -10,6 +10,18 @@ if $q.fetch != [3, "FOO"] then raise "fetch: failed" end
 if $q.fetch != [4, "BAR"] then raise "fetch: failed" end
 if $q.fetch != nil then raise "fetch: failed" end
 $q.close
+st = $q.stats(true)
+if st[:executes] != 1 || st[:rows] != 4 || $q.stats[:rows] != 0 then
+  raise "stats: failed"
+end
+if ODBC.stats[:rows] < 4 then raise "stats: failed" end
+st = $c.stats
+$c.run("select id from test").drop
+$c.prepare("select id, str from test where id < ?").drop
+st2 = $c.stats
+if st2[:executes] < st[:executes] + 1 || st2[:prepares] < st[:prepares] + 1 then
+  raise "stats: failed"
+end
 
 if $q.execute.entries != [[1, "foo"], [2, "bar"], [3, "FOO"], [4, "BAR"]] then
   raise "fetch: failed"
@@ -27,6 +39,20 @@ if $q.fetch_many(3) != [[3, "FOO"], [4, "BAR"]] then raise "fetch: failed" end
 if $q.fetch_many(99) != nil then raise "fetch: failed" end
 $q.close
 
+$q.rowsetsize = 3
+if $q.rowsetsize != 3 then raise "rowsetsize: failed" end
+$q.execute
+if $q.fetch != [1, "foo"] then raise "fetch: failed" end
+if $q.fetch_many(2) != [[2, "bar"], [3, "FOO"]] then raise "fetch: failed" end
+if $q.fetch_hash.size != 2 then raise "fetch: failed" end
+if $q.fetch != nil then raise "fetch: failed" end
+$q.close
+if $q.execute.fetch_all != [[1, "foo"], [2, "bar"], [3, "FOO"], [4, "BAR"]] then
+  raise "fetch: failed"
+end
+$q.close
+$q.rowsetsize = 1
+
 a = []
 $q.execute {|r| a=r.entries}
 if a.size != 4 then raise "fetch: failed" end
@@ -52,6 +78,29 @@ $q.execute.each_hash(:key=>:Symbol) {|r| a.push(r)}
 if a.size != 4 then raise "fetch: failed" end
 $q.close
 
+# re-executes without close keep the column metadata until an option changes
+k = $q.execute.fetch_hash.keys
+$q.ignorecase = true
+if $q.execute.fetch_hash.keys != k.collect {|x| x.upcase} then
+  raise "ignorecase: failed"
+end
+$q.ignorecase = false
+if $q.execute.fetch_hash.keys != k then raise "ignorecase: failed" end
+$q.rowsetsize = 3
+if $q.execute.fetch_all != [[1, "foo"], [2, "bar"], [3, "FOO"], [4, "BAR"]] then
+  raise "rowsetsize: failed"
+end
+$q.rowsetsize = 2
+if $q.execute.fetch_many(3) != [[1, "foo"], [2, "bar"], [3, "FOO"]] then
+  raise "rowsetsize: failed"
+end
+$q.rowsetsize = 1
+if $q.execute.fetch_all != [[1, "foo"], [2, "bar"], [3, "FOO"], [4, "BAR"]] ||
+   $q.stats[:executes] < 5 then
+  raise "fetch: failed"
+end
+$q.close
+
 a = []
 $q.execute.each_hash(:key=>:Symbol,:table_names=>true) {|r| a.push(r)}
 if a.size != 4 then raise "fetch: failed" end
@@ -67,3 +116,252 @@ $q.execute.each_hash(:key=>:Fixnum,:table_names=>false) {|r| a.push(r)}
 if a.size != 4 then raise "fetch: failed" end
 $q.close
 
+
+$c.stmt_cache_size = 2
+q1 = $c.prepare("select id,str from test where id = ?")
+if q1.execute(1).fetch != [1, "foo"] then raise "fetch: failed" end
+q1.drop
+q2 = $c.prepare("select id,str from test where id = ?")
+if q2.equal?(q1) then raise "stmt_cache: failed" end
+begin
+  q1.execute(1)
+  raise "stmt_cache: stale statement usable"
+rescue ODBC::Error
+end
+if q2.execute(2).fetch != [2, "bar"] then raise "fetch: failed" end
+n = q2.maxrows
+q2.maxrows = n + 1
+q2.drop
+st = $c.stmt_cache_stats
+if st[:hits] != 1 || st[:misses] != 1 || st[:size] != 1 then
+  raise "stmt_cache_stats: failed"
+end
+q2.drop
+q3 = $c.prepare("select id,str from test where id = ?")
+if q3.equal?(q2) || q3.maxrows != n || q3.execute(3).fetch != [3, "FOO"] then
+  raise "stmt_cache: drop twice failed"
+end
+q3.drop
+$c.stmt_cache_size = 0
+if $c.stmt_cache_stats[:size] != 0 then raise "stmt_cache: failed" end
+
+$q = $c.run("select id,str from test order by id")
+a = []
+while $q.next_row
+  s = ""
+  $q.get_data(1, nil, 16) {|chunk| s << chunk}
+  a.push(s)
+end
+if a != ["foo", "bar", "FOO", "BAR"] then raise "get_data: failed" end
+$q.close
+
+# scrolling with row sets moves relative to the current row
+$q = $c.prepare("select id from test order by id")
+$q.cursortype = ODBC::SQL_CURSOR_STATIC
+$q.rowsetsize = 3
+$q.execute
+if $q.fetch != [1] || $q.fetch != [2] ||
+   $q.fetch_scroll(ODBC::SQL_FETCH_LAST) != [4] ||
+   $q.fetch_scroll(ODBC::SQL_FETCH_ABSOLUTE, 2) != [2] ||
+   $q.fetch != [3] ||
+   $q.fetch_scroll(ODBC::SQL_FETCH_PRIOR) != [2] ||
+   $q.fetch_scroll(ODBC::SQL_FETCH_RELATIVE, 2) != [4] ||
+   $q.fetch != nil ||
+   $q.fetch_scroll(ODBC::SQL_FETCH_PRIOR) != [4] then
+  raise "fetch_scroll: failed"
+end
+$q.drop
+
+# truncation warnings must survive the driver calls which follow
+$q = $c.run("select str from test where id = 1")
+$q.next_row
+w = []
+$q.get_data(1, nil, 2) {|chunk| w.push($q.info)}
+if !w[0].is_a?(Array) || w[0].grep(/^01004/).empty? then
+  raise "info: failed"
+end
+$q.close
+$c.use_warnings = false
+$q = $c.run("select str from test where id = 1")
+$q.next_row
+w = []
+$q.get_data(1, nil, 2) {|chunk| w.push($q.info)}
+if w.compact != [] then raise "use_warnings: failed" end
+$q.close
+$c.use_warnings = true
+
+$q = $c.run("select id,str from test order by id")
+k1 = $q.fetch_hash!(:key=>:Symbol).keys
+k2 = $q.fetch_hash!(:key=>:Symbol).keys
+if k1.size != 2 || k1 != k2 then raise "fetch_hash!: failed" end
+$q.close
+
+$q = $c.prepare("select id,str from test order by id")
+$q.rowsetsize = 3
+$q.execute
+a = $q.fetch_columns(2)
+b = $q.fetch_columns
+if a != [[1, 2], ["foo", "bar"]] || b != [[3, 4], ["FOO", "BAR"]] then
+  raise "fetch_columns: failed"
+end
+if $q.fetch_columns then raise "fetch_columns: failed" end
+$q.execute
+a = $q.fetch_columns(nil, true)
+if a[0].unpack("l*") != [1, 2, 3, 4] then raise "fetch_columns: failed" end
+$q.drop
+
+require 'stringio'
+$q = $c.run("select id,str from test order by id")
+io = StringIO.new("".b)
+if $q.to_arrow_ipc(io, :batch_rows => 3) != 4 then
+  raise "to_arrow_ipc: failed"
+end
+if io.string[0, 4] != "\xff\xff\xff\xff".b ||
+   io.string[-8, 8] != "\xff\xff\xff\xff\x00\x00\x00\x00".b then
+  raise "to_arrow_ipc: failed"
+end
+$q.close
+# decode messages: schema with Int and Utf8 fields, batches of 3 and 1 rows
+fb_field = lambda do |b, tbl, id|
+  vt = tbl - b[tbl, 4].unpack1("l<")
+  next nil if 4 + 2 * id >= b[vt, 2].unpack1("S<")
+  o = b[vt + 4 + 2 * id, 2].unpack1("S<")
+  (o == 0) ? nil : tbl + o
+end
+fb_ref = lambda {|b, pos| pos + b[pos, 4].unpack1("L<")}
+arrow_msgs = lambda do |s|
+  msgs = []
+  pos = 0
+  loop do
+    len = s[pos + 4, 4].unpack1("l<")
+    break if len == 0
+    meta = s[pos + 8, len]
+    msg = fb_ref.call(meta, 0)
+    type = meta[fb_field.call(meta, msg, 1), 1].unpack1("C")
+    hdr = fb_ref.call(meta, fb_field.call(meta, msg, 2))
+    f = fb_field.call(meta, msg, 3)
+    body = f ? meta[f, 8].unpack1("q<") : 0
+    if type == 1
+      vec = fb_ref.call(meta, fb_field.call(meta, hdr, 1))
+      info = (0...meta[vec, 4].unpack1("L<")).map do |i|
+        fld = fb_ref.call(meta, vec + 4 + 4 * i)
+        meta[fb_field.call(meta, fld, 2), 1].unpack1("C")
+      end
+    else
+      info = meta[fb_field.call(meta, hdr, 0), 8].unpack1("q<")
+    end
+    msgs.push([type, info])
+    pos += 8 + len + body
+  end
+  msgs
+end
+if arrow_msgs.call(io.string) != [[1, [2, 5]], [3, 3], [3, 1]] then
+  raise "to_arrow_ipc: failed"
+end
+
+$q = $c.run("select id,str from test order by id")
+io = StringIO.new
+if $q.export_csv(io, :sep => ";", :header => true) != 4 ||
+   io.string.lines[1..-1].join != "1;foo\n2;bar\n3;FOO\n4;BAR\n" then
+  raise "export_csv: failed"
+end
+$q.close
+
+if Fiber.respond_to?(:set_scheduler) then
+  # minimal scheduler, statements poll while it runs other fibers
+  sched = Class.new do
+    def initialize; @ready = []; end
+    def fiber(&blk)
+      f = Fiber.new(:blocking => false, &blk)
+      f.resume
+      f
+    end
+    def kernel_sleep(duration = nil)
+      @ready << Fiber.current
+      Fiber.yield
+    end
+    def block(blocker, timeout = nil)
+      kernel_sleep
+      true
+    end
+    def unblock(blocker, fiber); end
+    def io_wait(io, events, timeout)
+      kernel_sleep
+      events
+    end
+    def close
+      @ready.shift.resume until @ready.empty?
+    end
+  end
+  rows = []
+  Thread.new do
+    Fiber.set_scheduler(sched.new)
+    2.times do |i|
+      Fiber.schedule do
+        q = $c.run("select id from test where id > #{i} order by id")
+        rows[i] = q.fetch_all
+        q.drop
+      end
+    end
+  end.join
+  if rows != [[[1], [2], [3], [4]], [[2], [3], [4]]] then
+    raise "fiber scheduler: failed"
+  end
+end
+
+require 'bigdecimal'
+$c.run("create table test_dec (i decimal(10,0), d decimal(10,2))")
+$q = $c.prepare("insert into test_dec (i, d) values (?, ?)")
+$q.execute(BigDecimal("42"), BigDecimal("-12.34"))
+$q.drop
+$c.use_bigdecimal = true
+$q = $c.run("select i, d from test_dec")
+r = $q.fetch_all
+$q.drop
+if !r[0][0].is_a?(Integer) || r[0][0] != 42 ||
+   !r[0][1].is_a?(BigDecimal) || r[0][1] != BigDecimal("-12.34") then
+  raise "use_bigdecimal: failed"
+end
+$c.use_bigdecimal = false
+$q = $c.run("select d from test_dec")
+r = $q.fetch_all
+$q.drop
+if !r[0][0].is_a?(String) || BigDecimal(r[0][0]) != BigDecimal("-12.34") then
+  raise "use_bigdecimal: failed"
+end
+$c.run("drop table test_dec")
+
+$c.run("create table test_time (d date, ts timestamp)")
+$c.run("insert into test_time (d, ts) " +
+       "values ({d '2020-02-29'}, {ts '2021-03-04 05:06:07'})")
+$c.use_time = true
+$q = $c.run("select d, ts from test_time")
+r = $q.fetch
+$q.drop
+if r != [Date.new(2020, 2, 29), Time.local(2021, 3, 4, 5, 6, 7)] then
+  raise "use_time: failed"
+end
+$c.use_utc = true
+$q = $c.run("select ts from test_time")
+r = $q.fetch
+$q.drop
+$c.use_utc = false
+$c.use_time = false
+if r != [Time.utc(2021, 3, 4, 5, 6, 7)] || !r[0].utc? then
+  raise "use_utc: failed"
+end
+$c.run("drop table test_time")
+
+# statements left to the garbage collector, forced GC during fetches
+require 'objspace'
+n = ODBC.gc_interval
+ODBC.gc_interval = 2
+if ODBC.gc_interval != 2 then raise "gc_interval: failed" end
+20.times { $c.run("select id from test").fetch_all }
+GC.start
+ODBC.gc_interval = n
+$q = $c.run("select id from test order by id")
+if ObjectSpace.memsize_of($q) <= 0 || $q.fetch_all != [[1], [2], [3], [4]] then
+  raise "gc: failed"
+end
+$q.drop
@@ -2,3 +2,23 @@ $q = $c.run("update test set id=0, str='hoge'")
 if $q.nrows != 4 then
   $stderr.print "update row count: expected 4, got ", $q.nrows, "\n"
 end
+ODBC.clear_error
+t = Thread.new do
+  begin
+    $c.run("update no_such_table set id=0")
+  rescue ODBC::Error
+  end
+  ODBC.error
+end
+if t.value.nil? || ODBC.error || $c.error.nil? then
+  raise "error: per thread/connection messages failed"
+end
+t = Thread.new do
+  begin
+    $c.run("update no_such_table set id=0")
+  rescue ODBC::Error
+  end
+  [Thread.current[:__odbc_error__].nil?, Thread.current.key?(:"@@error")]
+end
+if t.value != [false, false] then raise "error: thread local key failed" end
+$c.clear_error
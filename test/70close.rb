@@ -1 +1,38 @@
 $c.disconnect
+$p = ODBC::Pool.new($dsn, $uid, $pwd, :min => 1, :max => 2, :timeout => 0.5)
+if $p.stats[:idle] != 1 then raise "pool: failed" end
+c1 = $p.checkout
+c2 = $p.checkout
+begin
+  $p.checkout
+  raise "pool: timeout failed"
+rescue ODBC::Error
+end
+$p.checkin(c2)
+$p.with {|c| if !c.equal?(c2) then raise "pool: failed" end }
+$p.checkin(c1)
+st = $p.stats
+if st[:size] != 2 || st[:creations] != 2 || st[:timeouts] != 1 then
+  raise "pool: stats failed"
+end
+$p.shutdown
+if $p.stats[:size] != 0 then raise "pool: shutdown failed" end
+cs = ODBC::Environment.new.connect_many([[$dsn, $uid, $pwd]] * 3,
+                                        :parallelism => 2)
+if cs.size != 3 || !cs.all? {|c| c.connected?} then
+  raise "connect_many: failed"
+end
+cs.each {|c| c.disconnect}
+ODBC.clear_error
+begin
+  ODBC::Environment.new.connect_many([[$dsn, $uid, $pwd], ["no_such_dsn_"]])
+  raise "connect_many: failed"
+rescue ODBC::Error
+end
+if !ODBC.error.is_a?(Array) || ODBC.error.empty? then
+  raise "connect_many: error failed"
+end
+$p = ODBC::Pool.new($dsn, $uid, $pwd, :min => 3, :max => 3)
+st = $p.stats
+if st[:idle] != 3 || st[:creations] != 3 then raise "pool: warm up failed" end
+$p.shutdown
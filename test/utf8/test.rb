@@ -20,6 +20,51 @@ begin
     load f
     print "ok\n"
   end
+  # UTF-8 <-> UTF-16 round trips of parameters, SQL text and results,
+  # ASCII runs end around the 16 and 32 unit blocks of the SIMD paths
+  print "roundtrip" + "."*11
+  $stdout.flush
+  $c = ODBC.connect($dsn, $uid, $pwd)
+  $c.run("create table test (id int not null, str varchar(80) not null)")
+  strs = []
+  [15, 16, 17, 31, 32, 33, 64, 65].each do |n|
+    strs.push("x" * n, "x" * n + "\u00e9", "\u00e9" + "x" * n)
+    # surrogate pair across the block end
+    strs.push("x" * (n - 1) + "\u{1f600}" + "y")
+  end
+  strs.push("\u{1f600}", "a\u{10437}b\u{24b62}c", "\u20ac" * 40)
+  $q = $c.prepare("insert into test (id, str) values (?, ?)")
+  strs.each_with_index {|s, i| $q.execute(2 * i, s)}
+  $q.drop
+  strs.each_with_index do |s, i|
+    $c.do("insert into test (id, str) values (#{2 * i + 1}, '#{s}')")
+  end
+  $q = $c.run("select id, str from test order by id")
+  $q.fetch_all.each do |id, s|
+    if s != strs[id / 2] || s.encoding != Encoding::UTF_8 then
+      raise "roundtrip: #{id} failed"
+    end
+  end
+  $q.drop
+  # lone surrogates are passed through if the data source takes them
+  lone = ["\xed\xa0\x80", "x" * 16 + "\xed\xb0\x80",
+          "\xed\xa0\x80" + "x" * 32].collect {|s| s.force_encoding("UTF-8")}
+  $c.do("delete from test")
+  begin
+    lone.each_with_index {|s, i| $c.do("insert into test values (?, ?)", i, s)}
+  rescue ODBC::Error
+    lone = []
+  end
+  $q = $c.run("select id, str from test order by id")
+  $q.fetch_all.each do |id, s|
+    if lone.size > 0 && s.b != lone[id].b then
+      raise "roundtrip: lone surrogate #{id} failed"
+    end
+  end
+  $q.drop
+  $c.do("drop table test")
+  $c.disconnect
+  print "ok\n"
 ensure
   begin
     $c.drop_all unless $c.class != ODBC::Database